@@ -311,14 +311,14 @@ void OBSAdvAudioCtrl::OBSSourceDeactivated(void *param, calldata_t *calldata)
 
 void OBSAdvAudioCtrl::OBSSourceFlagsChanged(void *param, calldata_t *calldata)
 {
-	uint32_t flags = (uint32_t)calldata_int(calldata, "flags");
+	uint32_t flags = (uint32_t)calldata_int_at(calldata, 1, "flags");
 	QMetaObject::invokeMethod(reinterpret_cast<OBSAdvAudioCtrl *>(param),
 				  "SourceFlagsChanged", Q_ARG(uint32_t, flags));
 }
 
 void OBSAdvAudioCtrl::OBSSourceVolumeChanged(void *param, calldata_t *calldata)
 {
-	float volume = (float)calldata_float(calldata, "volume");
+	float volume = (float)calldata_float_at(calldata, 1, "volume");
 	QMetaObject::invokeMethod(reinterpret_cast<OBSAdvAudioCtrl *>(param),
 				  "SourceVolumeChanged", Q_ARG(float, volume));
 }
@@ -84,6 +84,7 @@ bool portable_mode = false;
 static bool multi = false;
 static bool log_verbose = false;
 static bool unfiltered_log = false;
+static bool profiler_trace = false;
 bool opt_start_streaming = false;
 bool opt_start_recording = false;
 bool opt_studio_mode = false;
@@ -1918,6 +1919,7 @@ static void SaveProfilerData(const ProfilerSnapshot &snap)
 	ostringstream dst;
 	dst.write(LITERAL_SIZE("obs-studio/profiler_data/"));
 	dst.write(currentLogFile.c_str(), pos);
+	string base = dst.str();
 	dst.write(LITERAL_SIZE(".csv.gz"));
 #undef LITERAL_SIZE
 
@@ -1925,6 +1927,15 @@ static void SaveProfilerData(const ProfilerSnapshot &snap)
 	if (!profiler_snapshot_dump_csv_gz(snap.get(), path))
 		blog(LOG_WARNING, "Could not save profiler data to '%s'",
 		     static_cast<const char *>(path));
+
+	if (!profiler_trace)
+		return;
+
+	BPtr<char> trace_path =
+		GetConfigPathPtr((base + ".trace.json").c_str());
+	if (!profiler_dump_trace_json(trace_path))
+		blog(LOG_WARNING, "Could not save profiler trace to '%s'",
+		     static_cast<const char *>(trace_path));
 }
 
 static auto ProfilerFree = [](void *) {
@@ -1961,7 +1972,10 @@ static int run_program(fstream &logFile, int argc, char *argv[])
 	std::unique_ptr<void, decltype(ProfilerFree)> prof_release(
 		static_cast<void *>(&ProfilerFree), ProfilerFree);
 
-	profiler_start();
+	if (profiler_trace)
+		profiler_start_buffered(0, 0);
+	else
+		profiler_start();
 	profile_register_root(run_program_init, 0);
 
 	ScopeProfiler prof{run_program_init};
@@ -2666,6 +2680,9 @@ int main(int argc, char *argv[])
 		} else if (arg_is(argv[i], "--unfiltered_log", nullptr)) {
 			unfiltered_log = true;
 
+		} else if (arg_is(argv[i], "--profiler-trace", nullptr)) {
+			profiler_trace = true;
+
 		} else if (arg_is(argv[i], "--startstreaming", nullptr)) {
 			opt_start_streaming = true;
 
@@ -2723,7 +2740,8 @@ int main(int argc, char *argv[])
 				"--multi, -m: Don't warn when launching multiple instances.\n\n"
 				"--verbose: Make log more verbose.\n"
 				"--always-on-top: Start in 'always on top' mode.\n\n"
-				"--unfiltered_log: Make log unfiltered.\n\n"
+				"--unfiltered_log: Make log unfiltered.\n"
+				"--profiler-trace: Use the low-overhead profiler and save a trace.\n\n"
 				"--disable-updater: Disable built-in updater (Windows/Mac only)\n\n"
 				"--disable-high-dpi-scaling: Disable automatic high-DPI scaling\n\n";
 
@@ -39,7 +39,7 @@ void VolControl::OBSVolumeLevel(void *data,
 void VolControl::OBSVolumeMuted(void *data, calldata_t *calldata)
 {
 	VolControl *volControl = static_cast<VolControl *>(data);
-	bool muted = calldata_bool(calldata, "muted");
+	bool muted = calldata_bool_at(calldata, 1, "muted");
 
 	QMetaObject::invokeMethod(volControl, "VolumeMuted",
 				  Q_ARG(bool, muted));
@@ -130,6 +130,12 @@ bool mp_decode_init(mp_media_t *m, enum AVMediaType type, bool hw)
 	d->m = m;
 	d->audio = type == AVMEDIA_TYPE_AUDIO;
 
+	if (os_event_init(&d->event, OS_EVENT_TYPE_AUTO) != 0) {
+		blog(LOG_WARNING, "MP: Failed to init %s event",
+		     av_get_media_type_string(type));
+		return false;
+	}
+
 	ret = av_find_best_stream(m->fmt, type, -1, -1, NULL, 0);
 	if (ret < 0)
 		return false;
@@ -206,12 +212,36 @@ void mp_decode_clear_packets(struct mp_decode *d)
 		circlebuf_pop_front(&d->packets, &pkt, sizeof(pkt));
 		av_packet_unref(&pkt);
 	}
+
+	d->packet_bytes = 0;
+}
+
+void mp_decode_clear_frames(struct mp_decode *d)
+{
+	while (d->frames.size) {
+		struct mp_frame frame;
+		circlebuf_pop_front(&d->frames, &frame, sizeof(frame));
+		av_frame_free(&frame.frame);
+	}
+
+	av_frame_free(&d->cur.frame);
+	d->cur_ready = false;
 }
 
 void mp_decode_free(struct mp_decode *d)
 {
 	mp_decode_clear_packets(d);
+	mp_decode_clear_frames(d);
 	circlebuf_free(&d->packets);
+	circlebuf_free(&d->frames);
+
+	while (d->free_frames.size) {
+		AVFrame *frame;
+		circlebuf_pop_front(&d->free_frames, &frame, sizeof(frame));
+		av_frame_free(&frame);
+	}
+	circlebuf_free(&d->free_frames);
+	os_event_destroy(d->event);
 
 	if (d->hw_frame) {
 		av_frame_unref(d->hw_frame);
@@ -240,7 +270,44 @@ void mp_decode_free(struct mp_decode *d)
 
 void mp_decode_push_packet(struct mp_decode *decode, AVPacket *packet)
 {
-	circlebuf_push_back(&decode->packets, packet, sizeof(*packet));
+	bool ended;
+
+	/* packets of a stream whose decoder has finished would never be
+	 * read.  a starved stream is waited for again once it has one. */
+	pthread_mutex_lock(&decode->m->queue_mutex);
+	ended = decode->finished;
+	if (!ended) {
+		circlebuf_push_back(&decode->packets, packet, sizeof(*packet));
+		decode->packet_bytes += packet->size;
+		decode->starved = false;
+	}
+	pthread_mutex_unlock(&decode->m->queue_mutex);
+
+	if (ended)
+		av_packet_unref(packet);
+	else
+		os_event_signal(decode->event);
+}
+
+/* eof is checked together with the queue, the demux thread sets it after
+ * pushing the last packet */
+static bool mp_decode_pop_packet(struct mp_decode *d, bool *eof)
+{
+	bool popped = false;
+
+	pthread_mutex_lock(&d->m->queue_mutex);
+	*eof = d->m->eof;
+	if (d->packets.size) {
+		circlebuf_pop_front(&d->packets, &d->orig_pkt,
+				    sizeof(d->orig_pkt));
+		d->packet_bytes -= d->orig_pkt.size;
+		popped = true;
+	}
+	pthread_mutex_unlock(&d->m->queue_mutex);
+
+	if (popped)
+		os_event_signal(d->m->demux_event);
+	return popped;
 }
 
 static inline int64_t get_estimated_duration(struct mp_decode *d,
@@ -329,29 +396,22 @@ static int decode_packet(struct mp_decode *d, int *got_frame)
 
 bool mp_decode_next(struct mp_decode *d)
 {
-	bool eof = d->m->eof;
+	bool eof;
 	int got_frame;
 	int ret;
 
 	d->frame_ready = false;
 
-	if (!eof && !d->packets.size)
-		return true;
-
 	while (!d->frame_ready) {
 		if (!d->packet_pending) {
-			if (!d->packets.size) {
-				if (eof) {
-					d->pkt.data = NULL;
-					d->pkt.size = 0;
-				} else {
-					return true;
-				}
-			} else {
-				circlebuf_pop_front(&d->packets, &d->orig_pkt,
-						    sizeof(d->orig_pkt));
+			if (mp_decode_pop_packet(d, &eof)) {
 				d->pkt = d->orig_pkt;
 				d->packet_pending = true;
+			} else if (eof) {
+				d->pkt.data = NULL;
+				d->pkt.size = 0;
+			} else {
+				return true;
 			}
 		}
 
@@ -427,10 +487,12 @@ bool mp_decode_next(struct mp_decode *d)
 	return true;
 }
 
+/* only called while the demux and decode threads are stopped */
 void mp_decode_flush(struct mp_decode *d)
 {
 	avcodec_flush_buffers(d->decoder);
 	mp_decode_clear_packets(d);
+	mp_decode_clear_frames(d);
 	d->eof = false;
 	d->frame_pts = 0;
 	d->frame_ready = false;
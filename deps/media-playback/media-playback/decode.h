@@ -46,6 +46,13 @@ extern "C" {
 
 struct mp_media;
 
+struct mp_frame {
+	AVFrame *frame;
+	int64_t pts;
+	int64_t next_pts;
+	bool scaled;
+};
+
 struct mp_decode {
 	struct mp_media *m;
 	AVStream *stream;
@@ -71,7 +78,26 @@ struct mp_decode {
 	AVPacket orig_pkt;
 	AVPacket pkt;
 	bool packet_pending;
+
+	/* the queues are shared with the demux and media threads, and
+	 * guarded by the queue mutex of the media */
 	struct circlebuf packets;
+	struct circlebuf frames;
+	struct circlebuf free_frames;
+	size_t packet_bytes;
+	/* nothing queued while another stream hit the queue limits, so
+	 * playback doesn't wait for its frames until it gets a packet */
+	bool starved;
+	bool finished;
+	bool failed;
+
+	pthread_t thread;
+	bool thread_valid;
+	os_event_t *event;
+
+	/* next frame to be played, owned by the media thread */
+	struct mp_frame cur;
+	bool cur_ready;
 };
 
 extern bool mp_decode_init(struct mp_media *media, enum AVMediaType type,
@@ -79,6 +105,7 @@ extern bool mp_decode_init(struct mp_media *media, enum AVMediaType type,
 extern void mp_decode_free(struct mp_decode *decode);
 
 extern void mp_decode_clear_packets(struct mp_decode *decode);
+extern void mp_decode_clear_frames(struct mp_decode *decode);
 
 extern void mp_decode_push_packet(struct mp_decode *decode, AVPacket *pkt);
 extern bool mp_decode_next(struct mp_decode *decode);
@@ -23,7 +23,13 @@
 #include "closest-format.h"
 
 #include <libavdevice/avdevice.h>
-#include <libavutil/imgutils.h>
+
+#define DEFAULT_LOOKAHEAD 4
+#define MAX_QUEUED_PACKETS 32
+
+/* like ffplay, the demuxer also stops once a single stream runs far ahead */
+#define MAX_QUEUED_PACKETS_HARD 1024
+#define MAX_QUEUED_BYTES (15 * 1024 * 1024)
 
 static int64_t base_sys_ts = 0;
 
@@ -167,20 +173,6 @@ static int mp_media_next_packet(mp_media_t *media)
 	return ret;
 }
 
-static inline bool mp_media_ready_to_start(mp_media_t *m)
-{
-	if (m->has_audio && !m->a.eof && !m->a.frame_ready)
-		return false;
-	if (m->has_video && !m->v.eof && !m->v.frame_ready)
-		return false;
-	return true;
-}
-
-static inline bool mp_decode_frame(struct mp_decode *d)
-{
-	return d->frame_ready || mp_decode_next(d);
-}
-
 static inline int get_sws_colorspace(enum AVColorSpace cs)
 {
 	switch (cs) {
@@ -225,51 +217,380 @@ static bool mp_media_init_scaling(mp_media_t *m)
 
 	sws_setColorspaceDetails(m->swscale, coeff, range, coeff, range, 0,
 				 FIXED_1_0, FIXED_1_0);
+	return true;
+}
 
-	int ret = av_image_alloc(m->scale_pic, m->scale_linesizes,
-				 m->v.decoder->width, m->v.decoder->height,
-				 m->scale_format, 32);
-	if (ret < 0) {
-		blog(LOG_WARNING, "MP: Failed to create scale pic data");
-		return false;
+static inline size_t queued_packets(struct mp_decode *d)
+{
+	return d->packets.size / sizeof(AVPacket);
+}
+
+static inline size_t queued_frames(struct mp_decode *d)
+{
+	return d->frames.size / sizeof(struct mp_frame);
+}
+
+static inline bool mp_decode_input_active(mp_media_t *m, struct mp_decode *d)
+{
+	bool has_stream = d->audio ? m->has_audio : m->has_video;
+	return has_stream && !d->starved && !d->finished;
+}
+
+/* a stream with nothing queued while another one is at the hard limits is
+ * either sparse, coarsely interleaved or has ended early in the file.
+ * playback waits for a frame of every stream, so waiting for it would stall
+ * both forever.  playback goes on without it until its next packet is read,
+ * which clears the flag again. */
+static bool mp_media_mark_starved_streams(mp_media_t *m)
+{
+	struct mp_decode *streams[] = {&m->v, &m->a};
+	bool starved = false;
+
+	for (size_t i = 0; i < 2; i++) {
+		struct mp_decode *d = streams[i];
+
+		if (mp_decode_input_active(m, d) && !d->packets.size) {
+			blog(LOG_DEBUG,
+			     "MP: No %s packets within the queue limits, "
+			     "playing on without waiting for them",
+			     d->audio ? "audio" : "video");
+			d->starved = true;
+			starved = true;
+		}
 	}
 
-	return true;
+	return starved;
 }
 
-static bool mp_media_prepare_frames(mp_media_t *m)
+/* the demuxer waits once every stream that's still being decoded has enough
+ * packets, otherwise a decoder could starve while the other stream's queue
+ * is full.  it also waits once a single stream hits the hard limits, so a
+ * stream that ended early or a sparse one can't let the other grow without
+ * bound. */
+static bool mp_media_packets_full(mp_media_t *m, bool *starved)
 {
-	bool actively_seeking = m->seek_next_ts && m->pause;
-
-	while (!mp_media_ready_to_start(m)) {
-		if (!m->eof) {
-			int ret = mp_media_next_packet(m);
-			if (ret == AVERROR_EOF || ret == AVERROR_EXIT) {
-				if (!actively_seeking) {
-					m->eof = true;
-				} else {
-					break;
-				}
-			} else if (ret < 0) {
-				return false;
-			}
+	struct mp_decode *streams[] = {&m->v, &m->a};
+	bool enough = true;
+	bool capped = false;
+	size_t bytes = 0;
+
+	for (size_t i = 0; i < 2; i++) {
+		struct mp_decode *d = streams[i];
+		size_t count;
+
+		if (!mp_decode_input_active(m, d))
+			continue;
+
+		count = queued_packets(d);
+		if (count < MAX_QUEUED_PACKETS)
+			enough = false;
+		if (count >= MAX_QUEUED_PACKETS_HARD)
+			capped = true;
+		bytes += d->packet_bytes;
+	}
+
+	if (bytes >= MAX_QUEUED_BYTES)
+		capped = true;
+
+	*starved = capped && mp_media_mark_starved_streams(m);
+	return enough || capped;
+}
+
+static void *mp_media_demux_thread(void *opaque)
+{
+	mp_media_t *m = opaque;
+
+	os_set_thread_name("mp_demux_thread");
+
+	for (;;) {
+		bool stop, full, starved;
+		int ret;
+
+		pthread_mutex_lock(&m->queue_mutex);
+		stop = m->pipeline_stop;
+		full = mp_media_packets_full(m, &starved);
+		pthread_mutex_unlock(&m->queue_mutex);
+
+		if (stop)
+			break;
+		if (starved)
+			os_event_signal(m->frame_event);
+		if (full) {
+			os_event_wait(m->demux_event);
+			continue;
 		}
 
-		if (m->has_video && !mp_decode_frame(&m->v))
+		ret = mp_media_next_packet(m);
+		if (ret < 0) {
+			pthread_mutex_lock(&m->queue_mutex);
+			m->demux_failed = ret != AVERROR_EOF &&
+					  ret != AVERROR_EXIT;
+			m->eof = true;
+			/* every frame left has to be played now */
+			m->v.starved = false;
+			m->a.starved = false;
+			pthread_mutex_unlock(&m->queue_mutex);
+			break;
+		}
+	}
+
+	/* decoders waiting for packets have to drain now */
+	if (m->has_video)
+		os_event_signal(m->v.event);
+	if (m->has_audio)
+		os_event_signal(m->a.event);
+	return NULL;
+}
+
+static AVFrame *mp_media_get_free_frame(mp_media_t *m, struct mp_decode *d)
+{
+	AVFrame *frame = NULL;
+
+	pthread_mutex_lock(&m->queue_mutex);
+	if (d->free_frames.size)
+		circlebuf_pop_front(&d->free_frames, &frame, sizeof(frame));
+	pthread_mutex_unlock(&m->queue_mutex);
+
+	return frame ? frame : av_frame_alloc();
+}
+
+static void mp_media_recycle_frame(mp_media_t *m, struct mp_decode *d,
+				   AVFrame *frame)
+{
+	pthread_mutex_lock(&m->queue_mutex);
+	circlebuf_push_back(&d->free_frames, &frame, sizeof(frame));
+	pthread_mutex_unlock(&m->queue_mutex);
+}
+
+/* scaled frames keep their buffers when recycled, so they're only
+ * allocated again if the size changes */
+static bool mp_media_scale_frame(mp_media_t *m, AVFrame *dst,
+				 const AVFrame *src)
+{
+	if (!dst->buf[0] || dst->format != m->scale_format ||
+	    dst->width != src->width || dst->height != src->height) {
+		av_frame_unref(dst);
+		dst->format = m->scale_format;
+		dst->width = src->width;
+		dst->height = src->height;
+
+		if (av_frame_get_buffer(dst, 32) < 0) {
+			blog(LOG_WARNING,
+			     "MP: Failed to allocate scaled frame");
 			return false;
-		if (m->has_audio && !mp_decode_frame(&m->a))
+		}
+	}
+
+	int ret = sws_scale(m->swscale, (const uint8_t *const *)src->data,
+			    src->linesize, 0, src->height, dst->data,
+			    dst->linesize);
+	if (ret < 0)
+		return false;
+
+	dst->colorspace = src->colorspace;
+	dst->color_trc = src->color_trc;
+	dst->color_range = src->color_range;
+	dst->key_frame = src->key_frame;
+	return true;
+}
+
+static bool mp_media_queue_frame(mp_media_t *m, struct mp_decode *d)
+{
+	struct mp_frame frame = {0};
+	AVFrame *f = d->frame;
+
+	if (!d->audio && !m->swscale) {
+		m->scale_format = closest_format(f->format);
+		if (m->scale_format != f->format && !mp_media_init_scaling(m))
 			return false;
 	}
 
-	if (m->has_video && m->v.frame_ready && !m->swscale) {
-		m->scale_format = closest_format(m->v.frame->format);
-		if (m->scale_format != m->v.frame->format) {
-			if (!mp_media_init_scaling(m)) {
-				return false;
-			}
+	frame.frame = mp_media_get_free_frame(m, d);
+	if (!frame.frame)
+		return false;
+
+	frame.pts = d->frame_pts;
+	frame.next_pts = d->next_pts;
+	frame.scaled = !d->audio && m->swscale;
+
+	/* a reference instead of moving the frame, so that frames of the
+	 * old decoding api are copied out of the decoder */
+	bool success = frame.scaled ? mp_media_scale_frame(m, frame.frame, f)
+				    : av_frame_ref(frame.frame, f) == 0;
+	av_frame_unref(f);
+
+	if (!success) {
+		mp_media_recycle_frame(m, d, frame.frame);
+		return true;
+	}
+
+	pthread_mutex_lock(&m->queue_mutex);
+	circlebuf_push_back(&d->frames, &frame, sizeof(frame));
+	pthread_mutex_unlock(&m->queue_mutex);
+
+	os_event_signal(m->frame_event);
+	return true;
+}
+
+static void *mp_media_decode_thread(void *opaque)
+{
+	struct mp_decode *d = opaque;
+	mp_media_t *m = d->m;
+	bool failed = false;
+
+	os_set_thread_name(d->audio ? "mp_audio_decode" : "mp_video_decode");
+
+	for (;;) {
+		bool stop, wait;
+
+		pthread_mutex_lock(&m->queue_mutex);
+		stop = m->pipeline_stop;
+		wait = queued_frames(d) >= (size_t)m->lookahead ||
+		       (!d->packet_pending && !d->packets.size && !m->eof);
+		pthread_mutex_unlock(&m->queue_mutex);
+
+		if (stop || d->eof)
+			break;
+		if (wait) {
+			os_event_wait(d->event);
+			continue;
 		}
+
+		if (!mp_decode_next(d) ||
+		    (d->frame_ready && !mp_media_queue_frame(m, d))) {
+			failed = true;
+			break;
+		}
+	}
+
+	pthread_mutex_lock(&m->queue_mutex);
+	d->finished = true;
+	d->failed = failed;
+	pthread_mutex_unlock(&m->queue_mutex);
+
+	os_event_signal(m->frame_event);
+	return NULL;
+}
+
+static void mp_media_start_decode(mp_media_t *m, struct mp_decode *d)
+{
+	if (pthread_create(&d->thread, NULL, mp_media_decode_thread, d) != 0) {
+		blog(LOG_WARNING, "MP: Could not create decode thread");
+		d->finished = true;
+		d->failed = true;
+		return;
+	}
+
+	d->thread_valid = true;
+}
+
+static void mp_media_start_pipeline(mp_media_t *m)
+{
+	m->pipeline_stop = false;
+	m->demux_failed = false;
+	m->eof = false;
+
+	/* reset before the demux thread starts, it checks which streams
+	 * have ended */
+	m->v.starved = false;
+	m->v.finished = false;
+	m->v.failed = false;
+	m->a.starved = false;
+	m->a.finished = false;
+	m->a.failed = false;
+
+	if (pthread_create(&m->demux_thread, NULL, mp_media_demux_thread, m) !=
+	    0) {
+		blog(LOG_WARNING, "MP: Could not create demux thread");
+		m->demux_failed = true;
+		m->eof = true;
+	} else {
+		m->demux_thread_valid = true;
 	}
 
+	if (m->has_video)
+		mp_media_start_decode(m, &m->v);
+	if (m->has_audio)
+		mp_media_start_decode(m, &m->a);
+}
+
+static void mp_media_stop_decode(struct mp_decode *d)
+{
+	if (d->thread_valid) {
+		os_event_signal(d->event);
+		pthread_join(d->thread, NULL);
+		d->thread_valid = false;
+	}
+}
+
+static void mp_media_stop_pipeline(mp_media_t *m)
+{
+	pthread_mutex_lock(&m->queue_mutex);
+	m->pipeline_stop = true;
+	pthread_mutex_unlock(&m->queue_mutex);
+
+	if (m->demux_thread_valid) {
+		os_event_signal(m->demux_event);
+		pthread_join(m->demux_thread, NULL);
+		m->demux_thread_valid = false;
+	}
+
+	mp_media_stop_decode(&m->v);
+	mp_media_stop_decode(&m->a);
+}
+
+/* takes the next decoded frame of a stream, waiting for it if needed.  no
+ * frame being ready afterwards means the stream has ended, or that the
+ * demuxer is still looking for its next packet (see starved). */
+static bool mp_media_get_frame(mp_media_t *m, struct mp_decode *d)
+{
+	bool finished;
+	bool starved;
+	bool failed;
+
+	if (d->cur_ready)
+		return true;
+
+	/* unscaled frames hold buffers of the decoder, release them now */
+	if (d->cur.frame && !d->cur.scaled)
+		av_frame_unref(d->cur.frame);
+
+	for (;;) {
+		pthread_mutex_lock(&m->queue_mutex);
+		if (d->cur.frame) {
+			circlebuf_push_back(&d->free_frames, &d->cur.frame,
+					    sizeof(d->cur.frame));
+			d->cur.frame = NULL;
+		}
+		if (d->frames.size) {
+			circlebuf_pop_front(&d->frames, &d->cur,
+					    sizeof(d->cur));
+			d->cur_ready = true;
+		}
+		finished = d->finished;
+		starved = d->starved;
+		failed = d->failed || m->demux_failed;
+		pthread_mutex_unlock(&m->queue_mutex);
+
+		if (d->cur_ready) {
+			os_event_signal(d->event);
+			return true;
+		}
+		if (finished)
+			return !failed;
+		if (starved)
+			return true;
+
+		os_event_wait(m->frame_event);
+	}
+}
+
+static bool mp_media_prepare_frames(mp_media_t *m)
+{
+	if (m->has_video && !mp_media_get_frame(m, &m->v))
+		return false;
+	if (m->has_audio && !mp_media_get_frame(m, &m->a))
+		return false;
 	return true;
 }
 
@@ -277,13 +598,13 @@ static inline int64_t mp_media_get_next_min_pts(mp_media_t *m)
 {
 	int64_t min_next_ns = 0x7FFFFFFFFFFFFFFFLL;
 
-	if (m->has_video && m->v.frame_ready) {
-		if (m->v.frame_pts < min_next_ns)
-			min_next_ns = m->v.frame_pts;
+	if (m->has_video && m->v.cur_ready) {
+		if (m->v.cur.pts < min_next_ns)
+			min_next_ns = m->v.cur.pts;
 	}
-	if (m->has_audio && m->a.frame_ready) {
-		if (m->a.frame_pts < min_next_ns)
-			min_next_ns = m->a.frame_pts;
+	if (m->has_audio && m->a.cur_ready) {
+		if (m->a.cur.pts < min_next_ns)
+			min_next_ns = m->a.cur.pts;
 	}
 
 	return min_next_ns;
@@ -293,29 +614,29 @@ static inline int64_t mp_media_get_base_pts(mp_media_t *m)
 {
 	int64_t base_ts = 0;
 
-	if (m->has_video && m->v.next_pts > base_ts)
-		base_ts = m->v.next_pts;
-	if (m->has_audio && m->a.next_pts > base_ts)
-		base_ts = m->a.next_pts;
+	if (m->has_video && m->v.cur.next_pts > base_ts)
+		base_ts = m->v.cur.next_pts;
+	if (m->has_audio && m->a.cur.next_pts > base_ts)
+		base_ts = m->a.cur.next_pts;
 
 	return base_ts;
 }
 
 static inline bool mp_media_can_play_frame(mp_media_t *m, struct mp_decode *d)
 {
-	return d->frame_ready && d->frame_pts <= m->next_pts_ns;
+	return d->cur_ready && d->cur.pts <= m->next_pts_ns;
 }
 
 static void mp_media_next_audio(mp_media_t *m)
 {
 	struct mp_decode *d = &m->a;
 	struct obs_source_audio audio = {0};
-	AVFrame *f = d->frame;
+	AVFrame *f = d->cur.frame;
 
 	if (!mp_media_can_play_frame(m, d))
 		return;
 
-	d->frame_ready = false;
+	d->cur_ready = false;
 	if (!m->a_cb)
 		return;
 
@@ -327,7 +648,7 @@ static void mp_media_next_audio(mp_media_t *m)
 	audio.format = convert_sample_format(f->format);
 	audio.frames = f->nb_samples;
 
-	audio.timestamp = m->base_ts + d->frame_pts - m->start_ts +
+	audio.timestamp = m->base_ts + d->cur.pts - m->start_ts +
 			  m->play_sys_ts - base_sys_ts;
 
 	if (audio.format == AUDIO_FORMAT_UNKNOWN)
@@ -336,6 +657,29 @@ static void mp_media_next_audio(mp_media_t *m)
 	m->a_cb(m->opaque, &audio);
 }
 
+static void mp_media_free_frame(void *param)
+{
+	AVFrame *f = param;
+	av_frame_free(&f);
+}
+
+/* decoded frames can only be shared if their buffers are not reused for the
+ * next frame, which is not the case for scaled frames */
+static bool mp_media_share_video(mp_media_t *m, struct obs_source_frame *frame)
+{
+	AVFrame *ref;
+
+	if (!m->v_shared_cb || m->v.cur.scaled)
+		return false;
+
+	ref = av_frame_clone(m->v.cur.frame);
+	if (!ref)
+		return false;
+
+	m->v_shared_cb(m->opaque, frame, mp_media_free_frame, ref);
+	return true;
+}
+
 static void mp_media_next_video(mp_media_t *m, bool preload)
 {
 	struct mp_decode *d = &m->v;
@@ -343,47 +687,31 @@ static void mp_media_next_video(mp_media_t *m, bool preload)
 	enum video_format new_format;
 	enum video_colorspace new_space;
 	enum video_range_type new_range;
-	AVFrame *f = d->frame;
+	AVFrame *f = d->cur.frame;
 
 	if (!preload) {
 		if (!mp_media_can_play_frame(m, d))
 			return;
 
-		d->frame_ready = false;
+		d->cur_ready = false;
 
 		if (!m->v_cb)
 			return;
-	} else if (!d->frame_ready) {
+	} else if (!d->cur_ready) {
 		return;
 	}
 
-	bool flip = false;
-	if (m->swscale) {
-		int ret = sws_scale(m->swscale, (const uint8_t *const *)f->data,
-				    f->linesize, 0, f->height, m->scale_pic,
-				    m->scale_linesizes);
-		if (ret < 0)
-			return;
-
-		flip = m->scale_linesizes[0] < 0 && m->scale_linesizes[1] == 0;
-		for (size_t i = 0; i < 4; i++) {
-			frame->data[i] = m->scale_pic[i];
-			frame->linesize[i] = abs(m->scale_linesizes[i]);
-		}
-
-	} else {
-		flip = f->linesize[0] < 0 && f->linesize[1] == 0;
+	bool flip = f->linesize[0] < 0 && f->linesize[1] == 0;
 
-		for (size_t i = 0; i < MAX_AV_PLANES; i++) {
-			frame->data[i] = f->data[i];
-			frame->linesize[i] = abs(f->linesize[i]);
-		}
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		frame->data[i] = f->data[i];
+		frame->linesize[i] = abs(f->linesize[i]);
 	}
 
 	if (flip)
 		frame->data[0] -= frame->linesize[0] * (f->height - 1);
 
-	new_format = convert_pixel_format(m->scale_format);
+	new_format = convert_pixel_format(f->format);
 	new_space = convert_color_space(f->colorspace, f->color_trc);
 	new_range = m->force_range == VIDEO_RANGE_DEFAULT
 			    ? convert_color_range(f->color_range)
@@ -414,7 +742,7 @@ static void mp_media_next_video(mp_media_t *m, bool preload)
 	if (frame->format == VIDEO_FORMAT_NONE)
 		return;
 
-	frame->timestamp = m->base_ts + d->frame_pts - m->start_ts +
+	frame->timestamp = m->base_ts + d->cur.pts - m->start_ts +
 			   m->play_sys_ts - base_sys_ts;
 
 	frame->width = f->width;
@@ -434,7 +762,7 @@ static void mp_media_next_video(mp_media_t *m, bool preload)
 		} else {
 			m->v_preload_cb(m->opaque, frame);
 		}
-	} else {
+	} else if (!mp_media_share_video(m, frame)) {
 		m->v_cb(m->opaque, frame);
 	}
 }
@@ -477,6 +805,8 @@ static void seek_to(mp_media_t *m, int64_t pos)
 						     stream->time_base)
 				      : seek_pos;
 
+	mp_media_stop_pipeline(m);
+
 	if (m->is_local_file) {
 		int ret = av_seek_frame(m->fmt, 0, seek_target, seek_flags);
 		if (ret < 0) {
@@ -485,14 +815,16 @@ static void seek_to(mp_media_t *m, int64_t pos)
 		}
 	}
 
-	if (m->has_video && m->is_local_file) {
+	if (m->has_video && m->is_local_file)
 		mp_decode_flush(&m->v);
-		if (m->seek_next_ts && m->pause && m->v_preload_cb &&
-		    mp_media_prepare_frames(m))
-			mp_media_next_video(m, true);
-	}
 	if (m->has_audio && m->is_local_file)
 		mp_decode_flush(&m->a);
+
+	mp_media_start_pipeline(m);
+
+	if (m->has_video && m->is_local_file && m->seek_next_ts && m->pause &&
+	    m->v_preload_cb && mp_media_prepare_frames(m))
+		mp_media_next_video(m, true);
 }
 
 static bool mp_media_reset(mp_media_t *m)
@@ -500,21 +832,22 @@ static bool mp_media_reset(mp_media_t *m)
 	bool stopping;
 	bool active;
 
+	/* cleared before the demux thread restarts, it would be
+	 * interrupted right away otherwise */
+	pthread_mutex_lock(&m->mutex);
+	stopping = m->stopping;
+	active = m->active;
+	m->stopping = false;
+	pthread_mutex_unlock(&m->mutex);
+
 	seek_to(m, m->fmt->start_time);
 
 	int64_t next_ts = mp_media_get_base_pts(m);
 	int64_t offset = next_ts - m->next_pts_ns;
 
-	m->eof = false;
 	m->base_ts += next_ts;
 	m->seek_next_ts = false;
 
-	pthread_mutex_lock(&m->mutex);
-	stopping = m->stopping;
-	active = m->active;
-	m->stopping = false;
-	pthread_mutex_unlock(&m->mutex);
-
 	if (!mp_media_prepare_frames(m))
 		return false;
 
@@ -543,6 +876,9 @@ static inline bool mp_media_sleepto(mp_media_t *m)
 {
 	bool timeout = false;
 
+	if (m->full_speed)
+		return false;
+
 	if (!m->next_ns) {
 		m->next_ns = os_gettime_ns();
 	} else {
@@ -562,8 +898,8 @@ static inline bool mp_media_sleepto(mp_media_t *m)
 
 static inline bool mp_media_eof(mp_media_t *m)
 {
-	bool v_ended = !m->has_video || !m->v.frame_ready;
-	bool a_ended = !m->has_audio || !m->a.frame_ready;
+	bool v_ended = !m->has_video || !m->v.cur_ready;
+	bool a_ended = !m->has_audio || !m->a.cur_ready;
 	bool eof = v_ended && a_ended;
 
 	if (eof) {
@@ -594,6 +930,10 @@ static int interrupt_callback(void *data)
 		stop = m->kill || m->stopping;
 		pthread_mutex_unlock(&m->mutex);
 
+		pthread_mutex_lock(&m->queue_mutex);
+		stop = stop || m->pipeline_stop;
+		pthread_mutex_unlock(&m->queue_mutex);
+
 		m->interrupt_poll_ts = ts;
 	}
 
@@ -757,8 +1097,11 @@ static inline bool mp_media_thread(mp_media_t *m)
 static void *mp_media_thread_start(void *opaque)
 {
 	mp_media_t *m = opaque;
+	bool success = mp_media_thread(m);
 
-	if (!mp_media_thread(m)) {
+	mp_media_stop_pipeline(m);
+
+	if (!success) {
 		if (m->stop_cb) {
 			m->stop_cb(m->opaque);
 		}
@@ -778,6 +1121,15 @@ static inline bool mp_media_init_internal(mp_media_t *m,
 		blog(LOG_WARNING, "MP: Failed to init semaphore");
 		return false;
 	}
+	if (pthread_mutex_init(&m->queue_mutex, NULL) != 0) {
+		blog(LOG_WARNING, "MP: Failed to init queue mutex");
+		return false;
+	}
+	if (os_event_init(&m->demux_event, OS_EVENT_TYPE_AUTO) != 0 ||
+	    os_event_init(&m->frame_event, OS_EVENT_TYPE_AUTO) != 0) {
+		blog(LOG_WARNING, "MP: Failed to init events");
+		return false;
+	}
 
 	m->path = info->path ? bstrdup(info->path) : NULL;
 	m->format_name = info->format ? bstrdup(info->format) : NULL;
@@ -796,8 +1148,10 @@ bool mp_media_init(mp_media_t *media, const struct mp_media_info *info)
 {
 	memset(media, 0, sizeof(*media));
 	pthread_mutex_init_value(&media->mutex);
+	pthread_mutex_init_value(&media->queue_mutex);
 	media->opaque = info->opaque;
 	media->v_cb = info->v_cb;
+	media->v_shared_cb = info->v_shared_cb;
 	media->a_cb = info->a_cb;
 	media->stop_cb = info->stop_cb;
 	media->v_seek_cb = info->v_seek_cb;
@@ -806,9 +1160,13 @@ bool mp_media_init(mp_media_t *media, const struct mp_media_info *info)
 	media->buffering = info->buffering;
 	media->speed = info->speed;
 	media->is_local_file = info->is_local_file;
+	media->lookahead = info->lookahead;
+	media->full_speed = info->full_speed;
 
 	if (!info->is_local_file || media->speed < 1 || media->speed > 200)
 		media->speed = 100;
+	if (media->lookahead < 1)
+		media->lookahead = DEFAULT_LOOKAHEAD;
 
 	static bool initialized = false;
 	if (!initialized) {
@@ -855,13 +1213,16 @@ void mp_media_free(mp_media_t *media)
 	mp_decode_free(&media->a);
 	avformat_close_input(&media->fmt);
 	pthread_mutex_destroy(&media->mutex);
+	pthread_mutex_destroy(&media->queue_mutex);
 	os_sem_destroy(media->sem);
+	os_event_destroy(media->demux_event);
+	os_event_destroy(media->frame_event);
 	sws_freeContext(media->swscale);
-	av_freep(&media->scale_pic[0]);
 	bfree(media->path);
 	bfree(media->format_name);
 	memset(media, 0, sizeof(*media));
 	pthread_mutex_init_value(&media->mutex);
+	pthread_mutex_init_value(&media->queue_mutex);
 }
 
 void mp_media_play(mp_media_t *m, bool loop, bool reconnecting)
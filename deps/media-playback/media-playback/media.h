@@ -39,6 +39,9 @@ extern "C" {
 #endif
 
 typedef void (*mp_video_cb)(void *opaque, struct obs_source_frame *frame);
+typedef void (*mp_shared_video_cb)(void *opaque, struct obs_source_frame *frame,
+				   obs_source_frame_release_t release,
+				   void *param);
 typedef void (*mp_audio_cb)(void *opaque, struct obs_source_audio *audio);
 typedef void (*mp_stop_cb)(void *opaque);
 
@@ -49,6 +52,7 @@ struct mp_media {
 	mp_video_cb v_seek_cb;
 	mp_stop_cb stop_cb;
 	mp_video_cb v_cb;
+	mp_shared_video_cb v_shared_cb;
 	mp_audio_cb a_cb;
 	void *opaque;
 
@@ -56,11 +60,12 @@ struct mp_media {
 	char *format_name;
 	int buffering;
 	int speed;
+	int lookahead;
+	bool full_speed;
 
+	/* owned by the video decode thread */
 	enum AVPixelFormat scale_format;
 	struct SwsContext *swscale;
-	int scale_linesizes[4];
-	uint8_t *scale_pic[4];
 
 	struct mp_decode v;
 	struct mp_decode a;
@@ -69,9 +74,19 @@ struct mp_media {
 	bool has_video;
 	bool has_audio;
 	bool is_file;
-	bool eof;
 	bool hw;
 
+	/* demux and decode threads, started and stopped by the media thread
+	 * around seeks */
+	pthread_mutex_t queue_mutex;
+	os_event_t *demux_event;
+	os_event_t *frame_event;
+	pthread_t demux_thread;
+	bool demux_thread_valid;
+	bool pipeline_stop;
+	bool demux_failed;
+	bool eof;
+
 	struct obs_source_frame obsframe;
 	enum video_colorspace cur_space;
 	enum video_range_type cur_range;
@@ -111,6 +126,7 @@ struct mp_media_info {
 	mp_video_cb v_cb;
 	mp_video_cb v_preload_cb;
 	mp_video_cb v_seek_cb;
+	mp_shared_video_cb v_shared_cb; /* optional, avoids copying frames */
 	mp_audio_cb a_cb;
 	mp_stop_cb stop_cb;
 
@@ -118,10 +134,12 @@ struct mp_media_info {
 	const char *format;
 	int buffering;
 	int speed;
+	int lookahead; /* decoded frames queued per stream, 0 for default */
 	enum video_range_type force_range;
 	bool hardware_decoding;
 	bool is_local_file;
 	bool reconnecting;
+	bool full_speed; /* ignores timestamps, for benchmarking */
 };
 
 extern bool mp_media_init(mp_media_t *media, const struct mp_media_info *info);
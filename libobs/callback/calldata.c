@@ -93,6 +93,33 @@ static bool cd_getparam(const calldata_t *data, const char *name, uint8_t **pos)
 	return false;
 }
 
+/* skips straight to the parameter at the given slot, and only searches by
+ * name if the parameter there has a different name */
+static bool cd_getparam_at(const calldata_t *data, size_t slot,
+			   const char *name, uint8_t **pos)
+{
+	size_t name_size;
+
+	if (!data->size)
+		return false;
+
+	*pos = data->stack;
+
+	name_size = cd_serialize_size(pos);
+	while (name_size != 0 && slot--) {
+		*pos += name_size;
+		*pos += cd_serialize_size(pos);
+		name_size = cd_serialize_size(pos);
+	}
+
+	if (name_size != 0 && strcmp((const char *)*pos, name) == 0) {
+		*pos += name_size;
+		return true;
+	}
+
+	return cd_getparam(data, name, pos);
+}
+
 static inline void cd_copy_string(uint8_t **pos, const char *str, size_t len)
 {
 	if (!len)
@@ -185,6 +212,26 @@ bool calldata_get_data(const calldata_t *data, const char *name, void *out,
 	return true;
 }
 
+bool calldata_get_data_at(const calldata_t *data, size_t slot,
+			  const char *name, void *out, size_t size)
+{
+	uint8_t *pos;
+	size_t data_size;
+
+	if (!data || !name || !*name)
+		return false;
+
+	if (!cd_getparam_at(data, slot, name, &pos))
+		return false;
+
+	data_size = cd_serialize_size(&pos);
+	if (data_size != size)
+		return false;
+
+	memcpy(out, pos, size);
+	return true;
+}
+
 void calldata_set_data(calldata_t *data, const char *name, const void *in,
 		       size_t size)
 {
@@ -234,6 +281,35 @@ void calldata_set_data(calldata_t *data, const char *name, const void *in,
 	}
 }
 
+void calldata_append_data(calldata_t *data, const char *name, const void *in,
+			  size_t size)
+{
+	uint8_t *pos;
+	size_t name_len;
+	size_t offset;
+
+	if (!data || !name || !*name)
+		return;
+
+	if (!data->fixed && !data->stack) {
+		cd_set_first_param(data, name, in, size);
+		return;
+	}
+
+	name_len = strlen(name) + 1;
+	offset = name_len + size + sizeof(size_t) * 2;
+
+	/* new parameters go where the terminating size currently is */
+	pos = data->stack + data->size - sizeof(size_t);
+	if (!cd_ensure_capacity(data, &pos, data->size + offset))
+		return;
+	data->size += offset;
+
+	cd_copy_string(&pos, name, name_len);
+	cd_copy_data(&pos, in, size);
+	memset(pos, 0, sizeof(size_t));
+}
+
 bool calldata_get_string(const calldata_t *data, const char *name,
 			 const char **str)
 {
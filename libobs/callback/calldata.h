@@ -79,6 +79,10 @@ EXPORT bool calldata_get_data(const calldata_t *data, const char *name,
 			      void *out, size_t size);
 EXPORT void calldata_set_data(calldata_t *data, const char *name,
 			      const void *in, size_t new_size);
+EXPORT void calldata_append_data(calldata_t *data, const char *name,
+				 const void *in, size_t size);
+EXPORT bool calldata_get_data_at(const calldata_t *data, size_t slot,
+				 const char *name, void *out, size_t size);
 
 static inline void calldata_clear(struct calldata *data)
 {
@@ -204,6 +208,83 @@ static inline void calldata_set_string(calldata_t *data, const char *name,
 		calldata_set_data(data, name, NULL, 0);
 }
 
+/* ------------------------------------------------------------------------- */
+/* Fixed layout: 'append' functions add a parameter without checking whether
+ * it has already been set, which makes building parameters cost the same
+ * regardless of how many there are.  Only use them to build calldata that
+ * always has the same parameters, each set once (such as signal
+ * parameters). */
+
+static inline void calldata_append_int(calldata_t *data, const char *name,
+				       long long val)
+{
+	calldata_append_data(data, name, &val, sizeof(val));
+}
+
+static inline void calldata_append_float(calldata_t *data, const char *name,
+					 double val)
+{
+	calldata_append_data(data, name, &val, sizeof(val));
+}
+
+static inline void calldata_append_bool(calldata_t *data, const char *name,
+					bool val)
+{
+	calldata_append_data(data, name, &val, sizeof(val));
+}
+
+static inline void calldata_append_ptr(calldata_t *data, const char *name,
+				       void *ptr)
+{
+	calldata_append_data(data, name, &ptr, sizeof(ptr));
+}
+
+static inline void calldata_append_string(calldata_t *data, const char *name,
+					  const char *str)
+{
+	if (str)
+		calldata_append_data(data, name, str, strlen(str) + 1);
+	else
+		calldata_append_data(data, name, NULL, 0);
+}
+
+/* 'at' functions get a parameter by its slot, the order in which it was
+ * appended, instead of searching for it by name.  The name at that slot is
+ * still checked, and the parameter is searched for by name if it differs
+ * (for example if the sender didn't use a fixed layout). */
+
+static inline long long calldata_int_at(const calldata_t *data, size_t slot,
+					const char *name)
+{
+	long long val = 0;
+	calldata_get_data_at(data, slot, name, &val, sizeof(val));
+	return val;
+}
+
+static inline double calldata_float_at(const calldata_t *data, size_t slot,
+				       const char *name)
+{
+	double val = 0.0;
+	calldata_get_data_at(data, slot, name, &val, sizeof(val));
+	return val;
+}
+
+static inline bool calldata_bool_at(const calldata_t *data, size_t slot,
+				    const char *name)
+{
+	bool val = false;
+	calldata_get_data_at(data, slot, name, &val, sizeof(val));
+	return val;
+}
+
+static inline void *calldata_ptr_at(const calldata_t *data, size_t slot,
+				    const char *name)
+{
+	void *val = NULL;
+	calldata_get_data_at(data, slot, name, &val, sizeof(val));
+	return val;
+}
+
 #ifdef __cplusplus
 }
 #endif
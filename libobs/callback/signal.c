@@ -29,6 +29,8 @@ struct signal_callback {
 
 struct signal_info {
 	struct decl_info func;
+	uint32_t name_hash;
+	struct signal_handler *handler;
 	DARRAY(struct signal_callback) callbacks;
 	pthread_mutex_t mutex;
 	bool signalling;
@@ -36,6 +38,19 @@ struct signal_info {
 	struct signal_info *next;
 };
 
+/* FNV-1a */
+static inline uint32_t get_name_hash(const char *name)
+{
+	uint32_t hash = 2166136261u;
+
+	while (*name) {
+		hash ^= (uint8_t)*(name++);
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
 static inline struct signal_info *signal_info_create(struct decl_info *info)
 {
 	pthread_mutexattr_t attr;
@@ -49,6 +64,8 @@ static inline struct signal_info *signal_info_create(struct decl_info *info)
 	si = bmalloc(sizeof(struct signal_info));
 
 	si->func = *info;
+	si->name_hash = get_name_hash(info->name);
+	si->handler = NULL;
 	si->next = NULL;
 	si->signalling = false;
 	da_init(si->callbacks);
@@ -97,31 +114,76 @@ struct global_callback_info {
 
 struct signal_handler {
 	struct signal_info *first;
+	struct signal_info *last;
 	pthread_mutex_t mutex;
 	volatile long refs;
 
+	/* open addressing hash table of signals by name */
+	struct signal_info **table;
+	size_t table_size;
+	size_t num_signals;
+
 	DARRAY(struct global_callback_info) global_callbacks;
 	pthread_mutex_t global_callbacks_mutex;
 };
 
+#define MIN_TABLE_SIZE 16
+
+static void table_insert(signal_handler_t *handler, struct signal_info *sig)
+{
+	size_t mask = handler->table_size - 1;
+	size_t i = sig->name_hash & mask;
+
+	while (handler->table[i])
+		i = (i + 1) & mask;
+	handler->table[i] = sig;
+}
+
+static void table_add(signal_handler_t *handler, struct signal_info *sig)
+{
+	handler->num_signals++;
+
+	/* keep the table at most half full */
+	if (handler->num_signals * 2 > handler->table_size) {
+		size_t size = handler->table_size
+				      ? handler->table_size * 2
+				      : MIN_TABLE_SIZE;
+		struct signal_info *cur = handler->first;
+
+		bfree(handler->table);
+		handler->table = bzalloc(size * sizeof(struct signal_info *));
+		handler->table_size = size;
+
+		for (; cur; cur = cur->next)
+			table_insert(handler, cur);
+	} else {
+		table_insert(handler, sig);
+	}
+}
+
 static struct signal_info *getsignal(signal_handler_t *handler,
-				     const char *name,
-				     struct signal_info **p_last)
+				     const char *name)
 {
-	struct signal_info *signal, *last = NULL;
+	uint32_t hash;
+	size_t mask, i;
+	struct signal_info *signal;
 
-	signal = handler->first;
-	while (signal != NULL) {
-		if (strcmp(signal->func.name, name) == 0)
-			break;
+	if (!handler->table || !name)
+		return NULL;
+
+	hash = get_name_hash(name);
+	mask = handler->table_size - 1;
+	i = hash & mask;
 
-		last = signal;
-		signal = signal->next;
+	while ((signal = handler->table[i]) != NULL) {
+		if (signal->name_hash == hash &&
+		    strcmp(signal->func.name, name) == 0)
+			return signal;
+
+		i = (i + 1) & mask;
 	}
 
-	if (p_last)
-		*p_last = last;
-	return signal;
+	return NULL;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -163,6 +225,7 @@ static void signal_handler_actually_destroy(signal_handler_t *handler)
 		sig = next;
 	}
 
+	bfree(handler->table);
 	da_free(handler->global_callbacks);
 	pthread_mutex_destroy(&handler->global_callbacks_mutex);
 	pthread_mutex_destroy(&handler->mutex);
@@ -179,7 +242,7 @@ void signal_handler_destroy(signal_handler_t *handler)
 bool signal_handler_add(signal_handler_t *handler, const char *signal_decl)
 {
 	struct decl_info func = {0};
-	struct signal_info *sig, *last;
+	struct signal_info *sig;
 	bool success = true;
 
 	if (!parse_decl_string(&func, signal_decl)) {
@@ -189,17 +252,20 @@ bool signal_handler_add(signal_handler_t *handler, const char *signal_decl)
 
 	pthread_mutex_lock(&handler->mutex);
 
-	sig = getsignal(handler, func.name, &last);
+	sig = getsignal(handler, func.name);
 	if (sig) {
 		blog(LOG_WARNING, "Signal declaration '%s' exists", func.name);
 		decl_info_free(&func);
 		success = false;
 	} else {
 		sig = signal_info_create(&func);
-		if (!last)
+		sig->handler = handler;
+		if (!handler->last)
 			handler->first = sig;
 		else
-			last->next = sig;
+			handler->last->next = sig;
+		handler->last = sig;
+		table_add(handler, sig);
 	}
 
 	pthread_mutex_unlock(&handler->mutex);
@@ -207,36 +273,32 @@ bool signal_handler_add(signal_handler_t *handler, const char *signal_decl)
 	return success;
 }
 
-static void signal_handler_connect_internal(signal_handler_t *handler,
-					    const char *signal,
-					    signal_callback_t callback,
-					    void *data, bool keep_ref)
+static inline struct signal_info *getsignal_locked(signal_handler_t *handler,
+						   const char *name)
 {
-	struct signal_info *sig, *last;
-	struct signal_callback cb_data = {callback, data, false, keep_ref};
-	size_t idx;
+	struct signal_info *sig;
 
 	if (!handler)
-		return;
+		return NULL;
 
 	pthread_mutex_lock(&handler->mutex);
-	sig = getsignal(handler, signal, &last);
+	sig = getsignal(handler, name);
 	pthread_mutex_unlock(&handler->mutex);
 
-	if (!sig) {
-		blog(LOG_WARNING,
-		     "signal_handler_connect: "
-		     "signal '%s' not found",
-		     signal);
-		return;
-	}
+	return sig;
+}
 
-	/* -------------- */
+static void signal_connect_internal(struct signal_info *sig,
+				    signal_callback_t callback, void *data,
+				    bool keep_ref)
+{
+	struct signal_callback cb_data = {callback, data, false, keep_ref};
+	size_t idx;
 
 	pthread_mutex_lock(&sig->mutex);
 
 	if (keep_ref)
-		os_atomic_inc_long(&handler->refs);
+		os_atomic_inc_long(&sig->handler->refs);
 
 	idx = signal_get_callback_idx(sig, callback, data);
 	if (keep_ref || idx == DARRAY_INVALID)
@@ -245,6 +307,28 @@ static void signal_handler_connect_internal(signal_handler_t *handler,
 	pthread_mutex_unlock(&sig->mutex);
 }
 
+static void signal_handler_connect_internal(signal_handler_t *handler,
+					    const char *signal,
+					    signal_callback_t callback,
+					    void *data, bool keep_ref)
+{
+	struct signal_info *sig;
+
+	if (!handler)
+		return;
+
+	sig = getsignal_locked(handler, signal);
+	if (!sig) {
+		blog(LOG_WARNING,
+		     "signal_handler_connect: "
+		     "signal '%s' not found",
+		     signal);
+		return;
+	}
+
+	signal_connect_internal(sig, callback, data, keep_ref);
+}
+
 void signal_handler_connect(signal_handler_t *handler, const char *signal,
 			    signal_callback_t callback, void *data)
 {
@@ -257,31 +341,13 @@ void signal_handler_connect_ref(signal_handler_t *handler, const char *signal,
 	signal_handler_connect_internal(handler, signal, callback, data, true);
 }
 
-static inline struct signal_info *getsignal_locked(signal_handler_t *handler,
-						   const char *name)
-{
-	struct signal_info *sig;
-
-	if (!handler)
-		return NULL;
-
-	pthread_mutex_lock(&handler->mutex);
-	sig = getsignal(handler, name, NULL);
-	pthread_mutex_unlock(&handler->mutex);
-
-	return sig;
-}
-
-void signal_handler_disconnect(signal_handler_t *handler, const char *signal,
-			       signal_callback_t callback, void *data)
+static void signal_disconnect_internal(struct signal_info *sig,
+				       signal_callback_t callback, void *data)
 {
-	struct signal_info *sig = getsignal_locked(handler, signal);
+	signal_handler_t *handler = sig->handler;
 	bool keep_ref = false;
 	size_t idx;
 
-	if (!sig)
-		return;
-
 	pthread_mutex_lock(&sig->mutex);
 
 	idx = signal_get_callback_idx(sig, callback, data);
@@ -301,6 +367,15 @@ void signal_handler_disconnect(signal_handler_t *handler, const char *signal,
 	}
 }
 
+void signal_handler_disconnect(signal_handler_t *handler, const char *signal,
+			       signal_callback_t callback, void *data)
+{
+	struct signal_info *sig = getsignal_locked(handler, signal);
+
+	if (sig)
+		signal_disconnect_internal(sig, callback, data);
+}
+
 static THREAD_LOCAL struct signal_callback *current_signal_cb = NULL;
 static THREAD_LOCAL struct global_callback_info *current_global_cb = NULL;
 
@@ -312,15 +387,12 @@ void signal_handler_remove_current(void)
 		current_global_cb->remove = true;
 }
 
-void signal_handler_signal(signal_handler_t *handler, const char *signal,
-			   calldata_t *params)
+static void signal_internal(struct signal_info *sig, calldata_t *params)
 {
-	struct signal_info *sig = getsignal_locked(handler, signal);
+	signal_handler_t *handler = sig->handler;
+	const char *signal = sig->func.name;
 	long remove_refs = 0;
 
-	if (!sig)
-		return;
-
 	pthread_mutex_lock(&sig->mutex);
 	sig->signalling = true;
 
@@ -380,6 +452,55 @@ void signal_handler_signal(signal_handler_t *handler, const char *signal,
 	}
 }
 
+void signal_handler_signal(signal_handler_t *handler, const char *signal,
+			   calldata_t *params)
+{
+	struct signal_info *sig = getsignal_locked(handler, signal);
+
+	if (sig)
+		signal_internal(sig, params);
+}
+
+/* ------------------------------------------------------------------------- */
+
+signal_handle_t *signal_handler_get_handle(signal_handler_t *handler,
+					   const char *signal)
+{
+	struct signal_info *sig = getsignal_locked(handler, signal);
+
+	if (!sig && handler)
+		blog(LOG_WARNING,
+		     "signal_handler_get_handle: "
+		     "signal '%s' not found",
+		     signal);
+	return sig;
+}
+
+const char *signal_handle_get_name(const signal_handle_t *signal)
+{
+	return signal ? signal->func.name : NULL;
+}
+
+void signal_handle_connect(signal_handle_t *signal,
+			   signal_callback_t callback, void *data)
+{
+	if (signal)
+		signal_connect_internal(signal, callback, data, false);
+}
+
+void signal_handle_disconnect(signal_handle_t *signal,
+			      signal_callback_t callback, void *data)
+{
+	if (signal)
+		signal_disconnect_internal(signal, callback, data);
+}
+
+void signal_handle_signal(signal_handle_t *signal, calldata_t *params)
+{
+	if (signal)
+		signal_internal(signal, params);
+}
+
 void signal_handler_connect_global(signal_handler_t *handler,
 				   global_signal_callback_t callback,
 				   void *data)
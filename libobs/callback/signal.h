@@ -78,6 +78,29 @@ EXPORT void signal_handler_remove_current(void);
 EXPORT void signal_handler_signal(signal_handler_t *handler, const char *signal,
 				  calldata_t *params);
 
+/*
+ * Signal handles
+ *
+ *   A handle refers directly to a signal of a signal handler, so frequently
+ * used signals can be connected to and emitted without looking up the signal
+ * by name every time.  Handles remain valid for the lifetime of the signal
+ * handler.
+ */
+
+struct signal_info;
+typedef struct signal_info signal_handle_t;
+
+EXPORT signal_handle_t *signal_handler_get_handle(signal_handler_t *handler,
+						  const char *signal);
+EXPORT const char *signal_handle_get_name(const signal_handle_t *signal);
+
+EXPORT void signal_handle_connect(signal_handle_t *signal,
+				  signal_callback_t callback, void *data);
+EXPORT void signal_handle_disconnect(signal_handle_t *signal,
+				     signal_callback_t callback, void *data);
+
+EXPORT void signal_handle_signal(signal_handle_t *signal, calldata_t *params);
+
 #ifdef __cplusplus
 }
 #endif
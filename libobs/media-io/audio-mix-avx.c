@@ -0,0 +1,107 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "audio-mix-avx.h"
+
+#if AUDIO_MIX_AVX
+
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AVX_FUNC
+#else
+#define AVX_FUNC __attribute__((target("avx")))
+#endif
+
+AVX_FUNC void audio_mix_add_avx(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m256 d0 = _mm256_loadu_ps(dst + i);
+		__m256 d1 = _mm256_loadu_ps(dst + i + 8);
+		__m256 s0 = _mm256_loadu_ps(src + i);
+		__m256 s1 = _mm256_loadu_ps(src + i + 8);
+		_mm256_storeu_ps(dst + i, _mm256_add_ps(d0, s0));
+		_mm256_storeu_ps(dst + i + 8, _mm256_add_ps(d1, s1));
+	}
+
+	for (; i < count; i++)
+		dst[i] += src[i];
+}
+
+/* no FMA: the separate multiply and add give the same result as the scalar
+ * version */
+AVX_FUNC void audio_mix_add_mul_avx(float *dst, const float *src,
+				    const float *mul, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m256 d0 = _mm256_loadu_ps(dst + i);
+		__m256 d1 = _mm256_loadu_ps(dst + i + 8);
+		__m256 s0 = _mm256_loadu_ps(src + i);
+		__m256 s1 = _mm256_loadu_ps(src + i + 8);
+		__m256 m0 = _mm256_loadu_ps(mul + i);
+		__m256 m1 = _mm256_loadu_ps(mul + i + 8);
+		s0 = _mm256_mul_ps(s0, m0);
+		s1 = _mm256_mul_ps(s1, m1);
+		_mm256_storeu_ps(dst + i, _mm256_add_ps(d0, s0));
+		_mm256_storeu_ps(dst + i + 8, _mm256_add_ps(d1, s1));
+	}
+
+	for (; i < count; i++)
+		dst[i] += src[i] * mul[i];
+}
+
+AVX_FUNC void audio_mix_clamp_avx(float *data, size_t count)
+{
+	const __m256 min_val = _mm256_set1_ps(-1.0f);
+	const __m256 max_val = _mm256_set1_ps(1.0f);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 val = _mm256_loadu_ps(data + i);
+		val = _mm256_min_ps(_mm256_max_ps(val, min_val), max_val);
+		_mm256_storeu_ps(data + i, val);
+	}
+
+	for (; i < count; i++) {
+		float val = data[i];
+		val = (val > 1.0f) ? 1.0f : val;
+		val = (val < -1.0f) ? -1.0f : val;
+		data[i] = val;
+	}
+}
+
+bool audio_mix_cpu_has_avx(void)
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+
+	/* AVX and OSXSAVE, and the OS must save the YMM registers */
+	if ((info[2] & (1 << 28)) == 0 || (info[2] & (1 << 27)) == 0)
+		return false;
+	return (_xgetbv(0) & 6) == 6;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx") != 0;
+#endif
+}
+
+#endif
@@ -0,0 +1,39 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "../util/c99defs.h"
+
+/*
+ * AVX versions of the audio-mix kernels.  They live in their own file so
+ * that the native AVX intrinsics never meet simde's SSE aliases.
+ */
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || \
+	defined(__i386__)
+#define AUDIO_MIX_AVX 1
+
+extern bool audio_mix_cpu_has_avx(void);
+
+extern void audio_mix_add_avx(float *dst, const float *src, size_t count);
+extern void audio_mix_add_mul_avx(float *dst, const float *src,
+				  const float *mul, size_t count);
+extern void audio_mix_clamp_avx(float *data, size_t count);
+#else
+#define AUDIO_MIX_AVX 0
+#endif
@@ -0,0 +1,166 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "../util/threading.h"
+#include "../util/sse-intrin.h"
+#include "audio-mix.h"
+#include "audio-mix-avx.h"
+
+struct audio_mix_funcs {
+	const char *name;
+	void (*add)(float *dst, const float *src, size_t count);
+	void (*add_mul)(float *dst, const float *src, const float *mul,
+			size_t count);
+	void (*clamp)(float *data, size_t count);
+};
+
+/* ------------------------------------------------------------------------- */
+/* scalar                                                                    */
+
+static void add_c(float *dst, const float *src, size_t count)
+{
+	const float *end = src + count;
+
+	while (src < end)
+		*(dst++) += *(src++);
+}
+
+static void add_mul_c(float *dst, const float *src, const float *mul,
+		      size_t count)
+{
+	const float *end = src + count;
+
+	while (src < end)
+		*(dst++) += *(src++) * *(mul++);
+}
+
+static void clamp_c(float *data, size_t count)
+{
+	float *end = data + count;
+
+	while (data < end) {
+		float val = *data;
+		val = (val > 1.0f) ? 1.0f : val;
+		val = (val < -1.0f) ? -1.0f : val;
+		*(data++) = val;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* SSE2 (native on x86, simde everywhere else)                               */
+
+static void add_sse2(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m128 d0 = _mm_loadu_ps(dst + i);
+		__m128 d1 = _mm_loadu_ps(dst + i + 4);
+		__m128 s0 = _mm_loadu_ps(src + i);
+		__m128 s1 = _mm_loadu_ps(src + i + 4);
+		_mm_storeu_ps(dst + i, _mm_add_ps(d0, s0));
+		_mm_storeu_ps(dst + i + 4, _mm_add_ps(d1, s1));
+	}
+
+	add_c(dst + i, src + i, count - i);
+}
+
+static void add_mul_sse2(float *dst, const float *src, const float *mul,
+			 size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m128 d0 = _mm_loadu_ps(dst + i);
+		__m128 d1 = _mm_loadu_ps(dst + i + 4);
+		__m128 s0 = _mm_loadu_ps(src + i);
+		__m128 s1 = _mm_loadu_ps(src + i + 4);
+		__m128 m0 = _mm_loadu_ps(mul + i);
+		__m128 m1 = _mm_loadu_ps(mul + i + 4);
+		_mm_storeu_ps(dst + i, _mm_add_ps(d0, _mm_mul_ps(s0, m0)));
+		_mm_storeu_ps(dst + i + 4, _mm_add_ps(d1, _mm_mul_ps(s1, m1)));
+	}
+
+	add_mul_c(dst + i, src + i, mul + i, count - i);
+}
+
+static void clamp_sse2(float *data, size_t count)
+{
+	const __m128 min_val = _mm_set1_ps(-1.0f);
+	const __m128 max_val = _mm_set1_ps(1.0f);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 val = _mm_loadu_ps(data + i);
+		val = _mm_min_ps(_mm_max_ps(val, min_val), max_val);
+		_mm_storeu_ps(data + i, val);
+	}
+
+	clamp_c(data + i, count - i);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static const struct audio_mix_funcs funcs_c = {"c", add_c, add_mul_c,
+					       clamp_c};
+static const struct audio_mix_funcs funcs_sse2 = {"sse2", add_sse2,
+						  add_mul_sse2, clamp_sse2};
+#if AUDIO_MIX_AVX
+static const struct audio_mix_funcs funcs_avx = {"avx", audio_mix_add_avx,
+						 audio_mix_add_mul_avx,
+						 audio_mix_clamp_avx};
+#endif
+
+static const struct audio_mix_funcs *funcs = &funcs_c;
+static pthread_once_t funcs_once = PTHREAD_ONCE_INIT;
+
+static void select_funcs(void)
+{
+	funcs = &funcs_sse2;
+
+#if AUDIO_MIX_AVX
+	if (audio_mix_cpu_has_avx())
+		funcs = &funcs_avx;
+#endif
+}
+
+static inline const struct audio_mix_funcs *get_funcs(void)
+{
+	pthread_once(&funcs_once, select_funcs);
+	return funcs;
+}
+
+void audio_mix_add(float *dst, const float *src, size_t count)
+{
+	get_funcs()->add(dst, src, count);
+}
+
+void audio_mix_add_mul(float *dst, const float *src, const float *mul,
+		       size_t count)
+{
+	get_funcs()->add_mul(dst, src, mul, count);
+}
+
+void audio_mix_clamp(float *data, size_t count)
+{
+	get_funcs()->clamp(data, count);
+}
+
+const char *audio_mix_get_impl_name(void)
+{
+	return get_funcs()->name;
+}
@@ -0,0 +1,49 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "../util/c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Float mixing kernels used by the audio thread.
+ *
+ *   The best implementation for the current CPU (AVX, SSE2 or plain C) is
+ * selected the first time any of these functions is called.  Buffers do not
+ * need to be aligned.
+ */
+
+/** Accumulates count floats: dst[i] += src[i] */
+EXPORT void audio_mix_add(float *dst, const float *src, size_t count);
+
+/** Accumulates count floats with a gain per float: dst[i] += src[i] * mul[i] */
+EXPORT void audio_mix_add_mul(float *dst, const float *src, const float *mul,
+			      size_t count);
+
+/** Clamps count floats in place to the -1.0..1.0 range */
+EXPORT void audio_mix_clamp(float *data, size_t count);
+
+/** Returns the name of the selected kernel implementation ("avx", etc) */
+EXPORT const char *audio_mix_get_impl_name(void);
+
+#ifdef __cplusplus
+}
+#endif
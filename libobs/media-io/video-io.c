@@ -21,6 +21,7 @@
 #include "../util/platform.h"
 #include "../util/profiler.h"
 #include "../util/threading.h"
+#include "../util/task-pool.h"
 #include "../util/darray.h"
 #include "../util/util_uint64.h"
 
@@ -31,20 +32,152 @@
 
 extern profiler_name_store_t *obs_get_profiler_name_store(void);
 
-#define MAX_CONVERT_BUFFERS 3
 #define MAX_CACHE_SIZE 16
 
+/* ------------------------------------------------------------------------- */
+/* frame buffers are reference counted so that callbacks can hold on to a
+ * frame (see video_data_addref) instead of copying it.  a buffer that is
+ * still referenced is never written to again; whoever writes frames takes a
+ * fresh buffer from the pool instead.  the pool itself is referenced by its
+ * owner and by each buffer that is out, so buffers can outlive the input or
+ * output they came from. */
+
+struct video_buffer_pool {
+	volatile long refs;
+	pthread_mutex_t mutex;
+	DARRAY(struct video_output_buffer *) free_buffers;
+
+	enum video_format format;
+	uint32_t width;
+	uint32_t height;
+};
+
+struct video_output_buffer {
+	volatile long refs;
+	struct video_buffer_pool *pool;
+	struct video_frame frame;
+};
+
+static struct video_buffer_pool *
+video_buffer_pool_create(enum video_format format, uint32_t width,
+			 uint32_t height)
+{
+	struct video_buffer_pool *pool = bzalloc(sizeof(*pool));
+
+	if (pthread_mutex_init(&pool->mutex, NULL) != 0) {
+		bfree(pool);
+		return NULL;
+	}
+
+	pool->refs = 1;
+	pool->format = format;
+	pool->width = width;
+	pool->height = height;
+	return pool;
+}
+
+static void video_buffer_pool_release(struct video_buffer_pool *pool)
+{
+	if (!pool || os_atomic_dec_long(&pool->refs) != 0)
+		return;
+
+	for (size_t i = 0; i < pool->free_buffers.num; i++) {
+		struct video_output_buffer *buf = pool->free_buffers.array[i];
+
+		video_frame_free(&buf->frame);
+		bfree(buf);
+	}
+
+	da_free(pool->free_buffers);
+	pthread_mutex_destroy(&pool->mutex);
+	bfree(pool);
+}
+
+static struct video_output_buffer *
+video_buffer_pool_get(struct video_buffer_pool *pool)
+{
+	struct video_output_buffer *buf = NULL;
+
+	pthread_mutex_lock(&pool->mutex);
+	if (pool->free_buffers.num) {
+		buf = pool->free_buffers.array[pool->free_buffers.num - 1];
+		da_pop_back(pool->free_buffers);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+
+	if (!buf) {
+		buf = bzalloc(sizeof(*buf));
+		buf->pool = pool;
+		video_frame_init(&buf->frame, pool->format, pool->width,
+				 pool->height);
+	}
+
+	buf->refs = 1;
+	os_atomic_inc_long(&pool->refs);
+	return buf;
+}
+
+static inline bool video_buffer_shared(struct video_output_buffer *buf)
+{
+	return os_atomic_load_long(&buf->refs) > 1;
+}
+
+void video_output_buffer_release(struct video_output_buffer *buf)
+{
+	struct video_buffer_pool *pool;
+
+	if (!buf || os_atomic_dec_long(&buf->refs) != 0)
+		return;
+
+	pool = buf->pool;
+
+	pthread_mutex_lock(&pool->mutex);
+	da_push_back(pool->free_buffers, &buf);
+	pthread_mutex_unlock(&pool->mutex);
+
+	video_buffer_pool_release(pool);
+}
+
+static inline void set_frame_buffer(struct video_data *data,
+				    const struct video_output_buffer *buf)
+{
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		data->data[i] = buf->frame.data[i];
+		data->linesize[i] = buf->frame.linesize[i];
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
 struct cached_frame_info {
 	struct video_data frame;
+	struct video_output_buffer *buf;
+	struct video_latency latency;
 	int skipped;
 	int count;
 };
 
+/* what callbacks are given: the public frame, followed by what video-io
+ * keeps about it */
+struct video_output_frame {
+	struct video_data data;
+	struct video_output_buffer *buf;
+	struct video_latency latency;
+};
+
+/* the frame a callback is being given on this thread.  frames are only
+ * looked up through it, so a video_data that did not come from video-io is
+ * never mistaken for one that did */
+static THREAD_LOCAL const struct video_output_frame *current_frame = NULL;
+
 struct video_input {
 	struct video_scale_info conversion;
 	video_scaler_t *scaler;
-	struct video_frame frame[MAX_CONVERT_BUFFERS];
-	int cur_frame;
+	struct video_buffer_pool *pool;
+
+	/* filled in by scale_inputs, possibly on a task pool thread */
+	struct video_output_frame scaled;
+	bool scale_success;
 
 	void (*callback)(void *param, struct video_data *frame);
 	void *param;
@@ -52,8 +185,7 @@ struct video_input {
 
 static inline void video_input_free(struct video_input *input)
 {
-	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-		video_frame_free(&input->frame[i]);
+	video_buffer_pool_release(input->pool);
 	video_scaler_destroy(input->scaler);
 }
 
@@ -77,6 +209,7 @@ struct video_output {
 	size_t available_frames;
 	size_t first_added;
 	size_t last_added;
+	struct video_buffer_pool *cache_pool;
 	struct cached_frame_info cache[MAX_CACHE_SIZE];
 
 	volatile bool raw_active;
@@ -86,34 +219,69 @@ struct video_output {
 /* ------------------------------------------------------------------------- */
 
 static inline bool scale_video_output(struct video_input *input,
-				      struct video_data *data)
+				      struct video_output_frame *out)
 {
-	bool success = true;
+	struct video_output_buffer *buf;
+	struct video_data *data = &out->data;
+	bool success;
+
+	/* the source buffer stays referenced by the cache, the scaled one
+	 * belongs to this frame and is released after the callback */
+	buf = video_buffer_pool_get(input->pool);
+
+	success = video_scaler_scale(input->scaler, buf->frame.data,
+				     buf->frame.linesize,
+				     (const uint8_t *const *)data->data,
+				     data->linesize);
+
+	if (success) {
+		set_frame_buffer(data, buf);
+		out->buf = buf;
+	} else {
+		blog(LOG_WARNING, "video-io: Could not scale frame!");
+		video_output_buffer_release(buf);
+	}
 
-	if (input->scaler) {
-		struct video_frame *frame;
+	return success;
+}
 
-		if (++input->cur_frame == MAX_CONVERT_BUFFERS)
-			input->cur_frame = 0;
+static void scale_input_task(void *param, uint32_t idx)
+{
+	struct video_output *video = param;
+	struct video_input *input = video->inputs.array + idx;
 
-		frame = &input->frame[input->cur_frame];
+	if (input->scaler)
+		input->scale_success = scale_video_output(input,
+							  &input->scaled);
+	else
+		input->scale_success = true;
+}
 
-		success = video_scaler_scale(input->scaler, frame->data,
-					     frame->linesize,
-					     (const uint8_t *const *)data->data,
-					     data->linesize);
+/* Each input has its own scaler and buffers, so when more than one of them
+ * needs scaling they are scaled side by side on the task pool, and the frame
+ * costs as much as the slowest scale rather than the sum of all of them. */
+static void scale_inputs(struct video_output *video,
+			 const struct cached_frame_info *frame_info)
+{
+	size_t scalers = 0;
 
-		if (success) {
-			for (size_t i = 0; i < MAX_AV_PLANES; i++) {
-				data->data[i] = frame->data[i];
-				data->linesize[i] = frame->linesize[i];
-			}
-		} else {
-			blog(LOG_WARNING, "video-io: Could not scale frame!");
-		}
+	for (size_t i = 0; i < video->inputs.num; i++) {
+		struct video_input *input = video->inputs.array + i;
+
+		input->scaled.data = frame_info->frame;
+		input->scaled.buf = frame_info->buf;
+		input->scaled.latency = frame_info->latency;
+		if (input->scaler)
+			scalers++;
 	}
 
-	return success;
+	if (scalers > 1) {
+		task_pool_run((uint32_t)video->inputs.num, scale_input_task,
+			      video);
+	} else {
+		for (size_t i = 0; i < video->inputs.num; i++)
+			scale_input_task(video, (uint32_t)i);
+	}
 }
 
 static inline bool video_output_cur_frame(struct video_output *video)
@@ -134,12 +302,21 @@ static inline bool video_output_cur_frame(struct video_output *video)
 
 	pthread_mutex_lock(&video->input_mutex);
 
+	scale_inputs(video, frame_info);
+
+	/* callbacks still run in connection order */
 	for (size_t i = 0; i < video->inputs.num; i++) {
 		struct video_input *input = video->inputs.array + i;
-		struct video_data frame = frame_info->frame;
 
-		if (scale_video_output(input, &frame))
-			input->callback(input->param, &frame);
+		if (!input->scale_success)
+			continue;
+
+		current_frame = &input->scaled;
+		input->callback(input->param, &input->scaled.data);
+		current_frame = NULL;
+
+		if (input->scaler)
+			video_output_buffer_release(input->scaled.buf);
 	}
 
 	pthread_mutex_unlock(&video->input_mutex);
@@ -148,7 +325,9 @@ static inline bool video_output_cur_frame(struct video_output *video)
 
 	pthread_mutex_lock(&video->data_mutex);
 
+	/* repeats of the same frame are not traced */
 	frame_info->frame.timestamp += video->frame_time;
+	memset(&frame_info->latency, 0, sizeof(frame_info->latency));
 	complete = --frame_info->count == 0;
 	skipped = frame_info->skipped > 0;
 
@@ -206,20 +385,26 @@ static inline bool valid_video_params(const struct video_output_info *info)
 	       info->fps_num != 0;
 }
 
-static inline void init_cache(struct video_output *video)
+static inline bool init_cache(struct video_output *video)
 {
 	if (video->info.cache_size > MAX_CACHE_SIZE)
 		video->info.cache_size = MAX_CACHE_SIZE;
 
+	video->cache_pool = video_buffer_pool_create(video->info.format,
+						     video->info.width,
+						     video->info.height);
+	if (!video->cache_pool)
+		return false;
+
 	for (size_t i = 0; i < video->info.cache_size; i++) {
-		struct video_frame *frame;
-		frame = (struct video_frame *)&video->cache[i];
+		struct cached_frame_info *cfi = &video->cache[i];
 
-		video_frame_init(frame, video->info.format, video->info.width,
-				 video->info.height);
+		cfi->buf = video_buffer_pool_get(video->cache_pool);
+		set_frame_buffer(&cfi->frame, cfi->buf);
 	}
 
 	video->available_frames = video->info.cache_size;
+	return true;
 }
 
 int video_output_open(video_t **video, struct video_output_info *info)
@@ -249,11 +434,11 @@ int video_output_open(video_t **video, struct video_output_info *info)
 		goto fail;
 	if (os_sem_init(&out->update_semaphore, 0) != 0)
 		goto fail;
+	if (!init_cache(out))
+		goto fail;
 	if (pthread_create(&out->thread, NULL, video_thread, out) != 0)
 		goto fail;
 
-	init_cache(out);
-
 	out->initialized = true;
 	*video = out;
 	return VIDEO_OUTPUT_SUCCESS;
@@ -275,7 +460,8 @@ void video_output_close(video_t *video)
 	da_free(video->inputs);
 
 	for (size_t i = 0; i < video->info.cache_size; i++)
-		video_frame_free((struct video_frame *)&video->cache[i]);
+		video_output_buffer_release(video->cache[i].buf);
+	video_buffer_pool_release(video->cache_pool);
 
 	os_sem_destroy(video->update_semaphore);
 	pthread_mutex_destroy(&video->data_mutex);
@@ -324,11 +510,13 @@ static inline bool video_input_init(struct video_input *input,
 			return false;
 		}
 
-		for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-			video_frame_init(&input->frame[i],
-					 input->conversion.format,
-					 input->conversion.width,
-					 input->conversion.height);
+		input->pool = video_buffer_pool_create(
+			input->conversion.format, input->conversion.width,
+			input->conversion.height);
+		if (!input->pool) {
+			video_scaler_destroy(input->scaler);
+			return false;
+		}
 	}
 
 	return true;
@@ -466,7 +654,20 @@ bool video_output_lock_frame(video_t *video, struct video_frame *frame,
 		}
 
 		cfi = &video->cache[video->last_added];
+
+		/* a callback still holds the last frame written here, so
+		 * write this one to a buffer of its own.  references are only
+		 * taken from callbacks, which are done with this slot by the
+		 * time it is available again, so the count can only drop
+		 * underneath us */
+		if (video_buffer_shared(cfi->buf)) {
+			video_output_buffer_release(cfi->buf);
+			cfi->buf = video_buffer_pool_get(video->cache_pool);
+			set_frame_buffer(&cfi->frame, cfi->buf);
+		}
+
 		cfi->frame.timestamp = timestamp;
+		memset(&cfi->latency, 0, sizeof(cfi->latency));
 		cfi->count = count;
 		cfi->skipped = 0;
 
@@ -493,6 +694,48 @@ void video_output_unlock_frame(video_t *video)
 	pthread_mutex_unlock(&video->data_mutex);
 }
 
+/* only valid between video_output_lock_frame and video_output_unlock_frame */
+void video_output_set_frame_latency(video_t *video,
+				    const struct video_latency *latency)
+{
+	if (!video)
+		return;
+
+	pthread_mutex_lock(&video->data_mutex);
+	video->cache[video->last_added].latency = *latency;
+	pthread_mutex_unlock(&video->data_mutex);
+}
+
+static inline const struct video_output_frame *
+get_output_frame(const struct video_data *frame)
+{
+	if (!frame || !current_frame || frame != &current_frame->data)
+		return NULL;
+	return current_frame;
+}
+
+void video_data_get_latency(const struct video_data *frame,
+			    struct video_latency *latency)
+{
+	const struct video_output_frame *out = get_output_frame(frame);
+
+	if (out)
+		*latency = out->latency;
+	else
+		memset(latency, 0, sizeof(*latency));
+}
+
+struct video_output_buffer *video_data_addref(const struct video_data *frame)
+{
+	const struct video_output_frame *out = get_output_frame(frame);
+
+	if (!out || !out->buf)
+		return NULL;
+
+	os_atomic_inc_long(&out->buf->refs);
+	return out->buf;
+}
+
 uint64_t video_output_get_frame_time(const video_t *video)
 {
 	return video ? video->frame_time : 0;
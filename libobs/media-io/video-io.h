@@ -30,6 +30,8 @@ struct video_frame;
 struct video_output;
 typedef struct video_output video_t;
 
+struct video_output_buffer;
+
 enum video_format {
 	VIDEO_FORMAT_NONE,
 
@@ -83,6 +85,27 @@ enum video_range_type {
 	VIDEO_RANGE_FULL
 };
 
+/*
+ * Stages a video frame passes through on its way to an output.  Each stage
+ * is stamped with os_gettime_ns() as the frame passes it, or left at zero if
+ * the frame did not go through that stage (e.g. a scene without async
+ * sources has no capture time).
+ */
+enum video_latency_stage {
+	VIDEO_LATENCY_CAPTURE,    /* async source frame received */
+	VIDEO_LATENCY_RENDER,     /* composited by the graphics thread */
+	VIDEO_LATENCY_OUTPUT,     /* handed to the video output thread */
+	VIDEO_LATENCY_ENCODE,     /* submitted to the encoder */
+	VIDEO_LATENCY_ENCODED,    /* packet returned by the encoder */
+	VIDEO_LATENCY_INTERLEAVE, /* sent to the output by libobs */
+	VIDEO_LATENCY_SEND,       /* written out by the output */
+	VIDEO_LATENCY_STAGES
+};
+
+struct video_latency {
+	uint64_t ts[VIDEO_LATENCY_STAGES];
+};
+
 struct video_data {
 	uint8_t *data[MAX_AV_PLANES];
 	uint32_t linesize[MAX_AV_PLANES];
@@ -249,6 +272,23 @@ video_output_get_info(const video_t *video);
 EXPORT bool video_output_lock_frame(video_t *video, struct video_frame *frame,
 				    int count, uint64_t timestamp);
 EXPORT void video_output_unlock_frame(video_t *video);
+EXPORT void video_output_set_frame_latency(video_t *video,
+					   const struct video_latency *latency);
+
+/** Gets the pipeline timestamps of a frame given to a video_output_connect
+ * callback.  Only valid within the callback, for the frame it was given;
+ * any other frame gets zeroed timestamps. */
+EXPORT void video_data_get_latency(const struct video_data *frame,
+				   struct video_latency *latency);
+
+/** Keeps the data of a frame given to a video_output_connect callback valid
+ * after the callback returns, without copying it.  The frame's data pointers
+ * stay valid until the returned reference is released with
+ * video_output_buffer_release.  Returns NULL outside of the callback, or for
+ * any frame other than the one the callback was given. */
+EXPORT struct video_output_buffer *
+video_data_addref(const struct video_data *frame);
+EXPORT void video_output_buffer_release(struct video_output_buffer *buf);
 EXPORT uint64_t video_output_get_frame_time(const video_t *video);
 EXPORT void video_output_stop(video_t *video);
 EXPORT bool video_output_stopped(video_t *video);
@@ -224,7 +224,7 @@ static void fader_source_volume_changed(void *vptr, calldata_t *calldata)
 		return;
 	}
 
-	const float mul = (float)calldata_float(calldata, "volume");
+	const float mul = (float)calldata_float_at(calldata, 1, "volume");
 	const float db = mul_to_db(mul);
 	fader->cur_db = db;
 
@@ -239,7 +239,7 @@ static void volmeter_source_volume_changed(void *vptr, calldata_t *calldata)
 
 	pthread_mutex_lock(&volmeter->mutex);
 
-	float mul = (float)calldata_float(calldata, "volume");
+	float mul = (float)calldata_float_at(calldata, 1, "volume");
 	volmeter->cur_db = mul_to_db(mul);
 
 	pthread_mutex_unlock(&volmeter->mutex);
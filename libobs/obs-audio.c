@@ -18,6 +18,8 @@
 #include <inttypes.h>
 #include "obs-internal.h"
 #include "util/util_uint64.h"
+#include "util/task-pool.h"
+#include "media-io/audio-mix.h"
 
 struct ts_info {
 	uint64_t start;
@@ -27,6 +29,20 @@ struct ts_info {
 #define DEBUG_AUDIO 0
 #define DEBUG_LAGGED_AUDIO 0
 #define MAX_BUFFERING_TICKS 45
+#define MIN_PARALLEL_AUDIO_SOURCES 4
+
+/* leaf sources are only rendered on the task pool once rendering them
+ * serially costs enough to be worth waking the pool threads and waiting on
+ * them, which takes tens of microseconds per tick.  libobs' own per-source
+ * work (peeking the input, copying it to each mix, applying volume) takes a
+ * few microseconds, so that is mostly reached through audio_mix callbacks.
+ * the cost is averaged over ticks, and the two thresholds are apart so it
+ * doesn't keep switching between the two */
+#define PARALLEL_AUDIO_START_NS 1000000ULL
+#define PARALLEL_AUDIO_STOP_NS 500000ULL
+#define MAX_AUDIO_RENDER_TASKS (TASK_POOL_MAX_THREADS + 1)
+
+static const char *floats_mixed_name = "audio_callback: floats mixed";
 
 static void push_audio_tree(obs_source_t *parent, obs_source_t *source, void *p)
 {
@@ -46,39 +62,47 @@ static inline size_t convert_time_to_frames(size_t sample_rate, uint64_t t)
 	return (size_t)util_mul_div64(t, sample_rate, 1000000000ULL);
 }
 
-static inline void mix_audio(struct audio_output_data *mixes,
-			     obs_source_t *source, size_t channels,
-			     size_t sample_rate, struct ts_info *ts)
+/* returns the number of floats mixed */
+static inline size_t mix_audio(struct audio_output_data *mixes,
+			       obs_source_t *source, uint32_t mixers,
+			       size_t channels, size_t sample_rate,
+			       struct ts_info *ts)
 {
 	size_t total_floats = AUDIO_OUTPUT_FRAMES;
 	size_t start_point = 0;
+	size_t mixed = 0;
 
 	if (source->audio_ts < ts->start || ts->end <= source->audio_ts)
-		return;
+		return 0;
 
 	if (source->audio_ts != ts->start) {
 		start_point = convert_time_to_frames(
 			sample_rate, source->audio_ts - ts->start);
 		if (start_point == AUDIO_OUTPUT_FRAMES)
-			return;
+			return 0;
 
 		total_floats -= start_point;
 	}
 
+	/* mixes the source isn't assigned to are silent, so skip them along
+	 * with the mixes that have no outputs */
+	mixers &= source->audio_mixers;
+
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
-		for (size_t ch = 0; ch < channels; ch++) {
-			register float *mix = mixes[mix_idx].data[ch];
-			register float *aud =
-				source->audio_output_buf[mix_idx][ch];
-			register float *end;
+		if ((mixers & (1 << mix_idx)) == 0)
+			continue;
 
-			mix += start_point;
-			end = aud + total_floats;
+		for (size_t ch = 0; ch < channels; ch++) {
+			float *mix = mixes[mix_idx].data[ch];
+			float *aud = source->audio_output_buf[mix_idx][ch];
 
-			while (aud < end)
-				*(mix++) += *(aud++);
+			audio_mix_add(mix + start_point, aud, total_floats);
 		}
+
+		mixed += total_floats * channels;
 	}
+
+	return mixed;
 }
 
 static bool ignore_audio(obs_source_t *source, size_t channels,
@@ -435,6 +459,167 @@ static inline const char *calc_min_ts(struct obs_core_data *data,
 	return buffering_name;
 }
 
+struct audio_render_job {
+	struct obs_core_audio *audio;
+	uint32_t mixers;
+	size_t channels;
+	size_t sample_rate;
+	size_t audio_size;
+	const struct ts_info *ts;
+	uint32_t tasks;
+	uint64_t task_ns[MAX_AUDIO_RENDER_TASKS];
+};
+
+static void render_audio_source(const struct audio_render_job *job,
+				obs_source_t *source)
+{
+	struct obs_core_audio *audio = job->audio;
+	uint32_t mixers = job->mixers;
+	size_t channels = job->channels;
+	size_t sample_rate = job->sample_rate;
+	size_t audio_size = job->audio_size;
+
+	obs_source_audio_render(source, mixers, channels, sample_rate,
+				audio_size);
+
+	/* if a source has gone backward in time and we can no
+	 * longer buffer, drop some or all of its audio */
+	if (audio->total_buffering_ticks == MAX_BUFFERING_TICKS &&
+	    source->audio_ts < job->ts->start) {
+		if (source->info.audio_render) {
+			blog(LOG_DEBUG,
+			     "render audio source %s timestamp has "
+			     "gone backwards",
+			     obs_source_get_name(source));
+
+			/* just avoid further damage */
+			source->audio_pending = true;
+#if DEBUG_AUDIO == 1
+			/* this should really be fixed */
+			assert(false);
+#endif
+		} else {
+			pthread_mutex_lock(&source->audio_buf_mutex);
+			bool rerender = ignore_audio(source, channels,
+						     sample_rate,
+						     job->ts->start);
+			pthread_mutex_unlock(&source->audio_buf_mutex);
+
+			/* if we (potentially) recovered, re-render */
+			if (rerender)
+				obs_source_audio_render(source, mixers,
+							channels, sample_rate,
+							audio_size);
+		}
+	}
+}
+
+/* audio_mix is plugin code, so it's only called off the audio thread if the
+ * source type says that's safe.  everything else a leaf source renders is
+ * libobs' own and only touches the source itself */
+static inline bool is_leaf_audio_source(const obs_source_t *source)
+{
+	if (source->info.audio_render || !source->audio_output_buf[0][0])
+		return false;
+
+	return !source->info.audio_mix ||
+	       (source->info.output_flags & OBS_SOURCE_THREADED_AUDIO) != 0;
+}
+
+static void render_leaf_sources_task(void *param, uint32_t idx)
+{
+	struct audio_render_job *job = param;
+	struct obs_core_audio *audio = job->audio;
+	uint64_t start = os_gettime_ns();
+
+	for (size_t i = idx; i < audio->leaf_sources.num; i += job->tasks)
+		render_audio_source(job, audio->leaf_sources.array[i]);
+
+	job->task_ns[idx] = os_gettime_ns() - start;
+}
+
+/* the average time it takes to render the leaf sources one after the other,
+ * which for the parallel path is the time all tasks took added up */
+static void update_leaf_render_cost(struct obs_core_audio *audio,
+				    uint64_t cost)
+{
+	if (!audio->leaf_render_ns)
+		audio->leaf_render_ns = cost;
+	else
+		audio->leaf_render_ns = (audio->leaf_render_ns * 7 + cost) / 8;
+
+	if (audio->parallel_render)
+		audio->parallel_render = audio->leaf_render_ns >=
+					 PARALLEL_AUDIO_STOP_NS;
+	else
+		audio->parallel_render = audio->leaf_render_ns >=
+					 PARALLEL_AUDIO_START_NS;
+}
+
+static void render_leaf_sources(struct audio_render_job *job)
+{
+	struct obs_core_audio *audio = job->audio;
+	size_t leaves = audio->leaf_sources.num;
+	uint64_t cost = 0;
+
+	job->tasks = 1;
+	if (audio->parallel_render && leaves >= MIN_PARALLEL_AUDIO_SOURCES) {
+		job->tasks = task_pool_threads();
+		if (job->tasks > MAX_AUDIO_RENDER_TASKS)
+			job->tasks = MAX_AUDIO_RENDER_TASKS;
+		if (job->tasks > (uint32_t)leaves)
+			job->tasks = (uint32_t)leaves;
+	}
+
+	if (job->tasks > 1)
+		task_pool_run(job->tasks, render_leaf_sources_task, job);
+	else
+		render_leaf_sources_task(job, 0);
+
+	for (uint32_t i = 0; i < job->tasks; i++)
+		cost += job->task_ns[i];
+
+	update_leaf_render_cost(audio, cost);
+}
+
+/*
+ * Leaf sources (no audio_render callback) only read and write their own
+ * buffers, so they can all be rendered at the same time, and are rendered
+ * first.  Sources that do have one (scenes, transitions, ...) mix the output
+ * of the sources below them, so they are rendered afterwards, one at a time
+ * and in render order.  Since the render order has every source after all
+ * of its children, each source still sees exactly the same input as when
+ * rendering everything in order on this thread.
+ *
+ * Whether the leaf sources go to the task pool is decided by how long they
+ * take to render, see PARALLEL_AUDIO_START_NS.  Audio filters don't run
+ * here, they run when the audio is output (on the thread of the source or
+ * its DSP thread), so this mostly pays off with audio_mix sources.
+ */
+static void render_audio_sources(struct audio_render_job *job)
+{
+	struct obs_core_audio *audio = job->audio;
+
+	da_resize(audio->leaf_sources, 0);
+
+	for (size_t i = 0; i < audio->render_order.num; i++) {
+		obs_source_t *source = audio->render_order.array[i];
+
+		if (is_leaf_audio_source(source))
+			da_push_back(audio->leaf_sources, &source);
+	}
+
+	if (audio->leaf_sources.num)
+		render_leaf_sources(job);
+
+	for (size_t i = 0; i < audio->render_order.num; i++) {
+		obs_source_t *source = audio->render_order.array[i];
+
+		if (!is_leaf_audio_source(source))
+			render_audio_source(job, source);
+	}
+}
+
 static inline void release_audio_sources(struct obs_core_audio *audio)
 {
 	for (size_t i = 0; i < audio->render_order.num; i++)
@@ -493,43 +678,16 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 
 	/* ------------------------------------------------ */
 	/* render audio data */
-	for (size_t i = 0; i < audio->render_order.num; i++) {
-		obs_source_t *source = audio->render_order.array[i];
-		obs_source_audio_render(source, mixers, channels, sample_rate,
-					audio_size);
-
-		/* if a source has gone backward in time and we can no
-		 * longer buffer, drop some or all of its audio */
-		if (audio->total_buffering_ticks == MAX_BUFFERING_TICKS &&
-		    source->audio_ts < ts.start) {
-			if (source->info.audio_render) {
-				blog(LOG_DEBUG,
-				     "render audio source %s timestamp has "
-				     "gone backwards",
-				     obs_source_get_name(source));
-
-				/* just avoid further damage */
-				source->audio_pending = true;
-#if DEBUG_AUDIO == 1
-				/* this should really be fixed */
-				assert(false);
-#endif
-			} else {
-				pthread_mutex_lock(&source->audio_buf_mutex);
-				bool rerender = ignore_audio(source, channels,
-							     sample_rate,
-							     ts.start);
-				pthread_mutex_unlock(&source->audio_buf_mutex);
-
-				/* if we (potentially) recovered, re-render */
-				if (rerender)
-					obs_source_audio_render(source, mixers,
-								channels,
-								sample_rate,
-								audio_size);
-			}
-		}
-	}
+	struct audio_render_job job = {
+		.audio = audio,
+		.mixers = mixers,
+		.channels = channels,
+		.sample_rate = sample_rate,
+		.audio_size = audio_size,
+		.ts = &ts,
+	};
+
+	render_audio_sources(&job);
 
 	/* ------------------------------------------------ */
 	/* get minimum audio timestamp */
@@ -546,6 +704,8 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 	/* ------------------------------------------------ */
 	/* mix audio */
 	if (!audio->buffering_wait_ticks) {
+		size_t floats_mixed = 0;
+
 		for (size_t i = 0; i < audio->root_nodes.num; i++) {
 			obs_source_t *source = audio->root_nodes.array[i];
 
@@ -555,11 +715,14 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 			pthread_mutex_lock(&source->audio_buf_mutex);
 
 			if (source->audio_output_buf[0][0] && source->audio_ts)
-				mix_audio(mixes, source, channels, sample_rate,
-					  &ts);
+				floats_mixed += mix_audio(mixes, source, mixers,
+							  channels, sample_rate,
+							  &ts);
 
 			pthread_mutex_unlock(&source->audio_buf_mutex);
 		}
+
+		profile_counter_set(floats_mixed_name, (int64_t)floats_mixed);
 	}
 
 	/* ------------------------------------------------ */
@@ -15,7 +15,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
-#include "obs.h"
+#include "obs-internal.h"
 #include "obs-avc.h"
 #include "util/array-serializer.h"
 
@@ -135,17 +135,19 @@ void obs_parse_avc_packet(struct encoder_packet *avc_packet,
 {
 	struct array_output_data output;
 	struct serializer s;
-	long ref = 1;
 
 	array_output_serializer_init(&s, &output);
 	*avc_packet = *src;
 
-	serialize(&s, &ref, sizeof(ref));
 	serialize_avc_data(&s, src->data, src->size, &avc_packet->keyframe,
 			   &avc_packet->priority);
 
-	avc_packet->data = output.bytes.array + sizeof(ref);
-	avc_packet->size = output.bytes.num - sizeof(ref);
+	/* released like any other packet, so it has to come from the pool */
+	avc_packet->data = obs_encoder_packet_data_alloc(output.bytes.num);
+	avc_packet->size = output.bytes.num;
+	memcpy(avc_packet->data, output.bytes.array, output.bytes.num);
+	array_output_serializer_free(&output);
+
 	avc_packet->drop_priority = get_drop_priority(avc_packet->priority);
 }
 
@@ -31,8 +31,10 @@
 struct obs_data_item {
 	volatile long ref;
 	struct obs_data *parent;
+	struct obs_data_item *prev;
 	struct obs_data_item *next;
 	enum obs_data_type type;
+	uint32_t name_hash;
 	size_t name_len;
 	size_t data_len;
 	size_t data_size;
@@ -46,6 +48,13 @@ struct obs_data {
 	volatile long ref;
 	char *json;
 	struct obs_data_item *first_item;
+	struct obs_data_item *last_item;
+	size_t num_items;
+
+	/* open addressing hash table of items by name, only created once
+	 * the object has enough items for it to be worth it */
+	struct obs_data_item **index;
+	size_t index_size;
 };
 
 struct obs_data_array {
@@ -88,6 +97,19 @@ static inline char *get_item_name(struct obs_data_item *item)
 	return (char *)item + sizeof(struct obs_data_item);
 }
 
+/* FNV-1a */
+static inline uint32_t get_name_hash(const char *name)
+{
+	uint32_t hash = 2166136261u;
+
+	while (*name) {
+		hash ^= (uint8_t)*(name++);
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
 static inline void *get_data_ptr(obs_data_item_t *item)
 {
 	return (uint8_t *)get_item_name(item) + item->name_len;
@@ -297,50 +319,202 @@ static struct obs_data_item *obs_data_item_create(const char *name,
 
 	strcpy(get_item_name(item), name);
 	memcpy(get_item_data(item), data, size);
+	item->name_hash = get_name_hash(name);
 
 	item_data_addref(item);
 	return item;
 }
 
-static struct obs_data_item **get_item_prev_next(struct obs_data *data,
-						 struct obs_data_item *current)
+/* ------------------------------------------------------------------------- */
+/* Item index */
+
+#define ITEM_INDEX_MIN_ITEMS 16
+
+static inline size_t index_home(const struct obs_data *data, uint32_t hash)
 {
-	if (!current || !data)
-		return NULL;
+	return hash & (data->index_size - 1);
+}
+
+static void index_insert(struct obs_data *data, struct obs_data_item *item)
+{
+	size_t i = index_home(data, item->name_hash);
 
-	struct obs_data_item **prev_next = &data->first_item;
+	while (data->index[i])
+		i = (i + 1) & (data->index_size - 1);
+	data->index[i] = item;
+}
+
+static void index_rebuild(struct obs_data *data, size_t size)
+{
 	struct obs_data_item *item = data->first_item;
 
-	while (item) {
-		if (item == current)
-			return prev_next;
+	bfree(data->index);
+	data->index = bzalloc(size * sizeof(struct obs_data_item *));
+	data->index_size = size;
 
-		prev_next = &item->next;
+	while (item) {
+		index_insert(data, item);
 		item = item->next;
 	}
+}
+
+/* called after the item has been linked in */
+static void index_add(struct obs_data *data, struct obs_data_item *item)
+{
+	if (!data->index) {
+		if (data->num_items >= ITEM_INDEX_MIN_ITEMS)
+			index_rebuild(data, ITEM_INDEX_MIN_ITEMS * 4);
+		return;
+	}
+
+	/* keep the table at most half full */
+	if (data->num_items * 2 > data->index_size)
+		index_rebuild(data, data->index_size * 2);
+	else
+		index_insert(data, item);
+}
+
+static size_t index_find_slot(const struct obs_data *data,
+			      const struct obs_data_item *item, uint32_t hash)
+{
+	size_t i = index_home(data, hash);
+
+	while (data->index[i] != item)
+		i = (i + 1) & (data->index_size - 1);
+	return i;
+}
+
+static void index_remove(struct obs_data *data, struct obs_data_item *item)
+{
+	size_t mask = data->index_size - 1;
+	size_t i, j;
+
+	if (!data->index)
+		return;
+
+	/* move back any following items that would no longer be reachable */
+	i = index_find_slot(data, item, item->name_hash);
+	data->index[i] = NULL;
+
+	for (j = (i + 1) & mask; data->index[j]; j = (j + 1) & mask) {
+		size_t home = index_home(data, data->index[j]->name_hash);
+		bool in_place = (i <= j) ? (i < home && home <= j)
+					 : (i < home || home <= j);
+		if (in_place)
+			continue;
+
+		data->index[i] = data->index[j];
+		data->index[j] = NULL;
+		i = j;
+	}
+}
+
+static struct obs_data_item *index_get(struct obs_data *data,
+				       const char *name)
+{
+	uint32_t hash = get_name_hash(name);
+	size_t i = index_home(data, hash);
+	struct obs_data_item *item;
+
+	while ((item = data->index[i]) != NULL) {
+		if (item->name_hash == hash &&
+		    strcmp(get_item_name(item), name) == 0)
+			return item;
+
+		i = (i + 1) & (data->index_size - 1);
+	}
 
 	return NULL;
 }
 
-static inline void obs_data_item_detach(struct obs_data_item *item)
+/* ------------------------------------------------------------------------- */
+
+static inline bool obs_data_item_attached(struct obs_data_item *item)
 {
-	struct obs_data_item **prev_next =
-		get_item_prev_next(item->parent, item);
+	return item->parent && (item->prev || item->parent->first_item == item);
+}
 
-	if (prev_next) {
-		*prev_next = item->next;
-		item->next = NULL;
+/* items are kept sorted by name, and are usually added in that order */
+static void obs_data_item_attach(struct obs_data *data,
+				 struct obs_data_item *item)
+{
+	const char *name = get_item_name(item);
+	struct obs_data_item *prev = data->last_item;
+
+	if (prev && strcmp(get_item_name(prev), name) > 0) {
+		struct obs_data_item *cur = data->first_item;
+
+		prev = NULL;
+		while (cur && strcmp(get_item_name(cur), name) < 0) {
+			prev = cur;
+			cur = cur->next;
+		}
 	}
+
+	item->parent = data;
+	item->prev = prev;
+	item->next = prev ? prev->next : data->first_item;
+
+	if (prev)
+		prev->next = item;
+	else
+		data->first_item = item;
+
+	if (item->next)
+		item->next->prev = item;
+	else
+		data->last_item = item;
+
+	data->num_items++;
+	index_add(data, item);
+}
+
+static inline void obs_data_item_detach(struct obs_data_item *item)
+{
+	struct obs_data *data = item->parent;
+
+	if (!obs_data_item_attached(item))
+		return;
+
+	if (item->prev)
+		item->prev->next = item->next;
+	else
+		data->first_item = item->next;
+
+	if (item->next)
+		item->next->prev = item->prev;
+	else
+		data->last_item = item->prev;
+
+	index_remove(data, item);
+	data->num_items--;
+
+	item->prev = NULL;
+	item->next = NULL;
 }
 
 static inline void obs_data_item_reattach(struct obs_data_item *old_ptr,
 					  struct obs_data_item *new_ptr)
 {
-	struct obs_data_item **prev_next =
-		get_item_prev_next(new_ptr->parent, old_ptr);
+	struct obs_data *data = new_ptr->parent;
 
-	if (prev_next)
-		*prev_next = new_ptr;
+	/* old_ptr has already been freed, only its address can be used */
+	if (!data || (!new_ptr->prev && data->first_item != old_ptr))
+		return;
+
+	if (new_ptr->prev)
+		new_ptr->prev->next = new_ptr;
+	else
+		data->first_item = new_ptr;
+
+	if (new_ptr->next)
+		new_ptr->next->prev = new_ptr;
+	else
+		data->last_item = new_ptr;
+
+	if (data->index)
+		data->index[index_find_slot(data, old_ptr,
+					    new_ptr->name_hash)] = new_ptr;
 }
 
 static struct obs_data_item *
@@ -708,10 +882,18 @@ static inline void obs_data_destroy(struct obs_data *data)
 
 	while (item) {
 		struct obs_data_item *next = item->next;
+
+		/* items can outlive their parent if still referenced */
+		item->parent = NULL;
+		item->prev = NULL;
+		item->next = NULL;
+
 		obs_data_item_release(&item);
 		item = next;
 	}
 
+	bfree(data->index);
+
 	/* NOTE: don't use bfree for json text, allocated by json */
 	free(data->json);
 	bfree(data);
@@ -772,6 +954,9 @@ static struct obs_data_item *get_item(struct obs_data *data, const char *name)
 	if (!data)
 		return NULL;
 
+	if (data->index)
+		return index_get(data, name);
+
 	struct obs_data_item *item = data->first_item;
 
 	while (item) {
@@ -794,31 +979,8 @@ static void set_item_data(struct obs_data *data, struct obs_data_item **item,
 	if ((!item || (item && !*item)) && data) {
 		new_item = obs_data_item_create(name, ptr, size, type,
 						default_data, autoselect_data);
-
-		obs_data_item_t *prev = obs_data_first(data);
-		obs_data_item_t *next = obs_data_first(data);
-		obs_data_item_next(&next);
-		for (; prev && next;
-		     obs_data_item_next(&prev), obs_data_item_next(&next)) {
-			if (strcmp(get_item_name(next), name) > 0)
-				break;
-		}
-
-		new_item->parent = data;
-		if (prev && strcmp(get_item_name(prev), name) < 0) {
-			prev->next = new_item;
-			new_item->next = next;
-
-		} else {
-			data->first_item = new_item;
-			new_item->next = prev;
-		}
-
-		if (!prev)
-			data->first_item = new_item;
-
-		obs_data_item_release(&prev);
-		obs_data_item_release(&next);
+		if (new_item)
+			obs_data_item_attach(data, new_item);
 
 	} else if (default_data) {
 		obs_data_item_set_default_data(item, ptr, size, type);
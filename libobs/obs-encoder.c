@@ -50,6 +50,7 @@ static bool init_encoder(struct obs_encoder *encoder, const char *name,
 	pthread_mutex_init_value(&encoder->callbacks_mutex);
 	pthread_mutex_init_value(&encoder->outputs_mutex);
 	pthread_mutex_init_value(&encoder->pause.mutex);
+	pthread_mutex_init_value(&encoder->video_queue_mutex);
 
 	if (pthread_mutexattr_init(&attr) != 0)
 		return false;
@@ -66,6 +67,8 @@ static bool init_encoder(struct obs_encoder *encoder, const char *name,
 		return false;
 	if (pthread_mutex_init(&encoder->pause.mutex, NULL) != 0)
 		return false;
+	if (pthread_mutex_init(&encoder->video_queue_mutex, NULL) != 0)
+		return false;
 
 	if (encoder->orig_info.get_defaults) {
 		encoder->orig_info.get_defaults(encoder->context.settings);
@@ -143,6 +146,8 @@ obs_encoder_t *obs_audio_encoder_create(const char *id, const char *name,
 
 static void receive_video(void *param, struct video_data *frame);
 static void receive_audio(void *param, size_t mix_idx, struct audio_data *data);
+static bool start_video_thread(struct obs_encoder *encoder);
+static void stop_video_thread(struct obs_encoder *encoder);
 
 static inline void get_audio_info(const struct obs_encoder *encoder,
 				  struct audio_convert_info *info)
@@ -211,6 +216,12 @@ static void add_connection(struct obs_encoder *encoder)
 		if (gpu_encode_available(encoder)) {
 			start_gpu_encode(encoder);
 		} else {
+			if (!start_video_thread(encoder))
+				blog(LOG_WARNING,
+				     "encoder '%s': could not start video "
+				     "thread, encoding on the video thread",
+				     encoder->context.name);
+
 			start_raw_video(encoder->media, &info, receive_video,
 					encoder);
 		}
@@ -229,6 +240,7 @@ static void remove_connection(struct obs_encoder *encoder, bool shutdown)
 			stop_gpu_encode(encoder);
 		} else {
 			stop_raw_video(encoder->media, receive_video, encoder);
+			stop_video_thread(encoder);
 		}
 	}
 
@@ -266,14 +278,17 @@ static void obs_encoder_actually_destroy(obs_encoder_t *encoder)
 		     encoder->context.name);
 
 		free_audio_buffers(encoder);
+		stop_video_thread(encoder);
 
 		if (encoder->context.data)
 			encoder->info.destroy(encoder->context.data);
 		da_free(encoder->callbacks);
+		da_free(encoder->latency_pending);
 		pthread_mutex_destroy(&encoder->init_mutex);
 		pthread_mutex_destroy(&encoder->callbacks_mutex);
 		pthread_mutex_destroy(&encoder->outputs_mutex);
 		pthread_mutex_destroy(&encoder->pause.mutex);
+		pthread_mutex_destroy(&encoder->video_queue_mutex);
 		obs_context_data_free(&encoder->context);
 		if (encoder->owns_info_id)
 			bfree((void *)encoder->info.id);
@@ -523,6 +538,7 @@ void obs_encoder_shutdown(obs_encoder_t *encoder)
 		encoder->first_received = false;
 		encoder->offset_usec = 0;
 		encoder->start_ts = 0;
+		da_resize(encoder->latency_pending, 0);
 	}
 	obs_encoder_set_last_error(encoder, NULL);
 	pthread_mutex_unlock(&encoder->init_mutex);
@@ -856,7 +872,6 @@ static void send_first_video_packet(struct obs_encoder *encoder,
 				    struct encoder_packet *packet)
 {
 	struct encoder_packet first_packet;
-	DARRAY(uint8_t) data;
 	uint8_t *sei;
 	size_t size;
 
@@ -864,25 +879,22 @@ static void send_first_video_packet(struct obs_encoder *encoder,
 	if (!packet->keyframe)
 		return;
 
-	da_init(data);
-
 	if (!get_sei(encoder, &sei, &size) || !sei || !size) {
 		cb->new_packet(cb->param, packet);
 		cb->sent_first_packet = true;
 		return;
 	}
 
-	da_push_back_array(data, sei, size);
-	da_push_back_array(data, packet->data, packet->size);
-
 	first_packet = *packet;
-	first_packet.data = data.array;
-	first_packet.size = data.num;
+	first_packet.size = size + packet->size;
+	first_packet.data = obs_encoder_packet_data_alloc(first_packet.size);
+	memcpy(first_packet.data, sei, size);
+	memcpy(first_packet.data + size, packet->data, packet->size);
 
 	cb->new_packet(cb->param, &first_packet);
 	cb->sent_first_packet = true;
 
-	da_free(data);
+	obs_encoder_packet_release(&first_packet);
 }
 
 static inline void send_packet(struct obs_encoder *encoder,
@@ -919,9 +931,14 @@ void full_stop(struct obs_encoder *encoder)
 	}
 }
 
+static inline struct video_latency *packet_latency(const uint8_t *data);
+
 void send_off_encoder_packet(obs_encoder_t *encoder, bool success,
-			     bool received, struct encoder_packet *pkt)
+			     bool received, struct encoder_packet *pkt,
+			     const struct video_latency *latency)
 {
+	struct encoder_packet shared = {0};
+
 	if (!success) {
 		blog(LOG_ERROR, "Error encoding with encoder '%s'",
 		     encoder->context.name);
@@ -947,18 +964,72 @@ void send_off_encoder_packet(obs_encoder_t *encoder, bool success,
 
 		pthread_mutex_lock(&encoder->callbacks_mutex);
 
+		/* every output gets a reference to the same copy of the
+		 * encoder's data, which stays unchanged once sent off */
+		if (encoder->callbacks.num) {
+			obs_encoder_packet_create_instance(&shared, pkt);
+			if (latency)
+				*packet_latency(shared.data) = *latency;
+		}
+
 		for (size_t i = encoder->callbacks.num; i > 0; i--) {
 			struct encoder_callback *cb;
+			struct encoder_packet cb_pkt = shared;
+
 			cb = encoder->callbacks.array + (i - 1);
-			send_packet(encoder, cb, pkt);
+			send_packet(encoder, cb, &cb_pkt);
 		}
 
 		pthread_mutex_unlock(&encoder->callbacks_mutex);
+
+		obs_encoder_packet_release(&shared);
+	}
+}
+
+#define MAX_PENDING_LATENCY 64
+
+/* encoders with frame reordering return packets out of order, so match the
+ * timestamps back up by pts */
+static void push_pending_latency(struct obs_encoder *encoder,
+				 const struct encoder_frame *frame,
+				 const struct video_latency *latency)
+{
+	struct encoder_latency *pending;
+
+	if (!latency || !latency->ts[VIDEO_LATENCY_OUTPUT])
+		return;
+
+	if (encoder->latency_pending.num == MAX_PENDING_LATENCY)
+		da_erase(encoder->latency_pending, 0);
+
+	pending = da_push_back_new(encoder->latency_pending);
+	pending->pts = frame->pts;
+	pending->latency = *latency;
+	pending->latency.ts[VIDEO_LATENCY_ENCODE] = os_gettime_ns();
+}
+
+static bool pop_pending_latency(struct obs_encoder *encoder,
+				const struct encoder_packet *pkt,
+				struct video_latency *latency)
+{
+	for (size_t i = 0; i < encoder->latency_pending.num; i++) {
+		struct encoder_latency *pending =
+			&encoder->latency_pending.array[i];
+
+		if (pending->pts == pkt->pts) {
+			*latency = pending->latency;
+			latency->ts[VIDEO_LATENCY_ENCODED] = os_gettime_ns();
+			da_erase(encoder->latency_pending, i);
+			return true;
+		}
 	}
+
+	return false;
 }
 
 static const char *do_encode_name = "do_encode";
-bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame)
+bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame,
+	       const struct video_latency *latency)
 {
 	profile_start(do_encode_name);
 	if (!encoder->profile_encoder_encode_name)
@@ -967,6 +1038,8 @@ bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame)
 					   "encode(%s)", encoder->context.name);
 
 	struct encoder_packet pkt = {0};
+	struct video_latency pkt_latency;
+	bool has_latency = false;
 	bool received = false;
 	bool success;
 
@@ -974,11 +1047,19 @@ bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame)
 	pkt.timebase_den = encoder->timebase_den;
 	pkt.encoder = encoder;
 
+	if (encoder->info.type == OBS_ENCODER_VIDEO)
+		push_pending_latency(encoder, frame, latency);
+
 	profile_start(encoder->profile_encoder_encode_name);
 	success = encoder->info.encode(encoder->context.data, frame, &pkt,
 				       &received);
 	profile_end(encoder->profile_encoder_encode_name);
-	send_off_encoder_packet(encoder, success, received, &pkt);
+
+	if (success && received && encoder->info.type == OBS_ENCODER_VIDEO)
+		has_latency = pop_pending_latency(encoder, &pkt, &pkt_latency);
+
+	send_off_encoder_packet(encoder, success, received, &pkt,
+				has_latency ? &pkt_latency : NULL);
 
 	profile_end(do_encode_name);
 
@@ -1015,45 +1096,284 @@ bool video_pause_check(struct pause_data *pause, uint64_t timestamp)
 	return ignore_frame;
 }
 
-static const char *receive_video_name = "receive_video";
-static void receive_video(void *param, struct video_data *frame)
+static void encode_raw_video(struct obs_encoder *encoder,
+			     struct encoder_video_frame *qf)
 {
-	profile_start(receive_video_name);
-
-	struct obs_encoder *encoder = param;
 	struct obs_encoder *pair = encoder->paired_encoder;
 	struct encoder_frame enc_frame;
 
 	if (!encoder->first_received && pair) {
 		if (!pair->first_received ||
-		    pair->first_raw_ts > frame->timestamp) {
-			goto wait_for_audio;
+		    pair->first_raw_ts > qf->timestamp) {
+			return;
 		}
 	}
 
-	if (video_pause_check(&encoder->pause, frame->timestamp))
-		goto wait_for_audio;
-
 	memset(&enc_frame, 0, sizeof(struct encoder_frame));
 
 	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
-		enc_frame.data[i] = frame->data[i];
-		enc_frame.linesize[i] = frame->linesize[i];
+		enc_frame.data[i] = qf->frame.data[i];
+		enc_frame.linesize[i] = qf->frame.linesize[i];
 	}
 
 	if (!encoder->start_ts)
-		encoder->start_ts = frame->timestamp;
+		encoder->start_ts = qf->timestamp;
 
 	enc_frame.frames = 1;
 	enc_frame.pts = encoder->cur_pts;
 
-	if (do_encode(encoder, &enc_frame))
+	if (do_encode(encoder, &enc_frame, &qf->latency))
 		encoder->cur_pts += encoder->timebase_num;
+}
+
+static void *video_encode_thread(void *param)
+{
+	struct obs_encoder *encoder = param;
+	uint64_t interval = video_output_get_frame_time(encoder->media);
+
+	os_set_thread_name("obs raw encode thread");
+
+	while (os_sem_wait(encoder->video_sem) == 0) {
+		struct encoder_video_frame *qf = NULL;
+		bool stop;
+
+		pthread_mutex_lock(&encoder->video_queue_mutex);
+		stop = encoder->video_thread_stop;
+		if (!stop && encoder->video_queue_num) {
+			uint64_t lag;
+
+			qf = &encoder->video_queue[encoder->video_queue_first];
+
+			lag = os_gettime_ns() - qf->queued_ts;
+			encoder->video_queue_lag = lag;
+			if (lag > encoder->video_queue_max_lag)
+				encoder->video_queue_max_lag = lag;
+		}
+		pthread_mutex_unlock(&encoder->video_queue_mutex);
+
+		if (stop)
+			break;
+
+		/* a frame that was repeated while it sat in the queue is
+		 * encoded once per repeat, the same way video-io and the GPU
+		 * encode thread repeat frames, so timestamps stay in sync */
+		while (qf) {
+			encode_raw_video(encoder, qf);
+
+			pthread_mutex_lock(&encoder->video_queue_mutex);
+			encoder->video_frames_encoded++;
+
+			/* emptied by full_stop after an encode error */
+			if (!encoder->video_queue_num ||
+			    encoder->video_thread_stop) {
+				qf = NULL;
+
+			} else if (--qf->count == 0) {
+				video_output_buffer_release(qf->buf);
+				qf->buf = NULL;
+
+				if (++encoder->video_queue_first ==
+				    ENCODER_VIDEO_QUEUE_SIZE)
+					encoder->video_queue_first = 0;
+				encoder->video_queue_num--;
+				qf = NULL;
+
+			} else {
+				qf->timestamp += interval;
+				memset(&qf->latency, 0, sizeof(qf->latency));
+			}
+			pthread_mutex_unlock(&encoder->video_queue_mutex);
+		}
+	}
+
+	return NULL;
+}
+
+/* call with video_queue_mutex held */
+static void clear_video_queue(struct obs_encoder *encoder)
+{
+	for (size_t i = 0; i < encoder->video_queue_num; i++) {
+		size_t idx = (encoder->video_queue_first + i) %
+			     ENCODER_VIDEO_QUEUE_SIZE;
+		struct encoder_video_frame *qf = &encoder->video_queue[idx];
+
+		video_output_buffer_release(qf->buf);
+		qf->buf = NULL;
+	}
+
+	encoder->video_queue_num = 0;
+}
+
+static bool start_video_thread(struct obs_encoder *encoder)
+{
+	/* still around if the last session ended with an encode error */
+	stop_video_thread(encoder);
+
+	encoder->video_queue_first = 0;
+	encoder->video_queue_num = 0;
+	encoder->video_frames_encoded = 0;
+	encoder->video_frames_repeated = 0;
+	encoder->video_queue_lag = 0;
+	encoder->video_queue_max_lag = 0;
+	encoder->video_thread_stop = false;
+
+	if (os_sem_init(&encoder->video_sem, 0) != 0)
+		return false;
+
+	if (pthread_create(&encoder->video_thread, NULL, video_encode_thread,
+			   encoder) != 0) {
+		os_sem_destroy(encoder->video_sem);
+		encoder->video_sem = NULL;
+		return false;
+	}
+
+	pthread_mutex_lock(&encoder->video_queue_mutex);
+	encoder->video_thread_active = true;
+	pthread_mutex_unlock(&encoder->video_queue_mutex);
+	return true;
+}
+
+static void stop_video_thread(struct obs_encoder *encoder)
+{
+	if (!encoder->video_thread_active)
+		return;
+
+	/* full_stop after an encode error ends up here on the encode thread
+	 * itself, which can't join itself.  drop whatever is still queued
+	 * and leave the thread idle until the encoder is started again or
+	 * destroyed */
+	if (pthread_equal(pthread_self(), encoder->video_thread)) {
+		pthread_mutex_lock(&encoder->video_queue_mutex);
+		clear_video_queue(encoder);
+		pthread_mutex_unlock(&encoder->video_queue_mutex);
+		return;
+	}
+
+	pthread_mutex_lock(&encoder->video_queue_mutex);
+	encoder->video_thread_stop = true;
+	encoder->video_thread_active = false;
+	pthread_mutex_unlock(&encoder->video_queue_mutex);
+
+	os_sem_post(encoder->video_sem);
+	pthread_join(encoder->video_thread, NULL);
+
+	if (encoder->video_frames_repeated)
+		blog(LOG_INFO,
+		     "encoder '%s': %" PRIu32 " of %" PRIu32 " frames "
+		     "repeated due to encoding lag (max queue lag %.1f ms)",
+		     encoder->context.name, encoder->video_frames_repeated,
+		     encoder->video_frames_encoded,
+		     (double)encoder->video_queue_max_lag / 1000000.0);
+
+	pthread_mutex_lock(&encoder->video_queue_mutex);
+	clear_video_queue(encoder);
+	pthread_mutex_unlock(&encoder->video_queue_mutex);
+
+	os_sem_destroy(encoder->video_sem);
+	encoder->video_sem = NULL;
+}
+
+static const char *receive_video_name = "receive_video";
+static void receive_video(void *param, struct video_data *frame)
+{
+	profile_start(receive_video_name);
+
+	struct obs_encoder *encoder = param;
+	struct encoder_video_frame *qf;
+	struct video_output_buffer *buf = NULL;
+
+	if (video_pause_check(&encoder->pause, frame->timestamp))
+		goto wait_for_audio;
+
+	/* a frame that cannot be referenced is only valid for the length of
+	 * this call, so it has to be encoded before returning */
+	if (encoder->video_thread_active)
+		buf = video_data_addref(frame);
+
+	if (!buf) {
+		struct encoder_video_frame direct = {0};
+
+		memcpy(direct.frame.data, frame->data, sizeof(frame->data));
+		memcpy(direct.frame.linesize, frame->linesize,
+		       sizeof(frame->linesize));
+		direct.timestamp = frame->timestamp;
+		video_data_get_latency(frame, &direct.latency);
+		encode_raw_video(encoder, &direct);
+		goto wait_for_audio;
+	}
+
+	pthread_mutex_lock(&encoder->video_queue_mutex);
+
+	/* the encoder is falling behind: have it repeat the newest queued
+	 * frame rather than make the video thread (and every other encoder)
+	 * wait on it */
+	if (encoder->video_queue_num == ENCODER_VIDEO_QUEUE_SIZE) {
+		size_t last = (encoder->video_queue_first +
+			       ENCODER_VIDEO_QUEUE_SIZE - 1) %
+			      ENCODER_VIDEO_QUEUE_SIZE;
+
+		encoder->video_queue[last].count++;
+		encoder->video_frames_repeated++;
+		pthread_mutex_unlock(&encoder->video_queue_mutex);
+
+		video_output_inc_texture_skipped_frames(encoder->media);
+		video_output_buffer_release(buf);
+		goto wait_for_audio;
+	}
+
+	qf = &encoder->video_queue[(encoder->video_queue_first +
+				    encoder->video_queue_num) %
+				   ENCODER_VIDEO_QUEUE_SIZE];
+
+	pthread_mutex_unlock(&encoder->video_queue_mutex);
+
+	/* only the video thread writes to the slots past the end of the
+	 * queue, so they can be filled in unlocked.  video-io leaves the
+	 * frame data alone for as long as the reference is held */
+	qf->buf = buf;
+	memcpy(qf->frame.data, frame->data, sizeof(frame->data));
+	memcpy(qf->frame.linesize, frame->linesize, sizeof(frame->linesize));
+
+	qf->timestamp = frame->timestamp;
+	video_data_get_latency(frame, &qf->latency);
+	qf->count = 1;
+
+	pthread_mutex_lock(&encoder->video_queue_mutex);
+	qf->queued_ts = os_gettime_ns();
+	encoder->video_queue_num++;
+	pthread_mutex_unlock(&encoder->video_queue_mutex);
+
+	os_sem_post(encoder->video_sem);
 
 wait_for_audio:
 	profile_end(receive_video_name);
 }
 
+bool obs_encoder_get_queue_stats(const obs_encoder_t *encoder,
+				 struct obs_encoder_queue_stats *stats)
+{
+	struct obs_encoder *enc = (struct obs_encoder *)encoder;
+
+	if (!obs_encoder_valid(encoder, "obs_encoder_get_queue_stats"))
+		return false;
+	if (!obs_ptr_valid(stats, "obs_encoder_get_queue_stats"))
+		return false;
+
+	pthread_mutex_lock(&enc->video_queue_mutex);
+	if (!enc->video_thread_active) {
+		pthread_mutex_unlock(&enc->video_queue_mutex);
+		return false;
+	}
+
+	stats->queued = (uint32_t)enc->video_queue_num;
+	stats->encoded = enc->video_frames_encoded;
+	stats->repeated = enc->video_frames_repeated;
+	stats->lag_ns = enc->video_queue_lag;
+	stats->max_lag_ns = enc->video_queue_max_lag;
+	pthread_mutex_unlock(&enc->video_queue_mutex);
+	return true;
+}
+
 static void clear_audio(struct obs_encoder *encoder)
 {
 	for (size_t i = 0; i < encoder->planes; i++)
@@ -1174,7 +1494,7 @@ static bool send_audio_data(struct obs_encoder *encoder)
 	enc_frame.frames = (uint32_t)encoder->framesize;
 	enc_frame.pts = encoder->cur_pts;
 
-	if (!do_encode(encoder, &enc_frame))
+	if (!do_encode(encoder, &enc_frame, NULL))
 		return false;
 
 	encoder->cur_pts += encoder->framesize;
@@ -1308,15 +1628,213 @@ void obs_encoder_remove_output(struct obs_encoder *encoder,
 	pthread_mutex_unlock(&encoder->outputs_mutex);
 }
 
+/* ------------------------------------------------------------------------- */
+/* Packet data pool */
+
+/*
+ * Packet data is allocated with an 80 byte header: the pool bucket at the
+ * start, then the pipeline timestamps of video packets, and the reference
+ * count in the last sizeof(long) bytes, right in front of the data.  Sizes
+ * from 256 bytes to 4 MiB are rounded up to one of four steps per power of
+ * two (at most 25% slack) and recycled through a free list per size, so the
+ * per-packet allocations of a long session mostly come from the same
+ * blocks.
+ *
+ * Plugins may still hand out data allocated the old way, with nothing but a
+ * bare long reference count in front of it, so the reference count of
+ * pooled data carries PACKET_REFS_POOLED and only the reference count is
+ * read before deciding what is in front of the data.
+ */
+
+#define PACKET_HEADER_SIZE 80
+#define PACKET_LATENCY_OFFSET 8
+#define PACKET_POOL_MIN_SHIFT 8
+#define PACKET_POOL_MAX_SHIFT 22
+#define PACKET_POOL_STEPS 4
+#define PACKET_POOL_SHIFTS (PACKET_POOL_MAX_SHIFT - PACKET_POOL_MIN_SHIFT)
+#define PACKET_POOL_BUCKETS (PACKET_POOL_SHIFTS * PACKET_POOL_STEPS + 1)
+#define PACKET_POOL_BUCKET_BYTES (8 * 1024 * 1024)
+#define PACKET_POOL_NONE ((uint32_t)-1)
+#define PACKET_REFS_POOLED (1L << 30)
+
+struct packet_pool_bucket {
+	void *free_list;
+	size_t num_free;
+};
+
+static pthread_mutex_t packet_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct packet_pool_bucket packet_pool[PACKET_POOL_BUCKETS];
+static int64_t packet_pool_bytes = 0;
+
+static const char *packet_pool_alloc_name = "encoder packet pool allocs";
+static const char *packet_pool_reuse_name = "encoder packet pool reuses";
+static const char *packet_pool_bytes_name = "encoder packet pool bytes in use";
+
+static uint32_t packet_pool_bucket(size_t size, size_t *capacity)
+{
+	size_t shift = PACKET_POOL_MIN_SHIFT;
+	size_t base, step, idx;
+
+	if (size <= ((size_t)1 << PACKET_POOL_MIN_SHIFT)) {
+		*capacity = (size_t)1 << PACKET_POOL_MIN_SHIFT;
+		return 0;
+	}
+	if (size > ((size_t)1 << PACKET_POOL_MAX_SHIFT)) {
+		*capacity = size;
+		return PACKET_POOL_NONE;
+	}
+
+	while (((size_t)2 << shift) < size)
+		shift++;
+
+	base = (size_t)1 << shift;
+	step = base / PACKET_POOL_STEPS;
+	idx = (size - base + step - 1) / step;
+
+	*capacity = base + idx * step;
+	return (uint32_t)((shift - PACKET_POOL_MIN_SHIFT) * PACKET_POOL_STEPS +
+			  idx);
+}
+
+static inline size_t packet_pool_capacity(uint32_t bucket)
+{
+	size_t shift, idx;
+
+	if (bucket == 0)
+		return (size_t)1 << PACKET_POOL_MIN_SHIFT;
+
+	shift = (bucket - 1) / PACKET_POOL_STEPS + PACKET_POOL_MIN_SHIFT;
+	idx = (bucket - 1) % PACKET_POOL_STEPS + 1;
+	return ((size_t)1 << shift) +
+	       idx * (((size_t)1 << shift) / PACKET_POOL_STEPS);
+}
+
+static inline size_t packet_pool_max_free(uint32_t bucket)
+{
+	size_t max_free =
+		PACKET_POOL_BUCKET_BYTES / packet_pool_capacity(bucket);
+	return max_free < 4 ? 4 : (max_free > 256 ? 256 : max_free);
+}
+
+static inline long *packet_refs(const uint8_t *data)
+{
+	return ((long *)data) - 1;
+}
+
+static inline bool packet_pooled(const uint8_t *data)
+{
+	return (os_atomic_load_long(packet_refs(data)) & PACKET_REFS_POOLED) !=
+	       0;
+}
+
+static inline uint32_t *packet_bucket_ptr(uint8_t *data)
+{
+	return (uint32_t *)(data - PACKET_HEADER_SIZE);
+}
+
+static inline struct video_latency *packet_latency(const uint8_t *data)
+{
+	return (struct video_latency *)(data - PACKET_HEADER_SIZE +
+					PACKET_LATENCY_OFFSET);
+}
+
+/* returns packet data with a reference count of 1 */
+uint8_t *obs_encoder_packet_data_alloc(size_t size)
+{
+	uint8_t *block = NULL;
+	uint8_t *data;
+	size_t capacity;
+	uint32_t bucket = packet_pool_bucket(size, &capacity);
+	int64_t bytes;
+
+	pthread_mutex_lock(&packet_pool_mutex);
+	if (bucket != PACKET_POOL_NONE && packet_pool[bucket].free_list) {
+		struct packet_pool_bucket *b = &packet_pool[bucket];
+
+		block = b->free_list;
+		memcpy(&b->free_list, block + PACKET_HEADER_SIZE,
+		       sizeof(void *));
+		b->num_free--;
+	}
+	if (bucket != PACKET_POOL_NONE)
+		packet_pool_bytes += (int64_t)capacity;
+	bytes = packet_pool_bytes;
+	pthread_mutex_unlock(&packet_pool_mutex);
+
+	if (block) {
+		profile_counter_add(packet_pool_reuse_name, 1);
+	} else {
+		block = bmalloc(PACKET_HEADER_SIZE + capacity);
+		profile_counter_add(packet_pool_alloc_name, 1);
+	}
+	profile_counter_set(packet_pool_bytes_name, bytes);
+
+	data = block + PACKET_HEADER_SIZE;
+	*packet_bucket_ptr(data) = bucket;
+	memset(packet_latency(data), 0, sizeof(struct video_latency));
+	*packet_refs(data) = PACKET_REFS_POOLED | 1;
+	return data;
+}
+
+static void packet_data_free(uint8_t *data)
+{
+	uint8_t *block = data - PACKET_HEADER_SIZE;
+	uint32_t bucket = *packet_bucket_ptr(data);
+	size_t capacity;
+	int64_t bytes;
+
+	capacity = bucket == PACKET_POOL_NONE ? 0
+					      : packet_pool_capacity(bucket);
+
+	pthread_mutex_lock(&packet_pool_mutex);
+	if (bucket != PACKET_POOL_NONE &&
+	    packet_pool[bucket].num_free < packet_pool_max_free(bucket)) {
+		struct packet_pool_bucket *b = &packet_pool[bucket];
+
+		memcpy(data, &b->free_list, sizeof(void *));
+		b->free_list = block;
+		b->num_free++;
+		block = NULL;
+	}
+	if (capacity)
+		packet_pool_bytes -= (int64_t)capacity;
+	bytes = packet_pool_bytes;
+	pthread_mutex_unlock(&packet_pool_mutex);
+
+	profile_counter_set(packet_pool_bytes_name, bytes);
+	bfree(block);
+}
+
+void obs_encoder_packet_pool_free(void)
+{
+	pthread_mutex_lock(&packet_pool_mutex);
+	for (size_t i = 0; i < PACKET_POOL_BUCKETS; i++) {
+		struct packet_pool_bucket *b = &packet_pool[i];
+
+		while (b->free_list) {
+			uint8_t *block = b->free_list;
+			memcpy(&b->free_list, block + PACKET_HEADER_SIZE,
+			       sizeof(void *));
+			bfree(block);
+		}
+		b->num_free = 0;
+	}
+	pthread_mutex_unlock(&packet_pool_mutex);
+}
+
+const struct video_latency *
+obs_encoder_packet_latency(const struct encoder_packet *pkt)
+{
+	static const struct video_latency none = {0};
+	return pkt->data && packet_pooled(pkt->data) ? packet_latency(pkt->data)
+						      : &none;
+}
+
 void obs_encoder_packet_create_instance(struct encoder_packet *dst,
 					const struct encoder_packet *src)
 {
-	long *p_refs;
-
 	*dst = *src;
-	p_refs = bmalloc(src->size + sizeof(long));
-	dst->data = (void *)(p_refs + 1);
-	*p_refs = 1;
+	dst->data = obs_encoder_packet_data_alloc(src->size);
 	memcpy(dst->data, src->data, src->size);
 }
 
@@ -1339,10 +1857,8 @@ void obs_encoder_packet_ref(struct encoder_packet *dst,
 	if (!src)
 		return;
 
-	if (src->data) {
-		long *p_refs = ((long *)src->data) - 1;
-		os_atomic_inc_long(p_refs);
-	}
+	if (src->data)
+		os_atomic_inc_long(packet_refs(src->data));
 
 	*dst = *src;
 }
@@ -1353,9 +1869,12 @@ void obs_encoder_packet_release(struct encoder_packet *pkt)
 		return;
 
 	if (pkt->data) {
-		long *p_refs = ((long *)pkt->data) - 1;
-		if (os_atomic_dec_long(p_refs) == 0)
-			bfree(p_refs);
+		long refs = os_atomic_dec_long(packet_refs(pkt->data));
+
+		if (refs == PACKET_REFS_POOLED)
+			packet_data_free(pkt->data);
+		else if (refs == 0)
+			bfree(packet_refs(pkt->data));
 	}
 
 	memset(pkt, 0, sizeof(struct encoder_packet));
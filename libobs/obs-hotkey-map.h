@@ -0,0 +1,154 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <string.h>
+#include "util/bmem.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Hotkeys and hotkey pairs by id.
+ *
+ *   Entries are allocated by the caller and linked in through the node they
+ * start with, so they never move and pointers to them (held by bindings and
+ * by the hotkeys of a pair) stay valid until they are removed.  The nodes
+ * are kept in registration order for enumeration, and in a chained hash
+ * table for lookups.  Ids are handed out sequentially, so the low bits of
+ * the id are used as the hash.
+ */
+
+struct hotkey_map_node {
+	size_t id;
+	struct hotkey_map_node *next;
+	struct hotkey_map_node *prev;
+	struct hotkey_map_node *hash_next;
+};
+
+struct hotkey_map {
+	struct hotkey_map_node *first;
+	struct hotkey_map_node *last;
+	struct hotkey_map_node **table;
+	size_t table_size;
+	size_t num;
+};
+
+#define HOTKEY_MAP_MIN_TABLE_SIZE 64
+
+static inline struct hotkey_map_node **
+hotkey_map_bucket(struct hotkey_map *map, size_t id)
+{
+	return &map->table[id & (map->table_size - 1)];
+}
+
+static inline void hotkey_map_grow(struct hotkey_map *map)
+{
+	size_t size = map->table_size ? map->table_size * 2
+				      : HOTKEY_MAP_MIN_TABLE_SIZE;
+
+	bfree(map->table);
+	map->table = bzalloc(size * sizeof(struct hotkey_map_node *));
+	map->table_size = size;
+
+	for (struct hotkey_map_node *node = map->first; node;
+	     node = node->next) {
+		struct hotkey_map_node **bucket =
+			hotkey_map_bucket(map, node->id);
+		node->hash_next = *bucket;
+		*bucket = node;
+	}
+}
+
+static inline struct hotkey_map_node *hotkey_map_find(struct hotkey_map *map,
+						       size_t id)
+{
+	struct hotkey_map_node *node;
+
+	if (!map->table)
+		return NULL;
+
+	node = *hotkey_map_bucket(map, id);
+	while (node && node->id != id)
+		node = node->hash_next;
+
+	return node;
+}
+
+/** Adds the node at the end of the map (its id must be set and unique) */
+static inline void hotkey_map_add(struct hotkey_map *map,
+				  struct hotkey_map_node *node)
+{
+	struct hotkey_map_node **bucket;
+
+	node->next = NULL;
+	node->prev = map->last;
+	if (map->last)
+		map->last->next = node;
+	else
+		map->first = node;
+	map->last = node;
+
+	/* keep about one node per bucket */
+	if (++map->num > map->table_size) {
+		hotkey_map_grow(map);
+		return;
+	}
+
+	bucket = hotkey_map_bucket(map, node->id);
+	node->hash_next = *bucket;
+	*bucket = node;
+}
+
+/** Unlinks the node from the map, freeing it is up to the caller */
+static inline void hotkey_map_remove(struct hotkey_map *map,
+				     struct hotkey_map_node *node)
+{
+	struct hotkey_map_node **link = hotkey_map_bucket(map, node->id);
+
+	while (*link && *link != node)
+		link = &(*link)->hash_next;
+	if (*link)
+		*link = node->hash_next;
+
+	if (node->prev)
+		node->prev->next = node->next;
+	else
+		map->first = node->next;
+	if (node->next)
+		node->next->prev = node->prev;
+	else
+		map->last = node->prev;
+
+	node->next = NULL;
+	node->prev = NULL;
+	node->hash_next = NULL;
+	map->num--;
+}
+
+/** Frees the table (the nodes themselves belong to the caller) */
+static inline void hotkey_map_free(struct hotkey_map *map)
+{
+	bfree(map->table);
+	memset(map, 0, sizeof(*map));
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,126 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "util/darray.h"
+#include "obs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Encoded packets waiting to be interleaved, sorted by dts_usec.
+ *
+ *   Packets arrive nearly in order, so the insert position is found with a
+ * binary search and usually ends up at (or close to) the end.  Packets are
+ * taken off the front by moving the 'first' index forward, and the array is
+ * only compacted once the consumed part is at least half of it, so sending
+ * a packet doesn't move the rest of the buffer every time.
+ *
+ *   The buffer does not hold references of its own: packets are released by
+ * whoever takes them out.
+ */
+
+struct interleave_buffer {
+	DARRAY(struct encoder_packet) packets;
+	size_t first;
+};
+
+#define INTERLEAVE_BUFFER_MIN_COMPACT 32
+
+static inline size_t interleave_buffer_num(const struct interleave_buffer *ib)
+{
+	return ib->packets.num - ib->first;
+}
+
+static inline struct encoder_packet *
+interleave_buffer_get(struct interleave_buffer *ib, size_t idx)
+{
+	return ib->packets.array + ib->first + idx;
+}
+
+/* video goes in front of packets with the same timestamp, audio after them */
+static inline bool interleave_packet_before(const struct encoder_packet *pkt,
+					    const struct encoder_packet *cur)
+{
+	return pkt->type == OBS_ENCODER_VIDEO ? pkt->dts_usec <= cur->dts_usec
+					      : pkt->dts_usec < cur->dts_usec;
+}
+
+static inline void interleave_buffer_insert(struct interleave_buffer *ib,
+					    const struct encoder_packet *pkt)
+{
+	size_t lo = ib->first;
+	size_t hi = ib->packets.num;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (interleave_packet_before(pkt, ib->packets.array + mid))
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	da_insert(ib->packets, lo, pkt);
+}
+
+/** Removes the first count packets (without releasing them) */
+static inline void interleave_buffer_pop_front(struct interleave_buffer *ib,
+					       size_t count)
+{
+	ib->first += count;
+
+	if (ib->first >= ib->packets.num) {
+		da_resize(ib->packets, 0);
+		ib->first = 0;
+
+	} else if (ib->first >= INTERLEAVE_BUFFER_MIN_COMPACT &&
+		   ib->first * 2 >= ib->packets.num) {
+		da_erase_range(ib->packets, 0, ib->first);
+		ib->first = 0;
+	}
+}
+
+/** Sorts the buffer again after the packet timestamps have been changed */
+static inline void interleave_buffer_resort(struct interleave_buffer *ib)
+{
+	DARRAY(struct encoder_packet) old_array;
+	size_t first = ib->first;
+
+	old_array.da = ib->packets.da;
+	memset(ib, 0, sizeof(*ib));
+
+	da_reserve(ib->packets, old_array.num - first);
+	for (size_t i = first; i < old_array.num; i++)
+		interleave_buffer_insert(ib, &old_array.array[i]);
+
+	da_free(old_array);
+}
+
+/** Frees the buffer (without releasing the packets) */
+static inline void interleave_buffer_free(struct interleave_buffer *ib)
+{
+	da_free(ib->packets);
+	ib->first = 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -20,6 +20,7 @@
 #include "util/c99defs.h"
 #include "util/darray.h"
 #include "util/circlebuf.h"
+#include "util/spsc-queue.h"
 #include "util/dstr.h"
 #include "util/threading.h"
 #include "util/platform.h"
@@ -32,9 +33,12 @@
 
 #include "media-io/audio-resampler.h"
 #include "media-io/video-io.h"
+#include "media-io/video-frame.h"
 #include "media-io/audio-io.h"
 
 #include "obs.h"
+#include "obs-interleave.h"
+#include "obs-hotkey-map.h"
 
 #include <caption/caption.h>
 
@@ -133,7 +137,9 @@ static inline bool check_path(const char *data, const char *path,
 /* ------------------------------------------------------------------------- */
 /* hotkeys */
 
+/* both start with their node in the hotkey maps (with the same id) */
 struct obs_hotkey {
+	struct hotkey_map_node node;
 	obs_hotkey_id id;
 	char *name;
 	char *description;
@@ -149,6 +155,7 @@ struct obs_hotkey {
 };
 
 struct obs_hotkey_pair {
+	struct hotkey_map_node node;
 	obs_hotkey_pair_id pair_id;
 	obs_hotkey_id id[2];
 	obs_hotkey_active_func func[2];
@@ -226,6 +233,7 @@ extern void obs_display_free(struct obs_display *display);
 struct obs_vframe_info {
 	uint64_t timestamp;
 	int count;
+	struct video_latency latency;
 };
 
 struct obs_tex_frame {
@@ -243,6 +251,11 @@ struct obs_task_info {
 	void *param;
 };
 
+struct threaded_source_tick {
+	struct obs_source *source;
+	float seconds;
+};
+
 struct obs_core_video {
 	graphics_t *graphics;
 	gs_stagesurf_t *copy_surfaces[NUM_TEXTURES][NUM_CHANNELS];
@@ -283,6 +296,17 @@ struct obs_core_video {
 
 	uint64_t video_time;
 	uint64_t video_frame_interval_ns;
+
+	/* enum obs_inactive_tick_mode, and the sources being ticked (only used
+	 * by the graphics thread) */
+	volatile long inactive_tick_mode;
+	DARRAY(struct obs_source *) tick_sources;
+	DARRAY(struct threaded_source_tick) threaded_ticks;
+
+	/* oldest new async frame drawn this frame, and the capture/render
+	 * times of the last main texture, queued by video_sleep */
+	uint64_t frame_capture_ts;
+	struct video_latency frame_latency;
 	uint64_t video_avg_frame_time_ns;
 	double video_fps;
 	video_t *video;
@@ -327,6 +351,9 @@ struct obs_core_audio {
 
 	DARRAY(struct obs_source *) render_order;
 	DARRAY(struct obs_source *) root_nodes;
+	DARRAY(struct obs_source *) leaf_sources;
+	uint64_t leaf_render_ns;
+	bool parallel_render;
 
 	uint64_t buffered_ts;
 	struct circlebuf buffered_timestamps;
@@ -372,9 +399,9 @@ struct obs_core_data {
 /* user hotkeys */
 struct obs_core_hotkeys {
 	pthread_mutex_t mutex;
-	DARRAY(obs_hotkey_t) hotkeys;
+	struct hotkey_map hotkeys;
 	obs_hotkey_id next_id;
-	DARRAY(obs_hotkey_pair_t) hotkey_pairs;
+	struct hotkey_map hotkey_pairs;
 	obs_hotkey_pair_id next_pair_id;
 
 	pthread_t hotkey_thread;
@@ -409,6 +436,8 @@ struct obs_core {
 	DARRAY(struct obs_module_path) module_paths;
 
 	DARRAY(struct obs_source_info) source_types;
+	/* profiler names of video_tick, one per entry of source_types */
+	DARRAY(const char *) source_tick_names;
 	DARRAY(struct obs_source_info) input_types;
 	DARRAY(struct obs_source_info) filter_types;
 	DARRAY(struct obs_source_info) transition_types;
@@ -419,6 +448,7 @@ struct obs_core {
 	DARRAY(struct obs_modeless_ui) modeless_ui_callbacks;
 
 	signal_handler_t *signals;
+	signal_handle_t *source_volume_signal;
 	proc_handler_t *procs;
 
 	char *locale;
@@ -557,10 +587,14 @@ static inline bool obs_weak_ref_get_ref(struct obs_weak_ref *ref)
 /* ------------------------------------------------------------------------- */
 /* sources  */
 
+/* every frame passed through the async queue is allocated as an async_frame,
+ * and has frame.async_frame set.  shared frames point to data owned by the
+ * source, and call release instead of freeing it */
 struct async_frame {
-	struct obs_source_frame *frame;
-	long unused_count;
-	bool used;
+	struct obs_source_frame frame;
+	obs_source_frame_release_t release;
+	void *param;
+	uint64_t received_ts;
 };
 
 enum audio_action_type {
@@ -594,6 +628,8 @@ struct caption_cb_info {
 	void *param;
 };
 
+struct audio_dsp_block;
+
 struct obs_source {
 	struct obs_context_data context;
 	struct obs_source_info info;
@@ -624,6 +660,10 @@ struct obs_source {
 	bool active;
 	bool showing;
 
+	/* seconds not yet passed to video_tick (see obs_inactive_tick_mode) */
+	float pending_tick_seconds;
+	const char *profile_tick_name;
+
 	/* used to temporarily disable sources if needed */
 	bool enabled;
 
@@ -662,9 +702,29 @@ struct obs_source {
 	DARRAY(struct audio_cb_info) audio_cb_list;
 	struct obs_audio_data audio_data;
 	size_t audio_storage_size;
+
+	/* optional audio DSP thread: obs_source_output_audio copies the audio
+	 * into a block and passes it through audio_dsp_queue to the thread,
+	 * which resamples it and runs the filters.  blocks go back through
+	 * audio_dsp_free.  while the thread is active, audio_dsp_mutex
+	 * serializes the threads outputting audio; it also serializes
+	 * starting/stopping the thread. */
+	pthread_mutex_t audio_dsp_mutex;
+	pthread_t audio_dsp_thread;
+	os_sem_t *audio_dsp_sem;
+	volatile bool audio_dsp_active;
+	struct spsc_queue audio_dsp_queue;
+	struct spsc_queue audio_dsp_free;
+	DARRAY(struct audio_dsp_block *) audio_dsp_blocks;
+	volatile long audio_dsp_dropped;
+
 	uint32_t audio_mixers;
 	float user_volume;
 	float volume;
+	signal_handle_t *volume_signal;
+	signal_handle_t *mute_signal;
+	signal_handle_t *update_flags_signal;
+	signal_handle_t *update_properties_signal;
 	int64_t sync_offset;
 	int64_t last_sync_offset;
 	float balance;
@@ -676,8 +736,6 @@ struct obs_source {
 	bool async_gpu_conversion;
 	enum video_format async_format;
 	bool async_full_range;
-	enum video_format async_cache_format;
-	bool async_cache_full_range;
 	enum gs_color_format async_texture_formats[MAX_AV_PLANES];
 	int async_channel_count;
 	long async_rotation;
@@ -687,13 +745,25 @@ struct obs_source {
 	bool async_unbuffered;
 	bool async_decoupled;
 	struct obs_source_frame *async_preload_frame;
-	DARRAY(struct async_frame) async_cache;
+
+	/* async frame queue: the output thread takes frames from async_free,
+	 * fills them, and passes them to the graphics thread through
+	 * async_queue, which pulls them into async_frames on tick.  frames
+	 * go back to async_free once they are no longer displayed. */
+	pthread_mutex_t async_output_mutex;
+	DARRAY(struct obs_source_frame *) async_cache;
+	long async_unused_count;
+	struct spsc_queue async_queue;
+	struct spsc_queue async_free;
+	volatile bool async_flush;
+	volatile long async_pending;
+	volatile long async_dropped;
+
+	/* only accessed with async_mutex held (usually graphics thread) */
 	DARRAY(struct obs_source_frame *) async_frames;
 	pthread_mutex_t async_mutex;
 	uint32_t async_width;
 	uint32_t async_height;
-	uint32_t async_cache_width;
-	uint32_t async_cache_height;
 	uint32_t async_convert_width[MAX_AV_PLANES];
 	uint32_t async_convert_height[MAX_AV_PLANES];
 
@@ -717,6 +787,8 @@ struct obs_source {
 	struct obs_source *filter_target;
 	DARRAY(struct obs_source *) filters;
 	pthread_mutex_t filter_mutex;
+	pthread_mutex_t filter_stats_mutex;
+	struct obs_audio_filter_stats audio_filter_stats;
 	gs_texrender_t *filter_texrender;
 	enum obs_allow_direct_render allow_direct;
 	bool rendering_filter;
@@ -846,6 +918,14 @@ convert_video_format(enum video_format format)
 extern void obs_source_activate(obs_source_t *source, enum view_type type);
 extern void obs_source_deactivate(obs_source_t *source, enum view_type type);
 extern void obs_source_video_tick(obs_source_t *source, float seconds);
+
+/* obs_source_video_tick in three steps, so that tick_sources can run the
+ * video_tick of sources with OBS_SOURCE_THREADED_TICK on the task pool.
+ * _begin returns false if video_tick shouldn't be called this frame, and
+ * otherwise sets the seconds to call it with */
+extern bool obs_source_video_tick_begin(obs_source_t *source, float *seconds);
+extern void obs_source_video_tick_call(obs_source_t *source, float seconds);
+extern void obs_source_video_tick_end(obs_source_t *source);
 extern float obs_source_get_target_volume(obs_source_t *source,
 					  obs_source_t *target);
 
@@ -937,9 +1017,28 @@ struct obs_output {
 	pthread_t end_data_capture_thread;
 	os_event_t *stopping_event;
 	pthread_mutex_t interleaved_mutex;
-	DARRAY(struct encoder_packet) interleaved_packets;
+	struct interleave_buffer interleaved_packets;
 	int stop_code;
 
+	/* calls encoded_packet off the encoder threads when enabled */
+	size_t delivery_queue_size;
+	pthread_t delivery_thread;
+	bool delivery_thread_active;
+	bool delivery_thread_stop;
+	os_sem_t *delivery_sem;
+	os_event_t *delivery_space_event;
+	pthread_mutex_t delivery_mutex;
+	struct circlebuf delivery_queue;
+	size_t delivery_queue_limit;
+	size_t delivery_max_queued;
+	uint64_t delivery_packets;
+	uint64_t delivery_wait_ns;
+
+	pthread_mutex_t latency_mutex;
+	struct latency_histogram *latency_stats;
+	bool latency_send_reported;
+	struct circlebuf latency_interleaved;
+
 	int reconnect_retry_sec;
 	int reconnect_retry_max;
 	int reconnect_retries;
@@ -1032,6 +1131,8 @@ extern void obs_output_remove_encoder(struct obs_output *output,
 extern void
 obs_encoder_packet_create_instance(struct encoder_packet *dst,
 				   const struct encoder_packet *src);
+extern uint8_t *obs_encoder_packet_data_alloc(size_t size);
+extern void obs_encoder_packet_pool_free(void);
 void obs_output_destroy(obs_output_t *output);
 
 /* ------------------------------------------------------------------------- */
@@ -1042,6 +1143,22 @@ struct obs_weak_encoder {
 	struct obs_encoder *encoder;
 };
 
+struct encoder_latency {
+	int64_t pts;
+	struct video_latency latency;
+};
+
+#define ENCODER_VIDEO_QUEUE_SIZE 4
+
+struct encoder_video_frame {
+	struct video_output_buffer *buf;
+	struct video_frame frame;
+	uint64_t timestamp;
+	uint64_t queued_ts;
+	struct video_latency latency;
+	int count;
+};
+
 struct encoder_callback {
 	bool sent_first_packet;
 	void (*new_packet)(void *param, struct encoder_packet *packet);
@@ -1109,6 +1226,27 @@ struct obs_encoder {
 
 	struct pause_data pause;
 
+	/* frames submitted to the encoder that have no packet yet */
+	DARRAY(struct encoder_latency) latency_pending;
+
+	/* raw video frames are referenced (not copied) into a small queue on
+	 * the video thread and encoded on a thread of its own, so a slow
+	 * encoder only holds up itself.  video_queue_mutex protects the queue
+	 * positions, counts and stats; a slot belongs to whichever side owns
+	 * it */
+	pthread_t video_thread;
+	bool video_thread_active;
+	bool video_thread_stop;
+	os_sem_t *video_sem;
+	pthread_mutex_t video_queue_mutex;
+	struct encoder_video_frame video_queue[ENCODER_VIDEO_QUEUE_SIZE];
+	size_t video_queue_first;
+	size_t video_queue_num;
+	uint32_t video_frames_encoded;
+	uint32_t video_frames_repeated;
+	uint64_t video_queue_lag;
+	uint64_t video_queue_max_lag;
+
 	const char *profile_encoder_encode_name;
 	char *last_error_message;
 };
@@ -1135,9 +1273,17 @@ extern void obs_encoder_remove_output(struct obs_encoder *encoder,
 extern bool start_gpu_encode(obs_encoder_t *encoder);
 extern void stop_gpu_encode(obs_encoder_t *encoder);
 
-extern bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame);
+extern bool do_encode(struct obs_encoder *encoder, struct encoder_frame *frame,
+		      const struct video_latency *latency);
 extern void send_off_encoder_packet(obs_encoder_t *encoder, bool success,
-				    bool received, struct encoder_packet *pkt);
+				    bool received, struct encoder_packet *pkt,
+				    const struct video_latency *latency);
+
+/* pipeline timestamps of a video packet sent off by an encoder, all zero for
+ * other packets.  kept in front of the packet data, so every reference to
+ * the data shares them */
+extern const struct video_latency *
+obs_encoder_packet_latency(const struct encoder_packet *pkt);
 
 void obs_encoder_destroy(obs_encoder_t *encoder);
 
@@ -704,9 +704,14 @@ void obs_register_source_s(const struct obs_source_info *info, size_t size)
 		data.id = bstrdup(data.id);
 	}
 
+	/* the type id is freed on shutdown, before the profiler is printed */
+	const char *tick_name = profile_store_name(
+		obs_get_profiler_name_store(), "tick(%s)", data.id);
+
 	if (array)
 		darray_push_back(sizeof(struct obs_source_info), array, &data);
 	da_push_back(obs->source_types, &data);
+	da_push_back(obs->source_tick_names, &tick_name);
 	return;
 
 error:
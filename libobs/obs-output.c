@@ -16,6 +16,7 @@
 ******************************************************************************/
 
 #include <inttypes.h>
+#include <math.h>
 #include "util/platform.h"
 #include "util/util_uint64.h"
 #include "obs.h"
@@ -107,6 +108,8 @@ obs_output_t *obs_output_create(const char *id, const char *name,
 	pthread_mutex_init_value(&output->delay_mutex);
 	pthread_mutex_init_value(&output->caption_mutex);
 	pthread_mutex_init_value(&output->pause.mutex);
+	pthread_mutex_init_value(&output->latency_mutex);
+	pthread_mutex_init_value(&output->delivery_mutex);
 
 	if (pthread_mutex_init(&output->interleaved_mutex, NULL) != 0)
 		goto fail;
@@ -116,6 +119,10 @@ obs_output_t *obs_output_create(const char *id, const char *name,
 		goto fail;
 	if (pthread_mutex_init(&output->pause.mutex, NULL) != 0)
 		goto fail;
+	if (pthread_mutex_init(&output->latency_mutex, NULL) != 0)
+		goto fail;
+	if (pthread_mutex_init(&output->delivery_mutex, NULL) != 0)
+		goto fail;
 	if (os_event_init(&output->stopping_event, OS_EVENT_TYPE_MANUAL) != 0)
 		goto fail;
 	if (!init_output_handlers(output, name, settings, hotkey_data))
@@ -165,14 +172,28 @@ fail:
 	return NULL;
 }
 
+static inline size_t num_interleaved_packets(struct obs_output *output)
+{
+	return interleave_buffer_num(&output->interleaved_packets);
+}
+
+static inline struct encoder_packet *
+get_interleaved_packet(struct obs_output *output, size_t idx)
+{
+	return interleave_buffer_get(&output->interleaved_packets, idx);
+}
+
 static inline void free_packets(struct obs_output *output)
 {
-	for (size_t i = 0; i < output->interleaved_packets.num; i++)
-		obs_encoder_packet_release(output->interleaved_packets.array +
-					   i);
-	da_free(output->interleaved_packets);
+	struct interleave_buffer *ib = &output->interleaved_packets;
+
+	for (size_t i = 0; i < interleave_buffer_num(ib); i++)
+		obs_encoder_packet_release(interleave_buffer_get(ib, i));
+	interleave_buffer_free(ib);
 }
 
+static void stop_delivery_thread(struct obs_output *output);
+
 static inline void clear_audio_buffers(obs_output_t *output)
 {
 	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
@@ -202,6 +223,7 @@ void obs_output_destroy(obs_output_t *output)
 			output->info.destroy(output->context.data);
 
 		free_packets(output);
+		stop_delivery_thread(output);
 
 		if (output->video_encoder) {
 			obs_encoder_remove_output(output->video_encoder,
@@ -222,10 +244,14 @@ void obs_output_destroy(obs_output_t *output)
 		pthread_mutex_destroy(&output->caption_mutex);
 		pthread_mutex_destroy(&output->interleaved_mutex);
 		pthread_mutex_destroy(&output->delay_mutex);
+		pthread_mutex_destroy(&output->latency_mutex);
+		pthread_mutex_destroy(&output->delivery_mutex);
 		os_event_destroy(output->reconnect_stop_event);
 		obs_context_data_free(&output->context);
 		circlebuf_free(&output->delay_data);
 		circlebuf_free(&output->caption_data);
+		circlebuf_free(&output->latency_interleaved);
+		bfree(output->latency_stats);
 		if (output->owns_info_id)
 			bfree((void *)output->info.id);
 		if (output->last_error_message)
@@ -255,6 +281,13 @@ bool obs_output_actual_start(obs_output_t *output)
 	if (output->context.data)
 		success = output->info.start(output->context.data);
 
+	pthread_mutex_lock(&output->latency_mutex);
+	bfree(output->latency_stats);
+	output->latency_stats = NULL;
+	output->latency_send_reported = false;
+	circlebuf_free(&output->latency_interleaved);
+	pthread_mutex_unlock(&output->latency_mutex);
+
 	if (success && output->video) {
 		output->starting_frame_count =
 			video_output_get_total_frames(output->video);
@@ -955,6 +988,461 @@ int obs_output_get_total_frames(const obs_output_t *output)
 		       : 0;
 }
 
+/* ------------------------------------------------------------------------- */
+/* Frame latency */
+
+/*
+ * Log-linear histogram in microseconds: values below 16us get their own
+ * bucket, every power of two above that is split in 16 buckets (about 6%
+ * precision), up to ~71 minutes.
+ */
+#define LATENCY_SUB_BUCKETS 16
+#define LATENCY_BUCKETS (29 * LATENCY_SUB_BUCKETS)
+#define LATENCY_TOTAL VIDEO_LATENCY_STAGES
+
+struct latency_histogram {
+	uint64_t count;
+	uint32_t buckets[LATENCY_BUCKETS];
+};
+
+static inline size_t latency_bucket(uint64_t usec)
+{
+	int msb = 4;
+
+	if (usec < LATENCY_SUB_BUCKETS)
+		return (size_t)usec;
+	if (usec > UINT32_MAX)
+		usec = UINT32_MAX;
+
+	while (usec >> (msb + 1))
+		msb++;
+
+	return (size_t)(msb - 3) * LATENCY_SUB_BUCKETS +
+	       (size_t)((usec >> (msb - 4)) & (LATENCY_SUB_BUCKETS - 1));
+}
+
+/* midpoint of the bucket, in nanoseconds */
+static inline uint64_t latency_bucket_value(size_t idx)
+{
+	if (idx < LATENCY_SUB_BUCKETS)
+		return (uint64_t)idx * 1000;
+
+	int shift = (int)(idx / LATENCY_SUB_BUCKETS) - 1;
+	uint64_t sub = idx % LATENCY_SUB_BUCKETS;
+	uint64_t low = (LATENCY_SUB_BUCKETS + sub) << shift;
+
+	return (low * 2 + ((uint64_t)1 << shift)) * 500;
+}
+
+static inline void add_latency(struct latency_histogram *hist, uint64_t ns)
+{
+	hist->buckets[latency_bucket(ns / 1000)]++;
+	hist->count++;
+}
+
+static uint64_t latency_percentile(const struct latency_histogram *hist,
+				   double percentile)
+{
+	uint64_t target = (uint64_t)ceil((double)hist->count * percentile);
+	uint64_t accu = 0;
+
+	if (!hist->count)
+		return 0;
+	if (!target)
+		target = 1;
+
+	for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+		accu += hist->buckets[i];
+		if (accu >= target)
+			return latency_bucket_value(i);
+	}
+
+	return latency_bucket_value(LATENCY_BUCKETS - 1);
+}
+
+/* adds the time each stage from 'first' to 'last' took since the stage before
+ * it, skipping stages the frame did not go through */
+static void record_latency(struct obs_output *output,
+			   const struct video_latency *latency,
+			   enum video_latency_stage first,
+			   enum video_latency_stage last)
+{
+	uint64_t start = 0;
+	uint64_t prev = 0;
+	bool total;
+
+	pthread_mutex_lock(&output->latency_mutex);
+
+	if (!output->latency_stats)
+		output->latency_stats =
+			bzalloc(sizeof(struct latency_histogram) *
+				(VIDEO_LATENCY_STAGES + 1));
+
+	for (int i = 0; i <= (int)last; i++) {
+		uint64_t ts = latency->ts[i];
+		if (!ts)
+			continue;
+
+		if (!start)
+			start = ts;
+		if (i >= (int)first && prev && ts >= prev)
+			add_latency(&output->latency_stats[i], ts - prev);
+		prev = ts;
+	}
+
+	/* the end-to-end time is measured up to the last stage the output
+	 * reports, libobs only knows about sends if the plugin tells it */
+	if (last == VIDEO_LATENCY_SEND)
+		output->latency_send_reported = true;
+	total = last == VIDEO_LATENCY_SEND || !output->latency_send_reported;
+
+	if (total && prev > start)
+		add_latency(&output->latency_stats[LATENCY_TOTAL],
+			    prev - start);
+
+	pthread_mutex_unlock(&output->latency_mutex);
+}
+
+/* video packets interleaved but not reported as sent yet.  they're sent in
+ * the order they're interleaved, so a packet reported as sent also means the
+ * ones before it will never be */
+struct interleaved_latency {
+	int64_t dts;
+	struct video_latency latency;
+};
+
+#define MAX_INTERLEAVED_LATENCY 64
+
+static inline void mark_packet_interleaved(struct obs_output *output,
+					   struct encoder_packet *packet)
+{
+	struct interleaved_latency il;
+
+	if (packet->type != OBS_ENCODER_VIDEO)
+		return;
+
+	il.latency = *obs_encoder_packet_latency(packet);
+	if (!il.latency.ts[VIDEO_LATENCY_ENCODED])
+		return;
+
+	il.dts = packet->dts;
+	il.latency.ts[VIDEO_LATENCY_INTERLEAVE] = os_gettime_ns();
+	record_latency(output, &il.latency, VIDEO_LATENCY_CAPTURE,
+		       VIDEO_LATENCY_INTERLEAVE);
+
+	pthread_mutex_lock(&output->latency_mutex);
+	if (output->latency_interleaved.size ==
+	    MAX_INTERLEAVED_LATENCY * sizeof(il))
+		circlebuf_pop_front(&output->latency_interleaved, NULL,
+				    sizeof(il));
+	circlebuf_push_back(&output->latency_interleaved, &il, sizeof(il));
+	pthread_mutex_unlock(&output->latency_mutex);
+}
+
+void obs_output_packet_sent(obs_output_t *output,
+			    const struct encoder_packet *packet)
+{
+	struct interleaved_latency il;
+	bool found = false;
+
+	if (!obs_output_valid(output, "obs_output_packet_sent"))
+		return;
+	if (!packet || packet->type != OBS_ENCODER_VIDEO)
+		return;
+
+	pthread_mutex_lock(&output->latency_mutex);
+	while (output->latency_interleaved.size) {
+		circlebuf_pop_front(&output->latency_interleaved, &il,
+				    sizeof(il));
+		if (il.dts == packet->dts) {
+			found = true;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&output->latency_mutex);
+
+	if (!found)
+		return;
+
+	il.latency.ts[VIDEO_LATENCY_SEND] = os_gettime_ns();
+	record_latency(output, &il.latency, VIDEO_LATENCY_SEND,
+		       VIDEO_LATENCY_SEND);
+}
+
+bool obs_output_get_frame_latency(obs_output_t *output,
+				  struct obs_output_frame_latency *latency)
+{
+	struct latency_histogram *stats;
+	bool success = false;
+
+	if (!obs_output_valid(output, "obs_output_get_frame_latency"))
+		return false;
+	if (!obs_ptr_valid(latency, "obs_output_get_frame_latency"))
+		return false;
+
+	memset(latency, 0, sizeof(*latency));
+
+	pthread_mutex_lock(&output->latency_mutex);
+	stats = output->latency_stats;
+	if (stats) {
+		for (size_t i = 0; i < VIDEO_LATENCY_STAGES; i++) {
+			latency->p50[i] = latency_percentile(&stats[i], 0.5);
+			latency->p99[i] = latency_percentile(&stats[i], 0.99);
+		}
+
+		latency->frames = stats[LATENCY_TOTAL].count;
+		latency->total_p50 =
+			latency_percentile(&stats[LATENCY_TOTAL], 0.5);
+		latency->total_p99 =
+			latency_percentile(&stats[LATENCY_TOTAL], 0.99);
+		success = true;
+	}
+	pthread_mutex_unlock(&output->latency_mutex);
+
+	return success;
+}
+
+void obs_output_reset_frame_latency(obs_output_t *output)
+{
+	if (!obs_output_valid(output, "obs_output_reset_frame_latency"))
+		return;
+
+	pthread_mutex_lock(&output->latency_mutex);
+	if (output->latency_stats)
+		memset(output->latency_stats, 0,
+		       sizeof(struct latency_histogram) *
+			       (VIDEO_LATENCY_STAGES + 1));
+	pthread_mutex_unlock(&output->latency_mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Packet delivery thread */
+
+static inline size_t delivery_queued(struct obs_output *output)
+{
+	return output->delivery_queue.size / sizeof(struct encoder_packet);
+}
+
+static void *delivery_thread(void *param)
+{
+	struct obs_output *output = param;
+
+	os_set_thread_name("obs output delivery thread");
+
+	while (os_sem_wait(output->delivery_sem) == 0) {
+		struct encoder_packet packet;
+		bool stop;
+
+		pthread_mutex_lock(&output->delivery_mutex);
+		stop = output->delivery_thread_stop;
+		if (!stop && output->delivery_queue.size) {
+			circlebuf_pop_front(&output->delivery_queue, &packet,
+					    sizeof(packet));
+			os_event_signal(output->delivery_space_event);
+		} else {
+			packet.data = NULL;
+		}
+		pthread_mutex_unlock(&output->delivery_mutex);
+
+		if (stop)
+			break;
+		if (!packet.data)
+			continue;
+
+		/* same check default_encoded_callback does: once capture has
+		 * ended the output no longer expects any packets */
+		if (data_active(output))
+			output->info.encoded_packet(output->context.data,
+						    &packet);
+		obs_encoder_packet_release(&packet);
+
+		pthread_mutex_lock(&output->delivery_mutex);
+		output->delivery_packets++;
+		pthread_mutex_unlock(&output->delivery_mutex);
+	}
+
+	return NULL;
+}
+
+static void free_delivery_queue(struct obs_output *output)
+{
+	while (output->delivery_queue.size) {
+		struct encoder_packet packet;
+		circlebuf_pop_front(&output->delivery_queue, &packet,
+				    sizeof(packet));
+		obs_encoder_packet_release(&packet);
+	}
+
+	circlebuf_free(&output->delivery_queue);
+}
+
+static void start_delivery_thread(struct obs_output *output)
+{
+	/* still around if the last session ended from inside encoded_packet */
+	stop_delivery_thread(output);
+
+	output->delivery_queue_limit = output->delivery_queue_size;
+	output->delivery_max_queued = 0;
+	output->delivery_packets = 0;
+	output->delivery_wait_ns = 0;
+	output->delivery_thread_stop = false;
+
+	if (!output->delivery_queue_limit)
+		return;
+
+	if (os_sem_init(&output->delivery_sem, 0) != 0)
+		goto fail;
+	if (os_event_init(&output->delivery_space_event,
+			  OS_EVENT_TYPE_MANUAL) != 0)
+		goto fail;
+
+	circlebuf_reserve(&output->delivery_queue,
+			  output->delivery_queue_limit *
+				  sizeof(struct encoder_packet));
+
+	if (pthread_create(&output->delivery_thread, NULL, delivery_thread,
+			   output) != 0)
+		goto fail;
+
+	output->delivery_thread_active = true;
+	return;
+
+fail:
+	blog(LOG_WARNING,
+	     "Output '%s': could not start delivery thread, "
+	     "delivering packets on the encoder threads",
+	     output->context.name);
+
+	circlebuf_free(&output->delivery_queue);
+	os_event_destroy(output->delivery_space_event);
+	os_sem_destroy(output->delivery_sem);
+	output->delivery_space_event = NULL;
+	output->delivery_sem = NULL;
+	output->delivery_queue_limit = 0;
+}
+
+static void stop_delivery_thread(struct obs_output *output)
+{
+	if (!output->delivery_thread_active)
+		return;
+
+	pthread_mutex_lock(&output->delivery_mutex);
+	output->delivery_thread_stop = true;
+	os_event_signal(output->delivery_space_event);
+	pthread_mutex_unlock(&output->delivery_mutex);
+	os_sem_post(output->delivery_sem);
+
+	/* capture was ended from inside encoded_packet: the thread exits once
+	 * the callback returns, and is joined on the next start or destroy */
+	if (pthread_equal(pthread_self(), output->delivery_thread))
+		return;
+
+	pthread_join(output->delivery_thread, NULL);
+
+	blog(LOG_INFO,
+	     "Output '%s': delivery thread: %" PRIu64 " packets, "
+	     "%zu queued at most, encoders waited %" PRIu64 " ms",
+	     output->context.name, output->delivery_packets,
+	     output->delivery_max_queued,
+	     output->delivery_wait_ns / 1000000);
+
+	pthread_mutex_lock(&output->delivery_mutex);
+	free_delivery_queue(output);
+	output->delivery_thread_active = false;
+	pthread_mutex_unlock(&output->delivery_mutex);
+
+	os_event_destroy(output->delivery_space_event);
+	os_sem_destroy(output->delivery_sem);
+	output->delivery_space_event = NULL;
+	output->delivery_sem = NULL;
+}
+
+/* called before the packet is interleaved, so that encoders never wait with
+ * interleaved_mutex held */
+static void wait_for_delivery_space(struct obs_output *output)
+{
+	uint64_t start = 0;
+
+	if (!output->delivery_thread_active)
+		return;
+
+	pthread_mutex_lock(&output->delivery_mutex);
+	while (delivery_queued(output) >= output->delivery_queue_limit &&
+	       !output->delivery_thread_stop) {
+		if (!start)
+			start = os_gettime_ns();
+
+		os_event_reset(output->delivery_space_event);
+		pthread_mutex_unlock(&output->delivery_mutex);
+		os_event_wait(output->delivery_space_event);
+		pthread_mutex_lock(&output->delivery_mutex);
+	}
+
+	if (start)
+		output->delivery_wait_ns += os_gettime_ns() - start;
+	pthread_mutex_unlock(&output->delivery_mutex);
+}
+
+/* takes ownership of the packet */
+static void deliver_packet(struct obs_output *output,
+			   struct encoder_packet *packet)
+{
+	size_t queued;
+
+	if (!output->delivery_thread_active) {
+		output->info.encoded_packet(output->context.data, packet);
+		obs_encoder_packet_release(packet);
+		return;
+	}
+
+	pthread_mutex_lock(&output->delivery_mutex);
+	circlebuf_push_back(&output->delivery_queue, packet, sizeof(*packet));
+	queued = delivery_queued(output);
+	if (queued > output->delivery_max_queued)
+		output->delivery_max_queued = queued;
+	pthread_mutex_unlock(&output->delivery_mutex);
+
+	os_sem_post(output->delivery_sem);
+}
+
+void obs_output_set_delivery_queue_size(obs_output_t *output,
+					size_t max_packets)
+{
+	if (!obs_output_valid(output, "obs_output_set_delivery_queue_size"))
+		return;
+
+	output->delivery_queue_size = max_packets;
+}
+
+size_t obs_output_get_delivery_queue_size(const obs_output_t *output)
+{
+	return obs_output_valid(output, "obs_output_get_delivery_queue_size")
+		       ? output->delivery_queue_size
+		       : 0;
+}
+
+bool obs_output_get_delivery_stats(const obs_output_t *output,
+				   struct obs_output_delivery_stats *stats)
+{
+	struct obs_output *out = (struct obs_output *)output;
+
+	if (!obs_output_valid(output, "obs_output_get_delivery_stats"))
+		return false;
+	if (!obs_ptr_valid(stats, "obs_output_get_delivery_stats"))
+		return false;
+
+	memset(stats, 0, sizeof(*stats));
+
+	pthread_mutex_lock(&out->delivery_mutex);
+	stats->queued = (uint32_t)delivery_queued(out);
+	stats->max_queued = (uint32_t)out->delivery_max_queued;
+	stats->delivered = out->delivery_packets;
+	stats->wait_ns = out->delivery_wait_ns;
+	pthread_mutex_unlock(&out->delivery_mutex);
+
+	return out->delivery_queue_limit != 0;
+}
+
 void obs_output_set_preferred_size(obs_output_t *output, uint32_t width,
 				   uint32_t height)
 {
@@ -1211,20 +1699,14 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 	struct encoder_packet backup = *out;
 	sei_t sei;
 	uint8_t *data;
+	uint8_t *out_data;
 	size_t size;
-	long ref = 1;
-
-	DARRAY(uint8_t) out_data;
 
 	if (out->priority > 1)
 		return false;
 
 	sei_init(&sei, 0.0);
 
-	da_init(out_data);
-	da_push_back_array(out_data, &ref, sizeof(ref));
-	da_push_back_array(out_data, out->data, out->size);
-
 	if (output->caption_data.size > 0) {
 
 		cea708_t cea708;
@@ -1284,16 +1766,21 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 
 	data = malloc(sei_render_size(&sei));
 	size = sei_render(&sei, data);
-	/* TODO SEI should come after AUD/SPS/PPS, but before any VCL */
-	da_push_back_array(out_data, nal_start, 4);
-	da_push_back_array(out_data, data, size);
+
+	/* the packet data is shared with other outputs, so the caption goes
+	 * into a new copy. TODO SEI should come after AUD/SPS/PPS, but before
+	 * any VCL */
+	out_data = obs_encoder_packet_data_alloc(out->size + 4 + size);
+	memcpy(out_data, out->data, out->size);
+	memcpy(out_data + out->size, nal_start, 4);
+	memcpy(out_data + out->size + 4, data, size);
 	free(data);
 
 	obs_encoder_packet_release(out);
 
 	*out = backup;
-	out->data = (uint8_t *)out_data.array + sizeof(ref);
-	out->size = out_data.num - sizeof(ref);
+	out->data = out_data;
+	out->size += 4 + size;
 
 	sei_free(&sei);
 
@@ -1304,7 +1791,8 @@ double last_caption_timestamp = 0;
 
 static inline void send_interleaved(struct obs_output *output)
 {
-	struct encoder_packet out = output->interleaved_packets.array[0];
+	struct encoder_packet out =
+		*interleave_buffer_get(&output->interleaved_packets, 0);
 
 	/* do not send an interleaved packet if there's no packet of the
 	 * opposing type of a higher timestamp in the interleave buffer.
@@ -1312,7 +1800,7 @@ static inline void send_interleaved(struct obs_output *output)
 	if (!has_higher_opposing_ts(output, &out))
 		return;
 
-	da_erase(output->interleaved_packets, 0);
+	interleave_buffer_pop_front(&output->interleaved_packets, 1);
 
 	if (out.type == OBS_ENCODER_VIDEO) {
 		output->total_frames++;
@@ -1346,8 +1834,8 @@ static inline void send_interleaved(struct obs_output *output)
 		pthread_mutex_unlock(&output->caption_mutex);
 	}
 
-	output->info.encoded_packet(output->context.data, &out);
-	obs_encoder_packet_release(&out);
+	mark_packet_interleaved(output, &out);
+	deliver_packet(output, &out);
 }
 
 static inline void set_higher_ts(struct obs_output *output,
@@ -1378,9 +1866,9 @@ static size_t get_interleaved_start_idx(struct obs_output *output)
 	size_t video_idx = DARRAY_INVALID;
 	size_t idx = 0;
 
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
+	for (size_t i = 0; i < num_interleaved_packets(output); i++) {
 		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
+			get_interleaved_packet(output, i);
 		int64_t diff;
 
 		if (packet->type != OBS_ENCODER_AUDIO) {
@@ -1416,7 +1904,7 @@ static int prune_premature_packets(struct obs_output *output)
 	}
 
 	max_idx = video_idx;
-	video = &output->interleaved_packets.array[video_idx];
+	video = get_interleaved_packet(output, video_idx);
 	duration_usec = video->timebase_num * 1000000LL / video->timebase_den;
 
 	for (size_t i = 0; i < audio_mixes; i++) {
@@ -1430,7 +1918,7 @@ static int prune_premature_packets(struct obs_output *output)
 			return -1;
 		}
 
-		audio = &output->interleaved_packets.array[audio_idx];
+		audio = get_interleaved_packet(output, audio_idx);
 		if (audio_idx > max_idx)
 			max_idx = audio_idx;
 
@@ -1446,11 +1934,11 @@ static void discard_to_idx(struct obs_output *output, size_t idx)
 {
 	for (size_t i = 0; i < idx; i++) {
 		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
+			get_interleaved_packet(output, i);
 		obs_encoder_packet_release(packet);
 	}
 
-	da_erase_range(output->interleaved_packets, 0, idx);
+	interleave_buffer_pop_front(&output->interleaved_packets, idx);
 }
 
 #define DEBUG_STARTING_PACKETS 0
@@ -1462,9 +1950,9 @@ static bool prune_interleaved_packets(struct obs_output *output)
 
 #if DEBUG_STARTING_PACKETS == 1
 	blog(LOG_DEBUG, "--------- Pruning! %d ---------", prune_start);
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
+	for (size_t i = 0; i < num_interleaved_packets(output); i++) {
 		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
+			get_interleaved_packet(output, i);
 		blog(LOG_DEBUG, "packet: %s %d, ts: %lld, pruned = %s",
 		     packet->type == OBS_ENCODER_AUDIO ? "audio" : "video",
 		     (int)packet->track_idx, packet->dts_usec,
@@ -1490,9 +1978,9 @@ static int find_first_packet_type_idx(struct obs_output *output,
 				      enum obs_encoder_type type,
 				      size_t audio_idx)
 {
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
+	for (size_t i = 0; i < num_interleaved_packets(output); i++) {
 		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
+			get_interleaved_packet(output, i);
 
 		if (packet->type == type) {
 			if (type == OBS_ENCODER_AUDIO &&
@@ -1511,9 +1999,9 @@ static int find_last_packet_type_idx(struct obs_output *output,
 				     enum obs_encoder_type type,
 				     size_t audio_idx)
 {
-	for (size_t i = output->interleaved_packets.num; i > 0; i--) {
+	for (size_t i = num_interleaved_packets(output); i > 0; i--) {
 		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i - 1];
+			get_interleaved_packet(output, i - 1);
 
 		if (packet->type == type) {
 			if (type == OBS_ENCODER_AUDIO &&
@@ -1533,7 +2021,7 @@ find_first_packet_type(struct obs_output *output, enum obs_encoder_type type,
 		       size_t audio_idx)
 {
 	int idx = find_first_packet_type_idx(output, type, audio_idx);
-	return (idx != -1) ? &output->interleaved_packets.array[idx] : NULL;
+	return (idx != -1) ? get_interleaved_packet(output, idx) : NULL;
 }
 
 static inline struct encoder_packet *
@@ -1541,7 +2029,7 @@ find_last_packet_type(struct obs_output *output, enum obs_encoder_type type,
 		      size_t audio_idx)
 {
 	int idx = find_last_packet_type_idx(output, type, audio_idx);
-	return (idx != -1) ? &output->interleaved_packets.array[idx] : NULL;
+	return (idx != -1) ? get_interleaved_packet(output, idx) : NULL;
 }
 
 static bool get_audio_and_video_packets(struct obs_output *output,
@@ -1621,9 +2109,9 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 	output->highest_video_ts -= video->dts_usec;
 
 	/* apply new offsets to all existing packet DTS/PTS values */
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
+	for (size_t i = 0; i < num_interleaved_packets(output); i++) {
 		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
+			get_interleaved_packet(output, i);
 		apply_interleaved_packet_offset(output, packet);
 	}
 
@@ -1633,34 +2121,12 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 static inline void insert_interleaved_packet(struct obs_output *output,
 					     struct encoder_packet *out)
 {
-	size_t idx;
-	for (idx = 0; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *cur_packet;
-		cur_packet = output->interleaved_packets.array + idx;
-
-		if (out->dts_usec == cur_packet->dts_usec &&
-		    out->type == OBS_ENCODER_VIDEO) {
-			break;
-		} else if (out->dts_usec < cur_packet->dts_usec) {
-			break;
-		}
-	}
-
-	da_insert(output->interleaved_packets, idx, out);
+	interleave_buffer_insert(&output->interleaved_packets, out);
 }
 
 static void resort_interleaved_packets(struct obs_output *output)
 {
-	DARRAY(struct encoder_packet) old_array;
-
-	old_array.da = output->interleaved_packets.da;
-	memset(&output->interleaved_packets, 0,
-	       sizeof(output->interleaved_packets));
-
-	for (size_t i = 0; i < old_array.num; i++)
-		insert_interleaved_packet(output, &old_array.array[i]);
-
-	da_free(old_array);
+	interleave_buffer_resort(&output->interleaved_packets);
 }
 
 static void discard_unused_audio_packets(struct obs_output *output,
@@ -1668,9 +2134,9 @@ static void discard_unused_audio_packets(struct obs_output *output,
 {
 	size_t idx = 0;
 
-	for (; idx < output->interleaved_packets.num; idx++) {
+	for (; idx < num_interleaved_packets(output); idx++) {
 		struct encoder_packet *p =
-			&output->interleaved_packets.array[idx];
+			get_interleaved_packet(output, idx);
 
 		if (p->dts_usec >= dts_usec)
 			break;
@@ -1692,6 +2158,8 @@ static void interleave_packets(void *data, struct encoder_packet *packet)
 	if (packet->type == OBS_ENCODER_AUDIO)
 		packet->track_idx = get_track_index(output, packet);
 
+	wait_for_delivery_space(output);
+
 	pthread_mutex_lock(&output->interleaved_mutex);
 
 	/* if first video frame is not a keyframe, discard until received */
@@ -1710,7 +2178,7 @@ static void interleave_packets(void *data, struct encoder_packet *packet)
 	if (output->active_delay_ns)
 		out = *packet;
 	else
-		obs_encoder_packet_create_instance(&out, packet);
+		obs_encoder_packet_ref(&out, packet);
 
 	if (was_started)
 		apply_interleaved_packet_offset(output, &out);
@@ -1746,7 +2214,18 @@ static void default_encoded_callback(void *param, struct encoder_packet *packet)
 		if (packet->type == OBS_ENCODER_AUDIO)
 			packet->track_idx = get_track_index(output, packet);
 
-		output->info.encoded_packet(output->context.data, packet);
+		mark_packet_interleaved(output, packet);
+
+		if (output->delivery_thread_active) {
+			struct encoder_packet out;
+
+			wait_for_delivery_space(output);
+			obs_encoder_packet_ref(&out, packet);
+			deliver_packet(output, &out);
+		} else {
+			output->info.encoded_packet(output->context.data,
+						    packet);
+		}
 
 		if (packet->type == OBS_ENCODER_VIDEO)
 			output->total_frames++;
@@ -1921,6 +2400,8 @@ static void hook_data_capture(struct obs_output *output, bool encoded,
 		reset_packet_data(output);
 		pthread_mutex_unlock(&output->interleaved_mutex);
 
+		start_delivery_thread(output);
+
 		encoded_callback = (has_video && has_audio)
 					   ? interleave_packets
 					   : default_encoded_callback;
@@ -2266,6 +2747,8 @@ static void *end_data_capture_thread(void *data)
 					 encoded_callback, output);
 		if (has_audio)
 			stop_audio_encoders(output, encoded_callback);
+
+		stop_delivery_thread(output);
 	} else {
 		if (has_video)
 			stop_raw_video(output->video,
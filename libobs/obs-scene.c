@@ -19,6 +19,7 @@
 #include "util/threading.h"
 #include "util/util_uint64.h"
 #include "graphics/math-defs.h"
+#include "media-io/audio-mix.h"
 #include "obs-scene.h"
 #include "obs-internal.h"
 
@@ -953,13 +954,18 @@ static uint32_t scene_getheight(void *data)
 	return scene->custom_size ? scene->cy : obs->video.base_height;
 }
 
-static void apply_scene_item_audio_actions(struct obs_scene_item *item,
+/* applies the show/hide actions of the item that fall within the audio block
+ * starting at ts (or all of them if ts is 0).  returns true if the item is
+ * shown or hidden partway through the block, in which case buf holds the gain
+ * of each frame; otherwise the whole block follows item->visible. */
+static bool apply_scene_item_audio_actions(struct obs_scene_item *item,
 					   float *buf, uint64_t ts,
 					   size_t sample_rate)
 {
 	bool cur_visible = item->visible;
 	uint64_t frame_num = 0;
 	size_t deref_count = 0;
+	bool ramp = false;
 
 	pthread_mutex_lock(&item->actions_mutex);
 
@@ -988,6 +994,9 @@ static void apply_scene_item_audio_actions(struct obs_scene_item *item,
 				buf[frame_num] = cur_visible ? 1.0f : 0.0f;
 		}
 
+		if (new_frame_num > 0 && cur_visible != item->visible)
+			ramp = true;
+
 		cur_visible = item->visible;
 	}
 
@@ -1004,6 +1013,8 @@ static void apply_scene_item_audio_actions(struct obs_scene_item *item,
 						       item->source);
 		}
 	}
+
+	return ramp;
 }
 
 static bool apply_scene_item_volume(struct obs_scene_item *item, float *buf,
@@ -1024,11 +1035,9 @@ static bool apply_scene_item_volume(struct obs_scene_item *item, float *buf,
 		uint64_t duration = util_mul_div64(AUDIO_OUTPUT_FRAMES,
 						   1000000000ULL, sample_rate);
 
-		if (!ts || action.timestamp < (ts + duration)) {
-			apply_scene_item_audio_actions(item, buf, ts,
-						       sample_rate);
-			return true;
-		}
+		if (!ts || action.timestamp < (ts + duration))
+			return apply_scene_item_audio_actions(item, buf, ts,
+							      sample_rate);
 	}
 
 	return false;
@@ -1037,31 +1046,8 @@ static bool apply_scene_item_volume(struct obs_scene_item *item, float *buf,
 static void process_all_audio_actions(struct obs_scene_item *item,
 				      size_t sample_rate)
 {
-	while (apply_scene_item_volume(item, NULL, 0, sample_rate))
-		;
-}
-
-static void mix_audio_with_buf(float *p_out, float *p_in, float *buf_in,
-			       size_t pos, size_t count)
-{
-	register float *out = p_out;
-	register float *buf = buf_in + pos;
-	register float *in = p_in + pos;
-	register float *end = in + count;
-
-	while (in < end)
-		*(out++) += *(in++) * *(buf++);
-}
-
-static inline void mix_audio(float *p_out, float *p_in, size_t pos,
-			     size_t count)
-{
-	register float *out = p_out;
-	register float *in = p_in + pos;
-	register float *end = in + count;
-
-	while (in < end)
-		*(out++) += *(in++);
+	/* with no timestamp, every pending action is applied at once */
+	apply_scene_item_audio_actions(item, NULL, 0, sample_rate);
 }
 
 static bool scene_audio_render(void *data, uint64_t *ts_out,
@@ -1142,10 +1128,10 @@ static bool scene_audio_render(void *data, uint64_t *ts_out,
 				float *in = child_audio.output[mix].data[ch];
 
 				if (apply_buf)
-					mix_audio_with_buf(out, in, buf, pos,
-							   count);
+					audio_mix_add_mul(out, in + pos,
+							  buf + pos, count);
 				else
-					mix_audio(out, in, pos, count);
+					audio_mix_add(out, in + pos, count);
 			}
 		}
 
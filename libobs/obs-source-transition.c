@@ -922,6 +922,19 @@ static void process_audio(obs_source_t *transition, obs_source_t *child,
 	}
 }
 
+static void copy_audio(obs_source_t *child, struct obs_source_audio_mix *audio,
+		       uint32_t mixers, size_t channels)
+{
+	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
+		if ((mixers & (1 << mix_idx)) == 0)
+			continue;
+
+		memcpy(audio->output[mix_idx].data[0],
+		       child->audio_output_buf[mix_idx][0],
+		       AUDIO_OUTPUT_FRAMES * sizeof(float) * channels);
+	}
+}
+
 static inline uint64_t calc_min_ts(obs_source_t *sources[2])
 {
 	uint64_t min_ts = 0;
@@ -1001,9 +1014,7 @@ bool obs_transition_audio_render(obs_source_t *transition, uint64_t *ts_out,
 					      min_ts, mixers, channels,
 					      sample_rate, mix_b);
 		} else if (state.s[0]) {
-			memcpy(audio->output[0].data[0],
-			       state.s[0]->audio_output_buf[0][0],
-			       TOTAL_AUDIO_SIZE);
+			copy_audio(state.s[0], audio, mixers, channels);
 		}
 
 		obs_source_release(state.s[0]);
@@ -31,6 +31,13 @@
 #include "obs.h"
 #include "obs-internal.h"
 
+/* maximum number of async frames waiting to be displayed */
+#define MAX_ASYNC_FRAMES 30
+
+/* maximum number of async frames allocated per source, including frames
+ * held by filters (such as the video delay filter) */
+#define MAX_ASYNC_CACHE_FRAMES 1024
+
 static bool filter_compatible(obs_source_t *source, obs_source_t *filter);
 
 static inline bool data_valid(const struct obs_source *source, const char *f)
@@ -115,8 +122,18 @@ bool obs_source_init_context(struct obs_source *source, obs_data_t *settings,
 				   settings, name, hotkey_data, private))
 		return false;
 
-	return signal_handler_add_array(source->context.signals,
-					source_signals);
+	if (!signal_handler_add_array(source->context.signals, source_signals))
+		return false;
+
+	source->volume_signal =
+		signal_handler_get_handle(source->context.signals, "volume");
+	source->mute_signal =
+		signal_handler_get_handle(source->context.signals, "mute");
+	source->update_flags_signal = signal_handler_get_handle(
+		source->context.signals, "update_flags");
+	source->update_properties_signal = signal_handler_get_handle(
+		source->context.signals, "update_properties");
+	return true;
 }
 
 const char *obs_source_get_display_name(const char *id)
@@ -181,10 +198,13 @@ static bool obs_source_init(struct obs_source *source)
 	source->audio_active = true;
 	pthread_mutex_init_value(&source->filter_mutex);
 	pthread_mutex_init_value(&source->async_mutex);
+	pthread_mutex_init_value(&source->async_output_mutex);
 	pthread_mutex_init_value(&source->audio_mutex);
 	pthread_mutex_init_value(&source->audio_buf_mutex);
 	pthread_mutex_init_value(&source->audio_cb_mutex);
 	pthread_mutex_init_value(&source->caption_cb_mutex);
+	pthread_mutex_init_value(&source->audio_dsp_mutex);
+	pthread_mutex_init_value(&source->filter_stats_mutex);
 
 	if (pthread_mutexattr_init(&attr) != 0)
 		return false;
@@ -202,8 +222,19 @@ static bool obs_source_init(struct obs_source *source)
 		return false;
 	if (pthread_mutex_init(&source->async_mutex, NULL) != 0)
 		return false;
+	if (pthread_mutex_init(&source->async_output_mutex, NULL) != 0)
+		return false;
 	if (pthread_mutex_init(&source->caption_cb_mutex, NULL) != 0)
 		return false;
+	if (pthread_mutex_init(&source->audio_dsp_mutex, NULL) != 0)
+		return false;
+	if (pthread_mutex_init(&source->filter_stats_mutex, NULL) != 0)
+		return false;
+
+	if ((source->info.output_flags & OBS_SOURCE_ASYNC) != 0) {
+		spsc_queue_init(&source->async_queue, MAX_ASYNC_FRAMES);
+		spsc_queue_init(&source->async_free, MAX_ASYNC_CACHE_FRAMES);
+	}
 
 	if (is_audio_source(source) || is_composite_source(source))
 		allocate_audio_output_buffer(source);
@@ -349,7 +380,11 @@ obs_source_create_internal(const char *id, const char *name,
 		source->owns_info_id = true;
 		source->info.unversioned_id = bstrdup(source->info.id);
 	} else {
+		size_t type_idx = info - obs->source_types.array;
+
 		source->info = *info;
+		source->profile_tick_name =
+			obs->source_tick_names.array[type_idx];
 
 		/* Always mark filters as private so they aren't found by
 		 * source enum/search functions.
@@ -603,14 +638,67 @@ void obs_source_frame_init(struct obs_source_frame *frame,
 	}
 }
 
+static inline struct obs_source_frame *
+async_frame_create(enum video_format format, uint32_t width, uint32_t height)
+{
+	struct async_frame *af = bzalloc(sizeof(struct async_frame));
+	obs_source_frame_init(&af->frame, format, width, height);
+	af->frame.async_frame = true;
+	return &af->frame;
+}
+
+static void async_frame_destroy(struct obs_source_frame *frame)
+{
+	struct async_frame *af = (struct async_frame *)frame;
+
+	if (!frame)
+		return;
+
+	/* frames created with obs_source_frame_create */
+	if (!frame->async_frame) {
+		obs_source_frame_destroy(frame);
+		return;
+	}
+
+	if (af->release)
+		af->release(af->param);
+	else
+		bfree(frame->data[0]);
+	bfree(af);
+}
+
+static inline bool async_frame_shared(const struct obs_source_frame *frame)
+{
+	return frame->async_frame &&
+	       ((const struct async_frame *)frame)->release != NULL;
+}
+
 static inline void obs_source_frame_decref(struct obs_source_frame *frame)
 {
 	if (os_atomic_dec_long(&frame->refs) == 0)
-		obs_source_frame_destroy(frame);
+		async_frame_destroy(frame);
+}
+
+/* gives back shared frames still held by the source */
+static void release_async_frames(struct obs_source *source)
+{
+	struct obs_source_frame *frame;
+
+	while ((frame = spsc_queue_pop(&source->async_queue)) != NULL)
+		remove_async_frame(source, frame);
+	for (size_t i = 0; i < source->async_frames.num; i++)
+		remove_async_frame(source, source->async_frames.array[i]);
+
+	remove_async_frame(source, source->cur_async_frame);
+	remove_async_frame(source, source->prev_async_frame);
+	source->cur_async_frame = NULL;
+	source->prev_async_frame = NULL;
+	da_resize(source->async_frames, 0);
 }
 
 static bool obs_source_filter_remove_refless(obs_source_t *source,
 					     obs_source_t *filter);
+static void stop_audio_dsp_thread(obs_source_t *source);
 
 void obs_source_destroy(struct obs_source *source)
 {
@@ -631,6 +719,12 @@ void obs_source_destroy(struct obs_source *source)
 	}
 	pthread_mutex_unlock(&obs->data.audio_sources_mutex);
 
+	/* finish the queued audio while the filters are still there */
+	pthread_mutex_lock(&source->audio_dsp_mutex);
+	if (source->audio_dsp_active)
+		stop_audio_dsp_thread(source);
+	pthread_mutex_unlock(&source->audio_dsp_mutex);
+
 	if (source->filter_parent)
 		obs_source_filter_remove_refless(source->filter_parent, source);
 
@@ -655,8 +749,9 @@ void obs_source_destroy(struct obs_source *source)
 	obs_hotkey_unregister(source->push_to_mute_key);
 	obs_hotkey_pair_unregister(source->mute_unmute_key);
 
+	release_async_frames(source);
 	for (i = 0; i < source->async_cache.num; i++)
-		obs_source_frame_decref(source->async_cache.array[i].frame);
+		obs_source_frame_decref(source->async_cache.array[i]);
 
 	gs_enter_context(obs->video.graphics);
 	if (source->async_texrender)
@@ -689,6 +784,8 @@ void obs_source_destroy(struct obs_source *source)
 	da_free(source->caption_cb_list);
 	da_free(source->async_cache);
 	da_free(source->async_frames);
+	spsc_queue_free(&source->async_queue);
+	spsc_queue_free(&source->async_free);
 	da_free(source->filters);
 	pthread_mutex_destroy(&source->filter_mutex);
 	pthread_mutex_destroy(&source->audio_actions_mutex);
@@ -697,6 +794,9 @@ void obs_source_destroy(struct obs_source *source)
 	pthread_mutex_destroy(&source->audio_mutex);
 	pthread_mutex_destroy(&source->caption_cb_mutex);
 	pthread_mutex_destroy(&source->async_mutex);
+	pthread_mutex_destroy(&source->async_output_mutex);
+	pthread_mutex_destroy(&source->audio_dsp_mutex);
+	pthread_mutex_destroy(&source->filter_stats_mutex);
 	obs_data_release(source->private_settings);
 	obs_context_data_free(&source->context);
 
@@ -942,10 +1042,16 @@ void obs_source_update(obs_source_t *source, obs_data_t *settings)
 
 void obs_source_update_properties(obs_source_t *source)
 {
+	struct calldata data;
+	uint8_t stack[128];
+
 	if (!obs_source_valid(source, "obs_source_update_properties"))
 		return;
 
-	obs_source_dosignal(source, NULL, "update_properties");
+	calldata_init_fixed(&data, stack, sizeof(stack));
+	calldata_append_ptr(&data, "source", source);
+
+	signal_handle_signal(source->update_properties_signal, &data);
 }
 
 void obs_source_send_mouse_click(obs_source_t *source,
@@ -1120,12 +1226,32 @@ static inline struct obs_source_frame *get_closest_frame(obs_source_t *source,
 bool set_async_texture_size(struct obs_source *source,
 			    const struct obs_source_frame *frame);
 
+/* takes frames from the output thread(s) */
+static void receive_async_frames(obs_source_t *source)
+{
+	struct obs_source_frame *frame;
+
+	while ((frame = spsc_queue_pop(&source->async_queue)) != NULL)
+		da_push_back(source->async_frames, &frame);
+
+	if (os_atomic_set_bool(&source->async_flush, false)) {
+		for (size_t i = 0; i < source->async_frames.num; i++)
+			remove_async_frame(source,
+					   source->async_frames.array[i]);
+
+		da_resize(source->async_frames, 0);
+		source->last_frame_ts = 0;
+	}
+}
+
 static void async_tick(obs_source_t *source)
 {
 	uint64_t sys_time = obs->video.video_time;
 
 	pthread_mutex_lock(&source->async_mutex);
 
+	receive_async_frames(source);
+
 	if (deinterlacing_enabled(source)) {
 		deinterlace_process_last_frame(source, sys_time);
 	} else {
@@ -1138,6 +1264,8 @@ static void async_tick(obs_source_t *source)
 	}
 
 	source->last_sys_timestamp = sys_time;
+	os_atomic_set_long(&source->async_pending,
+			   (long)source->async_frames.num);
 	pthread_mutex_unlock(&source->async_mutex);
 
 	if (source->cur_async_frame)
@@ -1145,15 +1273,34 @@ static void async_tick(obs_source_t *source)
 			set_async_texture_size(source, source->cur_async_frame);
 }
 
-void obs_source_video_tick(obs_source_t *source, float seconds)
+/* how often the tick of a source that is neither showing nor active is
+ * called when its ticks are coalesced */
+#define COALESCED_TICK_INTERVAL 0.25f
+
+/* filters and transitions follow whatever uses them, so only inputs and scenes
+ * have their ticks held back when they aren't used anywhere */
+static inline bool tick_held_back(const obs_source_t *source,
+				  enum obs_inactive_tick_mode mode)
 {
-	bool now_showing, now_active;
+	if (mode == OBS_INACTIVE_TICK_ALWAYS)
+		return false;
+	if (source->info.type != OBS_SOURCE_TYPE_INPUT &&
+	    source->info.type != OBS_SOURCE_TYPE_SCENE)
+		return false;
+	if (source->showing || source->active)
+		return false;
 
-	if (!obs_source_valid(source, "obs_source_video_tick"))
-		return;
+	return mode == OBS_INACTIVE_TICK_SKIP ||
+	       source->pending_tick_seconds < COALESCED_TICK_INTERVAL;
+}
+
+bool obs_source_video_tick_begin(obs_source_t *source, float *seconds)
+{
+	enum obs_inactive_tick_mode mode;
+	bool now_showing, now_active;
 
 	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
-		obs_transition_tick(source, seconds);
+		obs_transition_tick(source, *seconds);
 
 	if ((source->info.output_flags & OBS_SOURCE_ASYNC) != 0)
 		async_tick(source);
@@ -1213,13 +1360,48 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 		source->active = now_active;
 	}
 
-	if (source->context.data && source->info.video_tick)
-		source->info.video_tick(source->context.data, seconds);
+	if (!source->context.data || !source->info.video_tick)
+		return false;
+
+	mode = (enum obs_inactive_tick_mode)os_atomic_load_long(
+		&obs->video.inactive_tick_mode);
 
+	source->pending_tick_seconds += *seconds;
+	if (tick_held_back(source, mode)) {
+		if (mode == OBS_INACTIVE_TICK_SKIP)
+			source->pending_tick_seconds = 0.0f;
+		return false;
+	}
+
+	*seconds = source->pending_tick_seconds;
+	source->pending_tick_seconds = 0.0f;
+	return true;
+}
+
+void obs_source_video_tick_call(obs_source_t *source, float seconds)
+{
+	profile_start(source->profile_tick_name);
+	source->info.video_tick(source->context.data, seconds);
+	profile_end(source->profile_tick_name);
+}
+
+void obs_source_video_tick_end(obs_source_t *source)
+{
 	source->async_rendered = false;
 	source->deinterlace_rendered = false;
 }
 
+void obs_source_video_tick(obs_source_t *source, float seconds)
+{
+	if (!obs_source_valid(source, "obs_source_video_tick"))
+		return;
+
+	if (obs_source_video_tick_begin(source, &seconds))
+		obs_source_video_tick_call(source, seconds);
+
+	obs_source_video_tick_end(source);
+}
+
 /* unless the value is 3+ hours worth of frames, this won't overflow */
 static inline uint64_t conv_frames_to_time(const size_t sample_rate,
 					   const size_t frames)
@@ -2094,13 +2276,25 @@ static inline void check_to_swap_bgrx_bgra(obs_source_t *source,
 	}
 }
 
+static inline void update_frame_capture_ts(uint64_t received_ts)
+{
+	struct obs_core_video *video = &obs->video;
+
+	if (!video->frame_capture_ts || received_ts < video->frame_capture_ts)
+		video->frame_capture_ts = received_ts;
+}
+
 static void obs_source_update_async_video(obs_source_t *source)
 {
 	if (!source->async_rendered) {
 		struct obs_source_frame *frame = obs_source_get_frame(source);
+		uint64_t received_ts = 0;
 
-		if (frame)
+		if (frame) {
+			received_ts =
+				((struct async_frame *)frame)->received_ts;
 			frame = filter_async_video(source, frame);
+		}
 
 		source->async_rendered = true;
 		if (frame) {
@@ -2118,6 +2312,7 @@ static void obs_source_update_async_video(obs_source_t *source)
 						      source->async_textures,
 						      source->async_texrender);
 				source->async_update_texture = false;
+				update_frame_capture_ts(received_ts);
 			}
 
 			obs_source_release_frame(source, frame);
@@ -2752,104 +2947,81 @@ void obs_source_frame_copy(struct obs_source_frame *dst,
 	copy_frame_data(dst, src);
 }
 
-static inline bool async_texture_changed(struct obs_source *source,
-					 const struct obs_source_frame *frame)
+static inline bool async_frame_matches(const struct obs_source_frame *cached,
+				       const struct obs_source_frame *frame)
 {
-	enum convert_type prev, cur;
-	prev = get_convert_type(source->async_cache_format,
-				source->async_cache_full_range);
-	cur = get_convert_type(frame->format, frame->full_range);
-
-	return source->async_cache_width != frame->width ||
-	       source->async_cache_height != frame->height || prev != cur;
+	return cached->format == frame->format &&
+	       cached->width == frame->width &&
+	       cached->height == frame->height;
 }
 
-static inline void free_async_cache(struct obs_source *source)
+static void destroy_cached_frame(struct obs_source *source,
+				 struct obs_source_frame *frame)
 {
-	for (size_t i = 0; i < source->async_cache.num; i++)
-		obs_source_frame_decref(source->async_cache.array[i].frame);
-
-	da_resize(source->async_cache, 0);
-	da_resize(source->async_frames, 0);
-	source->cur_async_frame = NULL;
-	source->prev_async_frame = NULL;
+	da_erase_item(source->async_cache, &frame);
+	obs_source_frame_decref(frame);
 }
 
 #define MAX_UNUSED_FRAME_DURATION 5
 
-/* frees frame allocations if they haven't been used for a specific period
- * of time */
+/* frees a frame allocation if frames have been left unused for a specific
+ * period of time */
 static void clean_cache(obs_source_t *source)
 {
-	for (size_t i = source->async_cache.num; i > 0; i--) {
-		struct async_frame *af = &source->async_cache.array[i - 1];
-		if (!af->used) {
-			if (++af->unused_count == MAX_UNUSED_FRAME_DURATION) {
-				obs_source_frame_destroy(af->frame);
-				da_erase(source->async_cache, i - 1);
-			}
-		}
+	struct obs_source_frame *frame;
+
+	if (!spsc_queue_size(&source->async_free)) {
+		source->async_unused_count = 0;
+		return;
 	}
+
+	if (++source->async_unused_count < MAX_UNUSED_FRAME_DURATION)
+		return;
+
+	frame = spsc_queue_pop(&source->async_free);
+	if (frame)
+		destroy_cached_frame(source, frame);
+	source->async_unused_count = 0;
 }
 
-#define MAX_ASYNC_FRAMES 30
-//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
+static inline bool async_queue_full(struct obs_source *source)
+{
+	size_t pending = spsc_queue_size(&source->async_queue) +
+			 (size_t)os_atomic_load_long(&source->async_pending);
+	return pending >= MAX_ASYNC_FRAMES;
+}
+
+/* called with async_output_mutex held */
 static inline struct obs_source_frame *
 cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 {
-	struct obs_source_frame *new_frame = NULL;
-
-	pthread_mutex_lock(&source->async_mutex);
+	struct obs_source_frame *new_frame;
 
-	if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
-		free_async_cache(source);
-		source->last_frame_ts = 0;
-		pthread_mutex_unlock(&source->async_mutex);
+	if (async_queue_full(source)) {
+		os_atomic_set_bool(&source->async_flush, true);
 		return NULL;
 	}
 
-	if (async_texture_changed(source, frame)) {
-		free_async_cache(source);
-		source->async_cache_width = frame->width;
-		source->async_cache_height = frame->height;
-	}
-
-	const enum video_format format = frame->format;
-	source->async_cache_format = format;
-	source->async_cache_full_range = frame->full_range;
-
-	for (size_t i = 0; i < source->async_cache.num; i++) {
-		struct async_frame *af = &source->async_cache.array[i];
-		if (!af->used) {
-			new_frame = af->frame;
-			new_frame->format = format;
-			af->used = true;
-			af->unused_count = 0;
+	while ((new_frame = spsc_queue_pop(&source->async_free)) != NULL) {
+		if (async_frame_matches(new_frame, frame))
 			break;
-		}
+		destroy_cached_frame(source, new_frame);
 	}
 
 	clean_cache(source);
 
 	if (!new_frame) {
-		struct async_frame new_af;
+		if (source->async_cache.num >= MAX_ASYNC_CACHE_FRAMES)
+			return NULL;
 
-		new_frame = obs_source_frame_create(format, frame->width,
-						    frame->height);
-		new_af.frame = new_frame;
-		new_af.used = true;
-		new_af.unused_count = 0;
+		new_frame = async_frame_create(frame->format, frame->width,
+					       frame->height);
 		new_frame->refs = 1;
 
-		da_push_back(source->async_cache, &new_af);
+		da_push_back(source->async_cache, &new_frame);
 	}
 
-	os_atomic_inc_long(&new_frame->refs);
-
-	pthread_mutex_unlock(&source->async_mutex);
-
 	copy_frame_data(new_frame, frame);
-
 	return new_frame;
 }
 
@@ -2857,6 +3029,8 @@ static void
 obs_source_output_video_internal(obs_source_t *source,
 				 const struct obs_source_frame *frame)
 {
+	struct obs_source_frame *output;
+
 	if (!obs_source_valid(source, "obs_source_output_video"))
 		return;
 
@@ -2865,21 +3039,20 @@ obs_source_output_video_internal(obs_source_t *source,
 		return;
 	}
 
-	struct obs_source_frame *output = !!frame ? cache_video(source, frame)
-						  : NULL;
+	pthread_mutex_lock(&source->async_output_mutex);
 
-	/* ------------------------------------------- */
-	pthread_mutex_lock(&source->async_mutex);
+	output = cache_video(source, frame);
 	if (output) {
-		if (os_atomic_dec_long(&output->refs) == 0) {
-			obs_source_frame_destroy(output);
-			output = NULL;
-		} else {
-			da_push_back(source->async_frames, &output);
-			source->async_active = true;
-		}
+		((struct async_frame *)output)->received_ts = os_gettime_ns();
+
+		/* cannot fail, the queue is never allowed to fill up */
+		spsc_queue_push(&source->async_queue, output);
+		source->async_active = true;
+	} else {
+		os_atomic_inc_long(&source->async_dropped);
 	}
-	pthread_mutex_unlock(&source->async_mutex);
+
+	pthread_mutex_unlock(&source->async_output_mutex);
 }
 
 void obs_source_output_video(obs_source_t *source,
@@ -2931,12 +3104,130 @@ void obs_source_output_video2(obs_source_t *source,
 	obs_source_output_video_internal(source, &new_frame);
 }
 
+static void
+obs_source_output_shared_video_internal(obs_source_t *source,
+					const struct obs_source_frame *frame,
+					obs_source_frame_release_t release,
+					void *param)
+{
+	struct async_frame *af;
+
+	if (!obs_source_valid(source, "obs_source_output_shared_video"))
+		return;
+
+	if (!frame) {
+		source->async_active = false;
+		return;
+	}
+
+	pthread_mutex_lock(&source->async_output_mutex);
+
+	if (async_queue_full(source)) {
+		os_atomic_set_bool(&source->async_flush, true);
+		os_atomic_inc_long(&source->async_dropped);
+		pthread_mutex_unlock(&source->async_output_mutex);
+
+		if (release)
+			release(param);
+		return;
+	}
+
+	af = bmalloc(sizeof(struct async_frame));
+	af->frame = *frame;
+	af->frame.refs = 1;
+	af->frame.prev_frame = false;
+	af->frame.async_frame = true;
+	af->release = release;
+	af->param = param;
+	af->received_ts = os_gettime_ns();
+
+	spsc_queue_push(&source->async_queue, &af->frame);
+	source->async_active = true;
+
+	pthread_mutex_unlock(&source->async_output_mutex);
+}
+
+void obs_source_output_shared_video(obs_source_t *source,
+				    const struct obs_source_frame *frame,
+				    obs_source_frame_release_t release,
+				    void *param)
+{
+	if (!frame) {
+		obs_source_output_shared_video_internal(source, NULL, NULL,
+							NULL);
+		return;
+	}
+
+	struct obs_source_frame new_frame = *frame;
+	new_frame.full_range =
+		format_is_yuv(frame->format) ? new_frame.full_range : true;
+
+	obs_source_output_shared_video_internal(source, &new_frame, release,
+						param);
+}
+
+void obs_source_output_shared_video2(obs_source_t *source,
+				     const struct obs_source_frame2 *frame,
+				     obs_source_frame_release_t release,
+				     void *param)
+{
+	if (!frame) {
+		obs_source_output_shared_video_internal(source, NULL, NULL,
+							NULL);
+		return;
+	}
+
+	struct obs_source_frame new_frame;
+	enum video_range_type range =
+		resolve_video_range(frame->format, frame->range);
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		new_frame.data[i] = frame->data[i];
+		new_frame.linesize[i] = frame->linesize[i];
+	}
+
+	new_frame.width = frame->width;
+	new_frame.height = frame->height;
+	new_frame.timestamp = frame->timestamp;
+	new_frame.format = frame->format;
+	new_frame.full_range = range == VIDEO_RANGE_FULL;
+	new_frame.flip = frame->flip;
+
+	memcpy(&new_frame.color_matrix, &frame->color_matrix,
+	       sizeof(frame->color_matrix));
+	memcpy(&new_frame.color_range_min, &frame->color_range_min,
+	       sizeof(frame->color_range_min));
+	memcpy(&new_frame.color_range_max, &frame->color_range_max,
+	       sizeof(frame->color_range_max));
+
+	obs_source_output_shared_video_internal(source, &new_frame, release,
+						param);
+}
+
 void obs_source_set_async_rotation(obs_source_t *source, long rotation)
 {
 	if (source)
 		source->async_rotation = rotation;
 }
 
+uint32_t obs_source_get_async_queue_depth(const obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_get_async_queue_depth"))
+		return 0;
+	if (!source->async_queue.capacity)
+		return 0;
+
+	return (uint32_t)(spsc_queue_size(&source->async_queue) +
+			  os_atomic_load_long(&source->async_pending));
+}
+
+uint32_t obs_source_get_async_frames_dropped(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_get_async_frames_dropped")
+		       ? (uint32_t)os_atomic_load_long(&source->async_dropped)
+		       : 0;
+}
+
 void obs_source_output_cea708(obs_source_t *source,
 			      const struct obs_source_cea_708 *captions)
 {
@@ -3166,6 +3457,20 @@ void obs_source_set_video_frame2(obs_source_t *source,
 	obs_source_set_video_frame_internal(source, &new_frame);
 }
 
+static inline void update_audio_filter_stats(obs_source_t *filter,
+					     uint64_t ns)
+{
+	struct obs_audio_filter_stats *stats = &filter->audio_filter_stats;
+
+	pthread_mutex_lock(&filter->filter_stats_mutex);
+	stats->calls++;
+	stats->total_ns += ns;
+	stats->last_ns = ns;
+	if (ns > stats->max_ns)
+		stats->max_ns = ns;
+	pthread_mutex_unlock(&filter->filter_stats_mutex);
+}
+
 static inline struct obs_audio_data *
 filter_async_audio(obs_source_t *source, struct obs_audio_data *in)
 {
@@ -3177,8 +3482,12 @@ filter_async_audio(obs_source_t *source, struct obs_audio_data *in)
 			continue;
 
 		if (filter->context.data && filter->info.filter_audio) {
+			uint64_t start = os_gettime_ns();
+
 			in = filter->info.filter_audio(filter->context.data,
 						       in);
+			update_audio_filter_stats(filter,
+						  os_gettime_ns() - start);
 			if (!in)
 				return NULL;
 		}
@@ -3342,16 +3651,11 @@ static void process_audio(obs_source_t *source,
 		downmix_to_mono_planar(source, frames);
 }
 
-void obs_source_output_audio(obs_source_t *source,
-			     const struct obs_source_audio *audio)
+static void output_audio_internal(obs_source_t *source,
+				  const struct obs_source_audio *audio)
 {
 	struct obs_audio_data *output;
 
-	if (!obs_source_valid(source, "obs_source_output_audio"))
-		return;
-	if (!obs_ptr_valid(audio, "obs_source_output_audio"))
-		return;
-
 	process_audio(source, audio);
 
 	pthread_mutex_lock(&source->filter_mutex);
@@ -3374,19 +3678,236 @@ void obs_source_output_audio(obs_source_t *source,
 	pthread_mutex_unlock(&source->filter_mutex);
 }
 
-void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
+/* ------------------------------------------------------------------------- */
+/* audio DSP thread                                                          */
+
+/* maximum number of audio blocks waiting for the DSP thread (a block is
+ * usually around 10-20 milliseconds of audio) */
+#define AUDIO_DSP_QUEUE_BLOCKS 32
+
+struct audio_dsp_block {
+	struct obs_source_audio audio;
+	uint8_t *data;
+	size_t size;
+};
+
+static void *audio_dsp_thread(void *param)
 {
-	if (frame)
-		frame->prev_frame = false;
+	obs_source_t *source = param;
+	struct audio_dsp_block *block;
 
-	for (size_t i = 0; i < source->async_cache.num; i++) {
-		struct async_frame *f = &source->async_cache.array[i];
+	os_set_thread_name("obs audio dsp");
 
-		if (f->frame == frame) {
-			f->used = false;
+	/* the semaphore is posted once per block, and once without a block
+	 * when stopping, after all the blocks before it */
+	while (os_sem_wait(source->audio_dsp_sem) == 0) {
+		block = spsc_queue_pop(&source->audio_dsp_queue);
+		if (!block)
 			break;
+
+		output_audio_internal(source, &block->audio);
+		spsc_queue_push(&source->audio_dsp_free, block);
+	}
+
+	return NULL;
+}
+
+static void free_audio_dsp_blocks(obs_source_t *source)
+{
+	for (size_t i = 0; i < source->audio_dsp_blocks.num; i++) {
+		struct audio_dsp_block *block;
+
+		block = source->audio_dsp_blocks.array[i];
+		bfree(block->data);
+		bfree(block);
+	}
+
+	da_free(source->audio_dsp_blocks);
+	spsc_queue_free(&source->audio_dsp_queue);
+	spsc_queue_free(&source->audio_dsp_free);
+}
+
+/* called with audio_dsp_mutex held */
+static void start_audio_dsp_thread(obs_source_t *source)
+{
+	if (os_sem_init(&source->audio_dsp_sem, 0) != 0)
+		return;
+
+	spsc_queue_init(&source->audio_dsp_queue, AUDIO_DSP_QUEUE_BLOCKS);
+	spsc_queue_init(&source->audio_dsp_free, AUDIO_DSP_QUEUE_BLOCKS);
+
+	if (pthread_create(&source->audio_dsp_thread, NULL, audio_dsp_thread,
+			   source) != 0) {
+		blog(LOG_WARNING,
+		     "Failed to create the audio DSP thread of source '%s'",
+		     source->context.name);
+		free_audio_dsp_blocks(source);
+		os_sem_destroy(source->audio_dsp_sem);
+		source->audio_dsp_sem = NULL;
+		return;
+	}
+
+	os_atomic_set_bool(&source->audio_dsp_active, true);
+}
+
+/* called with audio_dsp_mutex held, processes the queued audio first.  the
+ * thread is only marked inactive once it's done, so audio output directly
+ * (without the mutex) can't overtake the audio still queued */
+static void stop_audio_dsp_thread(obs_source_t *source)
+{
+	os_sem_post(source->audio_dsp_sem);
+	pthread_join(source->audio_dsp_thread, NULL);
+	os_atomic_set_bool(&source->audio_dsp_active, false);
+
+	os_sem_destroy(source->audio_dsp_sem);
+	source->audio_dsp_sem = NULL;
+	free_audio_dsp_blocks(source);
+}
+
+/* called with audio_dsp_mutex held */
+static void queue_dsp_audio(obs_source_t *source,
+			    const struct obs_source_audio *audio)
+{
+	size_t planes = get_audio_planes(audio->format, audio->speakers);
+	size_t plane_size =
+		get_audio_size(audio->format, audio->speakers, audio->frames);
+	struct audio_dsp_block *block;
+	uint8_t *ptr;
+
+	block = spsc_queue_pop(&source->audio_dsp_free);
+	if (!block) {
+		if (source->audio_dsp_blocks.num == AUDIO_DSP_QUEUE_BLOCKS) {
+			os_atomic_inc_long(&source->audio_dsp_dropped);
+			return;
 		}
+
+		block = bzalloc(sizeof(*block));
+		da_push_back(source->audio_dsp_blocks, &block);
 	}
+
+	if (block->size < planes * plane_size) {
+		bfree(block->data);
+		block->size = planes * plane_size;
+		block->data = bmalloc(block->size);
+	}
+
+	block->audio = *audio;
+	ptr = block->data;
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		if (i < planes && audio->data[i]) {
+			memcpy(ptr, audio->data[i], plane_size);
+			block->audio.data[i] = ptr;
+			ptr += plane_size;
+		} else {
+			block->audio.data[i] = NULL;
+		}
+	}
+
+	/* cannot fail, there are never more blocks than the queue holds */
+	spsc_queue_push(&source->audio_dsp_queue, block);
+	os_sem_post(source->audio_dsp_sem);
+}
+
+void obs_source_output_audio(obs_source_t *source,
+			     const struct obs_source_audio *audio)
+{
+	if (!obs_source_valid(source, "obs_source_output_audio"))
+		return;
+	if (!obs_ptr_valid(audio, "obs_source_output_audio"))
+		return;
+
+	/* without a DSP thread the filters run right here, and the mutex is
+	 * left alone so that it isn't held across the whole filter chain */
+	if (!os_atomic_load_bool(&source->audio_dsp_active)) {
+		output_audio_internal(source, audio);
+		return;
+	}
+
+	pthread_mutex_lock(&source->audio_dsp_mutex);
+
+	/* stopped while waiting for the mutex */
+	if (source->audio_dsp_active)
+		queue_dsp_audio(source, audio);
+	else
+		output_audio_internal(source, audio);
+
+	pthread_mutex_unlock(&source->audio_dsp_mutex);
+}
+
+void obs_source_set_audio_dsp_thread(obs_source_t *source, bool enable)
+{
+	if (!obs_source_valid(source, "obs_source_set_audio_dsp_thread"))
+		return;
+
+	pthread_mutex_lock(&source->audio_dsp_mutex);
+
+	if (enable && !source->audio_dsp_active)
+		start_audio_dsp_thread(source);
+	else if (!enable && source->audio_dsp_active)
+		stop_audio_dsp_thread(source);
+
+	pthread_mutex_unlock(&source->audio_dsp_mutex);
+}
+
+bool obs_source_audio_dsp_thread_enabled(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_audio_dsp_thread_enabled")
+		       ? os_atomic_load_bool(&source->audio_dsp_active)
+		       : false;
+}
+
+uint32_t obs_source_get_audio_dsp_dropped(const obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_get_audio_dsp_dropped"))
+		return 0;
+
+	return (uint32_t)os_atomic_load_long(&source->audio_dsp_dropped);
+}
+
+bool obs_source_get_audio_filter_stats(obs_source_t *filter,
+				       struct obs_audio_filter_stats *stats)
+{
+	if (!obs_source_valid(filter, "obs_source_get_audio_filter_stats"))
+		return false;
+	if (!obs_ptr_valid(stats, "obs_source_get_audio_filter_stats"))
+		return false;
+	if (filter->info.type != OBS_SOURCE_TYPE_FILTER)
+		return false;
+
+	pthread_mutex_lock(&filter->filter_stats_mutex);
+	*stats = filter->audio_filter_stats;
+	pthread_mutex_unlock(&filter->filter_stats_mutex);
+	return true;
+}
+
+void obs_source_reset_audio_filter_stats(obs_source_t *filter)
+{
+	if (!obs_source_valid(filter, "obs_source_reset_audio_filter_stats"))
+		return;
+
+	pthread_mutex_lock(&filter->filter_stats_mutex);
+	memset(&filter->audio_filter_stats, 0,
+	       sizeof(filter->audio_filter_stats));
+	pthread_mutex_unlock(&filter->filter_stats_mutex);
+}
+
+/* called with async_mutex held, returns the frame to the output thread, or
+ * to the source that shared it */
+void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
+{
+	if (!frame)
+		return;
+
+	frame->prev_frame = false;
+
+	if (async_frame_shared(frame)) {
+		obs_source_frame_decref(frame);
+		return;
+	}
+
+	/* cannot fail, the cache never holds more frames than this queue */
+	spsc_queue_push(&source->async_free, frame);
 }
 
 /* #define DEBUG_ASYNC_FRAMES 1 */
@@ -3534,12 +4055,15 @@ void obs_source_release_frame(obs_source_t *source,
 		return;
 
 	if (!source) {
-		obs_source_frame_destroy(frame);
+		if (frame->async_frame)
+			async_frame_destroy(frame);
+		else
+			obs_source_frame_destroy(frame);
 	} else {
 		pthread_mutex_lock(&source->async_mutex);
 
 		if (os_atomic_dec_long(&frame->refs) == 0)
-			obs_source_frame_destroy(frame);
+			async_frame_destroy(frame);
 		else
 			remove_async_frame(source, frame);
 
@@ -3821,15 +4345,14 @@ void obs_source_set_volume(obs_source_t *source, float volume)
 		uint8_t stack[128];
 
 		calldata_init_fixed(&data, stack, sizeof(stack));
-		calldata_set_ptr(&data, "source", source);
-		calldata_set_float(&data, "volume", volume);
+		calldata_append_ptr(&data, "source", source);
+		calldata_append_float(&data, "volume", volume);
 
-		signal_handler_signal(source->context.signals, "volume", &data);
+		signal_handle_signal(source->volume_signal, &data);
 		if (!source->context.private)
-			signal_handler_signal(obs->signals, "source_volume",
-					      &data);
+			signal_handle_signal(obs->source_volume_signal, &data);
 
-		volume = (float)calldata_float(&data, "volume");
+		volume = (float)calldata_float_at(&data, 1, "volume");
 
 		pthread_mutex_lock(&source->audio_actions_mutex);
 		da_push_back(source->audio_actions, &action);
@@ -4102,10 +4625,10 @@ static inline void signal_flags_updated(obs_source_t *source)
 	uint8_t stack[128];
 
 	calldata_init_fixed(&data, stack, sizeof(stack));
-	calldata_set_ptr(&data, "source", source);
-	calldata_set_int(&data, "flags", source->flags);
+	calldata_append_ptr(&data, "source", source);
+	calldata_append_int(&data, "flags", source->flags);
 
-	signal_handler_signal(source->context.signals, "update_flags", &data);
+	signal_handle_signal(source->update_flags_signal, &data);
 }
 
 void obs_source_set_flags(obs_source_t *source, uint32_t flags)
@@ -4353,10 +4876,10 @@ void obs_source_set_muted(obs_source_t *source, bool muted)
 	source->user_muted = muted;
 
 	calldata_init_fixed(&data, stack, sizeof(stack));
-	calldata_set_ptr(&data, "source", source);
-	calldata_set_bool(&data, "muted", muted);
+	calldata_append_ptr(&data, "source", source);
+	calldata_append_bool(&data, "muted", muted);
 
-	signal_handler_signal(source->context.signals, "mute", &data);
+	signal_handle_signal(source->mute_signal, &data);
 
 	pthread_mutex_lock(&source->audio_actions_mutex);
 	da_push_back(source->audio_actions, &action);
@@ -4581,8 +5104,8 @@ static inline void apply_audio_action(obs_source_t *source,
 	}
 }
 
-static void apply_audio_actions(obs_source_t *source, size_t channels,
-				size_t sample_rate)
+static void apply_audio_actions(obs_source_t *source, uint32_t mixers,
+				size_t channels, size_t sample_rate)
 {
 	float vol_data[AUDIO_OUTPUT_FRAMES];
 	float cur_vol = get_source_volume(source, source->audio_ts);
@@ -4621,8 +5144,10 @@ static void apply_audio_actions(obs_source_t *source, size_t channels,
 
 	pthread_mutex_unlock(&source->audio_actions_mutex);
 
+	mixers &= source->audio_mixers;
+
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-		if ((source->audio_mixers & (1 << mix)) != 0)
+		if ((mixers & (1 << mix)) != 0)
 			multiply_vol_data(source, mix, channels, vol_data);
 	}
 }
@@ -4647,7 +5172,8 @@ static void apply_audio_volume(obs_source_t *source, uint32_t mixers,
 			conv_frames_to_time(sample_rate, AUDIO_OUTPUT_FRAMES);
 
 		if (action.timestamp < (source->audio_ts + duration)) {
-			apply_audio_actions(source, channels, sample_rate);
+			apply_audio_actions(source, mixers, channels,
+					    sample_rate);
 			return;
 		}
 	}
@@ -4656,17 +5182,18 @@ static void apply_audio_volume(obs_source_t *source, uint32_t mixers,
 	if (vol == 1.0f)
 		return;
 
-	if (vol == 0.0f || mixers == 0) {
-		memset(source->audio_output_buf[0][0], 0,
-		       AUDIO_OUTPUT_FRAMES * sizeof(float) *
-			       MAX_AUDIO_CHANNELS * MAX_AUDIO_MIXES);
-		return;
-	}
+	/* only mixes that are both active and assigned to the source are
+	 * ever read back, the rest are either silent or unused */
+	mixers &= source->audio_mixers;
 
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-		uint32_t mix_and_val = (1 << mix);
-		if ((source->audio_mixers & mix_and_val) != 0 &&
-		    (mixers & mix_and_val) != 0)
+		if ((mixers & (1 << mix)) == 0)
+			continue;
+
+		if (vol == 0.0f)
+			memset(source->audio_output_buf[mix][0], 0,
+			       AUDIO_OUTPUT_FRAMES * sizeof(float) * channels);
+		else
 			multiply_output_audio(source, mix, channels, vol);
 	}
 }
@@ -4778,8 +5305,11 @@ static inline void process_audio_source_tick(obs_source_t *source,
 			mix_and_val = 1;
 		}
 
-		if ((source->audio_mixers & mix_and_val) == 0 ||
-		    (mixers & mix_and_val) == 0) {
+		/* inactive mixes are never read, so leave them be */
+		if ((mixers & mix_and_val) == 0)
+			continue;
+
+		if ((source->audio_mixers & mix_and_val) == 0) {
 			memset(source->audio_output_buf[mix][0], 0,
 			       size * channels);
 			continue;
@@ -4795,7 +5325,7 @@ static inline void process_audio_source_tick(obs_source_t *source,
 		return;
 	}
 
-	if ((source->audio_mixers & 1) == 0 || (mixers & 1) == 0)
+	if ((source->audio_mixers & 1) == 0 && (mixers & 1) != 0)
 		memset(source->audio_output_buf[0][0], 0, size * channels);
 
 	apply_audio_volume(source, mixers, channels, sample_rate);
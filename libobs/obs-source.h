@@ -191,6 +191,24 @@ enum obs_media_state {
  */
 #define OBS_SOURCE_CEA_708 (1 << 14)
 
+/**
+ * Source type's video_tick is thread-safe
+ *
+ * The video_tick of sources of this type may be called from a worker thread,
+ * at the same time as the video_tick of other sources with this flag.  It is
+ * still never called at the same time as the source's own video_render.
+ */
+#define OBS_SOURCE_THREADED_TICK (1 << 15)
+
+/**
+ * Source type's audio_mix is thread-safe
+ *
+ * The audio_mix of sources of this type may be called from a worker thread,
+ * at the same time as the audio_mix of other sources.  Without this flag,
+ * audio_mix is only ever called from the audio thread.
+ */
+#define OBS_SOURCE_THREADED_AUDIO (1 << 16)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t *parent,
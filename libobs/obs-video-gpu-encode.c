@@ -103,7 +103,7 @@ static void *gpu_encode_thread(void *unused)
 				encoder->cur_pts, lock_key, &next_key, &pkt,
 				&received);
 			send_off_encoder_packet(encoder, success, received,
-						&pkt);
+						&pkt, NULL);
 
 			lock_key = next_key;
 
@@ -23,15 +23,26 @@
 #include "graphics/vec4.h"
 #include "media-io/format-conversion.h"
 #include "media-io/video-frame.h"
+#include "util/task-pool.h"
 
 #ifdef _WIN32
 #define WIN32_MEAN_AND_LEAN
 #include <windows.h>
 #endif
 
+/* profiled under the tick name of the source type, on the pool thread */
+static void tick_threaded_source(void *param, uint32_t idx)
+{
+	struct threaded_source_tick *tick =
+		(struct threaded_source_tick *)param + idx;
+
+	obs_source_video_tick_call(tick->source, tick->seconds);
+}
+
 static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 {
 	struct obs_core_data *data = &obs->data;
+	struct obs_core_video *video = &obs->video;
 	struct obs_source *source;
 	uint64_t delta_time;
 	float seconds;
@@ -57,7 +68,8 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 	pthread_mutex_unlock(&obs->data.draw_callbacks_mutex);
 
 	/* ------------------------------------- */
-	/* call the tick function of each source */
+	/* get a reference to each source, and   */
+	/* tick them without holding the lock    */
 
 	pthread_mutex_lock(&data->sources_mutex);
 
@@ -66,14 +78,48 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 		struct obs_source *cur_source = obs_source_get_ref(source);
 		source = (struct obs_source *)source->context.next;
 
-		if (cur_source) {
-			obs_source_video_tick(cur_source, seconds);
-			obs_source_release(cur_source);
-		}
+		if (cur_source)
+			da_push_back(video->tick_sources, &cur_source);
 	}
 
 	pthread_mutex_unlock(&data->sources_mutex);
 
+	/* ------------------------------------- */
+	/* call the tick function of each source */
+
+	for (size_t i = 0; i < video->tick_sources.num; i++) {
+		struct obs_source *cur_source = video->tick_sources.array[i];
+		float tick_seconds = seconds;
+
+		if (!obs_source_video_tick_begin(cur_source, &tick_seconds))
+			continue;
+
+		if (cur_source->info.output_flags & OBS_SOURCE_THREADED_TICK) {
+			struct threaded_source_tick *tick =
+				da_push_back_new(video->threaded_ticks);
+			tick->source = cur_source;
+			tick->seconds = tick_seconds;
+		} else {
+			obs_source_video_tick_call(cur_source, tick_seconds);
+		}
+	}
+
+	if (video->threaded_ticks.num) {
+		uint32_t count = (uint32_t)video->threaded_ticks.num;
+		task_pool_run(count, tick_threaded_source,
+			      video->threaded_ticks.array);
+	}
+
+	for (size_t i = 0; i < video->tick_sources.num; i++) {
+		struct obs_source *cur_source = video->tick_sources.array[i];
+
+		obs_source_video_tick_end(cur_source);
+		obs_source_release(cur_source);
+	}
+
+	da_resize(video->tick_sources, 0);
+	da_resize(video->threaded_ticks, 0);
+
 	return cur_time;
 }
 
@@ -687,7 +733,8 @@ static inline void copy_rgbx_frame(struct video_frame *output,
 }
 
 static inline void output_video_data(struct obs_core_video *video,
-				     struct video_data *input_frame, int count)
+				     struct video_data *input_frame,
+				     struct video_latency *latency, int count)
 {
 	const struct video_output_info *info;
 	struct video_frame output_frame;
@@ -698,6 +745,9 @@ static inline void output_video_data(struct obs_core_video *video,
 	locked = video_output_lock_frame(video->video, &output_frame, count,
 					 input_frame->timestamp);
 	if (locked) {
+		latency->ts[VIDEO_LATENCY_OUTPUT] = os_gettime_ns();
+		video_output_set_frame_latency(video->video, latency);
+
 		if (video->gpu_conversion) {
 			set_gpu_converted_data(video, &output_frame,
 					       input_frame, info);
@@ -731,6 +781,7 @@ static inline void video_sleep(struct obs_core_video *video, bool raw_active,
 
 	vframe_info.timestamp = cur_time;
 	vframe_info.count = count;
+	vframe_info.latency = video->frame_latency;
 
 	if (raw_active)
 		circlebuf_push_back(&video->vframe_info_buffer, &vframe_info,
@@ -759,6 +810,9 @@ static inline void output_frame(bool raw_active, const bool gpu_active)
 	profile_start(output_frame_gs_context_name);
 	gs_enter_context(video->graphics);
 
+	video->frame_capture_ts = 0;
+	video->frame_latency.ts[VIDEO_LATENCY_RENDER] = os_gettime_ns();
+
 	profile_start(output_frame_render_video_name);
 	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_RENDER_VIDEO,
 			      output_frame_render_video_name);
@@ -766,6 +820,9 @@ static inline void output_frame(bool raw_active, const bool gpu_active)
 	GS_DEBUG_MARKER_END();
 	profile_end(output_frame_render_video_name);
 
+	video->frame_latency.ts[VIDEO_LATENCY_CAPTURE] =
+		video->frame_capture_ts;
+
 	if (raw_active) {
 		profile_start(output_frame_download_frame_name);
 		frame_ready = download_frame(video, prev_texture, &frame);
@@ -786,7 +843,8 @@ static inline void output_frame(bool raw_active, const bool gpu_active)
 
 		frame.timestamp = vframe_info.timestamp;
 		profile_start(output_frame_output_video_data_name);
-		output_video_data(video, &frame, vframe_info.count);
+		output_video_data(video, &frame, &vframe_info.latency,
+				  vframe_info.count);
 		profile_end(output_frame_output_video_data_name);
 	}
 
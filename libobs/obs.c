@@ -19,6 +19,7 @@
 
 #include "graphics/matrix4.h"
 #include "callback/calldata.h"
+#include "util/task-pool.h"
 
 #include "obs.h"
 #include "obs-internal.h"
@@ -516,6 +517,8 @@ static void obs_free_video(void)
 
 		circlebuf_free(&video->vframe_info_buffer);
 		circlebuf_free(&video->vframe_info_buffer_gpu);
+		da_free(video->tick_sources);
+		da_free(video->threaded_ticks);
 
 		video->texture_rendered = false;
 		memset(video->textures_copied, 0,
@@ -606,6 +609,7 @@ static void obs_free_audio(void)
 	circlebuf_free(&audio->buffered_timestamps);
 	da_free(audio->render_order);
 	da_free(audio->root_nodes);
+	da_free(audio->leaf_sources);
 
 	da_free(audio->monitors);
 	bfree(audio->monitoring_device_name);
@@ -747,7 +751,12 @@ static inline bool obs_init_handlers(void)
 	if (!obs->procs)
 		return false;
 
-	return signal_handler_add_array(obs->signals, obs_signals);
+	if (!signal_handler_add_array(obs->signals, obs_signals))
+		return false;
+
+	obs->source_volume_signal =
+		signal_handler_get_handle(obs->signals, "source_volume");
+	return true;
 }
 
 static pthread_once_t obs_pthread_once_init_token = PTHREAD_ONCE_INIT;
@@ -759,7 +768,6 @@ static inline bool obs_init_hotkeys(void)
 
 	assert(hotkeys != NULL);
 
-	da_init(hotkeys->hotkeys);
 	hotkeys->signals = obs->signals;
 	hotkeys->name_map_init_token = obs_pthread_once_init_token;
 	hotkeys->mute = bstrdup("Mute");
@@ -1002,6 +1010,7 @@ void obs_shutdown(void)
 			bfree((void *)item->id);
 	}
 	da_free(obs->source_types);
+	da_free(obs->source_tick_names);
 
 #define FREE_REGISTERED_TYPES(structure, list)                         \
 	do {                                                           \
@@ -1041,10 +1050,13 @@ void obs_shutdown(void)
 	obs_free_video();
 	obs_free_hotkeys();
 	obs_free_graphics();
+	task_pool_shutdown();
+	obs_encoder_packet_pool_free();
 	proc_handler_destroy(obs->procs);
 	signal_handler_destroy(obs->signals);
 	obs->procs = NULL;
 	obs->signals = NULL;
+	obs->source_volume_signal = NULL;
 
 	for (size_t i = 0; i < obs->module_paths.num; i++)
 		free_module_path(obs->module_paths.array + i);
@@ -1239,6 +1251,23 @@ bool obs_get_audio_info(struct obs_audio_info *oai)
 	return true;
 }
 
+void obs_set_inactive_tick_mode(enum obs_inactive_tick_mode mode)
+{
+	if (!obs)
+		return;
+
+	os_atomic_set_long(&obs->video.inactive_tick_mode, (long)mode);
+}
+
+enum obs_inactive_tick_mode obs_get_inactive_tick_mode(void)
+{
+	if (!obs)
+		return OBS_INACTIVE_TICK_ALWAYS;
+
+	return (enum obs_inactive_tick_mode)os_atomic_load_long(
+		&obs->video.inactive_tick_mode);
+}
+
 bool obs_enum_source_types(size_t idx, const char **id)
 {
 	if (idx >= obs->source_types.num)
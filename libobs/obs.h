@@ -249,6 +249,10 @@ struct obs_source_frame {
 	/* used internally by libobs */
 	volatile long refs;
 	bool prev_frame;
+
+	/* allocated as a struct async_frame by libobs.  it sits in what used
+	 * to be padding, so the size of the structure is unchanged */
+	bool async_frame;
 };
 
 struct obs_source_frame2 {
@@ -396,6 +400,22 @@ EXPORT bool obs_get_video_info(struct obs_video_info *ovi);
 /** Gets the current audio settings, returns false if no audio */
 EXPORT bool obs_get_audio_info(struct obs_audio_info *oai);
 
+enum obs_inactive_tick_mode {
+	/** Tick every source every frame */
+	OBS_INACTIVE_TICK_ALWAYS,
+	/** Tick unused sources a few times a second with the combined time */
+	OBS_INACTIVE_TICK_COALESCE,
+	/** Don't tick unused sources at all */
+	OBS_INACTIVE_TICK_SKIP,
+};
+
+/**
+ * Sets how the video_tick of inputs and scenes that are neither showing nor
+ * active is called.  OBS_INACTIVE_TICK_ALWAYS by default.
+ */
+EXPORT void obs_set_inactive_tick_mode(enum obs_inactive_tick_mode mode);
+EXPORT enum obs_inactive_tick_mode obs_get_inactive_tick_mode(void);
+
 /**
  * Opens a plugin module directly from a specific path.
  *
@@ -969,6 +989,20 @@ EXPORT void obs_source_filter_set_order(obs_source_t *source,
 					obs_source_t *filter,
 					enum obs_order_movement movement);
 
+/** Time spent in the filter_audio callback of an audio filter */
+struct obs_audio_filter_stats {
+	uint64_t calls;
+	uint64_t total_ns;
+	uint64_t max_ns;
+	uint64_t last_ns;
+};
+
+/** Gets the filter_audio timings of a filter, returns false if not a filter */
+EXPORT bool
+obs_source_get_audio_filter_stats(obs_source_t *filter,
+				  struct obs_audio_filter_stats *stats);
+EXPORT void obs_source_reset_audio_filter_stats(obs_source_t *filter);
+
 /** Gets the settings string for a source */
 EXPORT obs_data_t *obs_source_get_settings(const obs_source_t *source);
 
@@ -1233,8 +1267,30 @@ EXPORT void obs_source_output_video(obs_source_t *source,
 EXPORT void obs_source_output_video2(obs_source_t *source,
 				     const struct obs_source_frame2 *frame);
 
+typedef void (*obs_source_frame_release_t)(void *param);
+
+/**
+ * Outputs asynchronous video data without copying it.  The frame data must
+ * remain valid until release is called, which can happen on any thread, and
+ * happens immediately if the frame is dropped.
+ */
+EXPORT void
+obs_source_output_shared_video(obs_source_t *source,
+			       const struct obs_source_frame *frame,
+			       obs_source_frame_release_t release, void *param);
+EXPORT void obs_source_output_shared_video2(
+	obs_source_t *source, const struct obs_source_frame2 *frame,
+	obs_source_frame_release_t release, void *param);
+
 EXPORT void obs_source_set_async_rotation(obs_source_t *source, long rotation);
 
+/** Returns the number of async video frames waiting to be displayed */
+EXPORT uint32_t obs_source_get_async_queue_depth(const obs_source_t *source);
+
+/** Returns the number of async video frames dropped due to a full queue */
+EXPORT uint32_t
+obs_source_get_async_frames_dropped(const obs_source_t *source);
+
 EXPORT void obs_source_output_cea708(obs_source_t *source,
 				     const struct obs_source_cea_708 *captions);
 
@@ -1269,6 +1325,17 @@ EXPORT void obs_source_set_video_frame2(obs_source_t *source,
 EXPORT void obs_source_output_audio(obs_source_t *source,
 				    const struct obs_source_audio *audio);
 
+/**
+ * Moves resampling and audio filtering of the audio output by the source to
+ * a thread of its own, so that obs_source_output_audio only copies the audio.
+ */
+EXPORT void obs_source_set_audio_dsp_thread(obs_source_t *source,
+					    bool enable);
+EXPORT bool obs_source_audio_dsp_thread_enabled(const obs_source_t *source);
+
+/** Returns the number of audio blocks dropped due to a full DSP queue */
+EXPORT uint32_t obs_source_get_audio_dsp_dropped(const obs_source_t *source);
+
 /** Signal an update to any currently used properties via 'update_properties' */
 EXPORT void obs_source_update_properties(obs_source_t *source);
 
@@ -1895,6 +1962,51 @@ EXPORT uint64_t obs_output_get_total_bytes(const obs_output_t *output);
 EXPORT int obs_output_get_frames_dropped(const obs_output_t *output);
 EXPORT int obs_output_get_total_frames(const obs_output_t *output);
 
+/**
+ * Video frame latency of an output, in nanoseconds.  p50/p99 of each stage
+ * are measured from the previous stage the frame went through, total_p50/p99
+ * from the first stage to the last one.
+ */
+struct obs_output_frame_latency {
+	uint64_t frames;
+	uint64_t p50[VIDEO_LATENCY_STAGES];
+	uint64_t p99[VIDEO_LATENCY_STAGES];
+	uint64_t total_p50;
+	uint64_t total_p99;
+};
+
+/** Gets the frame latency since the output started, false if none yet */
+EXPORT bool
+obs_output_get_frame_latency(obs_output_t *output,
+			     struct obs_output_frame_latency *latency);
+EXPORT void obs_output_reset_frame_latency(obs_output_t *output);
+
+/**
+ * Calls encoded_packet on a thread of the output's own, through a queue of up
+ * to max_packets packets, so that a slow output doesn't stall the encoders.
+ * Encoders only wait when the queue is full.  0 (the default) calls
+ * encoded_packet directly from the encoder threads.  Takes effect the next
+ * time the output starts capturing data.
+ */
+EXPORT void obs_output_set_delivery_queue_size(obs_output_t *output,
+					       size_t max_packets);
+EXPORT size_t obs_output_get_delivery_queue_size(const obs_output_t *output);
+
+struct obs_output_delivery_stats {
+	uint32_t queued;
+	uint32_t max_queued;
+	uint64_t delivered;
+	uint64_t wait_ns;
+};
+
+/**
+ * Gets the delivery queue stats of the current or last capture session, false
+ * if that session didn't use a delivery thread
+ */
+EXPORT bool
+obs_output_get_delivery_stats(const obs_output_t *output,
+			      struct obs_output_delivery_stats *stats);
+
 /**
  * Sets the preferred scaled resolution for this output.  Set width and height
  * to 0 to disable scaling.
@@ -1986,6 +2098,13 @@ EXPORT void obs_output_end_data_capture(obs_output_t *output);
  */
 EXPORT void obs_output_signal_stop(obs_output_t *output, int code);
 
+/**
+ * Lets libobs know that a video packet was written out, for frame latency
+ * tracking.  Call from the thread that actually sends the data.
+ */
+EXPORT void obs_output_packet_sent(obs_output_t *output,
+				   const struct encoder_packet *packet);
+
 EXPORT uint64_t obs_output_get_pause_offset(obs_output_t *output);
 
 /* ------------------------------------------------------------------------- */
@@ -2158,6 +2277,23 @@ EXPORT void *obs_encoder_create_rerouted(obs_encoder_t *encoder,
 /** Returns whether encoder is paused */
 EXPORT bool obs_encoder_paused(const obs_encoder_t *output);
 
+/**
+ * Raw video encoders are fed through a small queue of their own.  When an
+ * encoder falls behind and its queue fills up, the newest frame is repeated
+ * instead of holding up the video thread.
+ */
+struct obs_encoder_queue_stats {
+	uint32_t queued;     /* frames currently waiting to be encoded */
+	uint32_t encoded;    /* frames taken off the queue since starting */
+	uint32_t repeated;   /* frames repeated because the queue was full */
+	uint64_t lag_ns;     /* time the last frame spent in the queue */
+	uint64_t max_lag_ns; /* longest time any frame spent in the queue */
+};
+
+/** Gets the queue stats of a raw video encoder, false if it has no queue */
+EXPORT bool obs_encoder_get_queue_stats(const obs_encoder_t *encoder,
+					struct obs_encoder_queue_stats *stats);
+
 EXPORT const char *obs_encoder_get_last_error(obs_encoder_t *encoder);
 EXPORT void obs_encoder_set_last_error(obs_encoder_t *encoder,
 				       const char *message);
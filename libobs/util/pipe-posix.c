@@ -14,15 +14,28 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
 #include <stdio.h>
+#include <unistd.h>
 #include <sys/wait.h>
 
 #include "bmem.h"
 #include "pipe.h"
 
+extern char **environ;
+
 struct os_process_pipe {
 	bool read_pipe;
 	FILE *file;
+
+	/* set if started by os_process_pipe_create_fds rather than popen */
+	pid_t pid;
 };
 
 os_process_pipe_t *os_process_pipe_create(const char *cmd_line,
@@ -47,12 +60,118 @@ os_process_pipe_t *os_process_pipe_create(const char *cmd_line,
 	return out;
 }
 
+/* close-on-exec from the start, like the pipe popen creates, so that no
+ * other child process started in the meantime holds on to it */
+static int pipe_cloexec(int fds[2])
+{
+#ifdef __linux__
+	return pipe2(fds, O_CLOEXEC);
+#else
+	if (pipe(fds) != 0)
+		return -1;
+
+	fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+	fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+	return 0;
+#endif
+}
+
+os_process_pipe_t *os_process_pipe_create_fds(const char *cmd_line,
+					      const char *type, const int *fds,
+					      size_t num_fds)
+{
+	struct os_process_pipe pipe = {0};
+	struct os_process_pipe *out;
+	posix_spawn_file_actions_t actions;
+	char *argv[] = {"sh", "-c", (char *)cmd_line, NULL};
+	int pipe_fds[2];
+	int child_fd, parent_fd, free_fd;
+	int ret;
+
+	if (!cmd_line || !type) {
+		return NULL;
+	}
+	if (!num_fds) {
+		return os_process_pipe_create(cmd_line, type);
+	}
+
+	pipe.read_pipe = *type == 'r';
+
+	if (pipe_cloexec(pipe_fds) != 0) {
+		return NULL;
+	}
+
+	child_fd = pipe.read_pipe ? pipe_fds[1] : pipe_fds[0];
+	parent_fd = pipe.read_pipe ? pipe_fds[0] : pipe_fds[1];
+
+	/* the first descriptor number above all of the ones in use here */
+	free_fd = (pipe_fds[0] > pipe_fds[1] ? pipe_fds[0] : pipe_fds[1]) + 1;
+	for (size_t i = 0; i < num_fds; i++) {
+		if (fds[i] >= free_fd)
+			free_fd = fds[i] + 1;
+	}
+
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, child_fd,
+					 pipe.read_pipe ? STDOUT_FILENO
+							: STDIN_FILENO);
+
+	/* dup2 clears close-on-exec on the new descriptor, so dup each one to
+	 * a free number and back to get an inheritable copy under its own
+	 * number */
+	for (size_t i = 0; i < num_fds; i++) {
+		posix_spawn_file_actions_adddup2(&actions, fds[i], free_fd);
+		posix_spawn_file_actions_adddup2(&actions, free_fd, fds[i]);
+		posix_spawn_file_actions_addclose(&actions, free_fd);
+	}
+
+	ret = posix_spawn(&pipe.pid, "/bin/sh", &actions, NULL, argv, environ);
+	posix_spawn_file_actions_destroy(&actions);
+	close(child_fd);
+
+	if (ret != 0) {
+		close(parent_fd);
+		return NULL;
+	}
+
+	pipe.file = fdopen(parent_fd, type);
+	if (!pipe.file) {
+		close(parent_fd);
+		waitpid(pipe.pid, NULL, 0);
+		return NULL;
+	}
+
+	out = bmalloc(sizeof(pipe));
+	*out = pipe;
+	return out;
+}
+
+static int wait_process(pid_t pid)
+{
+	int status;
+
+	while (waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR)
+			return -1;
+	}
+
+	return status;
+}
+
 int os_process_pipe_destroy(os_process_pipe_t *pp)
 {
 	int ret = 0;
 
 	if (pp) {
-		int status = pclose(pp->file);
+		int status;
+
+		if (pp->pid) {
+			fclose(pp->file);
+			status = wait_process(pp->pid);
+		} else {
+			status = pclose(pp->file);
+		}
+
 		if (WIFEXITED(status))
 			ret = (int)(char)WEXITSTATUS(status);
 		bfree(pp);
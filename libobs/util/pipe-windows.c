@@ -140,6 +140,15 @@ error:
 	return NULL;
 }
 
+os_process_pipe_t *os_process_pipe_create_fds(const char *cmd_line,
+					      const char *type, const int *fds,
+					      size_t num_fds)
+{
+	/* there are no file descriptors to pass on here */
+	UNUSED_PARAMETER(fds);
+	return num_fds ? NULL : os_process_pipe_create(cmd_line, type);
+}
+
 int os_process_pipe_destroy(os_process_pipe_t *pp)
 {
 	int ret = 0;
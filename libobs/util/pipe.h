@@ -25,6 +25,15 @@ EXPORT os_process_pipe_t *os_process_pipe_create(const char *cmd_line,
 						 const char *type);
 EXPORT int os_process_pipe_destroy(os_process_pipe_t *pp);
 
+/* Like os_process_pipe_create, but the child process also inherits the given
+ * file descriptors, under the same numbers.  They should be close-on-exec,
+ * so that other child processes don't inherit them as well.  Not supported
+ * on Windows. */
+EXPORT os_process_pipe_t *os_process_pipe_create_fds(const char *cmd_line,
+						     const char *type,
+						     const int *fds,
+						     size_t num_fds);
+
 EXPORT size_t os_process_pipe_read(os_process_pipe_t *pp, uint8_t *data,
 				   size_t len);
 EXPORT size_t os_process_pipe_read_err(os_process_pipe_t *pp, uint8_t *data,
@@ -1,11 +1,13 @@
 #include <inttypes.h>
 #include "profiler.h"
 
+#include "circlebuf.h"
 #include "darray.h"
 #include "dstr.h"
 #include "platform.h"
 #include "threading.h"
 
+#include <errno.h>
 #include <math.h>
 
 #include <zlib.h>
@@ -14,6 +16,7 @@
 
 struct profiler_snapshot {
 	DARRAY(profiler_snapshot_entry_t) roots;
+	profiler_counters_t counters;
 };
 
 struct profiler_snapshot_entry {
@@ -257,6 +260,7 @@ static void merge_call(profile_entry *entry, profile_call *call,
 }
 
 static bool enabled = false;
+static bool buffered = false;
 static pthread_mutex_t root_mutex = PTHREAD_MUTEX_INITIALIZER;
 static DARRAY(profile_root_entry) root_entries;
 
@@ -270,8 +274,12 @@ void profiler_start(void)
 	pthread_mutex_unlock(&root_mutex);
 }
 
+static void stop_aggregator(void);
+
 void profiler_stop(void)
 {
+	stop_aggregator();
+
 	pthread_mutex_lock(&root_mutex);
 	enabled = false;
 	pthread_mutex_unlock(&root_mutex);
@@ -365,17 +373,14 @@ static void merge_context(profile_call *context)
 	free_call_context(prev_call);
 }
 
-void profile_start(const char *name)
+static void call_start(profile_call **context, const char *name, uint64_t time)
 {
-	if (!thread_enabled)
-		return;
-
 	profile_call new_call = {
 		.name = name,
 #ifdef TRACK_OVERHEAD
 		.overhead_start = os_gettime_ns(),
 #endif
-		.parent = thread_context,
+		.parent = *context,
 	};
 
 	profile_call *call = NULL;
@@ -388,20 +393,18 @@ void profile_start(const char *name)
 		memcpy(call, &new_call, sizeof(profile_call));
 	}
 
-	thread_context = call;
-	call->start_time = os_gettime_ns();
+	*context = call;
+	call->start_time = time ? time : os_gettime_ns();
 }
 
-void profile_end(const char *name)
+/* returns the root call once it has ended */
+static profile_call *call_end(profile_call **context, const char *name,
+			      uint64_t end)
 {
-	uint64_t end = os_gettime_ns();
-	if (!thread_enabled)
-		return;
-
-	profile_call *call = thread_context;
+	profile_call *call = *context;
 	if (!call) {
 		blog(LOG_ERROR, "Called profile end with no active profile");
-		return;
+		return NULL;
 	}
 
 	if (!call->name)
@@ -418,27 +421,567 @@ void profile_end(const char *name)
 			parent = parent->parent;
 
 		if (!parent || parent->name != name)
-			return;
+			return NULL;
 
 		while (call->name != name) {
-			profile_end(call->name);
+			call_end(context, call->name, end);
 			call = call->parent;
 		}
 	}
 
-	thread_context = call->parent;
+	*context = call->parent;
 
 	call->end_time = end;
 #ifdef TRACK_OVERHEAD
 	call->overhead_end = os_gettime_ns();
 #endif
 
-	if (call->parent)
+	return call->parent ? NULL : call;
+}
+
+static bool buffered_push(const char *name, uint64_t time, bool end);
+
+void profile_start(const char *name)
+{
+	if (!thread_enabled)
+		return;
+
+	if (buffered) {
+		if (!enabled)
+			thread_enabled = false;
+		else
+			buffered_push(name, os_gettime_ns(), false);
+		return;
+	}
+
+	call_start(&thread_context, name, 0);
+}
+
+void profile_end(const char *name)
+{
+	uint64_t end = os_gettime_ns();
+	if (!thread_enabled)
+		return;
+
+	if (buffered) {
+		buffered_push(name, end, true);
+		return;
+	}
+
+	profile_call *root = call_end(&thread_context, name, end);
+	if (root)
+		merge_context(root);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Buffered mode */
+
+/*
+ *   Each profiled thread gets a single-producer/single-consumer ring of
+ * start/end timestamps.  The aggregator thread periodically drains the rings,
+ * rebuilds the call trees and merges them with merge_context, so the hot path
+ * never takes a lock.  Completed calls are also kept in a bounded trace
+ * buffer for profiler_dump_trace_json.
+ *
+ *   If a ring is full, the thread drops everything until it is back at the
+ * top level, and then pushes a reset event (NULL name) so the aggregator can
+ * throw away the incomplete tree.
+ */
+
+#define DEFAULT_THREAD_EVENTS 16384
+#define DEFAULT_TRACE_EVENTS 131072
+#define AGGREGATE_INTERVAL_MS 50
+
+struct profile_event {
+	const char *name;
+	uint64_t time;
+	bool end;
+};
+
+typedef struct profile_thread profile_thread;
+struct profile_thread {
+	uint32_t id;
+	bool exited;
+
+	struct profile_event *events;
+	long capacity;
+	volatile long head; /* written by the profiled thread only */
+	volatile long tail; /* written by the aggregator only */
+
+	/* profiled thread only */
+	long depth;
+	bool dropping;
+
+	/* aggregator only */
+	profile_call *context;
+	bool named;
+};
+
+struct profile_trace_event {
+	const char *name;
+	uint32_t tid;
+	uint64_t start;
+	uint64_t duration;
+};
+
+struct profile_trace_thread {
+	uint32_t tid;
+	const char *name;
+};
+
+static size_t thread_events = DEFAULT_THREAD_EVENTS;
+static volatile long thread_generation = 0;
+static volatile long dropped_events = 0;
+static pthread_mutex_t threads_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(profile_thread *) threads;
+static uint32_t next_thread_id = 0;
+
+static pthread_once_t thread_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t thread_key;
+
+static THREAD_LOCAL profile_thread *thread_buffer = NULL;
+static THREAD_LOCAL long thread_buffer_generation = 0;
+
+static bool aggregator_active = false;
+static pthread_t aggregator_thread;
+static os_event_t *aggregator_event = NULL;
+
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct circlebuf trace_events;
+static size_t trace_max_events = DEFAULT_TRACE_EVENTS;
+static DARRAY(struct profile_trace_thread) trace_threads;
+
+/* the key only holds the thread id, the buffer itself may already be gone */
+static void thread_exited(void *data)
+{
+	uint32_t id = (uint32_t)(uintptr_t)data;
+
+	pthread_mutex_lock(&threads_mutex);
+	for (size_t i = 0; i < threads.num; i++) {
+		if (threads.array[i]->id == id) {
+			threads.array[i]->exited = true;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&threads_mutex);
+}
+
+static void create_thread_key(void)
+{
+	pthread_key_create(&thread_key, thread_exited);
+}
+
+static profile_thread *get_thread_buffer(void)
+{
+	long generation = os_atomic_load_long(&thread_generation);
+	if (thread_buffer && thread_buffer_generation == generation)
+		return thread_buffer;
+
+	profile_thread *t = bzalloc(sizeof(profile_thread));
+	t->capacity = (long)thread_events;
+	t->events = bmalloc(sizeof(struct profile_event) * thread_events);
+
+	pthread_once(&thread_key_once, create_thread_key);
+
+	pthread_mutex_lock(&threads_mutex);
+	t->id = ++next_thread_id;
+	da_push_back(threads, &t);
+	pthread_mutex_unlock(&threads_mutex);
+
+	pthread_setspecific(thread_key, (void *)(uintptr_t)t->id);
+
+	thread_buffer = t;
+	thread_buffer_generation = generation;
+	return t;
+}
+
+static inline long next_event_pos(const profile_thread *t, long pos)
+{
+	return (pos + 1 == t->capacity * 2) ? 0 : pos + 1;
+}
+
+static bool push_event(profile_thread *t, const char *name, uint64_t time,
+		       bool end)
+{
+	long head = t->head;
+	long size = head - os_atomic_load_long(&t->tail);
+
+	if (size < 0)
+		size += t->capacity * 2;
+	if (size == t->capacity)
+		return false;
+
+	struct profile_event *event = &t->events[head % t->capacity];
+	event->name = name;
+	event->time = time;
+	event->end = end;
+
+	os_atomic_store_long(&t->head, next_event_pos(t, head));
+	return true;
+}
+
+static bool buffered_push(const char *name, uint64_t time, bool end)
+{
+	profile_thread *t = get_thread_buffer();
+
+	if (end) {
+		if (t->depth)
+			t->depth--;
+	} else {
+		if (t->dropping) {
+			if (t->depth || !push_event(t, NULL, time, false)) {
+				t->depth++;
+				os_atomic_inc_long(&dropped_events);
+				return false;
+			}
+
+			t->dropping = false;
+		}
+
+		t->depth++;
+	}
+
+	if (!t->dropping && push_event(t, name, time, end))
+		return true;
+
+	t->dropping = true;
+	os_atomic_inc_long(&dropped_events);
+	return false;
+}
+
+static void add_trace_events(profile_thread *t, profile_call *call)
+{
+	struct profile_trace_event event = {
+		.name = call->name,
+		.tid = t->id,
+		.start = call->start_time,
+		.duration = call->end_time - call->start_time,
+	};
+
+	circlebuf_push_back(&trace_events, &event, sizeof(event));
+	if (trace_events.size > trace_max_events * sizeof(event))
+		circlebuf_pop_front(&trace_events, NULL, sizeof(event));
+
+	for (size_t i = 0; i < call->children.num; i++)
+		add_trace_events(t, &call->children.array[i]);
+}
+
+static void finish_root_call(profile_thread *t, profile_call *root)
+{
+	pthread_mutex_lock(&trace_mutex);
+	if (!t->named) {
+		struct profile_trace_thread *info =
+			da_push_back_new(trace_threads);
+		info->tid = t->id;
+		info->name = root->name;
+		t->named = true;
+	}
+
+	add_trace_events(t, root);
+	pthread_mutex_unlock(&trace_mutex);
+
+	merge_context(root);
+}
+
+static void free_thread_context(profile_thread *t)
+{
+	profile_call *root = t->context;
+	if (!root)
+		return;
+
+	while (root->parent)
+		root = root->parent;
+
+	free_call_context(root);
+	t->context = NULL;
+}
+
+static void drain_thread(profile_thread *t)
+{
+	long head = os_atomic_load_long(&t->head);
+	long tail = t->tail;
+
+	for (; tail != head; tail = next_event_pos(t, tail)) {
+		struct profile_event *event = &t->events[tail % t->capacity];
+
+		if (!event->name) {
+			free_thread_context(t);
+
+		} else if (!event->end) {
+			call_start(&t->context, event->name, event->time);
+
+		} else {
+			profile_call *root = call_end(&t->context, event->name,
+						      event->time);
+			if (root)
+				finish_root_call(t, root);
+		}
+	}
+
+	os_atomic_store_long(&t->tail, tail);
+}
+
+static void free_thread(profile_thread *t)
+{
+	free_thread_context(t);
+	bfree(t->events);
+	bfree(t);
+}
+
+static void drain_threads(void)
+{
+	pthread_mutex_lock(&threads_mutex);
+	for (size_t i = 0; i < threads.num;) {
+		profile_thread *t = threads.array[i];
+
+		drain_thread(t);
+
+		if (t->exited) {
+			free_thread(t);
+			da_erase(threads, i);
+		} else {
+			i++;
+		}
+	}
+	pthread_mutex_unlock(&threads_mutex);
+}
+
+static void *aggregator_thread_func(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	os_set_thread_name("profiler: aggregator");
+
+	while (os_event_timedwait(aggregator_event, AGGREGATE_INTERVAL_MS) ==
+	       ETIMEDOUT)
+		drain_threads();
+
+	drain_threads();
+	return NULL;
+}
+
+void profiler_start_buffered(size_t events_per_thread, size_t max_trace_events)
+{
+	pthread_mutex_lock(&root_mutex);
+	enabled = true;
+
+	if (aggregator_active)
+		goto unlock;
+
+	thread_events = events_per_thread ? events_per_thread
+					  : DEFAULT_THREAD_EVENTS;
+
+	pthread_mutex_lock(&trace_mutex);
+	trace_max_events = max_trace_events ? max_trace_events
+					    : DEFAULT_TRACE_EVENTS;
+	pthread_mutex_unlock(&trace_mutex);
+
+	if (os_event_init(&aggregator_event, OS_EVENT_TYPE_MANUAL) != 0)
+		goto fail;
+	if (pthread_create(&aggregator_thread, NULL, aggregator_thread_func,
+			   NULL) != 0) {
+		os_event_destroy(aggregator_event);
+		aggregator_event = NULL;
+		goto fail;
+	}
+
+	aggregator_active = true;
+	buffered = true;
+	goto unlock;
+
+fail:
+	blog(LOG_WARNING, "Failed to start the profiler aggregator thread, "
+			  "falling back to unbuffered profiling");
+unlock:
+	pthread_mutex_unlock(&root_mutex);
+}
+
+static void stop_aggregator(void)
+{
+	bool active;
+
+	pthread_mutex_lock(&root_mutex);
+	active = aggregator_active;
+	aggregator_active = false;
+	pthread_mutex_unlock(&root_mutex);
+
+	if (!active)
 		return;
 
-	merge_context(call);
+	os_event_signal(aggregator_event);
+	pthread_join(aggregator_thread, NULL);
+	os_event_destroy(aggregator_event);
+	aggregator_event = NULL;
+
+	long dropped = os_atomic_set_long(&dropped_events, 0);
+	if (dropped)
+		blog(LOG_WARNING,
+		     "Profiler dropped %ld events, consider a larger "
+		     "per-thread buffer",
+		     dropped);
+}
+
+static void free_buffered_data(void)
+{
+	DARRAY(profile_thread *) old_threads = {0};
+
+	pthread_mutex_lock(&root_mutex);
+	buffered = false;
+	pthread_mutex_unlock(&root_mutex);
+
+	pthread_mutex_lock(&threads_mutex);
+	os_atomic_inc_long(&thread_generation);
+	da_move(old_threads, threads);
+	pthread_mutex_unlock(&threads_mutex);
+
+	for (size_t i = 0; i < old_threads.num; i++)
+		free_thread(old_threads.array[i]);
+	da_free(old_threads);
+
+	pthread_mutex_lock(&trace_mutex);
+	circlebuf_free(&trace_events);
+	da_free(trace_threads);
+	pthread_mutex_unlock(&trace_mutex);
+}
+
+static void trace_cat_escaped(struct dstr *buffer, const char *str)
+{
+	for (; *str; str++) {
+		unsigned char ch = (unsigned char)*str;
+
+		if (ch == '"' || ch == '\\') {
+			dstr_cat_ch(buffer, '\\');
+			dstr_cat_ch(buffer, (char)ch);
+		} else if (ch < 0x20) {
+			dstr_catf(buffer, "\\u%04x", ch);
+		} else {
+			dstr_cat_ch(buffer, (char)ch);
+		}
+	}
+}
+
+static inline void trace_cat_usec(struct dstr *buffer, uint64_t ns)
+{
+	dstr_catf(buffer, "%" PRIu64 ".%03d", ns / 1000, (int)(ns % 1000));
 }
 
+bool profiler_dump_trace_json(const char *filename)
+{
+	DARRAY(struct profile_trace_thread) names = {0};
+	struct profile_trace_event *events = NULL;
+	struct dstr buffer = {0};
+	size_t num = 0;
+	FILE *f;
+
+	pthread_mutex_lock(&trace_mutex);
+	if (trace_events.size) {
+		num = trace_events.size / sizeof(struct profile_trace_event);
+		events = bmalloc(trace_events.size);
+		circlebuf_peek_front(&trace_events, events, trace_events.size);
+	}
+	da_copy(names, trace_threads);
+	pthread_mutex_unlock(&trace_mutex);
+
+	f = os_fopen(filename, "wb+");
+	if (!f)
+		goto exit;
+
+	dstr_copy(&buffer, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	fwrite(buffer.array, 1, buffer.len, f);
+
+	for (size_t i = 0; i < names.num; i++) {
+		dstr_printf(&buffer,
+			    "%s\n{\"name\":\"thread_name\",\"ph\":\"M\","
+			    "\"pid\":1,\"tid\":%" PRIu32
+			    ",\"args\":{\"name\":\"",
+			    i ? "," : "", names.array[i].tid);
+		trace_cat_escaped(&buffer, names.array[i].name);
+		dstr_cat(&buffer, "\"}}");
+		fwrite(buffer.array, 1, buffer.len, f);
+	}
+
+	for (size_t i = 0; i < num; i++) {
+		struct profile_trace_event *event = &events[i];
+
+		dstr_printf(&buffer, "%s\n{\"name\":\"",
+			    (i || names.num) ? "," : "");
+		trace_cat_escaped(&buffer, event->name);
+		dstr_catf(&buffer,
+			  "\",\"ph\":\"X\",\"pid\":1,\"tid\":%" PRIu32
+			  ",\"ts\":",
+			  event->tid);
+		trace_cat_usec(&buffer, event->start);
+		dstr_cat(&buffer, ",\"dur\":");
+		trace_cat_usec(&buffer, event->duration);
+		dstr_cat(&buffer, "}");
+		fwrite(buffer.array, 1, buffer.len, f);
+	}
+
+	fwrite("\n]}\n", 1, 4, f);
+	fclose(f);
+
+exit:
+	dstr_free(&buffer);
+	da_free(names);
+	bfree(events);
+	return f != NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Counters */
+
+static pthread_mutex_t counter_mutex = PTHREAD_MUTEX_INITIALIZER;
+static profiler_counters_t counters;
+
+static profiler_counter_t *get_counter(const char *name)
+{
+	for (size_t i = 0; i < counters.num; i++) {
+		if (counters.array[i].name == name)
+			return &counters.array[i];
+	}
+
+	profiler_counter_t *counter = da_push_back_new(counters);
+	counter->name = name;
+	counter->min_value = INT64_MAX;
+	counter->max_value = INT64_MIN;
+	return counter;
+}
+
+static inline void update_counter(profiler_counter_t *counter, int64_t value,
+				  int64_t delta)
+{
+	counter->value = value;
+	counter->total += delta;
+	counter->count += 1;
+
+	if (value < counter->min_value)
+		counter->min_value = value;
+	if (value > counter->max_value)
+		counter->max_value = value;
+}
+
+void profile_counter_add(const char *name, int64_t delta)
+{
+	if (!thread_enabled || !enabled)
+		return;
+
+	pthread_mutex_lock(&counter_mutex);
+	profiler_counter_t *counter = get_counter(name);
+	update_counter(counter, counter->value + delta, delta);
+	pthread_mutex_unlock(&counter_mutex);
+}
+
+void profile_counter_set(const char *name, int64_t value)
+{
+	if (!thread_enabled || !enabled)
+		return;
+
+	pthread_mutex_lock(&counter_mutex);
+	update_counter(get_counter(name), value, value);
+	pthread_mutex_unlock(&counter_mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+
 static int profiler_time_entry_compare(const void *first, const void *second)
 {
 	int64_t diff = ((profiler_time_entry *)second)->time_delta -
@@ -747,10 +1290,39 @@ void profile_print_func(const char *intro, profile_entry_print_func print,
 	dstr_free(&indent_buffer);
 }
 
+static void profile_print_counters(profiler_snapshot_t *snap)
+{
+	if (!snap->counters.num)
+		return;
+
+	blog(LOG_INFO, "== Profiler Counters ============================");
+	for (size_t i = 0; i < snap->counters.num; i++) {
+		profiler_counter_t *counter = &snap->counters.array[i];
+		double avg = counter->count
+				     ? (double)counter->total / counter->count
+				     : 0.;
+
+		blog(LOG_INFO,
+		     "%s: value=%" PRId64 ", min=%" PRId64 ", max=%" PRId64
+		     ", avg=%g, updates=%" PRIu64,
+		     counter->name, counter->value, counter->min_value,
+		     counter->max_value, avg, counter->count);
+	}
+	blog(LOG_INFO, "=================================================");
+}
+
 void profiler_print(profiler_snapshot_t *snap)
 {
+	bool free_snapshot = !snap;
+	if (!snap)
+		snap = profile_snapshot_create();
+
 	profile_print_func("== Profiler Results =============================",
 			   profile_print_entry, snap);
+	profile_print_counters(snap);
+
+	if (free_snapshot)
+		profile_snapshot_free(snap);
 }
 
 void profiler_print_time_between_calls(profiler_snapshot_t *snap)
@@ -803,6 +1375,9 @@ void profiler_free(void)
 {
 	DARRAY(profile_root_entry) old_root_entries = {0};
 
+	stop_aggregator();
+	free_buffered_data();
+
 	pthread_mutex_lock(&root_mutex);
 	enabled = false;
 	da_move(old_root_entries, root_entries);
@@ -825,6 +1400,10 @@ void profiler_free(void)
 	}
 
 	da_free(old_root_entries);
+
+	pthread_mutex_lock(&counter_mutex);
+	da_free(counters);
+	pthread_mutex_unlock(&counter_mutex);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -936,6 +1515,10 @@ profiler_snapshot_t *profile_snapshot_create(void)
 	}
 	pthread_mutex_unlock(&root_mutex);
 
+	pthread_mutex_lock(&counter_mutex);
+	da_copy(snap->counters, counters);
+	pthread_mutex_unlock(&counter_mutex);
+
 	for (size_t i = 0; i < snap->roots.num; i++)
 		sort_snapshot_entry(&snap->roots.array[i]);
 
@@ -961,6 +1544,7 @@ void profile_snapshot_free(profiler_snapshot_t *snap)
 		free_snapshot_entry(&snap->roots.array[i]);
 
 	da_free(snap->roots);
+	da_free(snap->counters);
 	bfree(snap);
 }
 
@@ -1103,6 +1687,11 @@ void profiler_snapshot_filter_roots(profiler_snapshot_t *snap,
 	}
 }
 
+profiler_counters_t *profiler_snapshot_counters(profiler_snapshot_t *snap)
+{
+	return snap ? &snap->counters : NULL;
+}
+
 size_t profiler_snapshot_num_children(profiler_snapshot_entry_t *entry)
 {
 	return entry ? entry->children.num : 0;
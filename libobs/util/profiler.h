@@ -22,12 +22,31 @@ EXPORT void profile_end(const char *name);
 
 EXPORT void profile_reenable_thread(void);
 
+/* ------------------------------------------------------------------------- */
+/* Counters */
+
+EXPORT void profile_counter_add(const char *name, int64_t delta);
+EXPORT void profile_counter_set(const char *name, int64_t value);
+
 /* ------------------------------------------------------------------------- */
 /* Profiler control */
 
 EXPORT void profiler_start(void);
 EXPORT void profiler_stop(void);
 
+/**
+ * Starts the profiler in buffered mode: profile_start/profile_end only write
+ * a timestamp into a lock-free per-thread ring buffer, and a background thread
+ * merges the rings into the regular profiler data.  The most recent
+ * trace_events completed calls are also kept for profiler_dump_trace_json.
+ * Zero selects the default size for either buffer.
+ */
+EXPORT void profiler_start_buffered(size_t events_per_thread,
+				    size_t trace_events);
+
+/** Writes the buffered-mode trace as Chrome/Perfetto trace event JSON */
+EXPORT bool profiler_dump_trace_json(const char *filename);
+
 EXPORT void profiler_print(profiler_snapshot_t *snap);
 EXPORT void profiler_print_time_between_calls(profiler_snapshot_t *snap);
 
@@ -63,6 +82,18 @@ struct profiler_time_entry {
 
 typedef DARRAY(profiler_time_entry_t) profiler_time_entries_t;
 
+struct profiler_counter {
+	const char *name;
+	int64_t value;
+	int64_t min_value;
+	int64_t max_value;
+	int64_t total;
+	uint64_t count;
+};
+
+typedef struct profiler_counter profiler_counter_t;
+typedef DARRAY(profiler_counter_t) profiler_counters_t;
+
 typedef bool (*profiler_entry_enum_func)(void *context,
 					 profiler_snapshot_entry_t *entry);
 
@@ -85,6 +116,9 @@ EXPORT void profiler_snapshot_filter_roots(profiler_snapshot_t *snap,
 					   profiler_name_filter_func func,
 					   void *data);
 
+EXPORT profiler_counters_t *
+profiler_snapshot_counters(profiler_snapshot_t *snap);
+
 EXPORT size_t profiler_snapshot_num_children(profiler_snapshot_entry_t *entry);
 EXPORT void
 profiler_snapshot_enumerate_children(profiler_snapshot_entry_t *entry,
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "c99defs.h"
+#include <string.h>
+
+#include "bmem.h"
+#include "threading.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Bounded lock-free pointer queue, for exactly one producer thread and one
+ * consumer thread.  If more than one thread can push (or pop), those threads
+ * must be serialized by the caller.
+ *
+ * Positions run from 0 to (capacity * 2 - 1) so that a full queue can be
+ * told apart from an empty one without wasting a slot.
+ */
+
+struct spsc_queue {
+	void **items;
+	long capacity;
+
+	volatile long head; /* written by the producer only */
+	volatile long tail; /* written by the consumer only */
+};
+
+static inline void spsc_queue_init(struct spsc_queue *q, size_t capacity)
+{
+	memset(q, 0, sizeof(struct spsc_queue));
+	q->capacity = (long)capacity;
+	q->items = bzalloc(sizeof(void *) * capacity);
+}
+
+static inline void spsc_queue_free(struct spsc_queue *q)
+{
+	bfree(q->items);
+	memset(q, 0, sizeof(struct spsc_queue));
+}
+
+static inline long spsc_queue_next_pos(const struct spsc_queue *q, long pos)
+{
+	return (pos + 1 == q->capacity * 2) ? 0 : pos + 1;
+}
+
+static inline size_t spsc_queue_size(const struct spsc_queue *q)
+{
+	long head = os_atomic_load_long(&q->head);
+	long tail = os_atomic_load_long(&q->tail);
+	long size = head - tail;
+
+	return (size_t)(size < 0 ? size + q->capacity * 2 : size);
+}
+
+/** Producer only.  Returns false if the queue is full. */
+static inline bool spsc_queue_push(struct spsc_queue *q, void *item)
+{
+	long head = q->head;
+
+	if (spsc_queue_size(q) == (size_t)q->capacity)
+		return false;
+
+	q->items[head % q->capacity] = item;
+	os_atomic_store_long(&q->head, spsc_queue_next_pos(q, head));
+	return true;
+}
+
+/** Consumer only.  Returns NULL if the queue is empty. */
+static inline void *spsc_queue_pop(struct spsc_queue *q)
+{
+	long tail = q->tail;
+	void *item;
+
+	if (tail == os_atomic_load_long(&q->head))
+		return NULL;
+
+	item = q->items[tail % q->capacity];
+	os_atomic_store_long(&q->tail, spsc_queue_next_pos(q, tail));
+	return item;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "task-pool.h"
+#include "bmem.h"
+#include "base.h"
+#include "platform.h"
+#include "threading.h"
+
+/* a job lives on the stack of the thread that called task_pool_run, and is
+ * linked into the pool until every one of its tasks has been claimed */
+struct task_job {
+	task_pool_func_t func;
+	void *param;
+	uint32_t count;
+	uint32_t next;
+
+	volatile long remaining;
+	os_event_t *done;
+
+	struct task_job *next_job;
+	struct task_job **prev_next;
+};
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct task_job *pool_jobs = NULL;
+static os_sem_t *pool_sem = NULL;
+static pthread_t *pool_threads = NULL;
+static uint32_t pool_num_threads = 0;
+static bool pool_initialized = false;
+static bool pool_stop = false;
+
+static inline void job_link(struct task_job *job)
+{
+	job->prev_next = &pool_jobs;
+	job->next_job = pool_jobs;
+	if (pool_jobs)
+		pool_jobs->prev_next = &job->next_job;
+	pool_jobs = job;
+}
+
+static inline void job_unlink(struct task_job *job)
+{
+	*job->prev_next = job->next_job;
+	if (job->next_job)
+		job->next_job->prev_next = job->prev_next;
+	job->prev_next = NULL;
+	job->next_job = NULL;
+}
+
+/* must be called with pool_mutex held */
+static inline bool job_claim(struct task_job *job, uint32_t *idx)
+{
+	if (job->next == job->count)
+		return false;
+
+	*idx = job->next++;
+	if (job->next == job->count)
+		job_unlink(job);
+	return true;
+}
+
+static inline bool job_run(struct task_job *job, uint32_t idx)
+{
+	job->func(job->param, idx);
+	return os_atomic_dec_long(&job->remaining) == 0;
+}
+
+static void *pool_thread(void *unused)
+{
+	os_set_thread_name("libobs: task pool");
+
+	for (;;) {
+		struct task_job *job;
+		uint32_t idx = 0;
+
+		if (os_sem_wait(pool_sem) != 0)
+			break;
+
+		for (;;) {
+			pthread_mutex_lock(&pool_mutex);
+			if (pool_stop) {
+				pthread_mutex_unlock(&pool_mutex);
+				return NULL;
+			}
+
+			job = pool_jobs;
+			if (job)
+				job_claim(job, &idx);
+			pthread_mutex_unlock(&pool_mutex);
+
+			if (!job)
+				break;
+
+			/* the owner waits on 'done' once it has run out of
+			 * tasks to claim itself, so the job is still alive */
+			if (job_run(job, idx))
+				os_event_signal(job->done);
+		}
+	}
+
+	UNUSED_PARAMETER(unused);
+	return NULL;
+}
+
+static uint32_t pool_start(void)
+{
+	uint32_t num_threads;
+
+	pthread_mutex_lock(&pool_mutex);
+
+	if (!pool_initialized) {
+		int cores = os_get_logical_cores();
+
+		pool_initialized = true;
+		pool_num_threads = 0;
+
+		if (cores > 1 && os_sem_init(&pool_sem, 0) == 0) {
+			uint32_t count = (uint32_t)cores - 1;
+			if (count > TASK_POOL_MAX_THREADS)
+				count = TASK_POOL_MAX_THREADS;
+
+			pool_threads = bzalloc(sizeof(pthread_t) * count);
+			for (uint32_t i = 0; i < count; i++) {
+				if (pthread_create(&pool_threads[i], NULL,
+						   pool_thread, NULL) != 0)
+					break;
+				pool_num_threads++;
+			}
+
+			blog(LOG_DEBUG, "task pool: started %u threads",
+			     pool_num_threads);
+		}
+	}
+
+	num_threads = pool_num_threads;
+	pthread_mutex_unlock(&pool_mutex);
+	return num_threads;
+}
+
+void task_pool_run(uint32_t count, task_pool_func_t func, void *param)
+{
+	struct task_job job = {0};
+	bool finished = false;
+	uint32_t num_threads;
+	uint32_t idx;
+
+	if (!count || !func)
+		return;
+
+	num_threads = count > 1 ? pool_start() : 0;
+	if (!num_threads) {
+		for (idx = 0; idx < count; idx++)
+			func(param, idx);
+		return;
+	}
+
+	if (os_event_init(&job.done, OS_EVENT_TYPE_AUTO) != 0) {
+		for (idx = 0; idx < count; idx++)
+			func(param, idx);
+		return;
+	}
+
+	job.func = func;
+	job.param = param;
+	job.count = count;
+	job.remaining = (long)count;
+
+	pthread_mutex_lock(&pool_mutex);
+	job_link(&job);
+	pthread_mutex_unlock(&pool_mutex);
+
+	if (num_threads > count - 1)
+		num_threads = count - 1;
+	for (uint32_t i = 0; i < num_threads; i++)
+		os_sem_post(pool_sem);
+
+	for (;;) {
+		bool claimed;
+
+		pthread_mutex_lock(&pool_mutex);
+		claimed = job_claim(&job, &idx);
+		pthread_mutex_unlock(&pool_mutex);
+
+		if (!claimed)
+			break;
+		if (job_run(&job, idx))
+			finished = true;
+	}
+
+	/* whoever finishes the last task signals, so unless that was us a
+	 * pool thread may still be about to touch the event */
+	if (!finished)
+		os_event_wait(job.done);
+
+	os_event_destroy(job.done);
+}
+
+uint32_t task_pool_threads(void)
+{
+	return pool_start() + 1;
+}
+
+void task_pool_shutdown(void)
+{
+	uint32_t num_threads;
+
+	pthread_mutex_lock(&pool_mutex);
+	if (!pool_initialized) {
+		pthread_mutex_unlock(&pool_mutex);
+		return;
+	}
+
+	pool_stop = true;
+	num_threads = pool_num_threads;
+	pthread_mutex_unlock(&pool_mutex);
+
+	for (uint32_t i = 0; i < num_threads; i++)
+		os_sem_post(pool_sem);
+	for (uint32_t i = 0; i < num_threads; i++)
+		pthread_join(pool_threads[i], NULL);
+
+	pthread_mutex_lock(&pool_mutex);
+	os_sem_destroy(pool_sem);
+	bfree(pool_threads);
+	pool_sem = NULL;
+	pool_threads = NULL;
+	pool_num_threads = 0;
+	pool_initialized = false;
+	pool_stop = false;
+	pthread_mutex_unlock(&pool_mutex);
+}
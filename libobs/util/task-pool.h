@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+#include "c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Small process-wide pool of worker threads for splitting short CPU-bound
+ * jobs (rows of an image, planes of audio, ...) into independent tasks.
+ *
+ * The pool is created on first use with one thread less than the number of
+ * logical cores (capped at TASK_POOL_MAX_THREADS).  The calling thread always
+ * takes part in its own job, so task_pool_run is safe to call from several
+ * threads at once, and from inside a task.
+ */
+
+#define TASK_POOL_MAX_THREADS 8
+
+typedef void (*task_pool_func_t)(void *param, uint32_t idx);
+
+/**
+ * Calls func(param, idx) for every idx in [0, count) spread across the pool,
+ * and returns once all of them have completed.  Tasks may run in any order.
+ */
+EXPORT void task_pool_run(uint32_t count, task_pool_func_t func, void *param);
+
+/**
+ * Returns how many tasks can run at the same time (the pool threads plus the
+ * caller), which is the most a job is worth splitting into.
+ */
+EXPORT uint32_t task_pool_threads(void);
+
+/**
+ * Stops and joins the pool threads.  Must not be called while any job is
+ * still running; the pool is created again if used afterwards.
+ */
+EXPORT void task_pool_shutdown(void);
+
+#ifdef __cplusplus
+}
+#endif
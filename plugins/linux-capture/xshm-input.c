@@ -18,6 +18,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
+#include <xcb/damage.h>
 #include <xcb/randr.h>
 #include <xcb/shm.h>
 #include <xcb/xfixes.h>
@@ -25,6 +26,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <obs-module.h>
 #include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
 #include "xcursor-xcb.h"
 #include "xhelpers.h"
 
@@ -32,14 +35,36 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define blog(level, msg, ...) blog(level, "xshm-input: " msg, ##__VA_ARGS__)
 
+/* a range of rows of the capture, empty if top >= bottom */
+struct xshm_rows {
+	int_fast32_t top;
+	int_fast32_t bottom;
+};
+
 struct xshm_data {
 	obs_source_t *source;
 
 	xcb_connection_t *xcb;
 	xcb_screen_t *xcb_screen;
-	xcb_shm_t *xshm;
+	xcb_shm_t *xshm[2];
 	xcb_xcursor_t *cursor;
 
+	xcb_damage_damage_t damage;
+	xcb_xfixes_region_t damage_region;
+	uint8_t damage_event;
+
+	pthread_t capture_thread;
+	bool capture_thread_active;
+	volatile bool capture_stop;
+
+	/* protects everything below */
+	pthread_mutex_t mutex;
+	int ready_buffer;
+	int upload_buffer;
+	int last_buffer;
+	struct xshm_rows stale_rows[2];
+	xcb_xfixes_get_cursor_image_reply_t *cursor_reply;
+
 	char *server;
 	uint_fast32_t screen_id;
 	int_fast32_t x_org;
@@ -174,6 +199,299 @@ static int_fast32_t xshm_update_geometry(struct xshm_data *data)
 	return 1;
 }
 
+static inline bool xshm_rows_empty(const struct xshm_rows *rows)
+{
+	return rows->top >= rows->bottom;
+}
+
+static inline void xshm_rows_add(struct xshm_rows *rows,
+				 const struct xshm_rows *add)
+{
+	if (xshm_rows_empty(add))
+		return;
+
+	if (xshm_rows_empty(rows)) {
+		*rows = *add;
+	} else {
+		if (add->top < rows->top)
+			rows->top = add->top;
+		if (add->bottom > rows->bottom)
+			rows->bottom = add->bottom;
+	}
+}
+
+/**
+ * Set up damage tracking on the root window
+ *
+ * Without the damage extension every frame is captured in full.
+ */
+static void xshm_damage_init(struct xshm_data *data)
+{
+	const xcb_query_extension_reply_t *ext;
+	xcb_damage_query_version_cookie_t ver_c;
+	xcb_damage_query_version_reply_t *ver_r;
+
+	ext = xcb_get_extension_data(data->xcb, &xcb_damage_id);
+	if (!ext || !ext->present) {
+		blog(LOG_INFO, "Missing Damage extension, capturing every "
+			       "frame !");
+		return;
+	}
+
+	ver_c = xcb_damage_query_version(data->xcb, XCB_DAMAGE_MAJOR_VERSION,
+					 XCB_DAMAGE_MINOR_VERSION);
+	ver_r = xcb_damage_query_version_reply(data->xcb, ver_c, NULL);
+	if (!ver_r)
+		return;
+	free(ver_r);
+
+	data->damage_region = xcb_generate_id(data->xcb);
+	xcb_xfixes_create_region(data->xcb, data->damage_region, 0, NULL);
+
+	data->damage = xcb_generate_id(data->xcb);
+	xcb_damage_create(data->xcb, data->damage, data->xcb_screen->root,
+			  XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+	data->damage_event = ext->first_event + XCB_DAMAGE_NOTIFY;
+}
+
+static void xshm_damage_free(struct xshm_data *data)
+{
+	if (data->damage) {
+		xcb_damage_destroy(data->xcb, data->damage);
+		xcb_xfixes_destroy_region(data->xcb, data->damage_region);
+		data->damage = 0;
+		data->damage_region = 0;
+	}
+}
+
+/**
+ * Get the rows of the capture that changed since the last call
+ */
+static void xshm_fetch_damage(struct xshm_data *data, struct xshm_rows *rows)
+{
+	xcb_xfixes_fetch_region_cookie_t reg_c;
+	xcb_xfixes_fetch_region_reply_t *reg_r;
+	xcb_rectangle_t *rects;
+	int count;
+
+	xcb_damage_subtract(data->xcb, data->damage, XCB_NONE,
+			    data->damage_region);
+	reg_c = xcb_xfixes_fetch_region(data->xcb, data->damage_region);
+	reg_r = xcb_xfixes_fetch_region_reply(data->xcb, reg_c, NULL);
+
+	if (!reg_r) {
+		rows->top = 0;
+		rows->bottom = data->adj_height;
+		return;
+	}
+
+	rects = xcb_xfixes_fetch_region_rectangles(reg_r);
+	count = xcb_xfixes_fetch_region_rectangles_length(reg_r);
+
+	for (int i = 0; i < count; i++) {
+		int_fast32_t left = rects[i].x - data->adj_x_org;
+		int_fast32_t right = left + rects[i].width;
+		struct xshm_rows r;
+
+		if (right <= 0 || left >= data->adj_width)
+			continue;
+
+		r.top = rects[i].y - data->adj_y_org;
+		r.bottom = r.top + rects[i].height;
+		if (r.top < 0)
+			r.top = 0;
+		if (r.bottom > data->adj_height)
+			r.bottom = data->adj_height;
+
+		xshm_rows_add(rows, &r);
+	}
+
+	free(reg_r);
+}
+
+/**
+ * Read the given rows of the screen into a shm segment
+ *
+ * Whole rows land in the segment at the same place a full capture puts them,
+ * so the rest of the segment keeps the last image captured into it.
+ */
+static bool xshm_get_rows(struct xshm_data *data, xcb_shm_t *shm,
+			  const struct xshm_rows *rows)
+{
+	xcb_shm_get_image_cookie_t img_c;
+	xcb_shm_get_image_reply_t *img_r;
+	uint32_t offset = (uint32_t)(rows->top * data->adj_width * 4);
+
+	img_c = xcb_shm_get_image_unchecked(
+		data->xcb, data->xcb_screen->root, data->adj_x_org,
+		data->adj_y_org + rows->top, data->adj_width,
+		rows->bottom - rows->top, ~0, XCB_IMAGE_FORMAT_Z_PIXMAP,
+		shm->seg, offset);
+	img_r = xcb_shm_get_image_reply(data->xcb, img_c, NULL);
+
+	if (!img_r)
+		return false;
+
+	free(img_r);
+	return true;
+}
+
+/**
+ * Capture changed rows into the segment the graphics thread isn't reading
+ *
+ * Each segment remembers the rows that changed since it was last written, so
+ * that writing one only has to catch up on those.
+ */
+static void xshm_capture_frame(struct xshm_data *data,
+			       const struct xshm_rows *damage)
+{
+	struct xshm_rows rows;
+	int target;
+
+	pthread_mutex_lock(&data->mutex);
+
+	target = data->last_buffer;
+	if (target == data->upload_buffer)
+		target ^= 1;
+	if (target == data->ready_buffer)
+		data->ready_buffer = -1;
+
+	xshm_rows_add(&data->stale_rows[0], damage);
+	xshm_rows_add(&data->stale_rows[1], damage);
+	rows = data->stale_rows[target];
+	data->stale_rows[target].top = 0;
+	data->stale_rows[target].bottom = 0;
+
+	pthread_mutex_unlock(&data->mutex);
+
+	if (xshm_rows_empty(&rows))
+		return;
+
+	if (!xshm_get_rows(data, data->xshm[target], &rows)) {
+		pthread_mutex_lock(&data->mutex);
+		xshm_rows_add(&data->stale_rows[target], &rows);
+		pthread_mutex_unlock(&data->mutex);
+		return;
+	}
+
+	pthread_mutex_lock(&data->mutex);
+	data->ready_buffer = target;
+	data->last_buffer = target;
+	pthread_mutex_unlock(&data->mutex);
+}
+
+static void xshm_capture_cursor(struct xshm_data *data)
+{
+	xcb_xfixes_get_cursor_image_cookie_t cur_c;
+	xcb_xfixes_get_cursor_image_reply_t *cur_r;
+
+	cur_c = xcb_xfixes_get_cursor_image_unchecked(data->xcb);
+	cur_r = xcb_xfixes_get_cursor_image_reply(data->xcb, cur_c, NULL);
+	if (!cur_r)
+		return;
+
+	pthread_mutex_lock(&data->mutex);
+	free(data->cursor_reply);
+	data->cursor_reply = cur_r;
+	pthread_mutex_unlock(&data->mutex);
+}
+
+/**
+ * Capture thread
+ *
+ * Does all the round trips to the X server once per frame, so the graphics
+ * thread only has to upload finished images.  With damage tracking, only the
+ * rows that changed are read back, and nothing at all on a static screen.
+ */
+static void *xshm_capture_thread(void *vptr)
+{
+	XSHM_DATA(vptr);
+	uint64_t interval = video_output_get_frame_time(obs_get_video());
+	uint64_t next = os_gettime_ns();
+	bool damaged = true;
+	bool full = true;
+
+	os_set_thread_name("xshm-input: capture thread");
+
+	while (!os_atomic_load_bool(&data->capture_stop)) {
+		struct xshm_rows rows = {0, 0};
+		xcb_generic_event_t *event;
+
+		while ((event = xcb_poll_for_event(data->xcb)) != NULL) {
+			if (data->damage && (event->response_type & ~0x80) ==
+						    data->damage_event)
+				damaged = true;
+			free(event);
+		}
+
+		if (xcb_connection_has_error(data->xcb)) {
+			blog(LOG_ERROR, "X connection lost, capture stopped");
+			break;
+		}
+
+		/* damage keeps piling up on the server while hidden, and is
+		 * all picked up at once when the source is shown again */
+		if (obs_source_showing(data->source)) {
+			if (data->show_cursor)
+				xshm_capture_cursor(data);
+
+			if (!data->damage || full) {
+				rows.bottom = data->adj_height;
+				full = false;
+			}
+			if (data->damage && damaged) {
+				xshm_fetch_damage(data, &rows);
+				damaged = false;
+			}
+
+			if (!xshm_rows_empty(&rows))
+				xshm_capture_frame(data, &rows);
+		}
+
+		next += interval;
+		if (!os_sleepto_ns(next))
+			next = os_gettime_ns();
+	}
+
+	return NULL;
+}
+
+static bool xshm_start_capture_thread(struct xshm_data *data)
+{
+	pthread_mutex_lock(&data->mutex);
+	data->ready_buffer = -1;
+	data->upload_buffer = -1;
+	data->last_buffer = 0;
+	for (size_t i = 0; i < 2; i++) {
+		data->stale_rows[i].top = 0;
+		data->stale_rows[i].bottom = data->adj_height;
+	}
+	pthread_mutex_unlock(&data->mutex);
+
+	os_atomic_set_bool(&data->capture_stop, false);
+	if (pthread_create(&data->capture_thread, NULL, xshm_capture_thread,
+			   data) != 0)
+		return false;
+
+	data->capture_thread_active = true;
+	return true;
+}
+
+static void xshm_stop_capture_thread(struct xshm_data *data)
+{
+	if (data->capture_thread_active) {
+		os_atomic_set_bool(&data->capture_stop, true);
+		pthread_join(data->capture_thread, NULL);
+		data->capture_thread_active = false;
+	}
+
+	pthread_mutex_lock(&data->mutex);
+	free(data->cursor_reply);
+	data->cursor_reply = NULL;
+	data->ready_buffer = -1;
+	pthread_mutex_unlock(&data->mutex);
+}
+
 /**
  * Returns the name of the plugin
  */
@@ -188,6 +506,8 @@ static const char *xshm_getname(void *unused)
  */
 static void xshm_capture_stop(struct xshm_data *data)
 {
+	xshm_stop_capture_thread(data);
+
 	obs_enter_graphics();
 
 	if (data->texture) {
@@ -201,12 +521,15 @@ static void xshm_capture_stop(struct xshm_data *data)
 
 	obs_leave_graphics();
 
-	if (data->xshm) {
-		xshm_xcb_detach(data->xshm);
-		data->xshm = NULL;
+	for (size_t i = 0; i < 2; i++) {
+		if (data->xshm[i]) {
+			xshm_xcb_detach(data->xshm[i]);
+			data->xshm[i] = NULL;
+		}
 	}
 
 	if (data->xcb) {
+		xshm_damage_free(data);
 		xcb_disconnect(data->xcb);
 		data->xcb = NULL;
 	}
@@ -242,22 +565,31 @@ static void xshm_capture_start(struct xshm_data *data)
 		goto fail;
 	}
 
-	data->xshm =
-		xshm_xcb_attach(data->xcb, data->adj_width, data->adj_height);
-	if (!data->xshm) {
-		blog(LOG_ERROR, "failed to attach shm !");
-		goto fail;
+	for (size_t i = 0; i < 2; i++) {
+		data->xshm[i] = xshm_xcb_attach(data->xcb, data->adj_width,
+						data->adj_height);
+		if (!data->xshm[i]) {
+			blog(LOG_ERROR, "failed to attach shm !");
+			goto fail;
+		}
 	}
 
 	data->cursor = xcb_xcursor_init(data->xcb);
 	xcb_xcursor_offset(data->cursor, data->adj_x_org, data->adj_y_org);
 
+	xshm_damage_init(data);
+
 	obs_enter_graphics();
 
 	xshm_resize_texture(data);
 
 	obs_leave_graphics();
 
+	if (!xshm_start_capture_thread(data)) {
+		blog(LOG_ERROR, "failed to start capture thread !");
+		goto fail;
+	}
+
 	return;
 fail:
 	xshm_capture_stop(data);
@@ -451,6 +783,7 @@ static void xshm_destroy(void *vptr)
 
 	xshm_capture_stop(data);
 
+	pthread_mutex_destroy(&data->mutex);
 	bfree(data);
 }
 
@@ -462,6 +795,12 @@ static void *xshm_create(obs_data_t *settings, obs_source_t *source)
 	struct xshm_data *data = bzalloc(sizeof(struct xshm_data));
 	data->source = source;
 
+	pthread_mutex_init_value(&data->mutex);
+	if (pthread_mutex_init(&data->mutex, NULL) != 0) {
+		bfree(data);
+		return NULL;
+	}
+
 	xshm_update(data, settings);
 
 	return data;
@@ -475,39 +814,44 @@ static void xshm_video_tick(void *vptr, float seconds)
 	UNUSED_PARAMETER(seconds);
 	XSHM_DATA(vptr);
 
+	xcb_xfixes_get_cursor_image_reply_t *cur_r;
+	int idx;
+
 	if (!data->texture)
 		return;
 	if (!obs_source_showing(data->source))
 		return;
 
-	xcb_shm_get_image_cookie_t img_c;
-	xcb_shm_get_image_reply_t *img_r;
-	xcb_xfixes_get_cursor_image_cookie_t cur_c;
-	xcb_xfixes_get_cursor_image_reply_t *cur_r;
-
-	img_c = xcb_shm_get_image_unchecked(data->xcb, data->xcb_screen->root,
-					    data->adj_x_org, data->adj_y_org,
-					    data->adj_width, data->adj_height,
-					    ~0, XCB_IMAGE_FORMAT_Z_PIXMAP,
-					    data->xshm->seg, 0);
-	cur_c = xcb_xfixes_get_cursor_image_unchecked(data->xcb);
-
-	img_r = xcb_shm_get_image_reply(data->xcb, img_c, NULL);
-	cur_r = xcb_xfixes_get_cursor_image_reply(data->xcb, cur_c, NULL);
-
-	if (!img_r)
-		goto exit;
+	/* the capture thread has the next image ready in a shm segment, which
+	 * it leaves alone until the upload is done */
+	pthread_mutex_lock(&data->mutex);
+	idx = data->ready_buffer;
+	data->ready_buffer = -1;
+	data->upload_buffer = idx;
+	cur_r = data->cursor_reply;
+	data->cursor_reply = NULL;
+	pthread_mutex_unlock(&data->mutex);
+
+	if (idx == -1 && !cur_r)
+		return;
 
 	obs_enter_graphics();
 
-	gs_texture_set_image(data->texture, (void *)data->xshm->data,
-			     data->adj_width * 4, false);
-	xcb_xcursor_update(data->cursor, cur_r);
+	if (idx != -1)
+		gs_texture_set_image(data->texture,
+				     (void *)data->xshm[idx]->data,
+				     data->adj_width * 4, false);
+	if (cur_r)
+		xcb_xcursor_update(data->cursor, cur_r);
 
 	obs_leave_graphics();
 
-exit:
-	free(img_r);
+	if (idx != -1) {
+		pthread_mutex_lock(&data->mutex);
+		data->upload_buffer = -1;
+		pthread_mutex_unlock(&data->mutex);
+	}
+
 	free(cur_r);
 }
 
@@ -571,7 +915,7 @@ struct obs_source_info xshm_input = {
 	.id = "xshm_input",
 	.type = OBS_SOURCE_TYPE_INPUT,
 	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW |
-			OBS_SOURCE_DO_NOT_DUPLICATE,
+			OBS_SOURCE_DO_NOT_DUPLICATE | OBS_SOURCE_THREADED_TICK,
 	.get_name = xshm_getname,
 	.create = xshm_create,
 	.destroy = xshm_destroy,
@@ -0,0 +1,425 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+/*
+ * Shared memory transport between obs and ffmpeg-mux.
+ *
+ *   Instead of writing packets into the stdin pipe of ffmpeg-mux, obs can
+ * write them into a ring buffer in a memfd that both processes map.  The
+ * data in the ring is the same stream as on the pipe (ffm_packet_info
+ * followed by the packet data), so only the way it's carried changes.
+ *
+ *   The ring is passed on the command line as "shm:<memfd>:<data eventfd>:
+ * <space eventfd>".  The writer signals the data eventfd when the reader is
+ * waiting for data, and the reader signals the space eventfd when the writer
+ * is waiting for space.  Neither side uses the pipe for data, but both use
+ * it to notice when the other side goes away: ffmpeg-mux watches stdin for
+ * the writer closing it, and obs watches the read end of a separate pipe
+ * whose write end only ffmpeg-mux holds.
+ *
+ *   All of these are close-on-exec in obs, and are passed to ffmpeg-mux
+ * alone (see ffm_shm_get_child_fds), so that no other process obs starts
+ * can keep the pipe from hanging up.
+ */
+
+#if defined(__linux__)
+#define FFM_SHM_SUPPORTED 1
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <util/threading.h>
+
+#define FFM_SHM_MAGIC 0x4d464653
+#define FFM_SHM_DATA_OFFSET 4096
+#define FFM_SHM_CHILD_FDS 4
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+struct ffm_shm_header {
+	uint32_t magic;
+	uint32_t ring_size;
+
+	/* bytes written and read so far, the ring size is a power of two so
+	 * these can wrap around */
+	volatile long head;
+	char pad0[64 - sizeof(long)];
+	volatile long tail;
+	char pad1[64 - sizeof(long)];
+
+	volatile long reader_waiting;
+	volatile long writer_waiting;
+	volatile long closed;
+};
+
+struct ffm_shm {
+	struct ffm_shm_header *header;
+	uint8_t *ring;
+	size_t ring_size;
+	size_t map_size;
+
+	int mem_fd;
+	int data_fd;
+	int space_fd;
+
+	/* hangs up when the other process goes away */
+	int peer_fd;
+	/* write end of the writer's peer pipe, for the reader only */
+	int child_fd;
+};
+
+static inline void ffm_shm_init(struct ffm_shm *shm)
+{
+	memset(shm, 0, sizeof(*shm));
+	shm->mem_fd = -1;
+	shm->data_fd = -1;
+	shm->space_fd = -1;
+	shm->peer_fd = -1;
+	shm->child_fd = -1;
+}
+
+static inline void ffm_shm_close_fd(int *fd)
+{
+	if (*fd != -1) {
+		close(*fd);
+		*fd = -1;
+	}
+}
+
+static inline void ffm_shm_free(struct ffm_shm *shm)
+{
+	if (shm->header)
+		munmap(shm->header, shm->map_size);
+
+	ffm_shm_close_fd(&shm->mem_fd);
+	ffm_shm_close_fd(&shm->data_fd);
+	ffm_shm_close_fd(&shm->space_fd);
+	ffm_shm_close_fd(&shm->peer_fd);
+	ffm_shm_close_fd(&shm->child_fd);
+	ffm_shm_init(shm);
+}
+
+static inline bool ffm_shm_map(struct ffm_shm *shm, size_t map_size)
+{
+	void *ptr = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			 shm->mem_fd, 0);
+	if (ptr == MAP_FAILED)
+		return false;
+
+	shm->header = ptr;
+	shm->ring = (uint8_t *)ptr + FFM_SHM_DATA_OFFSET;
+	shm->map_size = map_size;
+	return true;
+}
+
+static inline void ffm_shm_signal(int fd)
+{
+	eventfd_write(fd, 1);
+}
+
+/* Waits until fd is signalled or peer_fd hangs up, returns false on hang up
+ * (or error) */
+static inline bool ffm_shm_wait(int fd, int peer_fd)
+{
+	struct pollfd fds[2] = {{fd, POLLIN, 0}, {peer_fd, POLLIN, 0}};
+	eventfd_t val;
+
+	while (poll(fds, peer_fd != -1 ? 2 : 1, -1) < 0) {
+		if (errno != EINTR)
+			return false;
+	}
+
+	if (fds[0].revents & POLLIN)
+		eventfd_read(fd, &val);
+
+	return !(fds[1].revents & (POLLHUP | POLLERR));
+}
+
+static inline size_t ffm_shm_used(struct ffm_shm *shm)
+{
+	unsigned long head = (unsigned long)os_atomic_load_long(
+		&shm->header->head);
+	unsigned long tail = (unsigned long)os_atomic_load_long(
+		&shm->header->tail);
+	return (size_t)(head - tail);
+}
+
+/* ------------------------------------------------------------------------- */
+/* writer (obs)                                                              */
+
+/** Creates the ring, ring_size must be a power of two */
+static inline bool ffm_shm_create(struct ffm_shm *shm, size_t ring_size)
+{
+	size_t map_size = FFM_SHM_DATA_OFFSET + ring_size;
+	int fds[2];
+
+	ffm_shm_init(shm);
+
+	/* everything is close-on-exec from the start, the child gets its own
+	 * copies when it's started.  memfd_create and pipe2 are called
+	 * directly as they need a newer glibc (or _GNU_SOURCE) than we
+	 * otherwise do */
+	shm->mem_fd = (int)syscall(SYS_memfd_create, "obs-ffmpeg-mux",
+				   MFD_CLOEXEC);
+	if (shm->mem_fd == -1 || ftruncate(shm->mem_fd, (off_t)map_size) != 0)
+		goto fail;
+	if (!ffm_shm_map(shm, map_size))
+		goto fail;
+
+	shm->data_fd = eventfd(0, EFD_CLOEXEC);
+	shm->space_fd = eventfd(0, EFD_CLOEXEC);
+	if (shm->data_fd == -1 || shm->space_fd == -1)
+		goto fail;
+
+	if (syscall(SYS_pipe2, fds, O_CLOEXEC) != 0)
+		goto fail;
+	shm->peer_fd = fds[0];
+	shm->child_fd = fds[1];
+
+	shm->ring_size = ring_size;
+	shm->header->ring_size = (uint32_t)ring_size;
+	shm->header->magic = FFM_SHM_MAGIC;
+	return true;
+
+fail:
+	ffm_shm_free(shm);
+	return false;
+}
+
+/** Writes the command line argument that passes the ring to ffmpeg-mux */
+static inline void ffm_shm_get_arg(struct ffm_shm *shm, char *arg, size_t size)
+{
+	snprintf(arg, size, "shm:%d:%d:%d", shm->mem_fd, shm->data_fd,
+		 shm->space_fd);
+}
+
+/** Gets the descriptors ffmpeg-mux has to inherit (and no other process
+ * should), returns how many there are */
+static inline size_t ffm_shm_get_child_fds(struct ffm_shm *shm,
+					   int fds[FFM_SHM_CHILD_FDS])
+{
+	fds[0] = shm->mem_fd;
+	fds[1] = shm->data_fd;
+	fds[2] = shm->space_fd;
+	fds[3] = shm->child_fd;
+	return FFM_SHM_CHILD_FDS;
+}
+
+/** Called once ffmpeg-mux has been started with the ring */
+static inline void ffm_shm_started(struct ffm_shm *shm)
+{
+	/* only the child may keep the write end, so that the read end hangs
+	 * up when it exits */
+	ffm_shm_close_fd(&shm->child_fd);
+}
+
+static inline bool ffm_shm_wait_space(struct ffm_shm *shm)
+{
+	struct ffm_shm_header *h = shm->header;
+
+	os_atomic_set_long(&h->writer_waiting, 1);
+
+	if (ffm_shm_used(shm) < shm->ring_size) {
+		os_atomic_set_long(&h->writer_waiting, 0);
+		return true;
+	}
+
+	bool alive = ffm_shm_wait(shm->space_fd, shm->peer_fd);
+	os_atomic_set_long(&h->writer_waiting, 0);
+	return alive;
+}
+
+/** Writes data into the ring, waiting for space as needed.  Returns false if
+ * ffmpeg-mux has exited. */
+static inline bool ffm_shm_write(struct ffm_shm *shm, const void *data,
+				 size_t size)
+{
+	struct ffm_shm_header *h = shm->header;
+	const uint8_t *src = data;
+	size_t mask = shm->ring_size - 1;
+
+	while (size) {
+		size_t space = shm->ring_size - ffm_shm_used(shm);
+		unsigned long head;
+		size_t pos, len, first;
+
+		if (!space) {
+			if (!ffm_shm_wait_space(shm))
+				return false;
+			continue;
+		}
+
+		head = (unsigned long)os_atomic_load_long(&h->head);
+		pos = (size_t)head & mask;
+		len = size < space ? size : space;
+		first = shm->ring_size - pos;
+		if (first > len)
+			first = len;
+
+		memcpy(shm->ring + pos, src, first);
+		memcpy(shm->ring, src + first, len - first);
+
+		os_atomic_set_long(&h->head, (long)(head + len));
+		if (os_atomic_load_long(&h->reader_waiting))
+			ffm_shm_signal(shm->data_fd);
+
+		src += len;
+		size -= len;
+	}
+
+	return true;
+}
+
+/** Tells ffmpeg-mux that no more data is coming */
+static inline void ffm_shm_close_writer(struct ffm_shm *shm)
+{
+	os_atomic_set_long(&shm->header->closed, 1);
+	ffm_shm_signal(shm->data_fd);
+}
+
+/* ------------------------------------------------------------------------- */
+/* reader (ffmpeg-mux)                                                       */
+
+/** Maps the ring passed on the command line, peer_fd is the pipe from obs */
+static inline bool ffm_shm_open(struct ffm_shm *shm, const char *arg,
+				int peer_fd)
+{
+	struct stat st;
+
+	ffm_shm_init(shm);
+
+	if (sscanf(arg, "shm:%d:%d:%d", &shm->mem_fd, &shm->data_fd,
+		   &shm->space_fd) != 3)
+		goto fail;
+	if (fstat(shm->mem_fd, &st) != 0 ||
+	    st.st_size <= FFM_SHM_DATA_OFFSET)
+		goto fail;
+	if (!ffm_shm_map(shm, (size_t)st.st_size))
+		goto fail;
+
+	shm->ring_size = shm->header->ring_size;
+	if (shm->header->magic != FFM_SHM_MAGIC ||
+	    shm->ring_size != shm->map_size - FFM_SHM_DATA_OFFSET ||
+	    (shm->ring_size & (shm->ring_size - 1)) != 0)
+		goto fail;
+
+	shm->peer_fd = peer_fd;
+	return true;
+
+fail:
+	/* don't close stdin */
+	shm->peer_fd = -1;
+	ffm_shm_free(shm);
+	return false;
+}
+
+/** Waits until size bytes can be read, returns false if the writer closed
+ * the ring (or went away) before that */
+static inline bool ffm_shm_wait_data(struct ffm_shm *shm, size_t size)
+{
+	struct ffm_shm_header *h = shm->header;
+
+	for (;;) {
+		bool alive;
+
+		if (ffm_shm_used(shm) >= size)
+			return true;
+		if (os_atomic_load_long(&h->closed))
+			return ffm_shm_used(shm) >= size;
+
+		os_atomic_set_long(&h->reader_waiting, 1);
+
+		if (ffm_shm_used(shm) >= size ||
+		    os_atomic_load_long(&h->closed)) {
+			os_atomic_set_long(&h->reader_waiting, 0);
+			continue;
+		}
+
+		alive = ffm_shm_wait(shm->data_fd, shm->peer_fd);
+		os_atomic_set_long(&h->reader_waiting, 0);
+
+		if (!alive)
+			return ffm_shm_used(shm) >= size;
+	}
+}
+
+/** Marks size bytes as read */
+static inline void ffm_shm_consume(struct ffm_shm *shm, size_t size)
+{
+	struct ffm_shm_header *h = shm->header;
+	unsigned long tail = (unsigned long)os_atomic_load_long(&h->tail);
+
+	os_atomic_set_long(&h->tail, (long)(tail + size));
+	if (os_atomic_load_long(&h->writer_waiting))
+		ffm_shm_signal(shm->space_fd);
+}
+
+/** Returns the next size bytes in place if they don't wrap around the end of
+ * the ring, waiting for them if needed.  They stay valid until consumed. */
+static inline const uint8_t *ffm_shm_peek(struct ffm_shm *shm, size_t size)
+{
+	size_t mask = shm->ring_size - 1;
+	size_t pos;
+
+	if (size > shm->ring_size || !ffm_shm_wait_data(shm, size))
+		return NULL;
+
+	pos = (size_t)os_atomic_load_long(&shm->header->tail) & mask;
+	return pos + size <= shm->ring_size ? shm->ring + pos : NULL;
+}
+
+/** Reads size bytes, returns size or 0 if the writer closed the ring */
+static inline size_t ffm_shm_read(struct ffm_shm *shm, void *data, size_t size)
+{
+	uint8_t *dst = data;
+	size_t mask = shm->ring_size - 1;
+	size_t total = size;
+
+	while (size) {
+		size_t len = size < shm->ring_size ? size : shm->ring_size;
+		size_t pos, first;
+
+		if (!ffm_shm_wait_data(shm, len))
+			return 0;
+
+		pos = (size_t)os_atomic_load_long(&shm->header->tail) & mask;
+		first = shm->ring_size - pos;
+		if (first > len)
+			first = len;
+
+		memcpy(dst, shm->ring + pos, first);
+		memcpy(dst + first, shm->ring, len - first);
+		ffm_shm_consume(shm, len);
+
+		dst += len;
+		size -= len;
+	}
+
+	return total;
+}
+
+#endif
@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "ffmpeg-mux.h"
+#include "ffmpeg-mux-shm.h"
 
 #include <util/dstr.h>
 #include <libavformat/avformat.h>
@@ -43,6 +44,11 @@
 
 static char *global_stream_key = "";
 
+#ifdef FFM_SHM_SUPPORTED
+/* set when obs passes packets through shared memory instead of stdin */
+static struct ffm_shm *global_shm = NULL;
+#endif
+
 struct resize_buf {
 	uint8_t *buf;
 	size_t size;
@@ -166,6 +172,14 @@ static void ffmpeg_mux_free(struct ffmpeg_mux *ffm)
 
 	free_avformat(ffm);
 
+#ifdef FFM_SHM_SUPPORTED
+	if (global_shm) {
+		ffm_shm_free(global_shm);
+		free(global_shm);
+		global_shm = NULL;
+	}
+#endif
+
 	header_free(&ffm->video_header);
 
 	if (ffm->audio_header) {
@@ -347,6 +361,22 @@ static bool init_params(int *argc, char ***argv, struct main_params *params,
 
 	get_opt_str(argc, argv, &params->muxer_settings, "muxer settings");
 
+#ifdef FFM_SHM_SUPPORTED
+	if (*argc) {
+		char *transport;
+		get_opt_str(argc, argv, &transport, "transport");
+
+		global_shm = malloc(sizeof(*global_shm));
+		if (!ffm_shm_open(global_shm, transport, fileno(stdin))) {
+			fprintf(stderr, "Failed to open transport '%s'\n",
+				transport);
+			free(global_shm);
+			global_shm = NULL;
+			return false;
+		}
+	}
+#endif
+
 	return true;
 }
 
@@ -520,6 +550,11 @@ static size_t safe_read(void *vdata, size_t size)
 	uint8_t *data = vdata;
 	size_t total = size;
 
+#ifdef FFM_SHM_SUPPORTED
+	if (global_shm)
+		return ffm_shm_read(global_shm, vdata, size);
+#endif
+
 	while (size > 0) {
 		size_t in_size = fread(data, 1, size, stdin);
 		if (in_size == 0)
@@ -858,6 +893,17 @@ int main(int argc, char *argv[])
 	}
 
 	while (!fail && safe_read(&info, sizeof(info)) == sizeof(info)) {
+#ifdef FFM_SHM_SUPPORTED
+		/* mux straight from the ring when the packet doesn't wrap */
+		const uint8_t *data =
+			global_shm ? ffm_shm_peek(global_shm, info.size) : NULL;
+		if (data) {
+			fail = !ffmpeg_mux_packet(&ffm, (uint8_t *)data, &info);
+			ffm_shm_consume(global_shm, info.size);
+			continue;
+		}
+#endif
+
 		resize_buf_resize(&rb, info.size);
 
 		if (safe_read(rb.buf, info.size) == info.size) {
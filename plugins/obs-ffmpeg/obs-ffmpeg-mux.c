@@ -51,6 +51,12 @@ static inline void replay_buffer_clear(struct ffmpeg_muxer *stream)
 	}
 
 	circlebuf_free(&stream->packets);
+
+	/* saves still reading from the ring keep it alive */
+	replay_ring_release(stream->ring);
+	stream->ring = NULL;
+
+	circlebuf_free(&stream->ring_positions);
 	stream->cur_size = 0;
 	stream->cur_time = 0;
 	stream->max_size = 0;
@@ -66,10 +72,9 @@ static void ffmpeg_mux_destroy(void *data)
 	replay_buffer_clear(stream);
 	if (stream->mux_thread_joinable)
 		pthread_join(stream->mux_thread, NULL);
-	da_free(stream->mux_packets);
 	circlebuf_free(&stream->packets);
 
-	os_process_pipe_destroy(stream->pipe);
+	stop_pipe(stream);
 	dstr_free(&stream->path);
 	dstr_free(&stream->printable_path);
 	dstr_free(&stream->stream_key);
@@ -232,6 +237,39 @@ static void add_muxer_params(struct dstr *cmd, struct ffmpeg_muxer *stream)
 	dstr_free(&mux);
 }
 
+#ifdef FFM_SHM_SUPPORTED
+#define SHM_RING_SIZE (32 * 1024 * 1024)
+
+static void add_transport(struct dstr *cmd, struct ffmpeg_muxer *stream)
+{
+	char arg[64];
+
+	if (!stream->shm)
+		return;
+
+	ffm_shm_get_arg(stream->shm, arg, sizeof(arg));
+	dstr_catf(cmd, "\"%s\" ", arg);
+}
+
+static void create_shm(struct ffmpeg_muxer *stream)
+{
+	obs_data_t *settings = obs_output_get_settings(stream->output);
+	bool use_shm = obs_data_get_bool(settings, "shm_transport");
+	obs_data_release(settings);
+
+	if (!use_shm)
+		return;
+
+	stream->shm = bmalloc(sizeof(*stream->shm));
+	if (!ffm_shm_create(stream->shm, SHM_RING_SIZE)) {
+		warn("Failed to create shared memory ring, "
+		     "falling back to the pipe");
+		bfree(stream->shm);
+		stream->shm = NULL;
+	}
+}
+#endif
+
 static void build_command_line(struct ffmpeg_muxer *stream, struct dstr *cmd,
 			       const char *path)
 {
@@ -272,14 +310,70 @@ static void build_command_line(struct ffmpeg_muxer *stream, struct dstr *cmd,
 
 	add_stream_key(cmd, stream);
 	add_muxer_params(cmd, stream);
+#ifdef FFM_SHM_SUPPORTED
+	add_transport(cmd, stream);
+#endif
 }
 
 void start_pipe(struct ffmpeg_muxer *stream, const char *path)
 {
 	struct dstr cmd;
+
+#ifdef FFM_SHM_SUPPORTED
+	create_shm(stream);
+#endif
+
 	build_command_line(stream, &cmd, path);
+
+#ifdef FFM_SHM_SUPPORTED
+	if (stream->shm) {
+		int fds[FFM_SHM_CHILD_FDS];
+		size_t num_fds = ffm_shm_get_child_fds(stream->shm, fds);
+
+		stream->pipe = os_process_pipe_create_fds(cmd.array, "w", fds,
+							  num_fds);
+	} else {
+		stream->pipe = os_process_pipe_create(cmd.array, "w");
+	}
+#else
 	stream->pipe = os_process_pipe_create(cmd.array, "w");
+#endif
 	dstr_free(&cmd);
+
+#ifdef FFM_SHM_SUPPORTED
+	if (stream->shm) {
+		if (stream->pipe) {
+			ffm_shm_started(stream->shm);
+		} else {
+			ffm_shm_free(stream->shm);
+			bfree(stream->shm);
+			stream->shm = NULL;
+		}
+	}
+#endif
+}
+
+int stop_pipe(struct ffmpeg_muxer *stream)
+{
+	int ret;
+
+#ifdef FFM_SHM_SUPPORTED
+	/* let ffmpeg-mux drain the ring before waiting for it to exit */
+	if (stream->shm)
+		ffm_shm_close_writer(stream->shm);
+#endif
+
+	ret = os_process_pipe_destroy(stream->pipe);
+	stream->pipe = NULL;
+
+#ifdef FFM_SHM_SUPPORTED
+	if (stream->shm) {
+		ffm_shm_free(stream->shm);
+		bfree(stream->shm);
+		stream->shm = NULL;
+	}
+#endif
+	return ret;
 }
 
 static void set_file_not_readable_error(struct ffmpeg_muxer *stream,
@@ -375,8 +469,7 @@ int deactivate(struct ffmpeg_muxer *stream, int code)
 	}
 
 	if (active(stream)) {
-		ret = os_process_pipe_destroy(stream->pipe);
-		stream->pipe = NULL;
+		ret = stop_pipe(stream);
 
 		os_atomic_set_bool(&stream->active, false);
 		os_atomic_set_bool(&stream->sent_headers, false);
@@ -456,6 +549,24 @@ static void signal_failure(struct ffmpeg_muxer *stream)
 	os_atomic_set_bool(&stream->capturing, false);
 }
 
+#ifdef FFM_SHM_SUPPORTED
+static bool write_packet_shm(struct ffmpeg_muxer *stream,
+			     const struct ffm_packet_info *info,
+			     const struct encoder_packet *packet)
+{
+	if (!ffm_shm_write(stream->shm, info, sizeof(*info)) ||
+	    !ffm_shm_write(stream->shm, packet->data, packet->size)) {
+		warn("ffmpeg-mux exited while writing to the shared memory "
+		     "ring");
+		signal_failure(stream);
+		return false;
+	}
+
+	stream->total_bytes += packet->size;
+	return true;
+}
+#endif
+
 bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
 {
 	bool is_video = packet->type == OBS_ENCODER_VIDEO;
@@ -469,6 +580,11 @@ bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
 							: FFM_PACKET_AUDIO,
 				       .keyframe = packet->keyframe};
 
+#ifdef FFM_SHM_SUPPORTED
+	if (stream->shm)
+		return write_packet_shm(stream, &info, packet);
+#endif
+
 	ret = os_process_pipe_write(stream->pipe, (const uint8_t *)&info,
 				    sizeof(info));
 	if (ret != sizeof(info)) {
@@ -577,6 +693,11 @@ uint64_t ffmpeg_mux_total_bytes(void *data)
 	return stream->total_bytes;
 }
 
+void ffmpeg_mux_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_bool(settings, "shm_transport", false);
+}
+
 struct obs_output_info ffmpeg_muxer = {
 	.id = "ffmpeg_muxer",
 	.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED | OBS_OUTPUT_MULTI_TRACK |
@@ -589,6 +710,7 @@ struct obs_output_info ffmpeg_muxer = {
 	.encoded_packet = ffmpeg_mux_data,
 	.get_total_bytes = ffmpeg_mux_total_bytes,
 	.get_properties = ffmpeg_mux_properties,
+	.get_defaults = ffmpeg_mux_defaults,
 };
 
 static int connect_time(struct ffmpeg_muxer *stream)
@@ -619,6 +741,7 @@ struct obs_output_info ffmpeg_mpegts_muxer = {
 	.encoded_packet = ffmpeg_mux_data,
 	.get_total_bytes = ffmpeg_mux_total_bytes,
 	.get_properties = ffmpeg_mux_properties,
+	.get_defaults = ffmpeg_mux_defaults,
 	.get_connect_time_ms = ffmpeg_mpegts_mux_connect_time,
 };
 
@@ -650,7 +773,8 @@ static void replay_buffer_hotkey(void *data, obs_hotkey_id id,
 			return;
 		}
 
-		stream->save_ts = os_gettime_ns() / 1000LL;
+		stream->save_request_ns = os_gettime_ns();
+		stream->save_ts = (int64_t)(stream->save_request_ns / 1000);
 	}
 }
 
@@ -663,16 +787,42 @@ static void save_replay_proc(void *data, calldata_t *cd)
 static void get_last_replay(void *data, calldata_t *cd)
 {
 	struct ffmpeg_muxer *stream = data;
-	if (!os_atomic_load_bool(&stream->muxing))
-		calldata_set_string(cd, "path", stream->path.array);
+
+	pthread_mutex_lock(&stream->replay_mutex);
+	calldata_set_string(cd, "path", stream->path.array);
+	pthread_mutex_unlock(&stream->replay_mutex);
+}
+
+static void get_last_replay_timing(void *data, calldata_t *cd)
+{
+	struct ffmpeg_muxer *stream = data;
+
+	pthread_mutex_lock(&stream->replay_mutex);
+	calldata_set_int(cd, "snapshot_ns",
+			 (long long)stream->last_snapshot_ns);
+	calldata_set_int(cd, "first_packet_ns",
+			 (long long)stream->last_first_packet_ns);
+	calldata_set_int(cd, "total_ns", (long long)stream->last_save_ns);
+	pthread_mutex_unlock(&stream->replay_mutex);
 }
 
 static void *replay_buffer_create(obs_data_t *settings, obs_output_t *output)
 {
 	UNUSED_PARAMETER(settings);
 	struct ffmpeg_muxer *stream = bzalloc(sizeof(*stream));
+	pthread_mutexattr_t attr;
 	stream->output = output;
 
+	/* the "saved" signal is sent with it locked, and its handlers can
+	 * call get_last_replay */
+	if (pthread_mutexattr_init(&attr) != 0 ||
+	    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) != 0 ||
+	    pthread_mutex_init(&stream->replay_mutex, &attr) != 0) {
+		bfree(stream);
+		return NULL;
+	}
+	pthread_mutexattr_destroy(&attr);
+
 	stream->hotkey =
 		obs_hotkey_register_output(output, "ReplayBuffer.Save",
 					   obs_module_text("ReplayBuffer.Save"),
@@ -682,6 +832,10 @@ static void *replay_buffer_create(obs_data_t *settings, obs_output_t *output)
 	proc_handler_add(ph, "void save()", save_replay_proc, stream);
 	proc_handler_add(ph, "void get_last_replay(out string path)",
 			 get_last_replay, stream);
+	proc_handler_add(ph,
+			 "void get_last_replay_timing(out int snapshot_ns, "
+			 "out int first_packet_ns, out int total_ns)",
+			 get_last_replay_timing, stream);
 
 	signal_handler_t *sh = obs_output_get_signal_handler(output);
 	signal_handler_add(sh, "void saved()");
@@ -689,14 +843,481 @@ static void *replay_buffer_create(obs_data_t *settings, obs_output_t *output)
 	return stream;
 }
 
+/* ------------------------------------------------------------------------ */
+/* replay saves                                                             */
+
+/*
+ * Each save snapshots the buffer by taking a reference to every packet in
+ * it, and muxes the snapshot with its own ffmpeg-mux process on its own
+ * thread.  The buffer keeps going in the meantime, and a new save can start
+ * while the previous ones are still being written.
+ *
+ * The packets are in the order they were received, each track in dts order.
+ * Every track starts at 0 in the file, so the save thread merges the tracks
+ * by their offset dts as it writes them.
+ */
+
+#define SAVE_TRACKS (MAX_AUDIO_MIXES + 1)
+
+struct replay_save {
+	struct ffmpeg_muxer *owner;
+
+	/* the save's own ffmpeg-mux process */
+	struct ffmpeg_muxer mux;
+	struct dstr path;
+
+	DARRAY(struct encoder_packet) packets;
+	DARRAY(uint64_t) positions;
+	struct replay_ring *ring;
+
+	uint64_t request_ns;
+	uint64_t snapshot_ns;
+	uint64_t first_packet_ns;
+
+	pthread_t thread;
+	volatile bool done;
+};
+
+static inline size_t save_track(const struct encoder_packet *pkt)
+{
+	return pkt->type == OBS_ENCODER_VIDEO ? 0 : pkt->track_idx + 1;
+}
+
+static size_t next_track_packet(struct replay_save *save, size_t track,
+				size_t idx)
+{
+	while (idx < save->packets.num &&
+	       save_track(&save->packets.array[idx]) != track)
+		idx++;
+	return idx;
+}
+
+/* the rest of the packet is still needed to find the next ones */
+static inline void release_packet_data(struct encoder_packet *pkt)
+{
+	struct encoder_packet ref = *pkt;
+	obs_encoder_packet_release(&ref);
+	pkt->data = NULL;
+}
+
+static bool save_write_packet(struct replay_save *save, size_t idx,
+			      struct darray *buf)
+{
+	struct ffmpeg_muxer *stream = &save->mux;
+	struct encoder_packet *pkt = &save->packets.array[idx];
+	uint64_t pos;
+	DARRAY(uint8_t) data;
+	bool success;
+
+	if (!save->ring)
+		return write_packet(stream, pkt);
+
+	data.da = *buf;
+	da_resize(data, pkt->size);
+	*buf = data.da;
+
+	/* the data of the disk-backed buffer has to be read from the ring */
+	pos = save->positions.array[idx];
+	if (!replay_ring_read(save->ring, pos, data.array, pkt->size)) {
+		warn("Replay buffer data was overwritten before it could be "
+		     "saved");
+		return false;
+	}
+
+	pkt->data = data.array;
+	success = write_packet(stream, pkt);
+	pkt->data = NULL;
+	return success;
+}
+
+static bool save_write_packets(struct replay_save *save)
+{
+	struct encoder_packet *packets = save->packets.array;
+	size_t num = save->packets.num;
+	size_t next[SAVE_TRACKS];
+	int64_t usec_offsets[SAVE_TRACKS] = {0};
+	int64_t dts_offsets[SAVE_TRACKS] = {0};
+	struct darray buf = {0};
+	bool success = true;
+
+	for (size_t t = 0; t < SAVE_TRACKS; t++) {
+		next[t] = next_track_packet(save, t, 0);
+		if (next[t] < num) {
+			usec_offsets[t] = packets[next[t]].dts_usec;
+			dts_offsets[t] = packets[next[t]].dts;
+		}
+	}
+
+	for (;;) {
+		size_t best = num;
+		size_t best_track = 0;
+		int64_t best_usec = 0;
+		struct encoder_packet *pkt;
+
+		/* on a tie, the packet received last goes first */
+		for (size_t t = 0; t < SAVE_TRACKS; t++) {
+			int64_t usec;
+
+			if (next[t] >= num)
+				continue;
+
+			usec = packets[next[t]].dts_usec - usec_offsets[t];
+			if (best == num || usec < best_usec ||
+			    (usec == best_usec && next[t] > best)) {
+				best = next[t];
+				best_track = t;
+				best_usec = usec;
+			}
+		}
+
+		if (best == num)
+			break;
+
+		pkt = &packets[best];
+		pkt->dts_usec -= usec_offsets[best_track];
+		pkt->dts -= dts_offsets[best_track];
+		pkt->pts -= dts_offsets[best_track];
+
+		success = save_write_packet(save, best, &buf);
+		release_packet_data(pkt);
+		if (!success)
+			break;
+
+		if (!save->first_packet_ns)
+			save->first_packet_ns = os_gettime_ns();
+
+		next[best_track] =
+			next_track_packet(save, best_track, best + 1);
+	}
+
+	darray_free(&buf);
+	return success;
+}
+
+static void save_finished(struct replay_save *save)
+{
+	struct ffmpeg_muxer *stream = save->owner;
+	signal_handler_t *sh = obs_output_get_signal_handler(stream->output);
+	calldata_t cd = {0};
+
+	/* hold the lock so that handlers of the signal get this save's path
+	 * from get_last_replay even if another save finishes meanwhile */
+	pthread_mutex_lock(&stream->replay_mutex);
+
+	dstr_copy_dstr(&stream->path, &save->path);
+	stream->last_snapshot_ns = save->snapshot_ns;
+	stream->last_first_packet_ns =
+		save->first_packet_ns ? save->first_packet_ns - save->request_ns
+				      : 0;
+	stream->last_save_ns = os_gettime_ns() - save->request_ns;
+
+	info("Wrote replay buffer to '%s' (%.1f ms after the request)",
+	     save->path.array, (double)stream->last_save_ns / 1000000.0);
+
+	signal_handler_signal(sh, "saved", &cd);
+	pthread_mutex_unlock(&stream->replay_mutex);
+}
+
+static void *replay_save_thread(void *data)
+{
+	struct replay_save *save = data;
+	struct ffmpeg_muxer *stream = &save->mux;
+	bool success = false;
+
+	os_set_thread_name("replay-buffer-save");
+
+	start_pipe(stream, save->path.array);
+
+	if (!stream->pipe) {
+		warn("Failed to create process pipe");
+	} else if (!send_headers(stream)) {
+		warn("Could not write headers for file '%s'",
+		     save->path.array);
+	} else {
+		success = save_write_packets(save);
+	}
+
+	stop_pipe(stream);
+
+	if (success)
+		save_finished(save);
+
+	for (size_t i = 0; i < save->packets.num; i++)
+		obs_encoder_packet_release(&save->packets.array[i]);
+	da_free(save->packets);
+	da_free(save->positions);
+	replay_ring_release(save->ring);
+	save->ring = NULL;
+
+	os_atomic_set_bool(&save->done, true);
+	return NULL;
+}
+
+static void replay_save_free(struct replay_save *save)
+{
+	pthread_join(save->thread, NULL);
+
+	dstr_free(&save->mux.path);
+	dstr_free(&save->path);
+	bfree(save);
+}
+
+/* joins the saves that are done, or all of them if wait is set */
+static void replay_buffer_reap_saves(struct ffmpeg_muxer *stream, bool wait)
+{
+	for (size_t i = stream->saves.num; i > 0; i--) {
+		struct replay_save *save = stream->saves.array[i - 1];
+
+		if (wait || os_atomic_load_bool(&save->done)) {
+			replay_save_free(save);
+			da_erase(stream->saves, i - 1);
+		}
+	}
+}
+
+static bool replay_path_taken(struct ffmpeg_muxer *stream, const char *path)
+{
+	for (size_t i = 0; i < stream->saves.num; i++) {
+		if (dstr_cmp(&stream->saves.array[i]->path, path) == 0)
+			return true;
+	}
+
+	return os_file_exists(path);
+}
+
+/* filenames only have one second of resolution, so saves in the same second
+ * get a number appended, like the frontend does for recordings */
+static void find_unique_replay_path(struct ffmpeg_muxer *stream,
+				    struct dstr *path, bool space)
+{
+	struct dstr test = {0};
+	const char *slash;
+	const char *ext;
+	size_t ext_start;
+	int num = 2;
+
+	if (!replay_path_taken(stream, path->array))
+		return;
+
+	slash = strrchr(path->array, '/');
+	ext = strrchr(path->array, '.');
+	ext_start = ext && ext > slash ? (size_t)(ext - path->array)
+				       : path->len;
+
+	for (;;) {
+		dstr_ncopy(&test, path->array, ext_start);
+		if (space)
+			dstr_catf(&test, " (%d)", num++);
+		else
+			dstr_catf(&test, "_%d", num++);
+		dstr_cat(&test, path->array + ext_start);
+
+		if (!replay_path_taken(stream, test.array))
+			break;
+	}
+
+	dstr_move(path, &test);
+}
+
+static void get_replay_path(struct ffmpeg_muxer *stream, struct dstr *path)
+{
+	obs_data_t *settings = obs_output_get_settings(stream->output);
+	const char *dir = obs_data_get_string(settings, "directory");
+	const char *fmt = obs_data_get_string(settings, "format");
+	const char *ext = obs_data_get_string(settings, "extension");
+	bool space = obs_data_get_bool(settings, "allow_spaces");
+
+	char *filename = os_generate_formatted_filename(ext, space, fmt);
+
+	dstr_copy(path, dir);
+	dstr_replace(path, "\\", "/");
+	if (dstr_end(path) != '/')
+		dstr_cat_ch(path, '/');
+	dstr_cat(path, filename);
+
+	char *slash = strrchr(path->array, '/');
+	if (slash) {
+		*slash = 0;
+		os_mkdirs(path->array);
+		*slash = '/';
+	}
+
+	find_unique_replay_path(stream, path, space);
+
+	bfree(filename);
+	obs_data_release(settings);
+}
+
+static void replay_buffer_save(struct ffmpeg_muxer *stream)
+{
+	const size_t size = sizeof(struct encoder_packet);
+	size_t num_packets = stream->packets.size / size;
+	uint64_t start = os_gettime_ns();
+	struct replay_save *save = bzalloc(sizeof(*save));
+
+	save->owner = stream;
+	save->mux.output = stream->output;
+	save->request_ns = stream->save_request_ns ? stream->save_request_ns
+						   : start;
+
+	/* ---------------------------- */
+	/* snapshot the buffer */
+
+	da_resize(save->packets, num_packets);
+	circlebuf_peek_front(&stream->packets, save->packets.array,
+			     stream->packets.size);
+
+	for (size_t i = 0; i < num_packets; i++) {
+		struct encoder_packet *pkt = &save->packets.array[i];
+		obs_encoder_packet_ref(pkt, pkt);
+	}
+
+	if (stream->ring) {
+		da_resize(save->positions, num_packets);
+		circlebuf_peek_front(&stream->ring_positions,
+				     save->positions.array,
+				     stream->ring_positions.size);
+
+		save->ring = stream->ring;
+		replay_ring_addref(save->ring);
+	}
+
+	get_replay_path(stream, &save->path);
+	save->snapshot_ns = os_gettime_ns() - start;
+
+	/* ---------------------------- */
+
+	if (pthread_create(&save->thread, NULL, replay_save_thread, save) !=
+	    0) {
+		warn("Failed to create replay buffer save thread");
+		for (size_t i = 0; i < num_packets; i++)
+			obs_encoder_packet_release(&save->packets.array[i]);
+		da_free(save->packets);
+		da_free(save->positions);
+		replay_ring_release(save->ring);
+		dstr_free(&save->path);
+		bfree(save);
+		return;
+	}
+
+	da_push_back(stream->saves, &save);
+}
+
 static void replay_buffer_destroy(void *data)
 {
 	struct ffmpeg_muxer *stream = data;
 	if (stream->hotkey)
 		obs_hotkey_unregister(stream->hotkey);
+
+	replay_buffer_reap_saves(stream, true);
+	da_free(stream->saves);
+	pthread_mutex_destroy(&stream->replay_mutex);
 	ffmpeg_mux_destroy(data);
 }
 
+#define MIN_RING_SIZE (16 * 1024 * 1024)
+
+static int64_t get_encoder_bitrate(obs_encoder_t *encoder)
+{
+	obs_data_t *settings = obs_encoder_get_settings(encoder);
+	int64_t bitrate = obs_data_get_int(settings, "bitrate");
+	obs_data_release(settings);
+	return bitrate;
+}
+
+/* rates assumed for encoders without a bitrate (CQP, CRF, lossless, ...).
+ * for video that's bits per pixel per frame, about 37 Mbps at 1080p60 */
+#define ESTIMATED_VIDEO_BITS_PER_PIXEL 0.3
+#define ESTIMATED_AUDIO_KBPS 320
+
+static int64_t estimate_video_bitrate(obs_encoder_t *encoder)
+{
+	video_t *video = obs_encoder_video(encoder);
+	double fps = video ? video_output_get_frame_rate(video) : 0.0;
+	double pixels = (double)obs_encoder_get_width(encoder) *
+			(double)obs_encoder_get_height(encoder);
+
+	if (fps <= 0.0)
+		fps = 60.0;
+
+	return (int64_t)(pixels * fps * ESTIMATED_VIDEO_BITS_PER_PIXEL /
+			 1000.0);
+}
+
+static int64_t get_buffered_bitrate(struct ffmpeg_muxer *stream,
+				    obs_encoder_t *encoder)
+{
+	bool is_video = obs_encoder_get_type(encoder) == OBS_ENCODER_VIDEO;
+	int64_t kbps = get_encoder_bitrate(encoder);
+
+	if (kbps > 0)
+		return kbps;
+
+	kbps = is_video ? estimate_video_bitrate(encoder)
+			: ESTIMATED_AUDIO_KBPS;
+	warn("Encoder '%s' has no bitrate, sizing the disk buffer for an "
+	     "estimated %lld kbps.  Set a maximum size to control how much "
+	     "is buffered",
+	     obs_encoder_get_name(encoder), (long long)kbps);
+	return kbps;
+}
+
+static uint64_t get_ring_size(struct ffmpeg_muxer *stream)
+{
+	obs_encoder_t *vencoder = obs_output_get_video_encoder(stream->output);
+	int64_t kbps = 0;
+	uint64_t size;
+
+	if (stream->max_size) {
+		size = (uint64_t)stream->max_size;
+	} else {
+		/* no size limit, so estimate it from the bitrates */
+		if (vencoder)
+			kbps += get_buffered_bitrate(stream, vencoder);
+
+		for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
+			obs_encoder_t *aencoder =
+				obs_output_get_audio_encoder(stream->output, i);
+			if (aencoder)
+				kbps += get_buffered_bitrate(stream, aencoder);
+		}
+
+		size = (uint64_t)kbps * 1000 / 8 *
+		       (uint64_t)(stream->max_time / 1000000);
+		size += size / 4;
+	}
+
+	return size < MIN_RING_SIZE ? MIN_RING_SIZE : size;
+}
+
+static void create_ring(struct ffmpeg_muxer *stream, obs_data_t *settings)
+{
+	const char *dir = obs_data_get_string(settings, "disk_buffer_dir");
+	uint64_t size = get_ring_size(stream);
+	struct dstr path = {0};
+
+	if (!dir || !*dir)
+		dir = obs_data_get_string(settings, "directory");
+
+	dstr_copy(&path, dir);
+	dstr_replace(&path, "\\", "/");
+	if (dstr_end(&path) != '/')
+		dstr_cat_ch(&path, '/');
+	os_mkdirs(path.array);
+	dstr_catf(&path, ".obs-replay-buffer-%p.tmp", stream);
+
+	stream->ring = replay_ring_create(path.array, size);
+	if (stream->ring) {
+		info("Buffering packets in '%s' (%llu MB)", path.array,
+		     (unsigned long long)(size / (1024 * 1024)));
+	} else {
+		warn("Failed to create '%s', buffering packets in memory",
+		     path.array);
+	}
+
+	dstr_free(&path);
+}
+
 static bool replay_buffer_start(void *data)
 {
 	struct ffmpeg_muxer *stream = data;
@@ -706,9 +1327,13 @@ static bool replay_buffer_start(void *data)
 	if (!obs_output_initialize_encoders(stream->output, 0))
 		return false;
 
+	replay_buffer_reap_saves(stream, false);
+
 	obs_data_t *s = obs_output_get_settings(stream->output);
 	stream->max_time = obs_data_get_int(s, "max_time_sec") * 1000000LL;
 	stream->max_size = obs_data_get_int(s, "max_size_mb") * (1024 * 1024);
+	if (obs_data_get_bool(s, "disk_buffer"))
+		create_ring(stream, s);
 	obs_data_release(s);
 
 	os_atomic_set_bool(&stream->active, true);
@@ -725,6 +1350,9 @@ static bool purge_front(struct ffmpeg_muxer *stream)
 	bool keyframe;
 
 	circlebuf_pop_front(&stream->packets, &pkt, sizeof(pkt));
+	if (stream->ring)
+		circlebuf_pop_front(&stream->ring_positions, NULL,
+				    sizeof(uint64_t));
 
 	keyframe = pkt.type == OBS_ENCODER_VIDEO && pkt.keyframe;
 
@@ -780,154 +1408,45 @@ static inline void replay_buffer_purge(struct ffmpeg_muxer *stream,
 		purge(stream);
 }
 
-static void insert_packet(struct darray *array, struct encoder_packet *packet,
-			  int64_t video_offset, int64_t *audio_offsets,
-			  int64_t video_dts_offset, int64_t *audio_dts_offsets)
+/* drops the packets the next one will overwrite in the ring */
+static void replay_ring_purge(struct ffmpeg_muxer *stream, size_t size)
 {
-	struct encoder_packet pkt;
-	DARRAY(struct encoder_packet) packets;
-	packets.da = *array;
-	size_t idx;
-
-	obs_encoder_packet_ref(&pkt, packet);
-
-	if (pkt.type == OBS_ENCODER_VIDEO) {
-		pkt.dts_usec -= video_offset;
-		pkt.dts -= video_dts_offset;
-		pkt.pts -= video_dts_offset;
-	} else {
-		pkt.dts_usec -= audio_offsets[pkt.track_idx];
-		pkt.dts -= audio_dts_offsets[pkt.track_idx];
-		pkt.pts -= audio_dts_offsets[pkt.track_idx];
-	}
-
-	for (idx = packets.num; idx > 0; idx--) {
-		struct encoder_packet *p = packets.array + (idx - 1);
-		if (p->dts_usec < pkt.dts_usec)
-			break;
-	}
-
-	da_insert(packets, idx, &pkt);
-	*array = packets.da;
-}
-
-static void *replay_buffer_mux_thread(void *data)
-{
-	struct ffmpeg_muxer *stream = data;
-	bool error = false;
-
-	start_pipe(stream, stream->path.array);
-
-	if (!stream->pipe) {
-		warn("Failed to create process pipe");
-		error = true;
-		goto error;
-	}
-
-	if (!send_headers(stream)) {
-		warn("Could not write headers for file '%s'",
-		     stream->path.array);
-		error = true;
-		goto error;
-	}
-
-	for (size_t i = 0; i < stream->mux_packets.num; i++) {
-		struct encoder_packet *pkt = &stream->mux_packets.array[i];
-		write_packet(stream, pkt);
-		obs_encoder_packet_release(pkt);
-	}
+	struct replay_ring *ring = stream->ring;
+	uint64_t end = replay_ring_next_pos(ring, size) + size;
+	uint64_t front;
 
-	info("Wrote replay buffer to '%s'", stream->path.array);
+	if (end <= ring->size)
+		return;
 
-error:
-	os_process_pipe_destroy(stream->pipe);
-	stream->pipe = NULL;
-	da_free(stream->mux_packets);
-	os_atomic_set_bool(&stream->muxing, false);
+	while (stream->packets.size) {
+		circlebuf_peek_front(&stream->ring_positions, &front,
+				     sizeof(front));
+		if (front >= end - ring->size)
+			return;
 
-	if (!error) {
-		calldata_t cd = {0};
-		signal_handler_t *sh =
-			obs_output_get_signal_handler(stream->output);
-		signal_handler_signal(sh, "saved", &cd);
+		if (stream->keyframes >= 2)
+			purge(stream);
+		else
+			purge_front(stream);
 	}
-
-	return NULL;
 }
 
-static void replay_buffer_save(struct ffmpeg_muxer *stream)
+static bool replay_ring_push(struct ffmpeg_muxer *stream,
+			     struct encoder_packet *packet)
 {
-	const size_t size = sizeof(struct encoder_packet);
-	size_t num_packets = stream->packets.size / size;
-
-	da_reserve(stream->mux_packets, num_packets);
-
-	/* ---------------------------- */
-	/* reorder packets */
-
-	bool found_video = false;
-	bool found_audio[MAX_AUDIO_MIXES] = {0};
-	int64_t video_offset = 0;
-	int64_t video_dts_offset = 0;
-	int64_t audio_offsets[MAX_AUDIO_MIXES] = {0};
-	int64_t audio_dts_offsets[MAX_AUDIO_MIXES] = {0};
-
-	for (size_t i = 0; i < num_packets; i++) {
-		struct encoder_packet *pkt;
-		pkt = circlebuf_data(&stream->packets, i * size);
+	uint64_t pos;
 
-		if (pkt->type == OBS_ENCODER_VIDEO) {
-			if (!found_video) {
-				video_offset = pkt->dts_usec;
-				video_dts_offset = pkt->dts;
-				found_video = true;
-			}
-		} else {
-			if (!found_audio[pkt->track_idx]) {
-				found_audio[pkt->track_idx] = true;
-				audio_offsets[pkt->track_idx] = pkt->dts_usec;
-				audio_dts_offsets[pkt->track_idx] = pkt->dts;
-			}
-		}
-
-		insert_packet(&stream->mux_packets.da, pkt, video_offset,
-			      audio_offsets, video_dts_offset,
-			      audio_dts_offsets);
-	}
-
-	/* ---------------------------- */
-	/* generate filename */
-
-	obs_data_t *settings = obs_output_get_settings(stream->output);
-	const char *dir = obs_data_get_string(settings, "directory");
-	const char *fmt = obs_data_get_string(settings, "format");
-	const char *ext = obs_data_get_string(settings, "extension");
-	bool space = obs_data_get_bool(settings, "allow_spaces");
-
-	char *filename = os_generate_formatted_filename(ext, space, fmt);
-
-	dstr_copy(&stream->path, dir);
-	dstr_replace(&stream->path, "\\", "/");
-	if (dstr_end(&stream->path) != '/')
-		dstr_cat_ch(&stream->path, '/');
-	dstr_cat(&stream->path, filename);
-
-	char *slash = strrchr(stream->path.array, '/');
-	if (slash) {
-		*slash = 0;
-		os_mkdirs(stream->path.array);
-		*slash = '/';
+	if (packet->size > stream->ring->size) {
+		warn("Packet of %zu bytes does not fit in the replay buffer",
+		     packet->size);
+		return false;
 	}
 
-	bfree(filename);
-	obs_data_release(settings);
-
-	/* ---------------------------- */
+	replay_ring_purge(stream, packet->size);
 
-	os_atomic_set_bool(&stream->muxing, true);
-	stream->mux_thread_joinable = pthread_create(&stream->mux_thread, NULL,
-						     replay_buffer_mux_thread,
-						     stream) == 0;
+	pos = replay_ring_write(stream->ring, packet->data, packet->size);
+	circlebuf_push_back(&stream->ring_positions, &pos, sizeof(pos));
+	return true;
 }
 
 static void deactivate_replay_buffer(struct ffmpeg_muxer *stream, int code)
@@ -965,29 +1484,34 @@ static void replay_buffer_data(void *data, struct encoder_packet *packet)
 		}
 	}
 
-	obs_encoder_packet_ref(&pkt, packet);
-	replay_buffer_purge(stream, &pkt);
+	if (stream->ring) {
+		replay_buffer_purge(stream, packet);
+		if (!replay_ring_push(stream, packet))
+			return;
+
+		/* the index only keeps what the data is */
+		pkt = *packet;
+		pkt.data = NULL;
+	} else {
+		obs_encoder_packet_ref(&pkt, packet);
+		replay_buffer_purge(stream, &pkt);
+	}
 
 	if (!stream->packets.size)
 		stream->cur_time = pkt.dts_usec;
 	stream->cur_size += pkt.size;
 
-	circlebuf_push_back(&stream->packets, packet, sizeof(*packet));
+	circlebuf_push_back(&stream->packets, &pkt, sizeof(pkt));
 
 	if (packet->type == OBS_ENCODER_VIDEO && packet->keyframe)
 		stream->keyframes++;
 
 	if (stream->save_ts && packet->sys_dts_usec >= stream->save_ts) {
-		if (os_atomic_load_bool(&stream->muxing))
-			return;
+		replay_buffer_reap_saves(stream, false);
 
-		if (stream->mux_thread_joinable) {
-			pthread_join(stream->mux_thread, NULL);
-			stream->mux_thread_joinable = false;
-		}
-
-		stream->save_ts = 0;
 		replay_buffer_save(stream);
+		stream->save_ts = 0;
+		stream->save_request_ns = 0;
 	}
 }
 
@@ -998,6 +1522,8 @@ static void replay_buffer_defaults(obs_data_t *s)
 	obs_data_set_default_string(s, "format", "%CCYY-%MM-%DD %hh-%mm-%ss");
 	obs_data_set_default_string(s, "extension", "mp4");
 	obs_data_set_default_bool(s, "allow_spaces", true);
+	obs_data_set_default_bool(s, "disk_buffer", false);
+	ffmpeg_mux_defaults(s);
 }
 
 struct obs_output_info replay_buffer = {
@@ -10,9 +10,18 @@
 #include <util/platform.h>
 #include <util/threading.h>
 
+#include "ffmpeg-mux/ffmpeg-mux-shm.h"
+#include "obs-ffmpeg-replay-ring.h"
+
+struct replay_save;
+
 struct ffmpeg_muxer {
 	obs_output_t *output;
 	os_process_pipe_t *pipe;
+#ifdef FFM_SHM_SUPPORTED
+	/* packets go through this ring instead of the pipe when set */
+	struct ffm_shm *shm;
+#endif
 	int64_t stop_ts;
 	uint64_t total_bytes;
 	bool sent_headers;
@@ -32,8 +41,19 @@ struct ffmpeg_muxer {
 	int64_t save_ts;
 	int keyframes;
 	obs_hotkey_id hotkey;
-	volatile bool muxing;
-	DARRAY(struct encoder_packet) mux_packets;
+	uint64_t save_request_ns;
+	DARRAY(struct replay_save *) saves;
+
+	/* disk-backed replay buffer: when set, the packet data is in the
+	 * ring and the ring position of each packet is kept next to it */
+	struct replay_ring *ring;
+	struct circlebuf ring_positions;
+
+	/* results of the last save, set by the save threads */
+	pthread_mutex_t replay_mutex;
+	uint64_t last_snapshot_ns;
+	uint64_t last_first_packet_ns;
+	uint64_t last_save_ns;
 
 	/* these are accessed both by replay buffer and by HLS */
 	pthread_t mux_thread;
@@ -56,8 +76,10 @@ struct ffmpeg_muxer {
 bool stopping(struct ffmpeg_muxer *stream);
 bool active(struct ffmpeg_muxer *stream);
 void start_pipe(struct ffmpeg_muxer *stream, const char *path);
+int stop_pipe(struct ffmpeg_muxer *stream);
 bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet);
 bool send_headers(struct ffmpeg_muxer *stream);
 int deactivate(struct ffmpeg_muxer *stream, int code);
 void ffmpeg_mux_stop(void *data, uint64_t ts);
 uint64_t ffmpeg_mux_total_bytes(void *data);
+void ffmpeg_mux_defaults(obs_data_t *settings);
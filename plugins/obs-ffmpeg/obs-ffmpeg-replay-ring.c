@@ -0,0 +1,209 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "obs-ffmpeg-replay-ring.h"
+
+#include <string.h>
+#include <util/base.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#ifdef _WIN32
+static bool map_file(struct replay_ring *ring, const char *path,
+		     uint64_t size)
+{
+	wchar_t *wpath = NULL;
+	LARGE_INTEGER li;
+
+	if (!os_utf8_to_wcs_ptr(path, 0, &wpath))
+		return false;
+
+	/* the file goes away with the handle, even if we crash */
+	ring->file = CreateFileW(wpath, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+				 CREATE_ALWAYS,
+				 FILE_ATTRIBUTE_TEMPORARY |
+					 FILE_FLAG_DELETE_ON_CLOSE,
+				 NULL);
+	bfree(wpath);
+
+	if (ring->file == INVALID_HANDLE_VALUE) {
+		ring->file = NULL;
+		return false;
+	}
+
+	li.QuadPart = (LONGLONG)size;
+	if (!SetFilePointerEx(ring->file, li, NULL, FILE_BEGIN) ||
+	    !SetEndOfFile(ring->file))
+		return false;
+
+	ring->mapping = CreateFileMappingW(ring->file, NULL, PAGE_READWRITE,
+					   (DWORD)(size >> 32), (DWORD)size,
+					   NULL);
+	if (!ring->mapping)
+		return false;
+
+	ring->data = MapViewOfFile(ring->mapping, FILE_MAP_ALL_ACCESS, 0, 0,
+				   (SIZE_T)size);
+	return !!ring->data;
+}
+
+static void unmap_file(struct replay_ring *ring)
+{
+	if (ring->data)
+		UnmapViewOfFile(ring->data);
+	if (ring->mapping)
+		CloseHandle(ring->mapping);
+	if (ring->file)
+		CloseHandle(ring->file);
+}
+
+#else
+
+static bool map_file(struct replay_ring *ring, const char *path,
+		     uint64_t size)
+{
+	void *data;
+
+	ring->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (ring->fd == -1)
+		return false;
+
+	/* the mapping keeps the file alive, and this way it doesn't stay
+	 * behind if we crash */
+	unlink(path);
+
+#ifdef __linux__
+	if (posix_fallocate(ring->fd, 0, (off_t)size) != 0)
+		return false;
+#else
+	if (ftruncate(ring->fd, (off_t)size) != 0)
+		return false;
+#endif
+
+	data = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		    ring->fd, 0);
+	if (data == MAP_FAILED)
+		return false;
+
+	ring->data = data;
+	return true;
+}
+
+static void unmap_file(struct replay_ring *ring)
+{
+	if (ring->data)
+		munmap(ring->data, (size_t)ring->size);
+	if (ring->fd != -1)
+		close(ring->fd);
+}
+#endif
+
+struct replay_ring *replay_ring_create(const char *path, uint64_t size)
+{
+	struct replay_ring *ring = bzalloc(sizeof(*ring));
+#ifndef _WIN32
+	ring->fd = -1;
+#endif
+	ring->refs = 1;
+	ring->size = size;
+
+	if (!map_file(ring, path, size)) {
+		blog(LOG_WARNING,
+		     "replay_ring_create: Failed to map %llu bytes of '%s'",
+		     (unsigned long long)size, path);
+		unmap_file(ring);
+		bfree(ring);
+		return NULL;
+	}
+
+	pthread_mutex_init(&ring->mutex, NULL);
+	return ring;
+}
+
+void replay_ring_addref(struct replay_ring *ring)
+{
+	os_atomic_inc_long(&ring->refs);
+}
+
+void replay_ring_release(struct replay_ring *ring)
+{
+	if (!ring || os_atomic_dec_long(&ring->refs) != 0)
+		return;
+
+	unmap_file(ring);
+	pthread_mutex_destroy(&ring->mutex);
+	bfree(ring);
+}
+
+uint64_t replay_ring_next_pos(const struct replay_ring *ring, size_t size)
+{
+	uint64_t offset = ring->head % ring->size;
+
+	/* packets are stored in one piece, skip to the start if needed */
+	if (offset + size > ring->size)
+		return ring->head + (ring->size - offset);
+	return ring->head;
+}
+
+uint64_t replay_ring_write(struct replay_ring *ring, const void *data,
+			   size_t size)
+{
+	uint64_t pos = replay_ring_next_pos(ring, size);
+	uint64_t end = pos + size;
+
+	/* readers have to know before the data changes */
+	if (end > ring->size) {
+		pthread_mutex_lock(&ring->mutex);
+		ring->valid_pos = end - ring->size;
+		pthread_mutex_unlock(&ring->mutex);
+	}
+
+	memcpy(ring->data + pos % ring->size, data, size);
+	ring->head = end;
+	return pos;
+}
+
+static inline uint64_t get_valid_pos(struct replay_ring *ring)
+{
+	uint64_t pos;
+
+	pthread_mutex_lock(&ring->mutex);
+	pos = ring->valid_pos;
+	pthread_mutex_unlock(&ring->mutex);
+	return pos;
+}
+
+bool replay_ring_read(struct replay_ring *ring, uint64_t pos, void *data,
+		      size_t size)
+{
+	if (pos < get_valid_pos(ring))
+		return false;
+
+	memcpy(data, ring->data + pos % ring->size, size);
+
+	/* it may have been overwritten while copying */
+	return pos >= get_valid_pos(ring);
+}
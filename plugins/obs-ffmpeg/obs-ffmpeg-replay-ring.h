@@ -0,0 +1,76 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <util/c99defs.h>
+#include <util/threading.h>
+
+/*
+ * Packet data of the replay buffer, kept in a memory-mapped file instead of
+ * in memory.
+ *
+ *   The file is allocated up front and used as a ring.  Each packet is
+ * stored contiguously at an absolute position (the number of bytes written
+ * before it, counting the unused space skipped when a packet doesn't fit
+ * before the end of the file), which is what the replay buffer keeps in its
+ * index.  Writing a packet overwrites whatever was stored one ring size
+ * before it, so the caller has to drop those packets from its index first.
+ *
+ *   Packets can be read back from other threads while new ones are
+ * written.  A read fails if the packet was overwritten while it was being
+ * copied.  Replay saves keep a reference to the ring, so that it stays
+ * mapped until they're done even if the output stops.
+ */
+
+struct replay_ring {
+	volatile long refs;
+
+	uint8_t *data;
+	uint64_t size;
+
+	/* position of the next packet */
+	uint64_t head;
+
+	/* everything before this position may have been overwritten */
+	pthread_mutex_t mutex;
+	uint64_t valid_pos;
+
+#ifdef _WIN32
+	void *file;
+	void *mapping;
+#else
+	int fd;
+#endif
+};
+
+struct replay_ring *replay_ring_create(const char *path, uint64_t size);
+void replay_ring_addref(struct replay_ring *ring);
+void replay_ring_release(struct replay_ring *ring);
+
+/** Returns the position the next packet of the given size will be written
+ * at.  Packets stored before (position + size - ring size) get overwritten
+ * by it. */
+uint64_t replay_ring_next_pos(const struct replay_ring *ring, size_t size);
+
+/** Writes a packet at replay_ring_next_pos, returns its position */
+uint64_t replay_ring_write(struct replay_ring *ring, const void *data,
+			   size_t size);
+
+/** Copies a packet out, returns false if it's been overwritten */
+bool replay_ring_read(struct replay_ring *ring, uint64_t pos, void *data,
+		      size_t size);
@@ -249,6 +249,13 @@ static void get_frame(void *opaque, struct obs_source_frame *f)
 	obs_source_output_video(s->source, f);
 }
 
+static void get_shared_frame(void *opaque, struct obs_source_frame *f,
+			     obs_source_frame_release_t release, void *param)
+{
+	struct ffmpeg_source *s = opaque;
+	obs_source_output_shared_video(s->source, f, release, param);
+}
+
 static void preload_frame(void *opaque, struct obs_source_frame *f)
 {
 	struct ffmpeg_source *s = opaque;
@@ -299,6 +306,7 @@ static void ffmpeg_source_open(struct ffmpeg_source *s)
 			.v_cb = get_frame,
 			.v_preload_cb = preload_frame,
 			.v_seek_cb = seek_frame,
+			.v_shared_cb = get_shared_frame,
 			.a_cb = get_audio,
 			.stop_cb = media_stopped,
 			.path = s->input,
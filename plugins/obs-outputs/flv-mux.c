@@ -254,6 +254,35 @@ void flv_packet_mux(struct encoder_packet *packet, int32_t dts_offset,
 	*size = data.bytes.num;
 }
 
+bool flv_packet_tag_header(struct encoder_packet *packet, int32_t dts_offset,
+			   struct flv_tag_header *header, bool is_header)
+{
+	if (!packet->data || !packet->size)
+		return false;
+
+	header->time_ms = get_ms_time(packet, packet->dts) - dts_offset;
+
+	if (packet->type == OBS_ENCODER_VIDEO) {
+		int64_t offset = packet->pts - packet->dts;
+		int32_t offset_ms = get_ms_time(packet, offset);
+
+		header->type = RTMP_PACKET_TYPE_VIDEO;
+		header->prefix[0] = packet->keyframe ? 0x17 : 0x27;
+		header->prefix[1] = is_header ? 0 : 1;
+		header->prefix[2] = (uint8_t)(offset_ms >> 16);
+		header->prefix[3] = (uint8_t)(offset_ms >> 8);
+		header->prefix[4] = (uint8_t)offset_ms;
+		header->prefix_size = 5;
+	} else {
+		header->type = RTMP_PACKET_TYPE_AUDIO;
+		header->prefix[0] = 0xaf;
+		header->prefix[1] = is_header ? 0 : 1;
+		header->prefix_size = 2;
+	}
+
+	return true;
+}
+
 /* ------------------------------------------------------------------------- */
 /* stuff for additional media streams                                        */
 
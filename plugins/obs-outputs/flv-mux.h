@@ -34,6 +34,20 @@ extern void flv_additional_meta_data(obs_output_t *context, uint8_t **output,
 				     size_t *size);
 extern void flv_packet_mux(struct encoder_packet *packet, int32_t dts_offset,
 			   uint8_t **output, size_t *size, bool is_header);
+
+/* the parts of an FLV tag that come before the packet data, so that a tag
+ * can be sent without copying the packet data into it */
+struct flv_tag_header {
+	uint8_t type;
+	int32_t time_ms;
+	uint8_t prefix[5];
+	size_t prefix_size;
+};
+
+extern bool flv_packet_tag_header(struct encoder_packet *packet,
+				  int32_t dts_offset,
+				  struct flv_tag_header *header,
+				  bool is_header);
 extern void flv_additional_packet_mux(struct encoder_packet *packet,
 				      int32_t dts_offset, uint8_t **output,
 				      size_t *size, bool is_header,
@@ -164,6 +164,7 @@ static void HandleClientBW(RTMP *r, const RTMPPacket *packet);
 
 static int ReadN(RTMP *r, char *buffer, int n);
 static int WriteN(RTMP *r, const char *buffer, int n);
+static int WriteVecN(RTMP *r, RTMPIOVec *vec, int count);
 
 static void DecodeTEA(AVal *key, AVal *text);
 
@@ -1616,6 +1617,92 @@ WriteN(RTMP *r, const char *buffer, int n)
     return n == 0;
 }
 
+/* Sends the buffers of vec in order, the same way WriteN sends one buffer.
+ * vec is used as scratch space for partial sends. */
+static int
+WriteVecN(RTMP *r, RTMPIOVec *vec, int count)
+{
+    int gather = (r->Link.protocol & RTMP_FEATURE_HTTP) || r->m_sb.sb_ssl ||
+                 (r->m_bCustomSend && !r->m_customSendVecFunc);
+    int i;
+
+#ifdef CRYPTO
+    if (r->Link.rc4keyOut)
+        gather = 1;
+#endif
+
+    /* HTTP tunnels, encryption and plain custom send functions all need
+     * one contiguous buffer */
+    if (gather)
+    {
+        char buf[RTMP_BUFFER_CACHE_SIZE], *tbuf = buf, *toff;
+        int n = 0, ret;
+
+        for (i = 0; i < count; i++)
+            n += vec[i].iov_len;
+        if (n > (int)sizeof(buf))
+        {
+            tbuf = malloc(n);
+            if (!tbuf)
+                return FALSE;
+        }
+
+        toff = tbuf;
+        for (i = 0; i < count; i++)
+        {
+            memcpy(toff, vec[i].iov_base, vec[i].iov_len);
+            toff += vec[i].iov_len;
+        }
+
+        ret = WriteN(r, tbuf, n);
+        if (tbuf != buf)
+            free(tbuf);
+        return ret;
+    }
+
+    while (count > 0)
+    {
+        int nBytes;
+
+        if (r->m_bCustomSend)
+            nBytes = r->m_customSendVecFunc(&r->m_sb, vec, count, r->m_customSendParam);
+        else
+            nBytes = RTMPSockBuf_SendVec(&r->m_sb, vec, count);
+
+        if (nBytes < 0)
+        {
+            int sockerr = GetSockError();
+            RTMP_Log(RTMP_LOGERROR, "%s, RTMP send error %d (%d buffers)", __FUNCTION__,
+                     sockerr, count);
+
+            if (sockerr == EINTR && !RTMP_ctrlC)
+                continue;
+
+            r->last_error_code = sockerr;
+
+            RTMP_Close(r);
+            return FALSE;
+        }
+
+        if (nBytes == 0)
+            return FALSE;
+
+        while (count > 0 && nBytes >= vec->iov_len)
+        {
+            nBytes -= vec->iov_len;
+            vec++;
+            count--;
+        }
+        if (count > 0)
+        {
+            vec->iov_base += nBytes;
+            vec->iov_len -= nBytes;
+        }
+    }
+
+    return TRUE;
+}
+
 #define SAVC(x)	static const AVal av_##x = AVC(#x)
 
 SAVC(app);
@@ -4063,18 +4150,19 @@ RTMP_SendChunk(RTMP *r, RTMPChunk *chunk)
     return wrote;
 }
 
-int
-RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
+/* Writes the chunk header of a packet so that it ends at hend, and returns
+ * where it starts along with its size, the size of the channel id and the
+ * first header byte (needed for the headers of the following chunks) */
+static int
+EncodeChunkHeader(RTMP *r, RTMPPacket *packet, char *hend, char **pHeader,
+                  int *pHeaderSize, int *pChannelSize, char *pChunkType)
 {
     const RTMPPacket *prevPacket;
     uint32_t last = 0;
     int nSize;
     int hSize, cSize;
-    char *header, *hptr, *hend, hbuf[RTMP_MAX_HEADER_SIZE], c;
+    char *header, *hptr, c;
     uint32_t t;
-    char *buffer, *tbuf = NULL, *toff = NULL;
-    int nChunkSize;
-    int tlen;
 
     if (packet->m_nChannel >= r->m_channelsAllocatedOut)
     {
@@ -4119,16 +4207,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
     cSize = 0;
     t = packet->m_nTimeStamp - last;
 
-    if (packet->m_body)
-    {
-        header = packet->m_body - nSize;
-        hend = packet->m_body;
-    }
-    else
-    {
-        header = hbuf + 6;
-        hend = hbuf + sizeof(hbuf);
-    }
+    header = hend - nSize;
 
     if (packet->m_nChannel > 319)
         cSize = 2;
@@ -4185,6 +4264,31 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
     if (nSize > 1 && t >= 0xffffff)
         hptr = AMF_EncodeInt32(hptr, hend, t);
 
+    *pHeader = header;
+    *pHeaderSize = hSize;
+    *pChannelSize = cSize;
+    *pChunkType = c;
+    return TRUE;
+}
+
+int
+RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
+{
+    int nSize;
+    int hSize, cSize;
+    char *header, *hend, hbuf[RTMP_MAX_HEADER_SIZE], c;
+    char *buffer, *tbuf = NULL, *toff = NULL;
+    int nChunkSize;
+    int tlen;
+
+    if (packet->m_body)
+        hend = packet->m_body;
+    else
+        hend = hbuf + sizeof(hbuf);
+
+    if (!EncodeChunkHeader(r, packet, hend, &header, &hSize, &cSize, &c))
+        return FALSE;
+
     nSize = packet->m_nBodySize;
     buffer = packet->m_body;
     nChunkSize = r->m_outChunkSize;
@@ -4280,6 +4384,105 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
     return TRUE;
 }
 
+/* Like RTMP_SendPacket, but the body is given as a list of buffers (the
+ * packet's m_body is not used) and is referenced directly for every chunk
+ * instead of having the chunk headers written in between the body data */
+int
+RTMP_SendPacketVec(RTMP *r, RTMPPacket *packet, const RTMPIOVec *body, int count)
+{
+    char hbuf[RTMP_MAX_HEADER_SIZE], cbuf[RTMP_MAX_IOV][3];
+    RTMPIOVec vec[RTMP_MAX_IOV];
+    char *header, c;
+    int hSize, cSize;
+    int nSize, nChunkSize;
+    int nVec = 0, nCont = 0;
+    int seg = 0, segOffset = 0;
+
+    if (!EncodeChunkHeader(r, packet, hbuf + sizeof(hbuf), &header, &hSize, &cSize, &c))
+        return FALSE;
+
+    vec[nVec].iov_base = header;
+    vec[nVec++].iov_len = hSize;
+
+    nSize = packet->m_nBodySize;
+    nChunkSize = r->m_outChunkSize;
+
+    while (nSize > 0)
+    {
+        int chunk = nSize < nChunkSize ? nSize : nChunkSize;
+        nSize -= chunk;
+
+        while (chunk > 0)
+        {
+            int len;
+
+            if (seg >= count)
+            {
+                RTMP_Log(RTMP_LOGERROR, "%s, body is shorter than %u bytes",
+                         __FUNCTION__, packet->m_nBodySize);
+                return FALSE;
+            }
+
+            len = body[seg].iov_len - segOffset;
+            if (!len)
+            {
+                seg++;
+                segOffset = 0;
+                continue;
+            }
+            if (len > chunk)
+                len = chunk;
+
+            if (nVec == RTMP_MAX_IOV)
+            {
+                if (!WriteVecN(r, vec, nVec))
+                    return FALSE;
+                nVec = 0;
+                nCont = 0;
+            }
+
+            vec[nVec].iov_base = body[seg].iov_base + segOffset;
+            vec[nVec++].iov_len = len;
+            segOffset += len;
+            chunk -= len;
+        }
+
+        if (nSize > 0)
+        {
+            char *cont;
+
+            if (nVec == RTMP_MAX_IOV)
+            {
+                if (!WriteVecN(r, vec, nVec))
+                    return FALSE;
+                nVec = 0;
+                nCont = 0;
+            }
+
+            cont = cbuf[nCont++];
+            cont[0] = (0xc0 | c);
+            if (cSize)
+            {
+                int tmp = packet->m_nChannel - 64;
+                cont[1] = tmp & 0xff;
+                if (cSize == 2)
+                    cont[2] = tmp >> 8;
+            }
+
+            vec[nVec].iov_base = cont;
+            vec[nVec++].iov_len = 1 + cSize;
+        }
+    }
+
+    if (nVec && !WriteVecN(r, vec, nVec))
+        return FALSE;
+
+    if (!r->m_vecChannelsOut[packet->m_nChannel])
+        r->m_vecChannelsOut[packet->m_nChannel] = malloc(sizeof(RTMPPacket));
+    memcpy(r->m_vecChannelsOut[packet->m_nChannel], packet, sizeof(RTMPPacket));
+    return TRUE;
+}
+
 void
 RTMP_Close(RTMP *r)
 {
@@ -4380,6 +4583,7 @@ RTMP_Close(RTMP *r)
     memset (&r->m_bindIP, 0, sizeof(r->m_bindIP));
     r->m_bCustomSend = 0;
     r->m_customSendFunc = NULL;
+    r->m_customSendVecFunc = NULL;
     r->m_customSendParam = NULL;
 
 #if defined(CRYPTO) || defined(USE_ONLY_MD5)
@@ -4509,6 +4713,50 @@ RTMPSockBuf_Send(RTMPSockBuf *sb, const char *buf, int len)
     return rc;
 }
 
+int
+RTMPSockBuf_SendVec(RTMPSockBuf *sb, const RTMPIOVec *vec, int count)
+{
+#ifdef _WIN32
+    WSABUF bufs[RTMP_MAX_IOV];
+    DWORD sent = 0;
+#else
+    struct iovec iov[RTMP_MAX_IOV];
+    struct msghdr msg;
+#endif
+    int i;
+
+    if (count > RTMP_MAX_IOV)
+        count = RTMP_MAX_IOV;
+
+#if defined(RTMP_NETSTACK_DUMP)
+    for (i = 0; i < count; i++)
+        fwrite(vec[i].iov_base, 1, vec[i].iov_len, netstackdump);
+#endif
+
+#ifdef _WIN32
+    for (i = 0; i < count; i++)
+    {
+        bufs[i].buf = (CHAR *)vec[i].iov_base;
+        bufs[i].len = (ULONG)vec[i].iov_len;
+    }
+
+    if (WSASend(sb->sb_socket, bufs, (DWORD)count, &sent, 0, NULL, NULL) != 0)
+        return -1;
+    return (int)sent;
+#else
+    for (i = 0; i < count; i++)
+    {
+        iov[i].iov_base = (void *)vec[i].iov_base;
+        iov[i].iov_len = (size_t)vec[i].iov_len;
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+    return (int)sendmsg(sb->sb_socket, &msg, MSG_NOSIGNAL);
+#endif
+}
+
 int
 RTMPSockBuf_Close(RTMPSockBuf *sb)
 {
@@ -5369,3 +5617,38 @@ RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx)
     }
     return size+s2;
 }
+
+/* Sends one FLV tag whose body is given as a list of buffers, without
+ * building the tag in memory first */
+int
+RTMP_WriteVec(RTMP *r, int packetType, uint32_t timestamp,
+              const RTMPIOVec *body, int count, int streamIdx)
+{
+    RTMPPacket packet;
+    int size = 0, i;
+
+    for (i = 0; i < count; i++)
+        size += body[i].iov_len;
+
+    memset(&packet, 0, sizeof(packet));
+    packet.m_nChannel = 0x04;	/* source channel */
+    packet.m_nInfoField2 = r->Link.streams[streamIdx].id;
+    packet.m_packetType = packetType;
+    packet.m_nBodySize = size;
+    packet.m_nTimeStamp = timestamp;
+
+    if (((packetType == RTMP_PACKET_TYPE_AUDIO
+            || packetType == RTMP_PACKET_TYPE_VIDEO) &&
+            !timestamp) || packetType == RTMP_PACKET_TYPE_INFO)
+    {
+        packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
+    }
+    else
+    {
+        packet.m_headerType = RTMP_PACKET_SIZE_MEDIUM;
+    }
+
+    if (!RTMP_SendPacketVec(r, &packet, body, count))
+        return -1;
+    return size;
+}
@@ -273,6 +273,16 @@ extern "C"
         void *sb_ssl;
     } RTMPSockBuf;
 
+    /* one buffer of data to send, converted to the platform's iovec/WSABUF
+     * when sending */
+    typedef struct RTMPIOVec
+    {
+        const char *iov_base;
+        int iov_len;
+    } RTMPIOVec;
+
+#define RTMP_MAX_IOV 64
+
     void RTMPPacket_Reset(RTMPPacket *p);
     void RTMPPacket_Dump(RTMPPacket *p);
     int RTMPPacket_Alloc(RTMPPacket *p, uint32_t nSize);
@@ -393,6 +403,7 @@ extern "C"
     } RTMP_BINDINFO;
 
     typedef int (*CUSTOMSEND)(RTMPSockBuf*, const char *, int, void*);
+    typedef int (*CUSTOMSENDVEC)(RTMPSockBuf*, const RTMPIOVec *, int, void*);
 
     typedef struct RTMP
     {
@@ -418,6 +429,7 @@ extern "C"
         uint8_t m_bCustomSend;
         void*   m_customSendParam;
         CUSTOMSEND m_customSendFunc;
+        CUSTOMSENDVEC m_customSendVecFunc;
 
         RTMP_BINDINFO m_bindIP;
 
@@ -492,6 +504,8 @@ extern "C"
 
     int RTMP_ReadPacket(RTMP *r, RTMPPacket *packet);
     int RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue);
+    int RTMP_SendPacketVec(RTMP *r, RTMPPacket *packet,
+                           const RTMPIOVec *body, int count);
     int RTMP_SendChunk(RTMP *r, RTMPChunk *chunk);
     int RTMP_IsConnected(RTMP *r);
     SOCKET RTMP_Socket(RTMP *r);
@@ -530,6 +544,7 @@ extern "C"
 
     int RTMPSockBuf_Fill(RTMPSockBuf *sb);
     int RTMPSockBuf_Send(RTMPSockBuf *sb, const char *buf, int len);
+    int RTMPSockBuf_SendVec(RTMPSockBuf *sb, const RTMPIOVec *vec, int count);
     int RTMPSockBuf_Close(RTMPSockBuf *sb);
 
     int RTMP_SendCreateStream(RTMP *r);
@@ -539,6 +554,8 @@ extern "C"
     void RTMP_DropRequest(RTMP *r, int i, int freeit);
     int RTMP_Read(RTMP *r, char *buf, int size);
     int RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx);
+    int RTMP_WriteVec(RTMP *r, int packetType, uint32_t timestamp,
+                      const RTMPIOVec *body, int count, int streamIdx);
 
 #ifdef USE_HASHSWF
     /* hashswf.c */
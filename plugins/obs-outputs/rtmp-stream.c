@@ -398,6 +398,89 @@ retry_send:
 	return len;
 }
 
+static int socket_queue_data_vec(RTMPSockBuf *sb, const RTMPIOVec *vec,
+				 int count, void *arg)
+{
+	UNUSED_PARAMETER(sb);
+
+	struct rtmp_stream *stream = arg;
+	size_t space;
+	int queued = 0;
+
+retry_send:
+
+	if (!RTMP_IsConnected(&stream->rtmp))
+		return 0;
+
+	pthread_mutex_lock(&stream->write_buf_mutex);
+
+	space = stream->write_buf_size - stream->write_buf_len;
+	if (!space) {
+
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+
+		if (os_event_wait(stream->buffer_space_available_event)) {
+			return 0;
+		}
+
+		goto retry_send;
+	}
+
+	/* queue as much as fits, librtmp sends the rest afterwards */
+	for (int i = 0; i < count && space; i++) {
+		size_t len = (size_t)vec[i].iov_len;
+		if (len > space)
+			len = space;
+
+		memcpy(stream->write_buf + stream->write_buf_len,
+		       vec[i].iov_base, len);
+		stream->write_buf_len += len;
+		space -= len;
+		queued += (int)len;
+	}
+
+	pthread_mutex_unlock(&stream->write_buf_mutex);
+
+	os_event_signal(stream->buffer_has_data_event);
+
+	return queued;
+}
+
+/* sends a packet of the first track as an FLV tag, with the tag header in
+ * front of the packet data instead of copying both into a new buffer */
+static int send_packet_vec(struct rtmp_stream *stream,
+			   struct encoder_packet *packet, bool is_header,
+			   size_t *size)
+{
+	struct flv_tag_header header;
+	RTMPIOVec body[2];
+	uint32_t timestamp;
+
+	if (!flv_packet_tag_header(packet,
+				   is_header ? 0 : stream->start_dts_offset,
+				   &header, is_header)) {
+		*size = 0;
+		return 0;
+	}
+
+	/* FLV tag header, body, and previous tag size */
+	*size = 11 + header.prefix_size + packet->size + 4;
+
+#ifdef TEST_FRAMEDROPS
+	droptest_cap_data_rate(stream, *size);
+#endif
+
+	timestamp = (uint32_t)header.time_ms & 0xFFFFFF;
+	timestamp |= (uint32_t)((header.time_ms >> 24) & 0x7F) << 24;
+
+	body[0].iov_base = (const char *)header.prefix;
+	body[0].iov_len = (int)header.prefix_size;
+	body[1].iov_base = (const char *)packet->data;
+	body[1].iov_len = (int)packet->size;
+
+	return RTMP_WriteVec(&stream->rtmp, header.type, timestamp, body, 2, 0);
+}
+
 static int send_packet(struct rtmp_stream *stream,
 		       struct encoder_packet *packet, bool is_header,
 		       size_t idx)
@@ -427,17 +510,19 @@ static int send_packet(struct rtmp_stream *stream,
 		flv_additional_packet_mux(
 			packet, is_header ? 0 : stream->start_dts_offset, &data,
 			&size, is_header, idx);
-	} else {
-		flv_packet_mux(packet, is_header ? 0 : stream->start_dts_offset,
-			       &data, &size, is_header);
-	}
 
 #ifdef TEST_FRAMEDROPS
-	droptest_cap_data_rate(stream, size);
+		droptest_cap_data_rate(stream, size);
 #endif
 
-	ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
-	bfree(data);
+		ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
+		bfree(data);
+	} else {
+		ret = send_packet_vec(stream, packet, is_header, &size);
+	}
+
+	if (ret >= 0 && !is_header)
+		obs_output_packet_sent(stream->output, packet);
 
 	if (is_header)
 		bfree(packet->data);
@@ -875,6 +960,7 @@ static int init_send(struct rtmp_stream *stream)
 		stream->socket_thread_active = true;
 		stream->rtmp.m_bCustomSend = true;
 		stream->rtmp.m_customSendFunc = socket_queue_data;
+		stream->rtmp.m_customSendVecFunc = socket_queue_data_vec;
 		stream->rtmp.m_customSendParam = stream;
 	}
 
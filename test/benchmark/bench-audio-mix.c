@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <media-io/audio-io.h>
+#include <media-io/audio-mix.h>
+
+/*
+ * Mixes N synthetic sources into every mix/channel the same way
+ * audio_callback does for one AUDIO_OUTPUT_FRAMES tick, then clamps the
+ * mixes, and reports the average time per tick.
+ *
+ * usage: bench-audio-mix [sources] [channels] [iterations]
+ */
+
+#define BENCH_MIXES MAX_AUDIO_MIXES
+
+typedef void (*add_func_t)(float *dst, const float *src, size_t count);
+typedef void (*clamp_func_t)(float *data, size_t count);
+
+static void add_ref(float *dst, const float *src, size_t count)
+{
+	const float *end = src + count;
+
+	while (src < end)
+		*(dst++) += *(src++);
+}
+
+static void clamp_ref(float *data, size_t count)
+{
+	float *end = data + count;
+
+	while (data < end) {
+		float val = *data;
+		val = (val > 1.0f) ? 1.0f : val;
+		val = (val < -1.0f) ? -1.0f : val;
+		*(data++) = val;
+	}
+}
+
+static float *alloc_buffers(size_t count)
+{
+	float *buf = bmalloc(count * AUDIO_OUTPUT_FRAMES * sizeof(float));
+
+	for (size_t i = 0; i < count * AUDIO_OUTPUT_FRAMES; i++)
+		buf[i] = (float)((rand() % 2001) - 1000) / 2000.0f;
+	return buf;
+}
+
+static uint64_t run(add_func_t add, clamp_func_t clamp, float *mixes,
+		    const float *sources, size_t num_sources, size_t channels,
+		    int iterations)
+{
+	const size_t planes = BENCH_MIXES * channels;
+	uint64_t start = os_gettime_ns();
+
+	for (int i = 0; i < iterations; i++) {
+		memset(mixes, 0, planes * AUDIO_OUTPUT_FRAMES * sizeof(float));
+
+		for (size_t s = 0; s < num_sources; s++) {
+			const float *src =
+				sources + s * planes * AUDIO_OUTPUT_FRAMES;
+
+			for (size_t p = 0; p < planes; p++)
+				add(mixes + p * AUDIO_OUTPUT_FRAMES,
+				    src + p * AUDIO_OUTPUT_FRAMES,
+				    AUDIO_OUTPUT_FRAMES);
+		}
+
+		for (size_t p = 0; p < planes; p++)
+			clamp(mixes + p * AUDIO_OUTPUT_FRAMES,
+			      AUDIO_OUTPUT_FRAMES);
+	}
+
+	return (os_gettime_ns() - start) / (uint64_t)iterations;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t num_sources = argc > 1 ? (size_t)atoi(argv[1]) : 40;
+	size_t channels = argc > 2 ? (size_t)atoi(argv[2]) : 2;
+	int iterations = argc > 3 ? atoi(argv[3]) : 2000;
+	size_t planes;
+	float *sources;
+	float *mixes;
+	float *check;
+	size_t size;
+	uint64_t ref_ns;
+	uint64_t simd_ns;
+
+	if (!num_sources || !channels || channels > MAX_AUDIO_CHANNELS ||
+	    iterations <= 0) {
+		fprintf(stderr, "usage: %s [sources] [channels] "
+				"[iterations]\n",
+			argv[0]);
+		return 1;
+	}
+
+	planes = BENCH_MIXES * channels;
+	size = planes * AUDIO_OUTPUT_FRAMES * sizeof(float);
+	sources = alloc_buffers(num_sources * planes);
+	mixes = alloc_buffers(planes);
+	check = alloc_buffers(planes);
+
+	run(add_ref, clamp_ref, check, sources, num_sources, channels, 1);
+	run(audio_mix_add, audio_mix_clamp, mixes, sources, num_sources,
+	    channels, 1);
+	if (memcmp(check, mixes, size) != 0) {
+		fprintf(stderr, "mismatch between reference and '%s' "
+				"kernels\n",
+			audio_mix_get_impl_name());
+		return 1;
+	}
+
+	ref_ns = run(add_ref, clamp_ref, check, sources, num_sources, channels,
+		     iterations);
+	simd_ns = run(audio_mix_add, audio_mix_clamp, mixes, sources,
+		      num_sources, channels, iterations);
+
+	printf("sources: %d, mixes: %d, channels: %d, frames: %d\n",
+	       (int)num_sources, BENCH_MIXES, (int)channels,
+	       AUDIO_OUTPUT_FRAMES);
+	printf("%-8s %10llu ns/block\n", "scalar", (unsigned long long)ref_ns);
+	printf("%-8s %10llu ns/block\n", audio_mix_get_impl_name(),
+	       (unsigned long long)simd_ns);
+
+	bfree(sources);
+	bfree(mixes);
+	bfree(check);
+	return 0;
+}
@@ -0,0 +1,280 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <obs.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <util/util_uint64.h>
+
+/*
+ * Checks that rendering audio sources on the task pool gives the same mixed
+ * output as rendering them one after the other on the audio thread.
+ *
+ * A number of audio_mix sources each output a constant value at their own
+ * volume, half of them in a scene and half directly on output channels, so
+ * the mix settles on a value that doesn't depend on when each block of
+ * audio arrived.  The mix is first run with cheap sources, which libobs
+ * renders serially, and then with sources that take a while per block,
+ * which it moves to the task pool.  Both phases have to settle on exactly
+ * the same samples.
+ *
+ * usage: bench-audio-render [sources] [microseconds per source per block]
+ */
+
+#define SAMPLE_RATE 48000
+#define PHASE_MS 3000
+#define SETTLE_MS 1000
+
+struct render_source {
+	float value;
+	uint64_t next_ts;
+};
+
+static volatile long mix_cost_us = 0;
+static volatile long offthread_calls = 0;
+static volatile bool audio_thread_known = false;
+static pthread_t audio_thread;
+
+static pthread_mutex_t result_mutex;
+static bool collecting = false;
+static bool have_value = false;
+static bool mismatch = false;
+static float settled_value = 0.0f;
+static long blocks = 0;
+
+/* ------------------------------------------------------------------------- */
+
+static const char *render_source_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "bench_audio_render_source";
+}
+
+static void *render_source_create(obs_data_t *settings, obs_source_t *source)
+{
+	struct render_source *rs = bzalloc(sizeof(*rs));
+	rs->value = (float)obs_data_get_double(settings, "value");
+
+	UNUSED_PARAMETER(source);
+	return rs;
+}
+
+static void render_source_destroy(void *data)
+{
+	bfree(data);
+}
+
+static void spin_us(long us)
+{
+	uint64_t end = os_gettime_ns() + (uint64_t)us * 1000;
+
+	while (os_gettime_ns() < end)
+		;
+}
+
+static bool render_source_mix(void *data, uint64_t *ts_out,
+			      struct audio_output_data *audio_output,
+			      size_t channels, size_t sample_rate)
+{
+	struct render_source *rs = data;
+
+	if (os_atomic_load_bool(&audio_thread_known) &&
+	    !pthread_equal(pthread_self(), audio_thread))
+		os_atomic_inc_long(&offthread_calls);
+
+	spin_us(os_atomic_load_long(&mix_cost_us));
+
+	for (size_t ch = 0; ch < channels; ch++) {
+		float *out = audio_output->data[ch];
+
+		for (size_t i = 0; i < AUDIO_OUTPUT_FRAMES; i++)
+			out[i] = rs->value;
+	}
+
+	if (!rs->next_ts)
+		rs->next_ts = os_gettime_ns();
+
+	*ts_out = rs->next_ts;
+	rs->next_ts += util_mul_div64(AUDIO_OUTPUT_FRAMES, 1000000000ULL,
+				      sample_rate);
+	return true;
+}
+
+static struct obs_source_info render_source_info = {
+	.id = "bench_audio_render_source",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_AUDIO | OBS_SOURCE_THREADED_AUDIO,
+	.get_name = render_source_name,
+	.create = render_source_create,
+	.destroy = render_source_destroy,
+	.audio_mix = render_source_mix,
+};
+
+/* ------------------------------------------------------------------------- */
+
+static void receive_audio(void *param, size_t mix_idx, struct audio_data *data)
+{
+	const float *samples = (const float *)data->data[0];
+
+	if (!os_atomic_load_bool(&audio_thread_known)) {
+		audio_thread = pthread_self();
+		os_atomic_set_bool(&audio_thread_known, true);
+	}
+
+	pthread_mutex_lock(&result_mutex);
+
+	if (collecting) {
+		if (!have_value) {
+			settled_value = samples[0];
+			have_value = true;
+		}
+
+		for (uint32_t i = 0; i < data->frames; i++) {
+			if (samples[i] != settled_value) {
+				fprintf(stderr,
+					"MISMATCH: block %ld, sample %u: "
+					"%.9g != %.9g\n",
+					blocks, i, samples[i], settled_value);
+				mismatch = true;
+				break;
+			}
+		}
+
+		blocks++;
+	}
+
+	pthread_mutex_unlock(&result_mutex);
+
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(mix_idx);
+}
+
+static bool run_phase(const char *name, long cost_us, float *value)
+{
+	long calls;
+	bool success;
+
+	os_atomic_set_long(&mix_cost_us, cost_us);
+	os_sleep_ms(SETTLE_MS);
+
+	os_atomic_set_long(&offthread_calls, 0);
+
+	pthread_mutex_lock(&result_mutex);
+	collecting = true;
+	have_value = false;
+	mismatch = false;
+	blocks = 0;
+	pthread_mutex_unlock(&result_mutex);
+
+	os_sleep_ms(PHASE_MS);
+
+	pthread_mutex_lock(&result_mutex);
+	collecting = false;
+	*value = settled_value;
+	success = have_value && !mismatch;
+	printf("%-8s %4ld us/source: %ld blocks, mix value %.9g, "
+	       "%ld audio_mix calls off the audio thread\n",
+	       name, cost_us, blocks, settled_value,
+	       os_atomic_load_long(&offthread_calls));
+	pthread_mutex_unlock(&result_mutex);
+
+	/* not a failure: how much the sources cost to render also depends on
+	 * the machine and the build (sanitizers make them a lot slower) */
+	calls = os_atomic_load_long(&offthread_calls);
+	if (cost_us == 0 && calls)
+		printf("note: cheap sources were rendered off the audio "
+		       "thread\n");
+
+	return success;
+}
+
+int main(int argc, char *argv[])
+{
+	int num_sources = argc > 1 ? atoi(argv[1]) : 16;
+	long cost_us = argc > 2 ? atol(argv[2]) : 250;
+	struct obs_audio_info oai = {SAMPLE_RATE, SPEAKERS_STEREO};
+	obs_source_t **sources;
+	obs_scene_t *scene;
+	float serial_value = 0.0f;
+	float parallel_value = 0.0f;
+	float expected = 0.0f;
+	bool success = true;
+
+	if (num_sources < 2 || num_sources > MAX_CHANNELS || cost_us <= 0) {
+		fprintf(stderr, "usage: %s [sources] [us per source]\n",
+			argv[0]);
+		return 1;
+	}
+
+	pthread_mutex_init(&result_mutex, NULL);
+
+	if (!obs_startup("en-US", NULL, NULL) || !obs_reset_audio(&oai)) {
+		fprintf(stderr, "could not start libobs audio\n");
+		return 1;
+	}
+
+	obs_register_source(&render_source_info);
+
+	sources = bzalloc(sizeof(obs_source_t *) * num_sources);
+	scene = obs_scene_create_private("bench scene");
+
+	for (int i = 0; i < num_sources; i++) {
+		obs_data_t *settings = obs_data_create();
+		char name[32];
+		float volume = 0.5f + (float)i / (float)(num_sources * 2);
+		float value = 0.02f * (float)(i + 1) / (float)num_sources;
+
+		snprintf(name, sizeof(name), "source %d", i);
+		obs_data_set_double(settings, "value", value);
+		sources[i] = obs_source_create_private(
+			"bench_audio_render_source", name, settings);
+		obs_data_release(settings);
+
+		obs_source_set_volume(sources[i], volume);
+		expected += value * volume;
+
+		if (i < num_sources / 2)
+			obs_scene_add(scene, sources[i]);
+		else
+			obs_set_output_source(1 + i - num_sources / 2,
+					      sources[i]);
+	}
+
+	obs_set_output_source(0, obs_scene_get_source(scene));
+	audio_output_connect(obs_get_audio(), 0, NULL, receive_audio, NULL);
+
+	success &= run_phase("serial", 0, &serial_value);
+	success &= run_phase("parallel", cost_us, &parallel_value);
+
+	if (!os_atomic_load_long(&offthread_calls))
+		printf("note: nothing was rendered on the task pool (only "
+		       "one core?), so both phases were serial\n");
+
+	if (serial_value != parallel_value) {
+		fprintf(stderr, "MISMATCH: serial %.9g != parallel %.9g\n",
+			serial_value, parallel_value);
+		success = false;
+	}
+
+	if (fabsf(serial_value - expected) > 0.001f) {
+		fprintf(stderr, "mix value %.9g, expected about %.9g\n",
+			serial_value, expected);
+		success = false;
+	}
+
+	audio_output_disconnect(obs_get_audio(), 0, receive_audio, NULL);
+
+	for (int i = 0; i < MAX_CHANNELS; i++)
+		obs_set_output_source(i, NULL);
+	for (int i = 0; i < num_sources; i++)
+		obs_source_release(sources[i]);
+	obs_scene_release(scene);
+	bfree(sources);
+
+	obs_shutdown();
+	pthread_mutex_destroy(&result_mutex);
+
+	printf("%s\n", success ? "serial and parallel output match"
+			       : "FAILED");
+	return success ? 0 : 1;
+}
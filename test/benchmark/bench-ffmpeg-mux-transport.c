@@ -0,0 +1,372 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <ffmpeg-mux/ffmpeg-mux.h>
+#include <ffmpeg-mux/ffmpeg-mux-shm.h>
+
+/*
+ * Sends synthetic packets from obs to a forked ffmpeg-mux stand-in, once
+ * through a pipe the way os_process_pipe_write and safe_read do, and once
+ * through the shared memory ring.  The reader only hashes the packets it
+ * gets instead of muxing them, so the time and CPU spent are the cost of
+ * the transport itself.
+ *
+ * The CPU time reported is that of both processes.  Both runs must deliver
+ * exactly the same packets.
+ *
+ * usage: bench-ffmpeg-mux-transport [seconds of video] [video mbps]
+ */
+
+#define FPS 60
+#define KEYINT (FPS * 2)
+#define AUDIO_KBPS 160
+#define AUDIO_FRAMES 1024
+#define SAMPLE_RATE 48000
+#define RING_SIZE (32 * 1024 * 1024)
+
+struct packet {
+	struct ffm_packet_info info;
+	const uint8_t *data;
+};
+
+struct reader_results {
+	uint64_t packets;
+	uint64_t bytes;
+	uint64_t hash;
+};
+
+struct run_results {
+	uint64_t wall_ns;
+	uint64_t cpu_ns;
+	struct reader_results reader;
+};
+
+typedef void (*writer_func_t)(const struct packet *packets, size_t count,
+			      struct reader_results *res);
+
+static inline void hash_data(struct reader_results *res, const uint8_t *data,
+			     size_t size)
+{
+	const uint64_t prime = 0x100000001b3ULL;
+
+	while (size >= 8) {
+		uint64_t word;
+		memcpy(&word, data, 8);
+		res->hash = (res->hash ^ word) * prime;
+		data += 8;
+		size -= 8;
+	}
+
+	while (size--)
+		res->hash = (res->hash ^ *(data++)) * prime;
+}
+
+static inline void hash_packet(struct reader_results *res,
+			       const struct ffm_packet_info *info,
+			       const uint8_t *data)
+{
+	hash_data(res, (const uint8_t *)&info->pts, sizeof(info->pts));
+	hash_data(res, (const uint8_t *)&info->size, sizeof(info->size));
+	hash_data(res, data, info->size);
+	res->packets++;
+	res->bytes += info->size;
+}
+
+/* ------------------------------------------------------------------------- */
+/* synthetic stream                                                          */
+
+static struct packet *make_packets(size_t *count, uint8_t **payload,
+				   int seconds, int video_mbps)
+{
+	size_t video_count = (size_t)seconds * FPS;
+	size_t audio_count = (size_t)seconds * SAMPLE_RATE / AUDIO_FRAMES;
+	size_t frame_size = (size_t)video_mbps * 1000000 / 8 / FPS;
+	size_t audio_size = AUDIO_KBPS * 1000 / 8 * AUDIO_FRAMES / SAMPLE_RATE;
+	size_t key_size = frame_size * 4;
+	size_t payload_size = key_size > audio_size ? key_size : audio_size;
+	struct packet *packets;
+	size_t a = 0, v = 0, idx = 0;
+
+	*count = video_count + audio_count;
+	packets = bzalloc(sizeof(*packets) * *count);
+
+	*payload = bmalloc(payload_size);
+	for (size_t i = 0; i < payload_size; i++)
+		(*payload)[i] = (uint8_t)rand();
+
+	while (v < video_count || a < audio_count) {
+		int64_t v_us = (int64_t)v * 1000000 / FPS;
+		int64_t a_us = (int64_t)a * AUDIO_FRAMES * 1000000 /
+			       SAMPLE_RATE;
+		struct packet *packet = &packets[idx];
+
+		if (v < video_count && (a >= audio_count || v_us <= a_us)) {
+			packet->info.type = FFM_PACKET_VIDEO;
+			packet->info.pts = (int64_t)v;
+			packet->info.dts = (int64_t)v - 2;
+			packet->info.keyframe = v % KEYINT == 0;
+			packet->info.size = (uint32_t)(
+				packet->info.keyframe ? key_size : frame_size);
+			v++;
+		} else {
+			packet->info.type = FFM_PACKET_AUDIO;
+			packet->info.pts = (int64_t)a * AUDIO_FRAMES;
+			packet->info.dts = packet->info.pts;
+			packet->info.size = (uint32_t)audio_size;
+			a++;
+		}
+
+		/* vary the data a little between packets */
+		packet->data = *payload + idx % 61;
+		packet->info.size -= (uint32_t)(idx % 61);
+		idx++;
+	}
+
+	return packets;
+}
+
+/* ------------------------------------------------------------------------- */
+/* old version                                                               */
+
+static void read_pipe(FILE *file, struct reader_results *res)
+{
+	struct ffm_packet_info info;
+	uint8_t *buf = NULL;
+	size_t buf_size = 0;
+
+	while (fread(&info, 1, sizeof(info), file) == sizeof(info)) {
+		if (info.size > buf_size) {
+			buf_size = info.size;
+			buf = brealloc(buf, buf_size);
+		}
+
+		if (fread(buf, 1, info.size, file) != info.size)
+			break;
+
+		hash_packet(res, &info, buf);
+	}
+
+	bfree(buf);
+}
+
+static void run_pipe(const struct packet *packets, size_t count,
+		     struct reader_results *res)
+{
+	int fds[2];
+	pid_t pid;
+	FILE *file;
+
+	if (pipe(fds) != 0)
+		return;
+
+	pid = fork();
+	if (pid == 0) {
+		close(fds[1]);
+		read_pipe(fdopen(fds[0], "rb"), res);
+		_exit(0);
+	}
+
+	close(fds[0]);
+	file = fdopen(fds[1], "wb");
+
+	for (size_t i = 0; i < count; i++) {
+		const struct packet *packet = &packets[i];
+
+		if (fwrite(&packet->info, 1, sizeof(packet->info), file) !=
+			    sizeof(packet->info) ||
+		    fwrite(packet->data, 1, packet->info.size, file) !=
+			    packet->info.size) {
+			fprintf(stderr, "pipe write failed at packet %zu\n",
+				i);
+			break;
+		}
+	}
+
+	fclose(file);
+	waitpid(pid, NULL, 0);
+}
+
+/* ------------------------------------------------------------------------- */
+/* current version                                                           */
+
+static void read_shm(struct ffm_shm *shm, struct reader_results *res)
+{
+	struct ffm_packet_info info;
+	uint8_t *buf = NULL;
+	size_t buf_size = 0;
+
+	while (ffm_shm_read(shm, &info, sizeof(info)) == sizeof(info)) {
+		const uint8_t *data = ffm_shm_peek(shm, info.size);
+
+		if (data) {
+			hash_packet(res, &info, data);
+			ffm_shm_consume(shm, info.size);
+			continue;
+		}
+
+		if (info.size > buf_size) {
+			buf_size = info.size;
+			buf = brealloc(buf, buf_size);
+		}
+
+		if (ffm_shm_read(shm, buf, info.size) != info.size)
+			break;
+
+		hash_packet(res, &info, buf);
+	}
+
+	bfree(buf);
+}
+
+static void run_shm(const struct packet *packets, size_t count,
+		    struct reader_results *res)
+{
+	struct ffm_shm shm;
+	char arg[64];
+	int fds[2];
+	pid_t pid;
+
+	/* stands in for the stdin pipe of ffmpeg-mux */
+	if (pipe(fds) != 0)
+		return;
+	if (!ffm_shm_create(&shm, RING_SIZE)) {
+		fprintf(stderr, "failed to create the ring\n");
+		return;
+	}
+
+	ffm_shm_get_arg(&shm, arg, sizeof(arg));
+
+	pid = fork();
+	if (pid == 0) {
+		struct ffm_shm reader;
+
+		close(fds[1]);
+		if (ffm_shm_open(&reader, arg, fds[0]))
+			read_shm(&reader, res);
+		_exit(0);
+	}
+
+	close(fds[0]);
+	ffm_shm_started(&shm);
+
+	for (size_t i = 0; i < count; i++) {
+		const struct packet *packet = &packets[i];
+
+		if (!ffm_shm_write(&shm, &packet->info, sizeof(packet->info)) ||
+		    !ffm_shm_write(&shm, packet->data, packet->info.size)) {
+			fprintf(stderr, "ring write failed at packet %zu\n", i);
+			break;
+		}
+	}
+
+	ffm_shm_close_writer(&shm);
+	close(fds[1]);
+	waitpid(pid, NULL, 0);
+	ffm_shm_free(&shm);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static uint64_t rusage_ns(int who)
+{
+	struct rusage usage;
+	getrusage(who, &usage);
+
+	return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) *
+		       1000000000ULL +
+	       (uint64_t)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) *
+		       1000ULL;
+}
+
+static uint64_t cpu_ns(void)
+{
+	return rusage_ns(RUSAGE_SELF) + rusage_ns(RUSAGE_CHILDREN);
+}
+
+static void run(writer_func_t writer, const struct packet *packets,
+		size_t count, struct run_results *res)
+{
+	/* the reader leaves its results here before exiting */
+	struct reader_results *shared =
+		mmap(NULL, sizeof(*shared), PROT_READ | PROT_WRITE,
+		     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	uint64_t wall_start, cpu_start;
+
+	memset(shared, 0, sizeof(*shared));
+	shared->hash = 0xcbf29ce484222325ULL;
+
+	wall_start = os_gettime_ns();
+	cpu_start = cpu_ns();
+
+	writer(packets, count, shared);
+
+	res->cpu_ns = cpu_ns() - cpu_start;
+	res->wall_ns = os_gettime_ns() - wall_start;
+	res->reader = *shared;
+
+	munmap(shared, sizeof(*shared));
+}
+
+static void print_results(const char *name, const struct run_results *res)
+{
+	double seconds = (double)res->wall_ns / 1000000000.0;
+	double mbytes = (double)res->reader.bytes / 1000000.0;
+
+	printf("%-8s %12.1f %12.2f %16.2f\n", name, mbytes / seconds,
+	       (double)res->cpu_ns / 1000000.0,
+	       (double)res->cpu_ns / 1000.0 / mbytes);
+}
+
+int main(int argc, char *argv[])
+{
+	int seconds = argc > 1 ? atoi(argv[1]) : 600;
+	int video_mbps = argc > 2 ? atoi(argv[2]) : 250;
+	struct run_results ref = {0};
+	struct run_results test = {0};
+	struct packet *packets;
+	uint8_t *payload;
+	size_t count;
+	bool success = true;
+
+	if (seconds <= 0 || video_mbps <= 0) {
+		fprintf(stderr, "usage: %s [seconds of video] [video mbps]\n",
+			argv[0]);
+		return 1;
+	}
+
+	packets = make_packets(&count, &payload, seconds, video_mbps);
+
+	run(run_pipe, packets, count, &ref);
+	run(run_shm, packets, count, &test);
+
+	if (ref.reader.packets != count ||
+	    test.reader.packets != ref.reader.packets ||
+	    test.reader.bytes != ref.reader.bytes ||
+	    test.reader.hash != ref.reader.hash) {
+		fprintf(stderr,
+			"MISMATCH: %llu packets received, expected %llu\n",
+			(unsigned long long)test.reader.packets,
+			(unsigned long long)ref.reader.packets);
+		success = false;
+	}
+
+	printf("%zu packets (%d s of %d Mbps video + %d kbps audio)\n", count,
+	       seconds, video_mbps, AUDIO_KBPS);
+	printf("%-8s %12s %12s %16s\n", "version", "MB/s", "cpu ms",
+	       "cpu us/MB");
+	print_results("pipe", &ref);
+	print_results("shm", &test);
+	if (test.cpu_ns)
+		printf("cpu speedup: %.2fx\n",
+		       (double)ref.cpu_ns / (double)test.cpu_ns);
+
+	bfree(packets);
+	bfree(payload);
+	return success ? 0 : 1;
+}
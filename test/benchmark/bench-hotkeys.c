@@ -0,0 +1,463 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <util/bmem.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <obs-hotkey-map.h>
+
+/*
+ * Registers hotkeys the way sources do when a large scene collection is
+ * loaded: every source registers a mute/unmute pair plus push-to-mute and
+ * push-to-talk, the partner ids of the pair get linked up, and the saved
+ * bindings of the source are loaded.  The hotkeys are then looked up like
+ * the hotkey thread and the frontend do, and finally every source is
+ * released again.
+ *
+ * The old version (one array of hotkeys and one of pairs, linear searches
+ * by id, and fixing up the pointers held by bindings and pairs whenever an
+ * array moves) is compared with the hotkey map.
+ *
+ * usage: bench-hotkeys [hotkeys] [bound hotkeys] [lookups]
+ */
+
+#define HOTKEYS_PER_SOURCE 4
+
+struct hotkey {
+	struct hotkey_map_node node;
+	size_t id;
+	char *name;
+	char *description;
+	void *func;
+	void *data;
+	int pressed;
+	int registerer_type;
+	void *registerer;
+	size_t pair_partner_id;
+};
+
+struct hotkey_pair {
+	struct hotkey_map_node node;
+	size_t pair_id;
+	size_t id[2];
+	void *func[2];
+	bool pressed0;
+	bool pressed1;
+	void *data[2];
+};
+
+struct binding {
+	size_t hotkey_id;
+	struct hotkey *hotkey;
+};
+
+struct source {
+	size_t hotkeys[HOTKEYS_PER_SOURCE];
+	size_t pair;
+};
+
+struct results {
+	uint64_t register_ns;
+	uint64_t lookup_ns;
+	uint64_t release_ns;
+	uint64_t checksum;
+};
+
+static inline bool is_bound(size_t id, size_t bound_interval)
+{
+	return id % bound_interval == 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* old version                                                               */
+
+struct ref_hotkeys {
+	DARRAY(struct hotkey) hotkeys;
+	DARRAY(struct hotkey_pair) pairs;
+	DARRAY(struct binding) bindings;
+	size_t next_id;
+	size_t next_pair_id;
+};
+
+static bool ref_find_id(struct ref_hotkeys *hk, size_t id, size_t *idx)
+{
+	for (size_t i = 0; i < hk->hotkeys.num; i++) {
+		if (hk->hotkeys.array[i].id == id) {
+			*idx = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool ref_find_pair_id(struct ref_hotkeys *hk, size_t id, size_t *idx)
+{
+	for (size_t i = 0; i < hk->pairs.num; i++) {
+		if (hk->pairs.array[i].pair_id == id) {
+			*idx = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void ref_fixup_pointers(struct ref_hotkeys *hk)
+{
+	for (size_t i = 0; i < hk->bindings.num; i++) {
+		struct binding *binding = &hk->bindings.array[i];
+		size_t idx;
+
+		binding->hotkey = ref_find_id(hk, binding->hotkey_id, &idx)
+					  ? &hk->hotkeys.array[idx]
+					  : NULL;
+	}
+}
+
+static void ref_fixup_pair_pointers(struct ref_hotkeys *hk)
+{
+	for (size_t i = 0; i < hk->pairs.num; i++) {
+		struct hotkey_pair *pair = &hk->pairs.array[i];
+		size_t idx;
+
+		if (ref_find_id(hk, pair->id[0], &idx))
+			hk->hotkeys.array[idx].data = pair;
+		if (ref_find_id(hk, pair->id[1], &idx))
+			hk->hotkeys.array[idx].data = pair;
+	}
+}
+
+static size_t ref_register(struct ref_hotkeys *hk, void *data)
+{
+	struct hotkey *base_addr = hk->hotkeys.array;
+	struct hotkey *hotkey = da_push_back_new(hk->hotkeys);
+
+	hotkey->id = hk->next_id++;
+	hotkey->data = data;
+	hotkey->pair_partner_id = (size_t)-1;
+
+	if (base_addr != hk->hotkeys.array)
+		ref_fixup_pointers(hk);
+	return hotkey->id;
+}
+
+static size_t ref_register_pair(struct ref_hotkeys *hk, struct source *source)
+{
+	struct hotkey_pair *base_addr = hk->pairs.array;
+	struct hotkey_pair *pair = da_push_back_new(hk->pairs);
+	size_t idx;
+
+	pair->pair_id = hk->next_pair_id++;
+	pair->id[0] = ref_register(hk, pair);
+	pair->id[1] = ref_register(hk, pair);
+	source->hotkeys[0] = pair->id[0];
+	source->hotkeys[1] = pair->id[1];
+
+	if (base_addr != hk->pairs.array)
+		ref_fixup_pair_pointers(hk);
+
+	pair = &hk->pairs.array[hk->pairs.num - 1];
+	if (ref_find_id(hk, pair->id[0], &idx))
+		hk->hotkeys.array[idx].pair_partner_id = pair->id[1];
+	if (ref_find_id(hk, pair->id[1], &idx))
+		hk->hotkeys.array[idx].pair_partner_id = pair->id[0];
+
+	return pair->pair_id;
+}
+
+static void ref_remove_bindings(struct ref_hotkeys *hk, size_t id)
+{
+	for (size_t i = hk->bindings.num; i > 0; i--) {
+		if (hk->bindings.array[i - 1].hotkey_id == id)
+			da_erase(hk->bindings, i - 1);
+	}
+}
+
+static bool ref_unregister(struct ref_hotkeys *hk, size_t id)
+{
+	size_t idx;
+	if (!ref_find_id(hk, id, &idx))
+		return false;
+
+	da_erase(hk->hotkeys, idx);
+	ref_remove_bindings(hk, id);
+	return hk->hotkeys.num >= idx;
+}
+
+static void run_reference(struct source *sources, size_t num_sources,
+			  size_t bound_interval, const size_t *lookups,
+			  size_t num_lookups, struct results *res)
+{
+	struct ref_hotkeys hk = {0};
+	uint64_t start = os_gettime_ns();
+
+	for (size_t s = 0; s < num_sources; s++) {
+		struct source *source = &sources[s];
+
+		source->pair = ref_register_pair(&hk, source);
+		source->hotkeys[2] = ref_register(&hk, source);
+		source->hotkeys[3] = ref_register(&hk, source);
+
+		for (size_t i = 0; i < HOTKEYS_PER_SOURCE; i++) {
+			size_t id = source->hotkeys[i];
+			size_t idx;
+
+			if (!ref_find_id(&hk, id, &idx) ||
+			    !is_bound(id, bound_interval))
+				continue;
+
+			struct binding *binding = da_push_back_new(hk.bindings);
+			binding->hotkey_id = id;
+			binding->hotkey = &hk.hotkeys.array[idx];
+		}
+	}
+
+	res->register_ns = os_gettime_ns() - start;
+	start = os_gettime_ns();
+
+	for (size_t i = 0; i < num_lookups; i++) {
+		size_t idx;
+		if (ref_find_id(&hk, lookups[i], &idx))
+			res->checksum += hk.hotkeys.array[idx].pair_partner_id;
+	}
+
+	res->lookup_ns = os_gettime_ns() - start;
+	start = os_gettime_ns();
+
+	for (size_t s = 0; s < num_sources; s++) {
+		struct source *source = &sources[s];
+		bool need_fixup = false;
+		size_t idx;
+
+		for (size_t i = 2; i < HOTKEYS_PER_SOURCE; i++)
+			need_fixup = ref_unregister(&hk, source->hotkeys[i]) ||
+				     need_fixup;
+		if (need_fixup)
+			ref_fixup_pointers(&hk);
+
+		if (ref_find_pair_id(&hk, source->pair, &idx)) {
+			struct hotkey_pair *pair = &hk.pairs.array[idx];
+
+			need_fixup = ref_unregister(&hk, pair->id[0]);
+			need_fixup = ref_unregister(&hk, pair->id[1]) ||
+				     need_fixup;
+			if (need_fixup)
+				ref_fixup_pointers(&hk);
+
+			da_erase(hk.pairs, idx);
+			if (hk.pairs.num >= idx)
+				ref_fixup_pair_pointers(&hk);
+		}
+	}
+
+	res->release_ns = os_gettime_ns() - start;
+
+	da_free(hk.hotkeys);
+	da_free(hk.pairs);
+	da_free(hk.bindings);
+}
+
+/* ------------------------------------------------------------------------- */
+/* current version                                                           */
+
+struct map_hotkeys {
+	struct hotkey_map hotkeys;
+	struct hotkey_map pairs;
+	DARRAY(struct binding) bindings;
+	size_t next_id;
+	size_t next_pair_id;
+};
+
+static inline struct hotkey *map_find(struct map_hotkeys *hk, size_t id)
+{
+	return (struct hotkey *)hotkey_map_find(&hk->hotkeys, id);
+}
+
+static size_t map_register(struct map_hotkeys *hk, void *data)
+{
+	struct hotkey *hotkey = bzalloc(sizeof(*hotkey));
+
+	hotkey->id = hk->next_id++;
+	hotkey->node.id = hotkey->id;
+	hotkey->data = data;
+	hotkey->pair_partner_id = (size_t)-1;
+	hotkey_map_add(&hk->hotkeys, &hotkey->node);
+	return hotkey->id;
+}
+
+static size_t map_register_pair(struct map_hotkeys *hk, struct source *source)
+{
+	struct hotkey_pair *pair = bzalloc(sizeof(*pair));
+	struct hotkey *hotkey0, *hotkey1;
+
+	pair->pair_id = hk->next_pair_id++;
+	pair->node.id = pair->pair_id;
+	pair->id[0] = map_register(hk, pair);
+	pair->id[1] = map_register(hk, pair);
+	source->hotkeys[0] = pair->id[0];
+	source->hotkeys[1] = pair->id[1];
+	hotkey_map_add(&hk->pairs, &pair->node);
+
+	hotkey0 = map_find(hk, pair->id[0]);
+	hotkey1 = map_find(hk, pair->id[1]);
+	if (hotkey0)
+		hotkey0->pair_partner_id = pair->id[1];
+	if (hotkey1)
+		hotkey1->pair_partner_id = pair->id[0];
+
+	return pair->pair_id;
+}
+
+static void map_unregister(struct map_hotkeys *hk, size_t id)
+{
+	struct hotkey *hotkey = map_find(hk, id);
+	if (!hotkey)
+		return;
+
+	hotkey_map_remove(&hk->hotkeys, &hotkey->node);
+
+	for (size_t i = hk->bindings.num; i > 0; i--) {
+		if (hk->bindings.array[i - 1].hotkey_id == id)
+			da_erase(hk->bindings, i - 1);
+	}
+
+	bfree(hotkey);
+}
+
+static void run_map(struct source *sources, size_t num_sources,
+		    size_t bound_interval, const size_t *lookups,
+		    size_t num_lookups, struct results *res)
+{
+	struct map_hotkeys hk = {0};
+	uint64_t start = os_gettime_ns();
+
+	for (size_t s = 0; s < num_sources; s++) {
+		struct source *source = &sources[s];
+
+		source->pair = map_register_pair(&hk, source);
+		source->hotkeys[2] = map_register(&hk, source);
+		source->hotkeys[3] = map_register(&hk, source);
+
+		for (size_t i = 0; i < HOTKEYS_PER_SOURCE; i++) {
+			size_t id = source->hotkeys[i];
+			struct hotkey *hotkey = map_find(&hk, id);
+
+			if (!hotkey || !is_bound(id, bound_interval))
+				continue;
+
+			struct binding *binding = da_push_back_new(hk.bindings);
+			binding->hotkey_id = id;
+			binding->hotkey = hotkey;
+		}
+	}
+
+	res->register_ns = os_gettime_ns() - start;
+	start = os_gettime_ns();
+
+	for (size_t i = 0; i < num_lookups; i++) {
+		struct hotkey *hotkey = map_find(&hk, lookups[i]);
+		if (hotkey)
+			res->checksum += hotkey->pair_partner_id;
+	}
+
+	res->lookup_ns = os_gettime_ns() - start;
+	start = os_gettime_ns();
+
+	for (size_t s = 0; s < num_sources; s++) {
+		struct source *source = &sources[s];
+		struct hotkey_pair *pair;
+
+		for (size_t i = 2; i < HOTKEYS_PER_SOURCE; i++)
+			map_unregister(&hk, source->hotkeys[i]);
+
+		pair = (struct hotkey_pair *)hotkey_map_find(&hk.pairs,
+							     source->pair);
+		if (pair) {
+			map_unregister(&hk, pair->id[0]);
+			map_unregister(&hk, pair->id[1]);
+			hotkey_map_remove(&hk.pairs, &pair->node);
+			bfree(pair);
+		}
+	}
+
+	res->release_ns = os_gettime_ns() - start;
+
+	if (hk.hotkeys.num || hk.pairs.num || hk.bindings.num)
+		res->checksum = 0;
+
+	hotkey_map_free(&hk.hotkeys);
+	hotkey_map_free(&hk.pairs);
+	da_free(hk.bindings);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void print_results(const char *name, const struct results *res)
+{
+	printf("%-8s %12.2f %12.2f %12.2f\n", name,
+	       (double)res->register_ns / 1000000.0,
+	       (double)res->lookup_ns / 1000000.0,
+	       (double)res->release_ns / 1000000.0);
+}
+
+static inline uint64_t total_ns(const struct results *res)
+{
+	return res->register_ns + res->lookup_ns + res->release_ns;
+}
+
+int main(int argc, char *argv[])
+{
+	int num_hotkeys = argc > 1 ? atoi(argv[1]) : 10000;
+	int num_bound = argc > 2 ? atoi(argv[2]) : 100;
+	int num_lookups = argc > 3 ? atoi(argv[3]) : 100000;
+	struct results ref = {0};
+	struct results test = {0};
+	struct source *sources;
+	size_t *lookups;
+	size_t num_sources;
+	size_t bound_interval;
+	bool success;
+
+	if (num_hotkeys < HOTKEYS_PER_SOURCE || num_bound <= 0 ||
+	    num_bound > num_hotkeys || num_lookups < 0) {
+		fprintf(stderr,
+			"usage: %s [hotkeys] [bound hotkeys] [lookups]\n"
+			"  at least %d hotkeys, and no more bound hotkeys "
+			"than hotkeys\n",
+			argv[0], HOTKEYS_PER_SOURCE);
+		return 1;
+	}
+
+	num_sources = (size_t)num_hotkeys / HOTKEYS_PER_SOURCE;
+	num_hotkeys = (int)num_sources * HOTKEYS_PER_SOURCE;
+	bound_interval = (size_t)num_hotkeys / (size_t)num_bound;
+	sources = bzalloc(sizeof(*sources) * num_sources);
+	lookups = bmalloc(sizeof(*lookups) * ((size_t)num_lookups + 1));
+
+	for (int i = 0; i < num_lookups; i++)
+		lookups[i] = (size_t)(rand() % num_hotkeys);
+
+	run_reference(sources, num_sources, bound_interval, lookups,
+		      (size_t)num_lookups, &ref);
+	run_map(sources, num_sources, bound_interval, lookups,
+		(size_t)num_lookups, &test);
+
+	success = ref.checksum == test.checksum;
+	if (!success)
+		fprintf(stderr, "MISMATCH: checksum %llu != %llu\n",
+			(unsigned long long)test.checksum,
+			(unsigned long long)ref.checksum);
+
+	printf("%zu sources, %d hotkeys, %d bound, %d lookups\n", num_sources,
+	       num_hotkeys, num_bound, num_lookups);
+	printf("%-8s %12s %12s %12s\n", "version", "register ms", "lookup ms",
+	       "release ms");
+	print_results("linear", &ref);
+	print_results("map", &test);
+	printf("speedup: %.2fx\n", (double)total_ns(&ref) /
+					   (double)total_ns(&test));
+
+	bfree(sources);
+	bfree(lookups);
+	return success ? 0 : 1;
+}
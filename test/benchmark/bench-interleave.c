@@ -0,0 +1,279 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <util/bmem.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <obs-interleave.h>
+
+/*
+ * Feeds synthetic streams (one 60 fps video track plus several 48 kHz audio
+ * tracks) through the output interleave buffer and through the old linear
+ * insert/erase version of it, checks that both send the packets out in the
+ * same order, and reports the time each takes.
+ *
+ * The video packets arrive late by a configurable delay (like an encoder with
+ * lookahead or a deep B-frame setup), so audio piles up in the buffer while
+ * waiting for video, which is where the old version spent its time.
+ *
+ * usage: bench-interleave [seconds] [audio tracks] [video delay ms]
+ */
+
+#define VIDEO_INTERVAL_USEC 16667
+#define AUDIO_INTERVAL_USEC 21333
+#define MAX_TRACKS (MAX_AUDIO_MIXES + 1)
+
+struct arrival {
+	int64_t arrival_usec;
+	struct encoder_packet packet;
+};
+
+struct sent {
+	int64_t dts_usec;
+	enum obs_encoder_type type;
+	size_t track_idx;
+};
+
+static int compare_arrivals(const void *a, const void *b)
+{
+	const struct arrival *aa = a;
+	const struct arrival *ab = b;
+
+	if (aa->arrival_usec != ab->arrival_usec)
+		return aa->arrival_usec < ab->arrival_usec ? -1 : 1;
+	if (aa->packet.type != ab->packet.type)
+		return aa->packet.type == OBS_ENCODER_VIDEO ? -1 : 1;
+	return (int)aa->packet.track_idx - (int)ab->packet.track_idx;
+}
+
+static size_t make_streams(struct arrival **out, int seconds, size_t tracks,
+			   int64_t video_delay_usec)
+{
+	int64_t duration = (int64_t)seconds * 1000000;
+	size_t video_count = (size_t)(duration / VIDEO_INTERVAL_USEC);
+	size_t audio_count = (size_t)(duration / AUDIO_INTERVAL_USEC);
+	size_t count = video_count + audio_count * tracks;
+	struct arrival *arrivals = bzalloc(sizeof(*arrivals) * count);
+	size_t idx = 0;
+
+	for (size_t i = 0; i < video_count; i++) {
+		struct arrival *a = &arrivals[idx++];
+		a->packet.type = OBS_ENCODER_VIDEO;
+		a->packet.dts_usec = (int64_t)i * VIDEO_INTERVAL_USEC;
+		a->arrival_usec = a->packet.dts_usec + video_delay_usec;
+	}
+
+	for (size_t t = 0; t < tracks; t++) {
+		for (size_t i = 0; i < audio_count; i++) {
+			struct arrival *a = &arrivals[idx++];
+			a->packet.type = OBS_ENCODER_AUDIO;
+			a->packet.track_idx = t;
+			a->packet.dts_usec = (int64_t)i * AUDIO_INTERVAL_USEC;
+
+			/* small per-track jitter so that the tracks don't
+			 * arrive in lockstep */
+			a->arrival_usec = (int64_t)((i * 7 + t * 13) % 5);
+			a->arrival_usec *= 1000;
+			a->arrival_usec += a->packet.dts_usec;
+		}
+	}
+
+	qsort(arrivals, count, sizeof(*arrivals), compare_arrivals);
+	*out = arrivals;
+	return count;
+}
+
+/* ------------------------------------------------------------------------- */
+/* send rule: a packet can go once every other track has a later packet      */
+
+struct send_state {
+	int64_t highest[MAX_TRACKS];
+	size_t tracks;
+};
+
+static inline size_t track_of(const struct encoder_packet *packet)
+{
+	return packet->type == OBS_ENCODER_VIDEO ? 0 : packet->track_idx + 1;
+}
+
+static inline bool can_send(const struct send_state *state,
+			    const struct encoder_packet *packet)
+{
+	size_t track = track_of(packet);
+
+	for (size_t i = 0; i < state->tracks; i++) {
+		if (i != track && state->highest[i] <= packet->dts_usec)
+			return false;
+	}
+
+	return true;
+}
+
+static inline void update_highest(struct send_state *state,
+				  const struct encoder_packet *packet)
+{
+	size_t track = track_of(packet);
+
+	if (packet->dts_usec > state->highest[track])
+		state->highest[track] = packet->dts_usec;
+}
+
+static inline void record(struct sent *sent, size_t *num,
+			  const struct encoder_packet *packet)
+{
+	sent[*num].dts_usec = packet->dts_usec;
+	sent[*num].type = packet->type;
+	sent[*num].track_idx = packet->track_idx;
+	(*num)++;
+}
+
+/* ------------------------------------------------------------------------- */
+/* old version: linear scan insert, erase from the front                     */
+
+static size_t run_reference(const struct arrival *arrivals, size_t count,
+			    size_t tracks, struct sent *sent, size_t *max_depth)
+{
+	DARRAY(struct encoder_packet) packets;
+	struct send_state state = {{0}, tracks};
+	size_t num_sent = 0;
+
+	da_init(packets);
+
+	for (size_t i = 0; i < count; i++) {
+		const struct encoder_packet *out = &arrivals[i].packet;
+		size_t idx;
+
+		for (idx = 0; idx < packets.num; idx++) {
+			struct encoder_packet *cur = packets.array + idx;
+
+			if (out->dts_usec == cur->dts_usec &&
+			    out->type == OBS_ENCODER_VIDEO) {
+				break;
+			} else if (out->dts_usec < cur->dts_usec) {
+				break;
+			}
+		}
+
+		da_insert(packets, idx, out);
+		update_highest(&state, out);
+
+		if (packets.num > *max_depth)
+			*max_depth = packets.num;
+
+		while (packets.num && can_send(&state, packets.array)) {
+			record(sent, &num_sent, packets.array);
+			da_erase(packets, 0);
+		}
+	}
+
+	da_free(packets);
+	return num_sent;
+}
+
+/* ------------------------------------------------------------------------- */
+/* current version                                                           */
+
+static size_t run_interleave(const struct arrival *arrivals, size_t count,
+			     size_t tracks, struct sent *sent)
+{
+	struct interleave_buffer ib = {0};
+	struct send_state state = {{0}, tracks};
+	size_t num_sent = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		const struct encoder_packet *out = &arrivals[i].packet;
+
+		interleave_buffer_insert(&ib, out);
+		update_highest(&state, out);
+
+		while (interleave_buffer_num(&ib)) {
+			struct encoder_packet *first =
+				interleave_buffer_get(&ib, 0);
+			if (!can_send(&state, first))
+				break;
+
+			record(sent, &num_sent, first);
+			interleave_buffer_pop_front(&ib, 1);
+		}
+	}
+
+	interleave_buffer_free(&ib);
+	return num_sent;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool compare_sent(const struct sent *ref, size_t ref_num,
+			 const struct sent *test, size_t test_num)
+{
+	if (ref_num != test_num) {
+		fprintf(stderr, "MISMATCH: %zu packets sent, expected %zu\n",
+			test_num, ref_num);
+		return false;
+	}
+
+	for (size_t i = 0; i < ref_num; i++) {
+		if (ref[i].dts_usec != test[i].dts_usec ||
+		    ref[i].type != test[i].type ||
+		    ref[i].track_idx != test[i].track_idx) {
+			fprintf(stderr, "MISMATCH: packet %zu differs\n", i);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	int seconds = argc > 1 ? atoi(argv[1]) : 600;
+	int tracks = argc > 2 ? atoi(argv[2]) : 6;
+	int delay_ms = argc > 3 ? atoi(argv[3]) : 2000;
+	struct arrival *arrivals;
+	struct sent *ref_sent;
+	struct sent *test_sent;
+	size_t count, ref_num, test_num;
+	size_t max_depth = 0;
+	uint64_t ref_ns, test_ns, start;
+	bool success;
+
+	if (seconds <= 0 || tracks <= 0 || tracks > MAX_AUDIO_MIXES ||
+	    delay_ms < 0) {
+		fprintf(stderr,
+			"usage: %s [seconds] [audio tracks] [video delay ms]\n"
+			"  audio tracks must be between 1 and %d\n",
+			argv[0], MAX_AUDIO_MIXES);
+		return 1;
+	}
+
+	count = make_streams(&arrivals, seconds, (size_t)tracks,
+			     (int64_t)delay_ms * 1000);
+	ref_sent = bmalloc(sizeof(*ref_sent) * count);
+	test_sent = bmalloc(sizeof(*test_sent) * count);
+
+	start = os_gettime_ns();
+	ref_num = run_reference(arrivals, count, (size_t)tracks + 1, ref_sent,
+				&max_depth);
+	ref_ns = os_gettime_ns() - start;
+
+	start = os_gettime_ns();
+	test_num = run_interleave(arrivals, count, (size_t)tracks + 1,
+				  test_sent);
+	test_ns = os_gettime_ns() - start;
+
+	success = compare_sent(ref_sent, ref_num, test_sent, test_num);
+
+	printf("%zu packets (%d audio tracks, video %d ms late), "
+	       "up to %zu buffered\n",
+	       count, tracks, delay_ms, max_depth);
+	printf("%-12s %12s %12s\n", "version", "total ms", "ns/packet");
+	printf("%-12s %12.2f %12.1f\n", "linear", (double)ref_ns / 1000000.0,
+	       (double)ref_ns / (double)count);
+	printf("%-12s %12.2f %12.1f\n", "interleave",
+	       (double)test_ns / 1000000.0, (double)test_ns / (double)count);
+	printf("speedup: %.2fx\n", (double)ref_ns / (double)test_ns);
+
+	bfree(arrivals);
+	bfree(ref_sent);
+	bfree(test_sent);
+	return success ? 0 : 1;
+}
@@ -0,0 +1,293 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <media-playback/media.h>
+#include <media-playback/closest-format.h>
+#include <libavutil/imgutils.h>
+
+/*
+ * Decodes a media file as fast as possible, once the way the media thread
+ * used to, demuxing, decoding and scaling everything on one thread, and once
+ * through mp_media with its demux and decode threads, with timestamps
+ * ignored so that frames are output as soon as they're decoded.
+ *
+ * Both runs must output the same number of video frames.
+ *
+ * usage: bench-media-playback <file> [lookahead]
+ */
+
+struct results {
+	uint64_t video_frames;
+	uint64_t audio_frames;
+	uint64_t ns;
+};
+
+/* ------------------------------------------------------------------------- */
+/* old version                                                               */
+
+struct decoder {
+	AVCodecContext *ctx;
+	AVFrame *frame;
+	int stream;
+};
+
+struct reference {
+	AVFormatContext *fmt;
+	struct decoder v;
+	struct decoder a;
+
+	bool scale_checked;
+	struct SwsContext *swscale;
+	uint8_t *scale_pic[4];
+	int scale_linesizes[4];
+};
+
+static bool open_decoder(AVFormatContext *fmt, enum AVMediaType type,
+			 struct decoder *d)
+{
+	AVCodecParameters *par;
+	AVCodec *codec;
+	AVCodecContext *c;
+
+	d->stream = av_find_best_stream(fmt, type, -1, -1, NULL, 0);
+	if (d->stream < 0)
+		return false;
+
+	par = fmt->streams[d->stream]->codecpar;
+	codec = avcodec_find_decoder(par->codec_id);
+	if (!codec)
+		return false;
+
+	c = d->ctx = avcodec_alloc_context3(codec);
+	if (!c || avcodec_parameters_to_context(c, par) < 0)
+		return false;
+
+	/* same threading as mp_decode */
+	if (c->thread_count == 1 && c->codec_id != AV_CODEC_ID_PNG &&
+	    c->codec_id != AV_CODEC_ID_TIFF &&
+	    c->codec_id != AV_CODEC_ID_JPEG2000 &&
+	    c->codec_id != AV_CODEC_ID_MPEG4 && c->codec_id != AV_CODEC_ID_WEBP)
+		c->thread_count = 0;
+
+	if (avcodec_open2(c, codec, NULL) < 0)
+		return false;
+
+	d->frame = av_frame_alloc();
+	return !!d->frame;
+}
+
+static void close_decoder(struct decoder *d)
+{
+	av_frame_free(&d->frame);
+	avcodec_free_context(&d->ctx);
+}
+
+static void scale_frame(struct reference *r, AVFrame *f)
+{
+	if (!r->scale_checked) {
+		enum AVPixelFormat format = closest_format(f->format);
+
+		r->scale_checked = true;
+		if (format == f->format)
+			return;
+
+		r->swscale = sws_getCachedContext(NULL, f->width, f->height,
+						  f->format, f->width,
+						  f->height, format, SWS_POINT,
+						  NULL, NULL, NULL);
+		if (r->swscale &&
+		    av_image_alloc(r->scale_pic, r->scale_linesizes, f->width,
+				   f->height, format, 32) < 0) {
+			sws_freeContext(r->swscale);
+			r->swscale = NULL;
+		}
+	}
+
+	if (r->swscale)
+		sws_scale(r->swscale, (const uint8_t *const *)f->data,
+			  f->linesize, 0, f->height, r->scale_pic,
+			  r->scale_linesizes);
+}
+
+static void decode_packet(struct reference *r, struct decoder *d,
+			  AVPacket *pkt, struct results *res)
+{
+	if (avcodec_send_packet(d->ctx, pkt) < 0)
+		return;
+
+	while (avcodec_receive_frame(d->ctx, d->frame) == 0) {
+		if (d == &r->v) {
+			scale_frame(r, d->frame);
+			res->video_frames++;
+		} else {
+			res->audio_frames++;
+		}
+	}
+}
+
+static bool run_reference(const char *path, struct results *res)
+{
+	struct reference r = {0};
+	uint64_t start = os_gettime_ns();
+	bool has_video, has_audio;
+	AVPacket pkt;
+
+	if (avformat_open_input(&r.fmt, path, NULL, NULL) < 0 ||
+	    avformat_find_stream_info(r.fmt, NULL) < 0) {
+		fprintf(stderr, "failed to open '%s'\n", path);
+		return false;
+	}
+
+	has_video = open_decoder(r.fmt, AVMEDIA_TYPE_VIDEO, &r.v);
+	has_audio = open_decoder(r.fmt, AVMEDIA_TYPE_AUDIO, &r.a);
+
+	av_init_packet(&pkt);
+	while (av_read_frame(r.fmt, &pkt) >= 0) {
+		if (has_video && pkt.stream_index == r.v.stream)
+			decode_packet(&r, &r.v, &pkt, res);
+		else if (has_audio && pkt.stream_index == r.a.stream)
+			decode_packet(&r, &r.a, &pkt, res);
+		av_packet_unref(&pkt);
+	}
+
+	if (has_video)
+		decode_packet(&r, &r.v, NULL, res);
+	if (has_audio)
+		decode_packet(&r, &r.a, NULL, res);
+
+	res->ns = os_gettime_ns() - start;
+
+	close_decoder(&r.v);
+	close_decoder(&r.a);
+	sws_freeContext(r.swscale);
+	av_freep(&r.scale_pic[0]);
+	avformat_close_input(&r.fmt);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* current version                                                           */
+
+struct playback {
+	os_event_t *done;
+	struct results *res;
+	uint64_t last_frame_ns;
+};
+
+static void playback_video(void *opaque, struct obs_source_frame *frame)
+{
+	struct playback *pb = opaque;
+	pb->res->video_frames++;
+	pb->last_frame_ns = os_gettime_ns();
+}
+
+static void playback_audio(void *opaque, struct obs_source_audio *audio)
+{
+	struct playback *pb = opaque;
+	pb->res->audio_frames++;
+	pb->last_frame_ns = os_gettime_ns();
+}
+
+static void playback_stopped(void *opaque)
+{
+	struct playback *pb = opaque;
+	os_event_signal(pb->done);
+}
+
+static bool run_playback(const char *path, int lookahead,
+			 struct results *res)
+{
+	struct playback pb = {.res = res};
+	mp_media_t media;
+	uint64_t start;
+
+	struct mp_media_info info = {
+		.opaque = &pb,
+		.v_cb = playback_video,
+		.a_cb = playback_audio,
+		.stop_cb = playback_stopped,
+		.path = path,
+		.speed = 100,
+		.lookahead = lookahead,
+		.is_local_file = true,
+		.full_speed = true,
+	};
+
+	if (os_event_init(&pb.done, OS_EVENT_TYPE_MANUAL) != 0)
+		return false;
+
+	start = os_gettime_ns();
+
+	if (!mp_media_init(&media, &info)) {
+		os_event_destroy(pb.done);
+		return false;
+	}
+
+	mp_media_play(&media, false, false);
+	os_event_wait(pb.done);
+
+	/* it seeks back to the start after the last frame */
+	res->ns = pb.last_frame_ns - start;
+
+	mp_media_free(&media);
+	os_event_destroy(pb.done);
+
+	if (!pb.last_frame_ns) {
+		fprintf(stderr, "failed to play '%s'\n", path);
+		return false;
+	}
+
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void print_results(const char *name, const struct results *res)
+{
+	double seconds = (double)res->ns / 1000000000.0;
+
+	printf("%-10s %10llu %10llu %10.1f %10.1f\n", name,
+	       (unsigned long long)res->video_frames,
+	       (unsigned long long)res->audio_frames, seconds * 1000.0,
+	       (double)res->video_frames / seconds);
+}
+
+int main(int argc, char *argv[])
+{
+	int lookahead = argc > 2 ? atoi(argv[2]) : 0;
+	struct results ref = {0};
+	struct results test = {0};
+	bool success = true;
+
+	if (argc < 2 || lookahead < 0) {
+		fprintf(stderr, "usage: %s <file> [lookahead]\n", argv[0]);
+		return 1;
+	}
+
+#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(58, 9, 100)
+	av_register_all();
+	avcodec_register_all();
+#endif
+
+	if (!run_reference(argv[1], &ref) ||
+	    !run_playback(argv[1], lookahead, &test))
+		return 1;
+
+	if (test.video_frames != ref.video_frames) {
+		fprintf(stderr,
+			"MISMATCH: %llu video frames played, expected %llu\n",
+			(unsigned long long)test.video_frames,
+			(unsigned long long)ref.video_frames);
+		success = false;
+	}
+
+	printf("%-10s %10s %10s %10s %10s\n", "version", "video", "audio",
+	       "ms", "fps");
+	print_results("single", &ref);
+	print_results("pipelined", &test);
+	if (test.ns)
+		printf("speedup: %.2fx\n", (double)ref.ns / (double)test.ns);
+
+	return success ? 0 : 1;
+}
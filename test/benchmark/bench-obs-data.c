@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/bmem.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <obs-data.h>
+
+/*
+ * Builds a synthetic scene collection with N sources (each with nested
+ * settings, filters and hotkeys), then times loading it from JSON, looking
+ * up every setting the way property callbacks do, and saving it again.
+ *
+ * usage: bench-obs-data [sources] [settings per source] [iterations]
+ */
+
+static void add_settings(struct dstr *json, int source, int num_settings)
+{
+	dstr_cat(json, "{");
+	for (int i = 0; i < num_settings; i++) {
+		if (i)
+			dstr_cat(json, ",");
+
+		switch (i % 4) {
+		case 0:
+			dstr_catf(json, "\"setting_%03d\":%d", i, source + i);
+			break;
+		case 1:
+			dstr_catf(json, "\"setting_%03d\":%d.5", i, i);
+			break;
+		case 2:
+			dstr_catf(json, "\"setting_%03d\":\"value %d\"", i,
+				  source);
+			break;
+		case 3:
+			dstr_catf(json, "\"setting_%03d\":true", i);
+			break;
+		}
+	}
+	dstr_cat(json, "}");
+}
+
+static char *build_collection(int num_sources, int num_settings)
+{
+	struct dstr json = {0};
+
+	dstr_cat(&json, "{\"name\":\"bench\",\"sources\":[");
+	for (int s = 0; s < num_sources; s++) {
+		if (s)
+			dstr_cat(&json, ",");
+
+		dstr_catf(&json,
+			  "{\"name\":\"Source %d\",\"id\":\"bench_source\","
+			  "\"versioned_id\":\"bench_source\","
+			  "\"uuid\":\"%08x\",\"enabled\":true,"
+			  "\"flags\":0,\"volume\":1.0,\"balance\":0.5,"
+			  "\"muted\":false,\"mixers\":255,\"sync\":0,"
+			  "\"monitoring_type\":0,\"deinterlace_mode\":0,"
+			  "\"deinterlace_field_order\":0,"
+			  "\"push-to-talk\":false,\"push-to-mute\":false,"
+			  "\"push-to-talk-delay\":0,\"push-to-mute-delay\":0,"
+			  "\"private_settings\":{},\"settings\":",
+			  s, s);
+		add_settings(&json, s, num_settings);
+		dstr_cat(&json, ",\"filters\":[{\"name\":\"Filter\","
+				"\"id\":\"bench_filter\",\"settings\":");
+		add_settings(&json, s, num_settings / 2);
+		dstr_cat(&json, "}],\"hotkeys\":{\"libobs.mute\":[],"
+				"\"libobs.unmute\":[]}}");
+	}
+	dstr_cat(&json, "]}");
+
+	return json.array;
+}
+
+static const char *source_keys[] = {
+	"name",     "id",           "versioned_id",    "uuid",
+	"enabled",  "flags",        "volume",          "balance",
+	"muted",    "mixers",       "sync",            "monitoring_type",
+	"settings", "filters",      "hotkeys",         "private_settings",
+	"push-to-talk",             "push-to-mute",
+};
+
+#define NUM_SOURCE_KEYS (sizeof(source_keys) / sizeof(source_keys[0]))
+
+static int64_t lookup_all(obs_data_t *collection, int num_settings)
+{
+	obs_data_array_t *sources = obs_data_get_array(collection, "sources");
+	size_t count = obs_data_array_count(sources);
+	int64_t sum = 0;
+	char name[32];
+
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *source = obs_data_array_item(sources, i);
+		obs_data_t *settings = obs_data_get_obj(source, "settings");
+
+		for (size_t k = 0; k < NUM_SOURCE_KEYS; k++)
+			sum += obs_data_has_user_value(source, source_keys[k]);
+
+		for (int s = 0; s < num_settings; s++) {
+			snprintf(name, sizeof(name), "setting_%03d", s);
+			sum += obs_data_get_int(settings, name);
+		}
+
+		obs_data_set_int(settings, "setting_000", (long long)i);
+		obs_data_set_string(settings, "setting_002", "changed value");
+
+		obs_data_release(settings);
+		obs_data_release(source);
+	}
+
+	obs_data_array_release(sources);
+	return sum;
+}
+
+int main(int argc, char *argv[])
+{
+	int num_sources = argc > 1 ? atoi(argv[1]) : 1000;
+	int num_settings = argc > 2 ? atoi(argv[2]) : 40;
+	int iterations = argc > 3 ? atoi(argv[3]) : 10;
+	uint64_t load_ns = 0;
+	uint64_t lookup_ns = 0;
+	uint64_t save_ns = 0;
+	int64_t sum = 0;
+	size_t json_size = 0;
+	char *json;
+
+	if (num_sources <= 0 || num_settings <= 0 || iterations <= 0) {
+		fprintf(stderr, "usage: %s [sources] [settings per source] "
+				"[iterations]\n",
+			argv[0]);
+		return 1;
+	}
+
+	json = build_collection(num_sources, num_settings);
+
+	for (int i = 0; i < iterations; i++) {
+		uint64_t t0 = os_gettime_ns();
+		obs_data_t *collection = obs_data_create_from_json(json);
+		uint64_t t1 = os_gettime_ns();
+		sum += lookup_all(collection, num_settings);
+		uint64_t t2 = os_gettime_ns();
+		json_size = strlen(obs_data_get_json(collection));
+		uint64_t t3 = os_gettime_ns();
+
+		load_ns += t1 - t0;
+		lookup_ns += t2 - t1;
+		save_ns += t3 - t2;
+		obs_data_release(collection);
+	}
+
+	printf("sources: %d, settings per source: %d, json: %d -> %d bytes "
+	       "(checksum %lld)\n",
+	       num_sources, num_settings, (int)strlen(json), (int)json_size,
+	       (long long)sum);
+	printf("%-8s %10.3f ms\n", "load",
+	       (double)load_ns / (double)iterations / 1000000.0);
+	printf("%-8s %10.3f ms\n", "lookup",
+	       (double)lookup_ns / (double)iterations / 1000000.0);
+	printf("%-8s %10.3f ms\n", "save",
+	       (double)save_ns / (double)iterations / 1000000.0);
+
+	bfree(json);
+	return 0;
+}
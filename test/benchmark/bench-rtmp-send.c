@@ -0,0 +1,352 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <librtmp/rtmp.h>
+#include <flv-mux.h>
+
+/*
+ * Streams synthetic H.264/AAC packets over RTMP to a fake server on the
+ * loopback interface, once the old way (flv_packet_mux copies each packet
+ * into an FLV tag, RTMP_Write copies the tag into a packet and writes the
+ * chunk headers in between the data) and once with the scatter-gather path
+ * (RTMP_WriteVec sends the tag header, chunk headers and packet data
+ * straight from where they are).
+ *
+ * The connection is set up as if the RTMP handshake and publish had already
+ * happened, and the server just receives the chunk stream.  Both runs must
+ * produce exactly the same bytes on the wire.
+ *
+ * The packets are sent as fast as possible, so the video bitrate only
+ * affects the packet sizes.  The CPU time reported is that of the sending
+ * thread.
+ *
+ * usage: bench-rtmp-send [seconds of video] [video kbps] [chunk size]
+ */
+
+#define FPS 60
+#define KEYINT (FPS * 2)
+#define AUDIO_KBPS 160
+#define AUDIO_FRAMES 1024
+#define SAMPLE_RATE 48000
+
+struct sink {
+	int fd;
+	pthread_t thread;
+	uint64_t bytes;
+	uint64_t hash;
+	uint64_t word;
+};
+
+struct run_results {
+	uint64_t wall_ns;
+	uint64_t cpu_ns;
+	uint64_t bytes;
+	uint64_t hash;
+};
+
+typedef int (*send_func_t)(RTMP *rtmp, struct encoder_packet *packet);
+
+static inline void sink_hash(struct sink *sink, const uint8_t *data,
+			     size_t size)
+{
+	const uint64_t prime = 0x100000001b3ULL;
+
+	while (size && sink->bytes & 7) {
+		sink->word |= (uint64_t)*(data++) << ((sink->bytes & 7) * 8);
+		sink->bytes++;
+		size--;
+
+		if (!(sink->bytes & 7)) {
+			sink->hash = (sink->hash ^ sink->word) * prime;
+			sink->word = 0;
+		}
+	}
+
+	while (size >= 8) {
+		uint64_t word;
+		memcpy(&word, data, 8);
+		sink->hash = (sink->hash ^ word) * prime;
+		sink->bytes += 8;
+		data += 8;
+		size -= 8;
+	}
+
+	while (size--) {
+		sink->word |= (uint64_t)*(data++) << ((sink->bytes & 7) * 8);
+		sink->bytes++;
+	}
+}
+
+static void *sink_thread(void *data)
+{
+	struct sink *sink = data;
+	size_t size = 256 * 1024;
+	uint8_t *buf = bmalloc(size);
+	ssize_t ret;
+
+	while ((ret = recv(sink->fd, buf, size, 0)) > 0)
+		sink_hash(sink, buf, (size_t)ret);
+
+	/* the partial word at the end */
+	sink->hash ^= sink->word;
+
+	bfree(buf);
+	return NULL;
+}
+
+static bool open_connection(int *client_fd, struct sink *sink)
+{
+	struct sockaddr_in addr = {0};
+	socklen_t addr_len = sizeof(addr);
+	int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	int one = 1;
+
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (listen_fd < 0 ||
+	    bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+	    listen(listen_fd, 1) != 0 ||
+	    getsockname(listen_fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+		perror("listen");
+		return false;
+	}
+
+	*client_fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (*client_fd < 0 || connect(*client_fd, (struct sockaddr *)&addr,
+				      sizeof(addr)) != 0) {
+		perror("connect");
+		close(listen_fd);
+		return false;
+	}
+
+	/* like rtmp-stream with nagle disabled */
+	setsockopt(*client_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	memset(sink, 0, sizeof(*sink));
+	sink->hash = 0xcbf29ce484222325ULL;
+	sink->fd = accept(listen_fd, NULL, NULL);
+	close(listen_fd);
+
+	if (sink->fd < 0) {
+		perror("accept");
+		close(*client_fd);
+		return false;
+	}
+
+	pthread_create(&sink->thread, NULL, sink_thread, sink);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* synthetic stream                                                          */
+
+static struct encoder_packet *make_packets(size_t *count, uint8_t **payload,
+					   int seconds, int video_kbps)
+{
+	size_t video_count = (size_t)seconds * FPS;
+	size_t audio_count = (size_t)seconds * SAMPLE_RATE / AUDIO_FRAMES;
+	size_t frame_size = (size_t)video_kbps * 1000 / 8 / FPS;
+	size_t audio_size = AUDIO_KBPS * 1000 / 8 * AUDIO_FRAMES / SAMPLE_RATE;
+	size_t key_size = frame_size * 8;
+	size_t payload_size = key_size > audio_size ? key_size : audio_size;
+	struct encoder_packet *packets;
+	size_t a = 0, v = 0, idx = 0;
+
+	*count = video_count + audio_count;
+	packets = bzalloc(sizeof(*packets) * *count);
+
+	*payload = bmalloc(payload_size);
+	for (size_t i = 0; i < payload_size; i++)
+		(*payload)[i] = (uint8_t)rand();
+
+	/* interleave by dts like the output would */
+	while (v < video_count || a < audio_count) {
+		int64_t v_us = (int64_t)v * 1000000 / FPS;
+		int64_t a_us = (int64_t)a * AUDIO_FRAMES * 1000000 /
+			       SAMPLE_RATE;
+		struct encoder_packet *packet = &packets[idx++];
+
+		if (v < video_count && (a >= audio_count || v_us <= a_us)) {
+			packet->type = OBS_ENCODER_VIDEO;
+			packet->timebase_num = 1;
+			packet->timebase_den = FPS;
+			packet->dts = (int64_t)v - 2;
+			packet->pts = (int64_t)v;
+			packet->keyframe = v % KEYINT == 0;
+			packet->size = packet->keyframe ? key_size : frame_size;
+			v++;
+		} else {
+			packet->type = OBS_ENCODER_AUDIO;
+			packet->timebase_num = 1;
+			packet->timebase_den = SAMPLE_RATE;
+			packet->dts = (int64_t)a * AUDIO_FRAMES;
+			packet->pts = packet->dts;
+			packet->size = audio_size;
+			a++;
+		}
+
+		packet->data = *payload;
+	}
+
+	return packets;
+}
+
+/* ------------------------------------------------------------------------- */
+/* old version                                                               */
+
+static int send_mux(RTMP *rtmp, struct encoder_packet *packet)
+{
+	uint8_t *data;
+	size_t size;
+	int ret;
+
+	flv_packet_mux(packet, 0, &data, &size, false);
+	ret = RTMP_Write(rtmp, (char *)data, (int)size, 0);
+	bfree(data);
+	return ret;
+}
+
+/* ------------------------------------------------------------------------- */
+/* current version                                                           */
+
+static int send_vec(RTMP *rtmp, struct encoder_packet *packet)
+{
+	struct flv_tag_header header;
+	RTMPIOVec body[2];
+	uint32_t timestamp;
+
+	if (!flv_packet_tag_header(packet, 0, &header, false))
+		return 0;
+
+	timestamp = (uint32_t)header.time_ms & 0xFFFFFF;
+	timestamp |= (uint32_t)((header.time_ms >> 24) & 0x7F) << 24;
+
+	body[0].iov_base = (const char *)header.prefix;
+	body[0].iov_len = (int)header.prefix_size;
+	body[1].iov_base = (const char *)packet->data;
+	body[1].iov_len = (int)packet->size;
+
+	return RTMP_WriteVec(rtmp, header.type, timestamp, body, 2, 0);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static uint64_t thread_cpu_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static bool run(send_func_t send_func, struct encoder_packet *packets,
+		size_t count, int chunk_size, struct run_results *res)
+{
+	struct sink sink;
+	uint64_t wall_start, cpu_start;
+	RTMP rtmp;
+	int fd;
+
+	if (!open_connection(&fd, &sink))
+		return false;
+
+	RTMP_Init(&rtmp);
+	rtmp.m_sb.sb_socket = fd;
+	rtmp.m_outChunkSize = chunk_size;
+	rtmp.Link.streams[0].id = 1;
+	rtmp.Link.nStreams = 1;
+
+	wall_start = os_gettime_ns();
+	cpu_start = thread_cpu_ns();
+
+	for (size_t i = 0; i < count; i++) {
+		if (send_func(&rtmp, &packets[i]) < 0) {
+			fprintf(stderr, "send failed at packet %zu\n", i);
+			break;
+		}
+	}
+
+	shutdown(fd, SHUT_WR);
+	res->cpu_ns = thread_cpu_ns() - cpu_start;
+
+	pthread_join(sink.thread, NULL);
+	res->wall_ns = os_gettime_ns() - wall_start;
+	res->bytes = sink.bytes;
+	res->hash = sink.hash;
+
+	close(sink.fd);
+	close(fd);
+	free(rtmp.m_vecChannelsOut[4]);
+	free(rtmp.m_vecChannelsOut);
+	return true;
+}
+
+static void print_results(const char *name, const struct run_results *res)
+{
+	double seconds = (double)res->wall_ns / 1000000000.0;
+	double mbits = (double)res->bytes * 8.0 / 1000000.0;
+
+	printf("%-8s %12.1f %12.2f %16.2f\n", name,
+	       (double)res->bytes / seconds / 1000000.0,
+	       (double)res->cpu_ns / 1000000.0,
+	       (double)res->cpu_ns / 1000.0 / mbits);
+}
+
+int main(int argc, char *argv[])
+{
+	int seconds = argc > 1 ? atoi(argv[1]) : 600;
+	int video_kbps = argc > 2 ? atoi(argv[2]) : 6000;
+	int chunk_size = argc > 3 ? atoi(argv[3]) : 4096;
+	struct run_results ref = {0};
+	struct run_results test = {0};
+	struct encoder_packet *packets;
+	uint8_t *payload;
+	size_t count;
+	bool success;
+
+	if (seconds <= 0 || video_kbps <= 0 || chunk_size < 128) {
+		fprintf(stderr,
+			"usage: %s [seconds of video] [video kbps] "
+			"[chunk size]\n"
+			"  chunk size must be at least 128\n",
+			argv[0]);
+		return 1;
+	}
+
+	packets = make_packets(&count, &payload, seconds, video_kbps);
+
+	success = run(send_mux, packets, count, chunk_size, &ref) &&
+		  run(send_vec, packets, count, chunk_size, &test);
+
+	if (success && (ref.bytes != test.bytes || ref.hash != test.hash)) {
+		fprintf(stderr,
+			"MISMATCH: %llu bytes received, expected %llu\n",
+			(unsigned long long)test.bytes,
+			(unsigned long long)ref.bytes);
+		success = false;
+	}
+
+	printf("%zu packets (%d s of %d kbps video + %d kbps audio), "
+	       "chunk size %d\n",
+	       count, seconds, video_kbps, AUDIO_KBPS, chunk_size);
+	printf("%-8s %12s %12s %16s\n", "version", "MB/s", "cpu ms",
+	       "cpu us/Mbit");
+	print_results("mux", &ref);
+	print_results("iovec", &test);
+	if (test.cpu_ns)
+		printf("cpu speedup: %.2fx\n",
+		       (double)ref.cpu_ns / (double)test.cpu_ns);
+
+	bfree(packets);
+	bfree(payload);
+	return success ? 0 : 1;
+}
@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <media-io/audio-io.h>
+#include <media-io/audio-mix.h>
+
+/*
+ * Mixes a chain of nested scenes the way scene_audio_render does for one
+ * AUDIO_OUTPUT_FRAMES block: every scene has a number of audio sources plus
+ * the scene below it, and each scene's output is mixed into its parent.
+ *
+ * Some of the items have show/hide actions pending in the block: one in
+ * eight is shown partway through (a real volume ramp), one in eight has an
+ * action at the very start of the block (the volume doesn't change within
+ * it), and one in eight is hidden.
+ *
+ * The old scalar version, which builds the ramp buffer for every item with
+ * a pending action, is compared with the current one, which only uses the
+ * ramp buffer when the volume changes within the block and mixes with the
+ * SIMD kernels.
+ *
+ * usage: bench-scene-audio [depth] [items per scene] [iterations]
+ */
+
+#define BENCH_MIXES MAX_AUDIO_MIXES
+#define BENCH_CHANNELS 2
+#define PLANES (BENCH_MIXES * BENCH_CHANNELS)
+#define PLANE_SIZE (AUDIO_OUTPUT_FRAMES * sizeof(float))
+
+struct item {
+	const float *audio;
+	bool visible;
+
+	/* frame of the pending show/hide action, AUDIO_OUTPUT_FRAMES if none */
+	size_t action_frame;
+	bool action_visible;
+};
+
+struct scene {
+	struct item *items;
+	size_t num_items;
+	float *output;
+};
+
+typedef void (*render_func_t)(struct scene *scene);
+
+static float *alloc_planes(size_t count)
+{
+	float *buf = bmalloc(count * PLANES * PLANE_SIZE);
+
+	for (size_t i = 0; i < count * PLANES * AUDIO_OUTPUT_FRAMES; i++)
+		buf[i] = (float)((rand() % 2001) - 1000) / 20000.0f;
+	return buf;
+}
+
+static void fill_ramp(float *buf, const struct item *item)
+{
+	for (size_t i = 0; i < AUDIO_OUTPUT_FRAMES; i++) {
+		bool visible = i < item->action_frame ? item->visible
+						      : item->action_visible;
+		buf[i] = visible ? 1.0f : 0.0f;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* old version                                                               */
+
+static void mix_audio_with_buf_ref(float *out, const float *in,
+				   const float *buf, size_t count)
+{
+	const float *end = in + count;
+
+	while (in < end)
+		*(out++) += *(in++) * *(buf++);
+}
+
+static void mix_audio_ref(float *out, const float *in, size_t count)
+{
+	const float *end = in + count;
+
+	while (in < end)
+		*(out++) += *(in++);
+}
+
+static void render_ref(struct scene *scene)
+{
+	float buf[AUDIO_OUTPUT_FRAMES];
+
+	memset(scene->output, 0, PLANES * PLANE_SIZE);
+
+	for (size_t i = 0; i < scene->num_items; i++) {
+		const struct item *item = &scene->items[i];
+		bool apply_buf = item->action_frame < AUDIO_OUTPUT_FRAMES;
+
+		if (apply_buf)
+			fill_ramp(buf, item);
+		else if (!item->visible)
+			continue;
+
+		for (size_t p = 0; p < PLANES; p++) {
+			float *out = scene->output + p * AUDIO_OUTPUT_FRAMES;
+			const float *in = item->audio + p * AUDIO_OUTPUT_FRAMES;
+
+			if (apply_buf)
+				mix_audio_with_buf_ref(out, in, buf,
+						       AUDIO_OUTPUT_FRAMES);
+			else
+				mix_audio_ref(out, in, AUDIO_OUTPUT_FRAMES);
+		}
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* current version                                                           */
+
+static void render_simd(struct scene *scene)
+{
+	float buf[AUDIO_OUTPUT_FRAMES];
+
+	memset(scene->output, 0, PLANES * PLANE_SIZE);
+
+	for (size_t i = 0; i < scene->num_items; i++) {
+		const struct item *item = &scene->items[i];
+		bool pending = item->action_frame < AUDIO_OUTPUT_FRAMES;
+		bool ramp = pending && item->action_frame > 0 &&
+			    item->visible != item->action_visible;
+		bool visible = pending ? item->action_visible : item->visible;
+
+		if (ramp)
+			fill_ramp(buf, item);
+		else if (!visible)
+			continue;
+
+		for (size_t p = 0; p < PLANES; p++) {
+			float *out = scene->output + p * AUDIO_OUTPUT_FRAMES;
+			const float *in = item->audio + p * AUDIO_OUTPUT_FRAMES;
+
+			if (ramp)
+				audio_mix_add_mul(out, in, buf,
+						  AUDIO_OUTPUT_FRAMES);
+			else
+				audio_mix_add(out, in, AUDIO_OUTPUT_FRAMES);
+		}
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* scene 0 is the innermost one, every other scene has the one below it as
+ * its first item */
+static struct scene *make_scenes(size_t depth, size_t items,
+				 const float *sources)
+{
+	struct scene *scenes = bzalloc(sizeof(*scenes) * depth);
+	size_t source_idx = 0;
+
+	for (size_t d = 0; d < depth; d++) {
+		struct scene *scene = &scenes[d];
+		size_t first = d ? 1 : 0;
+
+		scene->num_items = items + first;
+		scene->items = bzalloc(sizeof(struct item) * scene->num_items);
+		scene->output = bmalloc(PLANES * PLANE_SIZE);
+
+		if (d) {
+			scene->items[0].audio = scenes[d - 1].output;
+			scene->items[0].visible = true;
+			scene->items[0].action_frame = AUDIO_OUTPUT_FRAMES;
+		}
+
+		for (size_t i = first; i < scene->num_items; i++) {
+			struct item *item = &scene->items[i];
+
+			item->audio = sources + source_idx++ * PLANES *
+							AUDIO_OUTPUT_FRAMES;
+			item->visible = true;
+			item->action_frame = AUDIO_OUTPUT_FRAMES;
+
+			switch (i % 8) {
+			case 0:
+				item->visible = false;
+				item->action_visible = true;
+				item->action_frame = AUDIO_OUTPUT_FRAMES / 3;
+				break;
+			case 1:
+				item->action_visible = true;
+				item->action_frame = 0;
+				break;
+			case 2:
+				item->visible = false;
+				break;
+			}
+		}
+	}
+
+	return scenes;
+}
+
+static void free_scenes(struct scene *scenes, size_t depth)
+{
+	for (size_t d = 0; d < depth; d++) {
+		bfree(scenes[d].items);
+		bfree(scenes[d].output);
+	}
+	bfree(scenes);
+}
+
+static uint64_t run(render_func_t render, struct scene *scenes, size_t depth,
+		    int iterations)
+{
+	uint64_t start = os_gettime_ns();
+
+	for (int i = 0; i < iterations; i++) {
+		for (size_t d = 0; d < depth; d++)
+			render(&scenes[d]);
+	}
+
+	return (os_gettime_ns() - start) / (uint64_t)iterations;
+}
+
+static bool compare_output(const float *ref, const float *test)
+{
+	for (size_t i = 0; i < PLANES * AUDIO_OUTPUT_FRAMES; i++) {
+		if (ref[i] != test[i]) {
+			fprintf(stderr, "MISMATCH: sample %zu: %f != %f\n", i,
+				test[i], ref[i]);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	int depth = argc > 1 ? atoi(argv[1]) : 4;
+	int items = argc > 2 ? atoi(argv[2]) : 16;
+	int iterations = argc > 3 ? atoi(argv[3]) : 2000;
+	struct scene *ref_scenes;
+	struct scene *test_scenes;
+	float *sources;
+	uint64_t ref_ns, test_ns;
+	bool success;
+
+	if (depth <= 0 || items <= 0 || iterations <= 0) {
+		fprintf(stderr,
+			"usage: %s [depth] [items per scene] [iterations]\n",
+			argv[0]);
+		return 1;
+	}
+
+	sources = alloc_planes((size_t)depth * (size_t)items);
+	ref_scenes = make_scenes((size_t)depth, (size_t)items, sources);
+	test_scenes = make_scenes((size_t)depth, (size_t)items, sources);
+
+	run(render_ref, ref_scenes, (size_t)depth, 1);
+	run(render_simd, test_scenes, (size_t)depth, 1);
+	success = compare_output(ref_scenes[depth - 1].output,
+				 test_scenes[depth - 1].output);
+
+	ref_ns = run(render_ref, ref_scenes, (size_t)depth, iterations);
+	test_ns = run(render_simd, test_scenes, (size_t)depth, iterations);
+
+	printf("scenes: %d deep, %d sources each, mixes: %d, channels: %d\n",
+	       depth, items, BENCH_MIXES, BENCH_CHANNELS);
+	printf("%-8s %10llu ns/block\n", "scalar", (unsigned long long)ref_ns);
+	printf("%-8s %10llu ns/block\n", audio_mix_get_impl_name(),
+	       (unsigned long long)test_ns);
+	printf("speedup: %.2fx\n", (double)ref_ns / (double)test_ns);
+
+	free_scenes(ref_scenes, (size_t)depth);
+	free_scenes(test_scenes, (size_t)depth);
+	bfree(sources);
+	return success ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <obs-hotkey-map.h>
+
+#define NODE_COUNT (HOTKEY_MAP_MIN_TABLE_SIZE * 4 + 1)
+
+static void check_order(struct hotkey_map *map, const size_t *ids, size_t num)
+{
+	struct hotkey_map_node *node = map->first;
+
+	assert_int_equal(map->num, num);
+
+	for (size_t i = 0; i < num; i++) {
+		assert_non_null(node);
+		assert_int_equal(node->id, ids[i]);
+		assert_ptr_equal(node->prev,
+				 i ? hotkey_map_find(map, ids[i - 1]) : NULL);
+		node = node->next;
+	}
+
+	assert_null(node);
+	assert_ptr_equal(map->last, num ? hotkey_map_find(map, ids[num - 1])
+					: NULL);
+}
+
+static void hotkey_map_add_find_test(void **state)
+{
+	struct hotkey_map map = {0};
+	struct hotkey_map_node nodes[NODE_COUNT] = {0};
+	size_t ids[NODE_COUNT];
+
+	assert_null(hotkey_map_find(&map, 0));
+
+	/* enough to make the table grow a few times */
+	for (size_t i = 0; i < NODE_COUNT; i++) {
+		nodes[i].id = ids[i] = i;
+		hotkey_map_add(&map, &nodes[i]);
+	}
+
+	assert_true(map.table_size >= map.num);
+
+	for (size_t i = 0; i < NODE_COUNT; i++)
+		assert_ptr_equal(hotkey_map_find(&map, i), &nodes[i]);
+	assert_null(hotkey_map_find(&map, NODE_COUNT));
+	assert_null(hotkey_map_find(&map, NODE_COUNT + map.table_size));
+
+	check_order(&map, ids, NODE_COUNT);
+
+	hotkey_map_free(&map);
+	assert_null(map.first);
+	assert_null(hotkey_map_find(&map, 0));
+}
+
+static void hotkey_map_remove_test(void **state)
+{
+	struct hotkey_map map = {0};
+	struct hotkey_map_node nodes[NODE_COUNT] = {0};
+	size_t ids[NODE_COUNT];
+	size_t num = 0;
+
+	for (size_t i = 0; i < NODE_COUNT; i++) {
+		nodes[i].id = i;
+		hotkey_map_add(&map, &nodes[i]);
+	}
+
+	/* the first, the last, and every third one in between */
+	for (size_t i = 0; i < NODE_COUNT; i++) {
+		if (i == 0 || i == NODE_COUNT - 1 || i % 3 == 0)
+			hotkey_map_remove(&map, &nodes[i]);
+		else
+			ids[num++] = i;
+	}
+
+	for (size_t i = 0; i < NODE_COUNT; i++) {
+		bool removed = i == 0 || i == NODE_COUNT - 1 || i % 3 == 0;
+		assert_ptr_equal(hotkey_map_find(&map, i),
+				 removed ? NULL : &nodes[i]);
+	}
+
+	check_order(&map, ids, num);
+
+	/* removed nodes can be added again, at the end */
+	hotkey_map_add(&map, &nodes[0]);
+	ids[num++] = 0;
+	assert_ptr_equal(hotkey_map_find(&map, 0), &nodes[0]);
+	check_order(&map, ids, num);
+
+	for (size_t i = 0; i < num; i++)
+		hotkey_map_remove(&map, hotkey_map_find(&map, ids[i]));
+
+	assert_int_equal(map.num, 0);
+	assert_null(map.first);
+	assert_null(map.last);
+	assert_null(hotkey_map_find(&map, 1));
+
+	hotkey_map_free(&map);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(hotkey_map_add_find_test),
+		cmocka_unit_test(hotkey_map_remove_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,137 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <obs-interleave.h>
+
+static void insert_packet(struct interleave_buffer *ib,
+			  enum obs_encoder_type type, int64_t dts_usec,
+			  size_t track_idx)
+{
+	struct encoder_packet pkt = {0};
+
+	pkt.type = type;
+	pkt.dts_usec = dts_usec;
+	pkt.track_idx = track_idx;
+	interleave_buffer_insert(ib, &pkt);
+}
+
+static void interleave_order_test(void **state)
+{
+	struct interleave_buffer ib = {0};
+	const int64_t expected[] = {0, 10, 20, 30, 40, 50};
+
+	insert_packet(&ib, OBS_ENCODER_VIDEO, 20, 0);
+	insert_packet(&ib, OBS_ENCODER_AUDIO, 0, 0);
+	insert_packet(&ib, OBS_ENCODER_VIDEO, 50, 0);
+	insert_packet(&ib, OBS_ENCODER_AUDIO, 10, 0);
+	insert_packet(&ib, OBS_ENCODER_AUDIO, 40, 0);
+	insert_packet(&ib, OBS_ENCODER_VIDEO, 30, 0);
+
+	assert_int_equal(interleave_buffer_num(&ib), 6);
+	for (size_t i = 0; i < 6; i++)
+		assert_int_equal(interleave_buffer_get(&ib, i)->dts_usec,
+				 expected[i]);
+
+	interleave_buffer_free(&ib);
+}
+
+static void interleave_ties_test(void **state)
+{
+	struct interleave_buffer ib = {0};
+
+	/* audio with the same timestamp stays in the order it came in */
+	insert_packet(&ib, OBS_ENCODER_AUDIO, 100, 0);
+	insert_packet(&ib, OBS_ENCODER_AUDIO, 100, 1);
+
+	/* video goes in front of everything with the same timestamp */
+	insert_packet(&ib, OBS_ENCODER_VIDEO, 100, 0);
+	insert_packet(&ib, OBS_ENCODER_AUDIO, 100, 2);
+
+	assert_int_equal(interleave_buffer_num(&ib), 4);
+	assert_int_equal(interleave_buffer_get(&ib, 0)->type,
+			 OBS_ENCODER_VIDEO);
+	for (size_t i = 1; i < 4; i++) {
+		struct encoder_packet *pkt = interleave_buffer_get(&ib, i);
+		assert_int_equal(pkt->type, OBS_ENCODER_AUDIO);
+		assert_int_equal(pkt->track_idx, i - 1);
+	}
+
+	interleave_buffer_free(&ib);
+}
+
+static void interleave_pop_front_test(void **state)
+{
+	struct interleave_buffer ib = {0};
+	const size_t count = INTERLEAVE_BUFFER_MIN_COMPACT * 4;
+
+	for (size_t i = 0; i < count; i++)
+		insert_packet(&ib, OBS_ENCODER_VIDEO, (int64_t)i, 0);
+
+	/* taking packets off the front doesn't change the order of the rest,
+	 * whether or not the array gets compacted */
+	for (size_t i = 0; i < count - 1; i++) {
+		interleave_buffer_pop_front(&ib, 1);
+		assert_int_equal(interleave_buffer_num(&ib), count - i - 1);
+		assert_int_equal(interleave_buffer_get(&ib, 0)->dts_usec,
+				 i + 1);
+		assert_true(ib.first < INTERLEAVE_BUFFER_MIN_COMPACT ||
+			    ib.first * 2 < ib.packets.num);
+	}
+
+	/* packets inserted after that still go in the right place */
+	insert_packet(&ib, OBS_ENCODER_AUDIO, 0, 0);
+	assert_int_equal(interleave_buffer_num(&ib), 2);
+	assert_int_equal(interleave_buffer_get(&ib, 0)->dts_usec, 0);
+	assert_int_equal(interleave_buffer_get(&ib, 1)->dts_usec, count - 1);
+
+	interleave_buffer_pop_front(&ib, 2);
+	assert_int_equal(interleave_buffer_num(&ib), 0);
+	assert_int_equal(ib.first, 0);
+
+	interleave_buffer_free(&ib);
+}
+
+static void interleave_resort_test(void **state)
+{
+	struct interleave_buffer ib = {0};
+
+	insert_packet(&ib, OBS_ENCODER_AUDIO, 0, 0);
+	insert_packet(&ib, OBS_ENCODER_VIDEO, 10, 0);
+	insert_packet(&ib, OBS_ENCODER_AUDIO, 20, 0);
+	insert_packet(&ib, OBS_ENCODER_VIDEO, 30, 0);
+	interleave_buffer_pop_front(&ib, 1);
+
+	/* shift the video back, past the audio packet in between */
+	for (size_t i = 0; i < interleave_buffer_num(&ib); i++) {
+		struct encoder_packet *pkt = interleave_buffer_get(&ib, i);
+		if (pkt->type == OBS_ENCODER_VIDEO)
+			pkt->dts_usec -= 10;
+	}
+
+	interleave_buffer_resort(&ib);
+
+	assert_int_equal(ib.first, 0);
+	assert_int_equal(interleave_buffer_num(&ib), 3);
+	assert_int_equal(interleave_buffer_get(&ib, 0)->dts_usec, 0);
+	assert_int_equal(interleave_buffer_get(&ib, 1)->type,
+			 OBS_ENCODER_VIDEO);
+	assert_int_equal(interleave_buffer_get(&ib, 1)->dts_usec, 20);
+	assert_int_equal(interleave_buffer_get(&ib, 2)->type,
+			 OBS_ENCODER_AUDIO);
+
+	interleave_buffer_free(&ib);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(interleave_order_test),
+		cmocka_unit_test(interleave_ties_test),
+		cmocka_unit_test(interleave_pop_front_test),
+		cmocka_unit_test(interleave_resort_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
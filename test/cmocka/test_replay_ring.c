@@ -0,0 +1,120 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <obs-ffmpeg-replay-ring.h>
+
+#define RING_SIZE 64
+#define PACKET_SIZE 20
+
+static struct replay_ring *create_ring(void)
+{
+	struct replay_ring *ring =
+		replay_ring_create("test_replay_ring.tmp", RING_SIZE);
+
+	assert_non_null(ring);
+	return ring;
+}
+
+static void fill_packet(uint8_t *data, uint8_t val)
+{
+	memset(data, val, PACKET_SIZE);
+}
+
+static void replay_ring_basic_test(void **state)
+{
+	struct replay_ring *ring = create_ring();
+	uint8_t in[PACKET_SIZE];
+	uint8_t out[PACKET_SIZE];
+
+	for (uint8_t i = 0; i < 3; i++) {
+		fill_packet(in, i + 1);
+		assert_int_equal(replay_ring_next_pos(ring, PACKET_SIZE),
+				 i * PACKET_SIZE);
+		assert_int_equal(replay_ring_write(ring, in, PACKET_SIZE),
+				 i * PACKET_SIZE);
+	}
+
+	for (uint8_t i = 0; i < 3; i++) {
+		fill_packet(in, i + 1);
+		assert_true(replay_ring_read(ring, i * PACKET_SIZE, out,
+					     PACKET_SIZE));
+		assert_memory_equal(in, out, PACKET_SIZE);
+	}
+
+	replay_ring_release(ring);
+}
+
+static void replay_ring_wrap_test(void **state)
+{
+	struct replay_ring *ring = create_ring();
+	uint8_t in[PACKET_SIZE];
+	uint8_t out[PACKET_SIZE];
+	uint64_t pos;
+
+	for (uint8_t i = 0; i < 3; i++) {
+		fill_packet(in, i + 1);
+		replay_ring_write(ring, in, PACKET_SIZE);
+	}
+
+	/* 60 bytes are used, so the next packet doesn't fit before the end
+	 * and is stored at the start of the ring, one ring size on */
+	assert_int_equal(replay_ring_next_pos(ring, PACKET_SIZE), RING_SIZE);
+
+	fill_packet(in, 4);
+	pos = replay_ring_write(ring, in, PACKET_SIZE);
+	assert_int_equal(pos, RING_SIZE);
+	assert_true(replay_ring_read(ring, pos, out, PACKET_SIZE));
+	assert_memory_equal(in, out, PACKET_SIZE);
+
+	/* the packet it was written over can't be read any more */
+	assert_false(replay_ring_read(ring, 0, out, PACKET_SIZE));
+
+	/* the ones after it are still there */
+	fill_packet(in, 2);
+	assert_true(replay_ring_read(ring, PACKET_SIZE, out, PACKET_SIZE));
+	assert_memory_equal(in, out, PACKET_SIZE);
+
+	/* and are lost in turn as the ring keeps going around */
+	fill_packet(in, 5);
+	pos = replay_ring_write(ring, in, PACKET_SIZE);
+	assert_int_equal(pos, RING_SIZE + PACKET_SIZE);
+	assert_false(replay_ring_read(ring, PACKET_SIZE, out, PACKET_SIZE));
+	assert_true(replay_ring_read(ring, PACKET_SIZE * 2, out,
+				     PACKET_SIZE));
+	assert_true(replay_ring_read(ring, pos, out, PACKET_SIZE));
+	assert_memory_equal(in, out, PACKET_SIZE);
+
+	replay_ring_release(ring);
+}
+
+static void replay_ring_ref_test(void **state)
+{
+	struct replay_ring *ring = create_ring();
+	uint8_t in[PACKET_SIZE];
+	uint8_t out[PACKET_SIZE];
+
+	fill_packet(in, 1);
+	replay_ring_write(ring, in, PACKET_SIZE);
+
+	/* a save keeps the ring mapped after the output lets go of it */
+	replay_ring_addref(ring);
+	replay_ring_release(ring);
+
+	assert_true(replay_ring_read(ring, 0, out, PACKET_SIZE));
+	assert_memory_equal(in, out, PACKET_SIZE);
+
+	replay_ring_release(ring);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(replay_ring_basic_test),
+		cmocka_unit_test(replay_ring_wrap_test),
+		cmocka_unit_test(replay_ring_ref_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,95 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/spsc-queue.h>
+
+#define CAPACITY 4
+
+static void *item(size_t i)
+{
+	return (void *)(uintptr_t)(i + 1);
+}
+
+static void spsc_queue_empty_test(void **state)
+{
+	struct spsc_queue q;
+	spsc_queue_init(&q, CAPACITY);
+
+	assert_int_equal(spsc_queue_size(&q), 0);
+	assert_null(spsc_queue_pop(&q));
+
+	assert_true(spsc_queue_push(&q, item(0)));
+	assert_ptr_equal(spsc_queue_pop(&q), item(0));
+
+	/* popping doesn't go past what was pushed */
+	assert_int_equal(spsc_queue_size(&q), 0);
+	assert_null(spsc_queue_pop(&q));
+
+	spsc_queue_free(&q);
+}
+
+static void spsc_queue_full_test(void **state)
+{
+	struct spsc_queue q;
+	spsc_queue_init(&q, CAPACITY);
+
+	for (size_t i = 0; i < CAPACITY; i++)
+		assert_true(spsc_queue_push(&q, item(i)));
+
+	/* every slot is used, a full queue isn't mistaken for an empty one */
+	assert_int_equal(spsc_queue_size(&q), CAPACITY);
+	assert_false(spsc_queue_push(&q, item(CAPACITY)));
+	assert_int_equal(spsc_queue_size(&q), CAPACITY);
+
+	assert_ptr_equal(spsc_queue_pop(&q), item(0));
+	assert_true(spsc_queue_push(&q, item(CAPACITY)));
+	assert_false(spsc_queue_push(&q, item(CAPACITY + 1)));
+
+	for (size_t i = 1; i <= CAPACITY; i++)
+		assert_ptr_equal(spsc_queue_pop(&q), item(i));
+	assert_null(spsc_queue_pop(&q));
+
+	spsc_queue_free(&q);
+}
+
+static void spsc_queue_wrap_test(void **state)
+{
+	struct spsc_queue q;
+	size_t pushed = 0;
+	size_t popped = 0;
+
+	spsc_queue_init(&q, CAPACITY);
+
+	/* go around the positions several times at every fill level */
+	for (size_t round = 0; round < CAPACITY * 8; round++) {
+		size_t fill = round % (CAPACITY + 1);
+
+		while (spsc_queue_size(&q) < fill)
+			assert_true(spsc_queue_push(&q, item(pushed++)));
+
+		assert_int_equal(spsc_queue_size(&q), fill);
+		assert_int_equal(spsc_queue_push(&q, item(pushed)),
+				 fill < CAPACITY);
+		if (fill < CAPACITY)
+			pushed++;
+
+		while (popped < pushed)
+			assert_ptr_equal(spsc_queue_pop(&q), item(popped++));
+		assert_null(spsc_queue_pop(&q));
+	}
+
+	spsc_queue_free(&q);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(spsc_queue_empty_test),
+		cmocka_unit_test(spsc_queue_full_test),
+		cmocka_unit_test(spsc_queue_wrap_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}